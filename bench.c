@@ -0,0 +1,939 @@
+/* * * * * * * * *
+ * Benchmark program that measures the throughput of the various hash table
+ * types by calling the hashtbl.h functions directly (without the overhead of
+ * parsing commands and printing results in the interpreter)
+ *
+ * usage:
+ *   make bench
+ *   ./bench [-r repetitions] [-w warmups] [-j] mode [nkeys] [type ...]
+ *       -r: how many times the suite times each table (default 5)
+ *       -w: how many untimed runs the suite makes of each table first
+ *           (default 1)
+ *       -j: write the suite's results as JSON instead of CSV
+ *       mode: which benchmark to run (see below)
+ *       nkeys: number of distinct keys to use (default 10000)
+ *       type: table types to benchmark, as for a2 -t (default all of them)
+ *
+ * modes:
+ *   get: put nkeys keys with values into a hash map, then get every key
+ *   str: insert nkeys short string keys (user names, emails, url paths and
+ *        session tokens) into a string table, then look up each of them and
+ *        nkeys strings that aren't there
+ *   batch: insert nkeys keys into a hash table, then look up nkeys of them in
+ *          random order (hits) and nkeys keys that aren't there (misses),
+ *          one at a time and then in batches of 1, 2, 4, ... 256 keys
+ *   load: build a hash table holding nkeys keys, first by inserting them one
+ *         at a time and then with the bulk-load constructor
+ *   scan: put nkeys keys with values into a hash map, then visit every entry
+ *         by getting each key, with hash_table_foreach and with a cursor
+ *   disk: insert nkeys keys into a disk-resident xtndbln table whose buffer
+ *         pool holds 1/2 and then 1/10 of its pages, then look up each key
+ *         (in random order) and nkeys keys that aren't there, compared with
+ *         an in-memory xtndbln table (other types are skipped)
+ *   memory: insert nkeys keys into a hash table, printing the bytes it uses
+ *           (in total, per key, and split between directory and buckets)
+ *           each time the number of keys doubles, from 16 up to nkeys
+ *   threads: fill a sharded hash table with nkeys keys, then have 1, 2, 4, ...
+ *            threads (up to the number of CPUs) each run nkeys operations on
+ *            it at once (90% lookups, 10% inserts), first with a mutex per
+ *            shard and then with a reader-writer lock per shard
+ *   suite: for 1000, 10000, ... keys up to nkeys, and each load level
+ *          (max_load) of the table types that have one, time inserting the
+ *          keys into a fresh table, looking each of them up (in scrambled
+ *          order) and looking up as many keys that aren't there, repeatedly,
+ *          and print the median and standard deviation of each throughput
+ *          with the bytes the table used, one CSV row (or JSON object) for
+ *          each table
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "inthash.h"
+#include "hashtbl.h"
+
+#define DEFAULT_NKEYS 10000
+#define INITIAL_SIZE 4
+#define MAX_STR_LEN 48
+#define MAX_BATCH 256
+
+// the files the disk benchmark keeps its table in (in the current directory)
+#define DISK_PATH "bench-disk"
+#define DISK_PAGE_KEYS 510	// how many keys fit in each 4 KB disk bucket
+#define DISK_PAGE_FILL 0.69	// how full extendible buckets are on average
+
+// the shape of the threads benchmark
+#define THREAD_SHARD_BITS 6	// 64 shards
+#define MAX_THREADS 32
+#define LOOKUP_PERCENT 90
+
+// the shape of the suite
+#define SUITE_MIN_KEYS 1000
+#define DEFAULT_REPETITIONS 5
+#define DEFAULT_WARMUPS 1
+#define SCRAMBLE_STRIDE 2147483647	// (prime, so it steps through any
+									// number of keys below it in full)
+
+// the load levels the suite runs LINEAR and CUCKOO tables at (the others
+// grow by splitting buckets, whatever their load)
+static double suite_loads[] = { 0.5, 0.75, 1 };
+#define NLOADS (sizeof suite_loads / sizeof *suite_loads)
+
+// the names of every table type, in TableType order
+static char *typenames[] = {
+	"linear", "xtndbl1", "cuckoo", "xtndbln", "xuckoo", "xuckoon"
+};
+#define NTYPES (sizeof typenames / sizeof *typenames)
+
+// the i-th benchmark key: distinct for all i, and always below both hash
+// function primes so no two keys ever share both of their hash values
+// (a full collision would make the single-key extendible tables split forever)
+static int64 bench_key(int64 i) {
+	return (i * 2654435761ULL) % 2147483563ULL;
+}
+
+// seconds of CPU time elapsed since 'start'
+static double seconds_since(clock_t start) {
+	return (clock() - start) * 1.0 / CLOCKS_PER_SEC;
+}
+
+// seconds of real time elapsed since 'start' (for benchmarks that wait on
+// the disk, which CPU time wouldn't count)
+static double wall_seconds_since(struct timespec start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// operations per second, guarding against timings too short to measure
+static double ops_per_sec(int nops, double seconds) {
+	return seconds > 0 ? nops / seconds : 0;
+}
+
+// a small xorshift pseudo-random number generator, so that every run of the
+// benchmark uses exactly the same workload
+static int64 rng_state = 88172645463325252ULL;
+static int64 next_random() {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+// write a random lowercase word of 'min' to 'max' letters into 'str'
+static int random_word(char *str, int min, int max) {
+	int len = min + next_random() % (max - min + 1), i;
+	for (i = 0; i < len; i++) {
+		str[i] = 'a' + next_random() % 26;
+	}
+	str[len] = '\0';
+	return len;
+}
+
+// write the i-th benchmark string into 'str', returning its length. strings
+// are shaped like the identifiers real services use as keys, cycling through
+// user names, email addresses, url paths and hexadecimal session tokens.
+// the i suffix keeps the strings distinct
+static int bench_string(char *str, int i) {
+	char word[16], domain[16];
+	random_word(word, 3, 10);
+	switch (i % 4) {
+		case 0:
+			return sprintf(str, "%s%d", word, i);
+		case 1:
+			random_word(domain, 4, 8);
+			return sprintf(str, "%s.%d@%s.com", word, i, domain);
+		case 2:
+			return sprintf(str, "/api/v1/%s/%d", word, i);
+		default:
+			return sprintf(str, "%08llx%08x", next_random() & 0xffffffff, i);
+	}
+}
+
+/*************************************************************************/
+
+// put 'nkeys' keys into a hash map of type 'type', then time a get of each
+static void bench_get(TableType type, int nkeys) {
+	HashTable *table = new_hash_map(type, INITIAL_SIZE);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		hash_table_put(table, bench_key(i), i);
+	}
+
+	// get every key back, checking the values so the work can't be skipped
+	int64 value, sum = 0;
+	clock_t start = clock();
+	for (i = 0; i < nkeys; i++) {
+		if (hash_table_get(table, bench_key(i), &value)) {
+			sum += value;
+		}
+	}
+	double seconds = seconds_since(start);
+	assert(sum == (int64)nkeys * (nkeys - 1) / 2 && "error: wrong values!");
+
+	printf(" %9s | %9d | %14.0f\n", typenames[type], nkeys,
+		ops_per_sec(nkeys, seconds));
+	free_hash_table(table);
+}
+
+// insert 'nkeys' strings into a string table of type 'type', then time
+// looking up each of them (hits) and 'nkeys' strings never inserted (misses)
+static void bench_str(TableType type, int nkeys) {
+	HashTable *table = new_string_hash_table(type, INITIAL_SIZE);
+	if (table == NULL) {
+		return; // no string keys for this table type
+	}
+
+	// generate the strings up front, so we only time the table: the first
+	// nkeys are inserted, the rest are only used for missing lookups
+	char *strs = malloc((int64)nkeys * 2 * MAX_STR_LEN);
+	int *lens = malloc(sizeof *lens * nkeys * 2);
+	assert(strs && lens);
+	int i;
+	int64 bytes = 0;
+	rng_state = 88172645463325252ULL;
+	for (i = 0; i < nkeys * 2; i++) {
+		lens[i] = bench_string(&strs[(int64)i * MAX_STR_LEN], i);
+		bytes += i < nkeys ? lens[i] : 0;
+	}
+
+	clock_t start = clock();
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert_str(table, &strs[(int64)i * MAX_STR_LEN], lens[i]);
+	}
+	double insert_seconds = seconds_since(start);
+
+	int found = 0;
+	start = clock();
+	for (i = 0; i < nkeys; i++) {
+		found += hash_table_lookup_str(table, &strs[(int64)i * MAX_STR_LEN],
+			lens[i]);
+	}
+	double hit_seconds = seconds_since(start);
+	assert(found == nkeys && "error: inserted string not found!");
+
+	start = clock();
+	for (i = nkeys; i < nkeys * 2; i++) {
+		found += hash_table_lookup_str(table, &strs[(int64)i * MAX_STR_LEN],
+			lens[i]);
+	}
+	double miss_seconds = seconds_since(start);
+	assert(found == nkeys && "error: missing string found!");
+
+	printf(" %9s | %9d | %7.1f | %14.0f | %14.0f | %14.0f\n",
+		typenames[type], nkeys, bytes * 1.0 / nkeys,
+		ops_per_sec(nkeys, insert_seconds), ops_per_sec(nkeys, hit_seconds),
+		ops_per_sec(nkeys, miss_seconds));
+
+	free(strs);
+	free(lens);
+	free_hash_table(table);
+}
+
+// time looking up the 'n' keys in 'keys' in 'table' one at a time if 'batch'
+// is 0, or in batches of 'batch' keys otherwise. returns the number found
+static int time_lookups(HashTable *table, int64 *keys, int n, int batch,
+	double *seconds) {
+	bool results[MAX_BATCH];
+	int found = 0, i, j, m;
+	clock_t start = clock();
+	if (batch == 0) {
+		for (i = 0; i < n; i++) {
+			found += hash_table_lookup(table, keys[i]);
+		}
+	} else {
+		for (i = 0; i < n; i += batch) {
+			m = n - i < batch ? n - i : batch;
+			hash_table_lookup_batch(table, &keys[i], m, results);
+			for (j = 0; j < m; j++) {
+				found += results[j];
+			}
+		}
+	}
+	*seconds = seconds_since(start);
+	return found;
+}
+
+// insert 'nkeys' keys into a hash table of type 'type', then time looking up
+// each of them in random order (hits), and 'nkeys' keys never inserted
+// (misses), first one key at a time and then with every batch size
+static void bench_batch(TableType type, int nkeys) {
+	HashTable *table = new_hash_table(type, INITIAL_SIZE);
+	int64 *hits = malloc(sizeof *hits * nkeys);
+	int64 *misses = malloc(sizeof *misses * nkeys);
+	assert(hits && misses);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert(table, bench_key(i));
+		hits[i] = bench_key(i);
+		misses[i] = bench_key(nkeys + i);
+	}
+
+	// shuffle the hits so they don't follow insertion order
+	rng_state = 88172645463325252ULL;
+	for (i = nkeys - 1; i > 0; i--) {
+		int j = next_random() % (i + 1);
+		int64 tmp = hits[i];
+		hits[i] = hits[j];
+		hits[j] = tmp;
+	}
+
+	// batch size 0 means one key at a time, without the batch functions
+	int batch;
+	double hit_seconds, miss_seconds;
+	for (batch = 0; batch <= MAX_BATCH; batch = batch ? batch * 2 : 1) {
+		int found = time_lookups(table, hits, nkeys, batch, &hit_seconds);
+		assert(found == nkeys && "error: inserted key not found!");
+		found = time_lookups(table, misses, nkeys, batch, &miss_seconds);
+		assert(found == 0 && "error: missing key found!");
+
+		if (batch == 0) {
+			printf(" %9s | %9d |   scalar", typenames[type], nkeys);
+		} else {
+			printf(" %9s | %9d | %8d", typenames[type], nkeys, batch);
+		}
+		printf(" | %14.0f | %14.0f\n", ops_per_sec(nkeys, hit_seconds),
+			ops_per_sec(nkeys, miss_seconds));
+	}
+
+	free(hits);
+	free(misses);
+	free_hash_table(table);
+}
+
+// time building a table of type 'type' holding 'nkeys' keys, first by
+// inserting each key into an empty table (as when starting up from scratch)
+// and then by bulk-loading the whole array of keys at once
+static void bench_load(TableType type, int nkeys) {
+	int64 *keys = malloc(sizeof *keys * nkeys);
+	assert(keys);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		keys[i] = bench_key(i);
+	}
+
+	clock_t start = clock();
+	HashTable *table = new_hash_table(type, INITIAL_SIZE);
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert(table, keys[i]);
+	}
+	double insert_seconds = seconds_since(start);
+	free_hash_table(table);
+
+	start = clock();
+	table = new_hash_table_from_keys(type, INITIAL_SIZE, keys, nkeys);
+	double load_seconds = seconds_since(start);
+
+	// make sure the bulk-loaded table really holds every key
+	for (i = 0; i < nkeys; i++) {
+		assert(hash_table_lookup(table, keys[i]) && "error: key not loaded!");
+	}
+
+	printf(" %9s | %9d | %15.6f | %12.6f | %7.2fx\n", typenames[type], nkeys,
+		insert_seconds, load_seconds,
+		load_seconds > 0 ? insert_seconds / load_seconds : 0);
+
+	free(keys);
+	free_hash_table(table);
+}
+
+// time inserting the 'nkeys' keys of 'keys' into 'table', then looking up
+// each of them in 'order' (hits) and 'nkeys' keys never inserted (misses),
+// printing a row labelled 'label' with 'npages' buffer pool pages
+static void time_disk_ops(HashTable *table, char *label, int npages,
+	int64 *keys, int64 *order, int nkeys) {
+	int i, found = 0;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert(table, keys[i]);
+	}
+	double insert_seconds = wall_seconds_since(start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		found += hash_table_lookup(table, order[i]);
+	}
+	double hit_seconds = wall_seconds_since(start);
+	assert(found == nkeys && "error: inserted key not found!");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		found -= hash_table_lookup(table, bench_key(nkeys + i));
+	}
+	double miss_seconds = wall_seconds_since(start);
+	assert(found == nkeys && "error: missing key found!");
+
+	printf(" %16s | %9d | %10d | %14.0f | %14.0f | %14.0f\n", label, nkeys,
+		npages, ops_per_sec(nkeys, insert_seconds),
+		ops_per_sec(nkeys, hit_seconds), ops_per_sec(nkeys, miss_seconds));
+}
+
+// time 'nkeys' inserts, hits and misses on a disk-resident xtndbln table with
+// a buffer pool holding 1/2 and then 1/10 of the pages those keys will need,
+// and on an in-memory xtndbln table with the same bucket size
+static void bench_disk(TableType type, int nkeys) {
+	if (type != XTNDBLN) {
+		return;
+	}
+
+	int64 *keys = malloc(sizeof *keys * nkeys);
+	int64 *order = malloc(sizeof *order * nkeys);
+	assert(keys && order);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		keys[i] = order[i] = bench_key(i);
+	}
+	rng_state = 88172645463325252ULL;
+	for (i = nkeys - 1; i > 0; i--) {
+		int j = next_random() % (i + 1);
+		int64 tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	HashTable *table = new_hash_table(XTNDBLN, DISK_PAGE_KEYS);
+	time_disk_ops(table, "xtndbln (memory)", 0, keys, order, nkeys);
+	free_hash_table(table);
+
+	// size each buffer pool relative to the working set: every page the
+	// keys will end up in
+	int working_set = nkeys / (DISK_PAGE_KEYS * DISK_PAGE_FILL) + 1;
+	int ratios[] = { 2, 10 };
+	int r;
+	for (r = 0; r < sizeof ratios / sizeof *ratios; r++) {
+		int npages = working_set / ratios[r];
+		npages = npages < 2 ? 2 : npages;
+		char label[32];
+		sprintf(label, "disk (set %dx)", ratios[r]);
+
+		// start from empty files every time
+		remove(DISK_PATH ".pages");
+		remove(DISK_PATH ".dir");
+		table = new_disk_hash_table(DISK_PATH, npages);
+		assert(table && "error: can't create disk table files!");
+		time_disk_ops(table, label, npages, keys, order, nkeys);
+		free_hash_table(table);
+	}
+	remove(DISK_PATH ".pages");
+	remove(DISK_PATH ".dir");
+
+	free(keys);
+	free(order);
+}
+
+// the running totals kept while scanning a table
+typedef struct scan_totals {
+	int nkeys;
+	int64 sum;
+} ScanTotals;
+
+// foreach callback adding each entry to the ScanTotals in 'ctx'
+static void add_entry(int64 key, int64 value, void *ctx) {
+	ScanTotals *totals = ctx;
+	totals->nkeys++;
+	totals->sum += value;
+}
+
+// put 'nkeys' keys into a hash map of type 'type', then time visiting every
+// entry: by getting each key in turn (as a caller without a scan would have
+// to), with hash_table_foreach, and with a cursor
+static void bench_scan(TableType type, int nkeys) {
+	HashTable *table = new_hash_map(type, INITIAL_SIZE);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		hash_table_put(table, bench_key(i), i);
+	}
+	int64 expected = (int64)nkeys * (nkeys - 1) / 2;
+
+	int64 key, value, sum = 0;
+	clock_t start = clock();
+	for (i = 0; i < nkeys; i++) {
+		if (hash_table_get(table, bench_key(i), &value)) {
+			sum += value;
+		}
+	}
+	double get_seconds = seconds_since(start);
+	assert(sum == expected && "error: wrong values!");
+
+	ScanTotals totals = { 0, 0 };
+	start = clock();
+	hash_table_foreach(table, add_entry, &totals);
+	double foreach_seconds = seconds_since(start);
+	assert(totals.nkeys == nkeys && totals.sum == expected
+		&& "error: foreach missed entries!");
+
+	Cursor cursor = CURSOR_START;
+	totals.nkeys = 0;
+	totals.sum = 0;
+	start = clock();
+	while (hash_table_next(table, &cursor, &key, &value)) {
+		totals.nkeys++;
+		totals.sum += value;
+	}
+	double cursor_seconds = seconds_since(start);
+	assert(totals.nkeys == nkeys && totals.sum == expected
+		&& "error: cursor missed entries!");
+
+	printf(" %9s | %9d | %14.0f | %14.0f | %14.0f\n", typenames[type], nkeys,
+		ops_per_sec(nkeys, get_seconds), ops_per_sec(nkeys, foreach_seconds),
+		ops_per_sec(nkeys, cursor_seconds));
+	free_hash_table(table);
+}
+
+// insert 'nkeys' keys into a hash table of type 'type', printing how much
+// memory it uses after 16, 32, 64, ... keys and after the last key
+static void bench_memory(TableType type, int nkeys) {
+	HashTable *table = new_hash_table(type, INITIAL_SIZE);
+	int i, next = 16;
+	for (i = 1; i <= nkeys; i++) {
+		hash_table_insert(table, bench_key(i - 1));
+		if (i == next || i == nkeys) {
+			MemoryUsage usage;
+			size_t total = hash_table_memory_usage(table, &usage);
+			printf(" %9s | %9d | %12zu | %9.1f | %12zu | %12zu | %12zu\n",
+				typenames[type], i, total, total * 1.0 / i, usage.directory,
+				usage.buckets, usage.slack);
+			next *= 2;
+		}
+	}
+	free_hash_table(table);
+}
+
+// what each thread of the threads benchmark is given to do
+typedef struct worker {
+	HashTable *table;	// the sharded table all the threads share
+	int id;				// which thread this is, from 0
+	int nops;			// how many operations to run
+	int nkeys;			// how many keys the table was filled with
+	int found;			// how many lookups found their key (the result)
+} Worker;
+
+// run one thread's share of the threads benchmark: lookups of random keys
+// (half of which are in the table) mixed with inserts of keys no other
+// thread inserts
+static void *run_worker(void *arg) {
+	Worker *worker = arg;
+	int64 state = 88172645463325252ULL + worker->id;
+	int i, found = 0;
+	for (i = 0; i < worker->nops; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		if (state % 100 < LOOKUP_PERCENT) {
+			found += hash_table_lookup(worker->table,
+				bench_key(state % (2 * worker->nkeys)));
+		} else {
+			hash_table_insert(worker->table,
+				bench_key(worker->nkeys * (2 + worker->id) + i));
+		}
+	}
+	worker->found = found;
+	return NULL;
+}
+
+// fill a sharded table of type 'type' with 'nkeys' keys, then time 'nthreads'
+// threads each running 'nkeys' operations on it at once, returning the
+// combined operations per second of real time
+static double time_threads(TableType type, int nkeys, int nthreads,
+	bool rwlocks) {
+	HashTable *table = new_sharded_hash_table(type, INITIAL_SIZE,
+		THREAD_SHARD_BITS, rwlocks);
+	int i;
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert(table, bench_key(i));
+	}
+
+	Worker workers[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nthreads; i++) {
+		workers[i] = (Worker){ table, i, nkeys, nkeys, 0 };
+		pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+	}
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	double seconds = wall_seconds_since(start);
+
+	free_hash_table(table);
+	return ops_per_sec(nkeys * nthreads, seconds);
+}
+
+// time a sharded table of type 'type' used by 1, 2, 4, ... threads at once
+// (up to the number of CPUs), with mutexes and then with rwlocks
+static void bench_threads(TableType type, int nkeys) {
+	int ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int max_threads = ncpus < 1 ? 1 : ncpus > MAX_THREADS ? MAX_THREADS : ncpus;
+
+	int r;
+	for (r = 0; r < 2; r++) {
+		bool rwlocks = r == 1;
+		double single = 0;
+		int nthreads;
+		for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+			double ops = time_threads(type, nkeys, nthreads, rwlocks);
+			if (nthreads == 1) {
+				single = ops;
+			}
+			printf(" %9s | %6s | %7d | %9d | %14.0f | %7.2fx\n",
+				typenames[type], rwlocks ? "rwlock" : "mutex", nthreads, nkeys,
+				ops, single > 0 ? ops / single : 0);
+		}
+	}
+}
+
+// how the suite runs each table, from the command line
+static int repetitions = DEFAULT_REPETITIONS;
+static int warmups = DEFAULT_WARMUPS;
+static bool json = false;
+static bool first_result = true;	// (for separating JSON objects)
+
+// the median and standard deviation of some repeated measurements
+typedef struct spread {
+	double median;
+	double stddev;
+} Spread;
+
+// how one table did in the suite
+typedef struct suite_result {
+	Spread insert, hit, miss;	// (operations per second)
+	size_t bytes;
+} SuiteResult;
+
+// compare doubles, for sorting them
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// the median and (sample) standard deviation of the 'n' numbers in 'samples'
+// (which are sorted as a side effect)
+static Spread spread_of(double *samples, int n) {
+	double mean = 0, squares = 0;
+	int i;
+	for (i = 0; i < n; i++) {
+		mean += samples[i] / n;
+	}
+	for (i = 0; i < n; i++) {
+		squares += (samples[i] - mean) * (samples[i] - mean);
+	}
+	qsort(samples, n, sizeof *samples, compare_doubles);
+	Spread spread = { n % 2 ? samples[n / 2]
+		: (samples[n / 2 - 1] + samples[n / 2]) / 2,
+		n > 1 ? sqrt(squares / (n - 1)) : 0 };
+	return spread;
+}
+
+// time inserting 'nkeys' keys into a fresh table set up as 'config' says,
+// then looking up every one of them (in scrambled order, without storing
+// them) and 'nkeys' keys never inserted, storing the operations per second
+// of each at 'rates' and returning the bytes the table used
+static size_t time_suite_run(HashTableConfig *config, int nkeys,
+	double *rates) {
+	HashTable *table = new_hash_table_ex(config);
+	int i, found = 0;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		hash_table_insert(table, bench_key(i));
+	}
+	rates[0] = ops_per_sec(nkeys, wall_seconds_since(start));
+
+	// step through the keys SCRAMBLE_STRIDE at a time, wrapping around, to
+	// visit them all out of order
+	int stride = SCRAMBLE_STRIDE % nkeys, key = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		found += hash_table_lookup(table, bench_key(key));
+		key += stride;
+		if (key >= nkeys) {
+			key -= nkeys;
+		}
+	}
+	rates[1] = ops_per_sec(nkeys, wall_seconds_since(start));
+	assert(found == nkeys && "error: inserted key not found!");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nkeys; i++) {
+		found -= hash_table_lookup(table, bench_key(nkeys + i));
+	}
+	rates[2] = ops_per_sec(nkeys, wall_seconds_since(start));
+	assert(found == nkeys && "error: missing key found!");
+
+	size_t bytes = hash_table_memory_usage(table, NULL);
+	free_hash_table(table);
+	return bytes;
+}
+
+// run a table set up as 'config' says through the suite with 'nkeys' keys:
+// 'warmups' untimed runs and then 'repetitions' timed ones
+static void run_suite_config(HashTableConfig *config, int nkeys,
+	SuiteResult *result) {
+	double *samples = malloc(sizeof *samples * 3 * repetitions), rates[3];
+	assert(samples);
+	int r, op;
+	for (r = 0; r < warmups; r++) {
+		time_suite_run(config, nkeys, rates);
+	}
+	for (r = 0; r < repetitions; r++) {
+		result->bytes = time_suite_run(config, nkeys, rates);
+		for (op = 0; op < 3; op++) {
+			samples[op * repetitions + r] = rates[op];
+		}
+	}
+	result->insert = spread_of(samples, repetitions);
+	result->hit = spread_of(samples + repetitions, repetitions);
+	result->miss = spread_of(samples + 2 * repetitions, repetitions);
+	free(samples);
+}
+
+// run a table set up as 'config' says through the suite in a child process
+// (so that each starts from a fresh heap, and one that fails an assertion,
+// e.g. by growing too large, doesn't end the suite)
+// returns false (after saying why) if the child process didn't finish
+static bool suite_config(HashTableConfig *config, int nkeys,
+	SuiteResult *result) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		perror("error: can't run suite");
+		exit(EXIT_FAILURE);
+	}
+	fflush(stdout);
+	pid_t child = fork();
+	if (child < 0) {
+		perror("error: can't run suite");
+		exit(EXIT_FAILURE);
+	}
+	if (child == 0) {
+		close(fds[0]);
+		run_suite_config(config, nkeys, result);
+		bool sent = write(fds[1], result, sizeof *result) == sizeof *result;
+		_exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	ssize_t got = read(fds[0], result, sizeof *result);
+	close(fds[0]);
+	int status;
+	waitpid(child, &status, 0);
+	if (got == sizeof *result) {
+		return true;
+	}
+	if (WIFSIGNALED(status)) {
+		fprintf(stderr, "error: %s with %d keys failed (killed by signal "
+			"%d)\n", typenames[config->type], nkeys, WTERMSIG(status));
+	} else {
+		fprintf(stderr, "error: %s with %d keys failed (exit status %d)\n",
+			typenames[config->type], nkeys, WEXITSTATUS(status));
+	}
+	return false;
+}
+
+// print how a table of type 'type' did in the suite, as a CSV row or a JSON
+// object ('load' is 0 for types without a load level, and 'result' NULL if
+// the table failed)
+static void print_suite_result(TableType type, int nkeys, double load,
+	SuiteResult *result) {
+	Spread *spreads[3] = { NULL };
+	if (result != NULL) {
+		spreads[0] = &result->insert;
+		spreads[1] = &result->hit;
+		spreads[2] = &result->miss;
+	}
+	char *names[3] = { "insert", "hit", "miss" };
+	int op;
+
+	if (!json) {
+		printf("%s,%d,", typenames[type], nkeys);
+		if (load > 0) {
+			printf("%g", load);
+		}
+		printf(",%s,%d", result ? "ok" : "failed", repetitions);
+		for (op = 0; op < 3; op++) {
+			if (result) {
+				printf(",%.0f,%.0f", spreads[op]->median, spreads[op]->stddev);
+			} else {
+				printf(",,");
+			}
+		}
+		if (result) {
+			printf(",%zu,%.1f\n", result->bytes, result->bytes * 1.0 / nkeys);
+		} else {
+			printf(",,\n");
+		}
+		return;
+	}
+
+	printf("%s  {\"type\": \"%s\", \"keys\": %d, \"max_load\": ",
+		first_result ? "" : ",\n", typenames[type], nkeys);
+	first_result = false;
+	if (load > 0) {
+		printf("%g", load);
+	} else {
+		printf("null");
+	}
+	printf(", \"status\": \"%s\", \"repetitions\": %d",
+		result ? "ok" : "failed", repetitions);
+	if (result) {
+		for (op = 0; op < 3; op++) {
+			printf(", \"%s_ops_per_sec\": {\"median\": %.0f, "
+				"\"stddev\": %.0f}", names[op], spreads[op]->median,
+				spreads[op]->stddev);
+		}
+		printf(", \"bytes\": %zu, \"bytes_per_key\": %.1f", result->bytes,
+			result->bytes * 1.0 / nkeys);
+	}
+	printf("}");
+}
+
+// run tables of type 'type' through the suite with 1000, 10000, ... keys up
+// to 'nkeys' (and 'nkeys' itself), at each load level if the type has them
+static void bench_suite(TableType type, int nkeys) {
+	bool loaded = type == LINEAR || type == CUCKOO;
+	int64 n;
+	for (n = SUITE_MIN_KEYS; n < nkeys * 10LL; n *= 10) {
+		int keys = n < nkeys ? n : nkeys;
+		int l;
+		for (l = 0; l < (loaded ? NLOADS : 1); l++) {
+			HashTableConfig config = default_hash_table_config(type,
+				INITIAL_SIZE);
+			config.stats = STATS_NONE;
+			if (loaded) {
+				config.max_load = suite_loads[l];
+			}
+			SuiteResult result;
+			bool ok = suite_config(&config, keys, &result);
+			print_suite_result(type, keys, loaded ? suite_loads[l] : 0,
+				ok ? &result : NULL);
+		}
+		if (keys == nkeys) {
+			break;
+		}
+	}
+}
+
+/*************************************************************************/
+
+void printusageexit(char *exe) {
+	fprintf(stderr, "usage: %s [-r repetitions] [-w warmups] [-j] mode "
+		"[nkeys] [type ...]\n", exe);
+	fprintf(stderr, " -r: how many times the suite times each table "
+		"(default %d)\n", DEFAULT_REPETITIONS);
+	fprintf(stderr, " -w: how many untimed runs the suite makes first "
+		"(default %d)\n", DEFAULT_WARMUPS);
+	fprintf(stderr, " -j: write the suite's results as JSON instead of CSV\n");
+	fprintf(stderr, " mode: get, str, batch, load, scan, disk, memory, threads "
+		"or suite\n");
+	fprintf(stderr, " nkeys: number of distinct keys (default %d)\n",
+		DEFAULT_NKEYS);
+	fprintf(stderr, " type: table types to run, as for a2 -t (default all)\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	int option;
+	while ((option = getopt(argc, argv, "r:w:j")) != -1) {
+		switch (option) {
+			case 'r':
+				repetitions = atoi(optarg);
+				break;
+			case 'w':
+				warmups = atoi(optarg);
+				break;
+			case 'j':
+				json = true;
+				break;
+			default:
+				printusageexit(argv[0]);
+		}
+	}
+	if (argc - optind < 1 || repetitions < 1 || warmups < 0) {
+		printusageexit(argv[0]);
+	}
+	char *mode = argv[optind];
+	int nkeys = argc - optind > 1 ? atoi(argv[optind + 1]) : DEFAULT_NKEYS;
+	if (nkeys <= 0) {
+		printusageexit(argv[0]);
+	}
+
+	// run every type unless some were listed on the command line
+	bool run[NTYPES] = { false };
+	int i, nlisted = 0;
+	for (i = optind + 2; i < argc; i++) {
+		TableType type = strtotype(argv[i]);
+		if (type == NOTYPE) {
+			printusageexit(argv[0]);
+		}
+		run[type] = true;
+		nlisted++;
+	}
+
+	// choose the benchmark function for this mode, and print its header
+	void (*bench)(TableType type, int nkeys);
+	if (strcmp(mode, "get") == 0) {
+		bench = bench_get;
+		printf("      type |      keys |    get ops/sec\n");
+	} else if (strcmp(mode, "str") == 0) {
+		bench = bench_str;
+		printf("      type |      keys | avg len | insert ops/sec "
+			"|    hit ops/sec |   miss ops/sec\n");
+	} else if (strcmp(mode, "batch") == 0) {
+		bench = bench_batch;
+		printf("      type |      keys |    batch |    hit ops/sec "
+			"|   miss ops/sec\n");
+	} else if (strcmp(mode, "load") == 0) {
+		bench = bench_load;
+		printf("      type |      keys | incremental sec |     bulk sec "
+			"| speedup\n");
+	} else if (strcmp(mode, "scan") == 0) {
+		bench = bench_scan;
+		printf("      type |      keys |    get keys/sec "
+			"| foreach keys/s |  cursor keys/s\n");
+	} else if (strcmp(mode, "disk") == 0) {
+		bench = bench_disk;
+		printf("            table |      keys | pool pages | insert ops/sec "
+			"|    hit ops/sec |   miss ops/sec\n");
+	} else if (strcmp(mode, "memory") == 0) {
+		bench = bench_memory;
+		printf("      type |      keys |  total bytes | bytes/key "
+			"|    directory |      buckets |        slack\n");
+	} else if (strcmp(mode, "threads") == 0) {
+		bench = bench_threads;
+		printf("      type |   lock | threads | keys each |        ops/sec "
+			"| speedup\n");
+	} else if (strcmp(mode, "suite") == 0) {
+		bench = bench_suite;
+		printf(json ? "[\n" : "type,keys,max_load,status,repetitions,"
+			"insert_ops_median,insert_ops_stddev,hit_ops_median,hit_ops_stddev,"
+			"miss_ops_median,miss_ops_stddev,bytes,bytes_per_key\n");
+	} else {
+		printusageexit(argv[0]);
+	}
+
+	int t;
+	for (t = 0; t < NTYPES; t++) {
+		if (nlisted == 0 || run[t]) {
+			bench(t, nkeys);
+		}
+	}
+	if (bench == bench_suite && json) {
+		printf("\n]\n");
+	}
+
+	return 0;
+}
@@ -1,31 +1,177 @@
 /* * * * * * * * *
  * Utility program that generates random input and lookup commands for
  * the hash table interpreter program
- * 
+ *
  * usage:
  *   make cmdgen
- *   ./cmdgen ninserts nlookups > commandfilename
+ *   ./cmdgen [-b] [-d distribution] [-z exponent] [-r ratio] [-m] [-s seed]
+ *       [-k bits] [-c collisions] [-x bits] [-j threads] ninserts nlookups
+ *       > commandfilename
+ *       -b: write the commands in binary form (for a2 -b) instead of text
+ *       -d or --dist: which inserted keys lookups look for (see below)
+ *       -z or --zipf: the exponent of the zipf distribution (default 0.99)
+ *       -r or --hit-ratio: the fraction of lookups that look for a key that
+ *           has been inserted (default 0.5); the rest look for keys that
+ *           never are
+ *       -m or --mix: mix the inserts in among the lookups (spread evenly, in
+ *           the ratio ninserts:nlookups) instead of doing them all first
+ *       -s or --seed: the seed that decides every key and choice, so that
+ *           the same seed always generates the same commands (default: from
+ *           the time, printed to stderr so the run can be repeated)
+ *       -k or --key-bits: uniform and zipf keys are below 2^bits (default
+ *           64, the whole range). -k 21 gives keys that every table type
+ *           can hold: no two keys below 2^21 have h1 or h2 values ending in
+ *           the same 26 bits, all that the largest table can tell apart, so
+ *           even a table with one key per bucket can always split them up
+ *       -c or --collide: make every key collide with the others (see below)
+ *       -x or --bits: how many of the low bits of the hash values colliding
+ *           keys share (default 10)
+ *       -j or --threads: how many threads generate commands (default: one
+ *           per CPU); the commands are the same however many there are
  *       ninserts: number of insert commands to generate
  *       nlookups: number of lookup commands to generate
  *       commandfilename: name of file to store commands in
  *
+ * distributions:
+ *   uniform: inserted keys are spread over the whole key range (see
+ *       --key-bits), and lookups pick any of the keys inserted so far with
+ *       equal chance
+ *   zipf: keys as for uniform, but lookups favour the first keys inserted,
+ *       the k-th of them being looked up in proportion to 1/k^exponent
+ *   sequential: inserted keys are 1, 2, 3, ..., and lookups go through the
+ *       keys inserted so far in order, over and over
+ *
+ * collisions (the keys of every distribution are replaced by these, the
+ * worst case for tables that index by the low bits of the hash value):
+ *   h1: every key's h1 value ends in the same bits
+ *   h2: every key's h2 value ends in the same bits
+ *   both: every key's h1 value and h2 value end in the same bits (found by
+ *       searching, so there are fewer of them: lower --bits for more)
+ *   cycle: keys come in threes, each three sharing the low bits of both
+ *       values (but different bits from every other three), so that each
+ *       three makes a cuckoo cycle until the tables outgrow those bits
+ *
+ * commands are generated in chunks, several at once on their own threads,
+ * and written in order; nothing is kept from one chunk to the next (every
+ * key and choice is worked out from the seed and the command's number), so
+ * any number of commands take the same memory
+ *
  * created for COMP20007 Design of Algorithms - Assignment 2, 2017
  * by Shreyash Patodia and Matt Farrugia
- * 
- * modifications by ...
+ *
+ * modifications by William Liandri (wliandri@student.unimelb.edu.au)
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
+#include <getopt.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "inthash.h"
+#include "commands.h"
+
+#define DEFAULT_ZIPF_EXPONENT 0.99
+#define DEFAULT_HIT_RATIO 0.5
+#define DEFAULT_KEY_BITS 64
+#define DEFAULT_COLLISION_BITS 10
+#define MAX_COLLISION_BITS 20
+
+/* How many commands a thread generates at a time. */
+#define CHUNK_COMMANDS (1 << 16)
+
+/* The most bytes one command takes up: as text, "i ", 20 digits and a
+ * newline (more than any binary command). */
+#define MAX_COMMAND_BYTES 24
+
+/* The ways lookups can choose which inserted key to look for. */
+typedef enum distribution {
+	UNIFORM, ZIPF, SEQUENTIAL
+} Distribution;
+static char *distribution_names[] = { "uniform", "zipf", "sequential" };
+#define NDISTRIBUTIONS 3
+
+/* The ways keys can be made to collide in the tables. */
+typedef enum collision {
+	NO_COLLISIONS, H1_COLLISIONS, H2_COLLISIONS, BOTH_COLLISIONS,
+	CYCLE_COLLISIONS
+} Collision;
+static char *collision_names[] = { "none", "h1", "h2", "both", "cycle" };
+#define NCOLLISIONS 5
+
+/* How many keys make up each cuckoo cycle (one more than fits in the two
+ * places they can all go). */
+#define CYCLE_KEYS 3
+
+/* Everything that decides which commands are generated. */
+typedef struct workload {
+	int64 ninserts;
+	int64 nlookups;
+	Distribution distribution;
+	double exponent;	/* (zipf only) */
+	double hit_ratio;
+	bool mix;
+	int64 seed;
+	int key_bits;	/* (uniform and zipf only) */
+	Collision collision;
+	int bits;		/* (collisions only) */
+
+	/* (worked out from the above by start_workload) */
+	int64 random_base;	/* where random numbers start from */
+	int64 key_base;		/* where keys start from */
+	double zipf_first;	/* the zipf integral at the first rank */
+	double zipf_squeeze;	/* how far off a rank can be without checking */
+	int h1_suffix;		/* the low bits colliding keys' h1 values end in */
+	int h2_suffix;		/* (and their h2 values) */
+	int64 *keys;		/* (both and cycle only) every key, found up front */
+} Workload;
+
+/* Commands generated into memory by a thread of their own, ready to be
+ * written. */
+typedef struct chunk {
+	Workload *workload;
+	int64 first, last;	/* which commands (from first up to last) */
+	char *bytes;		/* (room for CHUNK_COMMANDS) */
+	size_t len;
+	int64 count;
+	pthread_t thread;
+} Chunk;
 
 /*************************************************************************/
 
 void printusageexit(char *exe) {
 	/* Print usage information: */
-	fprintf(stderr, "usage: %s ninserts nlookups > commandfilename\n", exe);
+	fprintf(stderr, "usage: %s [-b] [-d distribution] [-z exponent] "
+		"[-r ratio] [-m] [-s seed] [-k bits] [-c collisions] [-x bits] "
+		"[-j threads] ninserts nlookups > commandfilename\n", exe);
+	fprintf(stderr, " -b: write binary commands (for a2 -b) instead of text\n");
+	fprintf(stderr, " -d, --dist: which inserted keys lookups look for: "
+		"uniform (default), zipf or sequential\n");
+	fprintf(stderr, " -z, --zipf: the exponent of the zipf distribution "
+		"(default %g)\n", DEFAULT_ZIPF_EXPONENT);
+	fprintf(stderr, " -r, --hit-ratio: the fraction of lookups for keys that "
+		"have been inserted (default %g)\n", DEFAULT_HIT_RATIO);
+	fprintf(stderr, " -m, --mix: mix the inserts in among the lookups instead "
+		"of doing them all first\n");
+	fprintf(stderr, " -s, --seed: the seed for every key and choice (default: "
+		"from the time)\n");
+	fprintf(stderr, " -k, --key-bits: uniform and zipf keys are below 2^bits "
+		"(default %d; 21 for keys every table type can hold)\n",
+		DEFAULT_KEY_BITS);
+	fprintf(stderr, " -c, --collide: make keys collide: none (default), h1, "
+		"h2, both or cycle\n");
+	fprintf(stderr, " -x, --bits: how many low bits of the hash values "
+		"colliding keys share (default %d, at most %d)\n",
+		DEFAULT_COLLISION_BITS, MAX_COLLISION_BITS);
+	fprintf(stderr, " -j, --threads: how many threads generate commands "
+		"(default: one per CPU)\n");
 	fprintf(stderr, " ninserts: number of insert commands to generate\n");
 	fprintf(stderr, " nlookups: number of lookup commands to generate\n");
 	fprintf(stderr, " commandfilename: name of file to store commands in\n");
@@ -36,53 +182,504 @@ void printusageexit(char *exe) {
 
 /*************************************************************************/
 
-int main(int argc, char **argv) {
-	int i;
+/* Where binary commands go, if writing them (otherwise NULL). */
+BinaryWriter *binary = NULL;
 
-	/* Get command line arguments. */
-	if (argc < 3) {
-		printusageexit(argv[0]);
+/* Every number from 00 to 99, for writing keys two digits at a time. */
+static const char digit_pairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* Add a command to 'chunk', with argument 'key' if 'argc' is 2. */
+void command(Chunk *chunk, char operation, int argc, int64 key) {
+	char *bytes = chunk->bytes + chunk->len;
+	chunk->count++;
+	if (binary != NULL) {
+		chunk->len += encode_binary_command((unsigned char *)bytes, operation,
+			argc, key);
+		return;
 	}
-	int ninserts  = atoi(argv[1]);
-	int nlookups = atoi(argv[2]);
 
-	/* Seed the random number generator. */
-	srand(time(NULL));
+	/* (as printf("%c %llu\n") would, but much faster: the digits are found
+	 * last first, two at a time) */
+	int n = 0;
+	bytes[n++] = operation;
+	if (argc == 2) {
+		char digits[20];
+		int start = 20;
+		while (key >= 100) {
+			int pair = key % 100 * 2;
+			key /= 100;
+			digits[--start] = digit_pairs[pair + 1];
+			digits[--start] = digit_pairs[pair];
+		}
+		if (key >= 10) {
+			digits[--start] = digit_pairs[key * 2 + 1];
+			digits[--start] = digit_pairs[key * 2];
+		} else {
+			digits[--start] = '0' + key;
+		}
+		bytes[n++] = ' ';
+		memcpy(bytes + n, digits + start, 20 - start);
+		n += 20 - start;
+	}
+	bytes[n++] = '\n';
+	chunk->len += n;
+}
 
-	/* Decide on some random numbers for insertion. */
-	int max = 100 * ninserts + 1;
-	int64 *inserts = malloc(sizeof (int64) * ninserts);
-	for (i = 0; i < ninserts; i++) {
-		inserts[i] = rand() % max;
+/* Write every command in 'chunk' to stdout, and empty it. */
+void write_chunk(Chunk *chunk) {
+	if (binary != NULL) {
+		write_binary_commands(binary, (unsigned char *)chunk->bytes,
+			chunk->len, chunk->count);
+	} else {
+		fwrite(chunk->bytes, 1, chunk->len, stdout);
 	}
+	chunk->len = 0;
+	chunk->count = 0;
+}
+
+/*************************************************************************/
 
-	/* Print insertion commands for these numbers. */
-	for (i = 0; i < ninserts; i++) {
-		printf("i %llu\n", inserts[i]);
+/* Random numbers are worked out from the seed and the number of the command
+ * they're for (rather than drawn one after another), so every command can be
+ * generated on its own. 'n' tells apart the random numbers one command
+ * needs. */
+int64 random_for(Workload *workload, int64 i, int n) {
+	return mix_key(workload->random_base + i * 4 + n);
+}
+
+/* A random number from 0 up to (but not including) 1, made from 'r'. */
+double random_fraction(int64 r) {
+	return (r >> 11) * (1.0 / (1ULL << 53));
+}
+
+/* How many hash values below 'range' end in the low 'bits' bits 'suffix'. */
+int64 suffix_values(int64 range, int bits, int suffix) {
+	return (range - suffix + (1LL << bits) - 1) >> bits;
+}
+
+/* How many keys have an h1 value (or h2 value, if 'second') ending in the
+ * workload's low bits 'suffix'. */
+int64 suffix_keys(Workload *workload, bool second, int suffix) {
+	return suffix_values(second ? H2_RANGE : H1_RANGE, workload->bits, suffix)
+		* HASH_PREIMAGES;
+}
+
+/* The i-th key (for i below suffix_keys) whose h1 value (or h2 value, if
+ * 'second') ends in the workload's low bits 'suffix': each hash value ending
+ * in them in turn, then each again with the next key that hashes to it. */
+int64 suffix_key(Workload *workload, bool second, int suffix, int64 i) {
+	int64 values = suffix_keys(workload, second, suffix) / HASH_PREIMAGES;
+	int hash = suffix + ((i % values) << workload->bits);
+	return second ? h2_key(hash, i / values) : h1_key(hash, i / values);
+}
+
+/* Find the first 'n' keys whose h1 and h2 values both end in the workload's
+ * suffixes, by trying every key whose h1 value does.
+ * returns false if there aren't that many */
+bool find_both_collisions(Workload *workload, int64 *keys, int64 n) {
+	int64 mask = (1LL << workload->bits) - 1, found = 0, i;
+	int64 candidates = suffix_keys(workload, false, workload->h1_suffix);
+	for (i = 0; i < candidates && found < n; i++) {
+		int64 key = suffix_key(workload, false, workload->h1_suffix, i);
+		if ((h2(key) & mask) == workload->h2_suffix) {
+			keys[found++] = key;
+		}
 	}
+	return found == n;
+}
 
+/* Find 'n' keys in threes (the last maybe cut short), each three with h1 and
+ * h2 values ending in the same low bits: three number g tries the keys whose
+ * h1 values end in its own bits (and, once every ending has been used, the
+ * next keys hashing to them), sorting them by the end of their h2 value until
+ * three share it.
+ * returns false if there aren't that many */
+bool find_cycle_collisions(Workload *workload, int64 *keys, int64 n) {
+	int64 size = 1LL << workload->bits, mask = size - 1, g, i;
+	int64 *seen = calloc(size, sizeof *seen);	/* (by three number + 1) */
+	int64 *first = malloc(size * (CYCLE_KEYS - 1) * sizeof *first);
+	int *count = malloc(size * sizeof *count);
+	assert(seen && first && count);
 
-	/* Print lookup commands. Some will succeed, others will fail. */
-	for (i = 0; i < nlookups; i++) {
-		
-		/* Flip a coin to decide whether to use an existing key or a new one. */
-		int64 lookup;
-		if (rand() % 2) {
-			/* Use a random existing key */
-			lookup = inserts[rand() % ninserts];
-		
-		} else {
-			/* Generate a new random key */
-			lookup = rand() % max;
+	bool found = true;
+	for (g = 0; g * CYCLE_KEYS < n && found; g++) {
+		int suffix = (workload->h1_suffix + g) & mask;
+		int n_key = g >> workload->bits;
+		int64 values = suffix_values(H1_RANGE, workload->bits, suffix);
+		if (n_key >= HASH_PREIMAGES) {
+			found = false;
+			break;
+		}
+		for (i = 0; i < values; i++) {
+			int64 key = h1_key(suffix + (i << workload->bits), n_key);
+			int64 end = h2(key) & mask;
+			if (seen[end] != g + 1) {
+				seen[end] = g + 1;
+				count[end] = 0;
+			}
+			if (count[end] < CYCLE_KEYS - 1) {
+				first[end * (CYCLE_KEYS - 1) + count[end]++] = key;
+				continue;
+			}
+
+			/* Three share it: they're the next keys. */
+			int64 k, start = g * CYCLE_KEYS;
+			for (k = 0; k < CYCLE_KEYS && start + k < n; k++) {
+				keys[start + k] = k < CYCLE_KEYS - 1
+					? first[end * (CYCLE_KEYS - 1) + k] : key;
+			}
+			break;
+		}
+		found = i < values;
+	}
+
+	free(seen);
+	free(first);
+	free(count);
+	return found;
+}
+
+/* Scramble the low 'bits' bits of 'x' (bits < 64) into a number below
+ * 2^bits, as mix_key does for all 64: multiplying by an odd number and xoring
+ * in the high bits shifted down can both be undone within those bits, so no
+ * two numbers below 2^bits give the same result. */
+int64 mix_bits(int64 x, int bits) {
+	int64 mask = (1ULL << bits) - 1;
+	int shift = (bits + 1) / 2;
+	x &= mask;
+	x = (x ^ (x >> shift)) * 0xbf58476d1ce4e5b9ULL & mask;
+	x = (x ^ (x >> shift)) * 0x94d049bb133111ebULL & mask;
+	return x ^ (x >> shift);
+}
+
+/* The i-th key of the workload: keys 0 up to ninserts-1 are the ones
+ * inserted (in order), and every key after them is one that never is. */
+int64 key_at(Workload *workload, int64 i) {
+	if (workload->keys != NULL) {
+		return workload->keys[i];
+	}
+	if (workload->collision == H1_COLLISIONS) {
+		return suffix_key(workload, false, workload->h1_suffix, i);
+	}
+	if (workload->collision == H2_COLLISIONS) {
+		return suffix_key(workload, true, workload->h2_suffix, i);
+	}
+	if (workload->distribution == SEQUENTIAL) {
+		return i + 1;
+	}
+
+	/* (neither mix_key nor mix_bits gives two numbers the same result, so
+	 * no two keys are the same) */
+	if (workload->key_bits < 64) {
+		return mix_bits(workload->key_base + i, workload->key_bits);
+	}
+	return mix_key(workload->key_base + i);
+}
+
+/* How many keys have been inserted before command number 'i'. */
+int64 inserted_before(Workload *workload, int64 i) {
+	if (!workload->mix) {
+		return i < workload->ninserts ? i : workload->ninserts;
+	}
+
+	/* Mixed inserts are spread evenly among the lookups (starting with
+	 * one). */
+	int64 total = workload->ninserts + workload->nlookups;
+	return (int64)(((unsigned __int128)i * workload->ninserts + total - 1)
+		/ total);
+}
+
+/* The integral of x^-exponent (shifted to be 0 at x = 1), and its inverse,
+ * for drawing from the zipf distribution by rejection-inversion (W. Hormann
+ * and G. Derflinger, "Rejection-inversion to generate variates from monotone
+ * discrete distributions", 1996). */
+double zipf_integral(double x, double exponent) {
+	double log_x = log(x), t = (1 - exponent) * log_x;
+	return (fabs(t) > 1e-8 ? expm1(t) / t : 1 + t / 2) * log_x;
+}
+double zipf_integral_inverse(double x, double exponent) {
+	double t = x * (1 - exponent);
+	if (t < -1) {
+		t = -1;
+	}
+	return exp((fabs(t) > 1e-8 ? log1p(t) / t : 1 - t / 2) * x);
+}
+
+/* A number from 1 to 'n', with k drawn in proportion to 1/k^exponent, made
+ * from the random numbers for command 'i'. */
+int64 zipf_rank(Workload *workload, int64 i, int64 n) {
+	double s = workload->exponent;
+	double last = zipf_integral(n + 0.5, s);
+	int64 r = random_for(workload, i, 2);
+	while (true) {
+		double u = last + random_fraction(r) * (workload->zipf_first - last);
+		double x = zipf_integral_inverse(u, s);
+		int64 k = (int64)(x + 0.5);
+		if (k < 1) {
+			k = 1;
+		} else if (k > n) {
+			k = n;
+		}
+		if (k - x <= workload->zipf_squeeze
+			|| u >= zipf_integral(k + 0.5, s) - exp(-s * log(k))) {
+			return k;
+		}
+
+		/* Rejected (which is rare): try again with another number. */
+		r = mix_key(r);
+	}
+}
+
+/* Work out everything 'workload' needs before generating commands. */
+void start_workload(Workload *workload) {
+	workload->random_base = mix_key(workload->seed);
+	workload->key_base = mix_key(workload->random_base);
+	double s = workload->exponent;
+	workload->zipf_first = zipf_integral(1.5, s) - 1;
+	workload->zipf_squeeze = 2 - zipf_integral_inverse(zipf_integral(2.5, s)
+		- exp(-s * log(2)), s);
+
+	/* Colliding keys share random low bits (and, for both and cycle, are
+	 * found up front). */
+	int64 mask = (1LL << workload->bits) - 1;
+	workload->h1_suffix = random_for(workload, -1, 0) & mask;
+	workload->h2_suffix = random_for(workload, -1, 1) & mask;
+	workload->keys = NULL;
+	int64 nkeys = workload->ninserts + workload->nlookups, available = nkeys;
+	bool enough = true;
+	switch (workload->collision) {
+		case H1_COLLISIONS:
+			available = suffix_keys(workload, false, workload->h1_suffix);
+			break;
+		case H2_COLLISIONS:
+			available = suffix_keys(workload, true, workload->h2_suffix);
+			break;
+		case BOTH_COLLISIONS:
+		case CYCLE_COLLISIONS:
+			workload->keys = malloc(nkeys * sizeof *workload->keys);
+			assert(workload->keys);
+			enough = workload->collision == BOTH_COLLISIONS
+				? find_both_collisions(workload, workload->keys, nkeys)
+				: find_cycle_collisions(workload, workload->keys, nkeys);
+			break;
+		default:
+			break;
+	}
+	if (workload->collision == NO_COLLISIONS
+		&& workload->distribution != SEQUENTIAL && workload->key_bits < 64
+		&& nkeys > 1ULL << workload->key_bits) {
+		fprintf(stderr, "error: not enough keys below 2^%d for %llu keys (try "
+			"more --key-bits)\n", workload->key_bits, nkeys);
+		exit(1);
+	}
+	if (!enough || available < nkeys) {
+		fprintf(stderr, "error: not enough %s collisions in %d bits for %llu "
+			"keys (try fewer --bits)\n", collision_names[workload->collision],
+			workload->bits, nkeys);
+		exit(1);
+	}
+}
+
+/* Generate command number 'i' of the workload. */
+void generate_command(Workload *workload, int64 i, Chunk *chunk) {
+	int64 inserted = inserted_before(workload, i);
+
+	/* It's an insert if it's the one that takes the count of inserted keys
+	 * up by one. */
+	if (inserted_before(workload, i + 1) > inserted) {
+		command(chunk, 'i', 2, key_at(workload, inserted));
+		return;
+	}
+
+	/* Otherwise, it's a lookup: for a key inserted already, or not. */
+	int64 lookup = i - inserted;
+	if (inserted == 0 || random_fraction(random_for(workload, i, 0))
+		>= workload->hit_ratio) {
+		command(chunk, 'l', 2, key_at(workload, workload->ninserts + lookup));
+		return;
+	}
+	int64 index;
+	switch (workload->distribution) {
+		case ZIPF:
+			index = zipf_rank(workload, i, inserted) - 1;
+			break;
+		case SEQUENTIAL:
+			index = lookup % inserted;
+			break;
+		default:
+			index = random_for(workload, i, 1) % inserted;
+			break;
+	}
+	command(chunk, 'l', 2, key_at(workload, index));
+}
+
+/* Generate the commands of 'chunk' (run on a thread of its own). */
+void *generate_chunk(void *arg) {
+	Chunk *chunk = arg;
+	int64 i;
+	for (i = chunk->first; i < chunk->last; i++) {
+		generate_command(chunk->workload, i, chunk);
+	}
+	return NULL;
+}
+
+/* Start generating the next chunks of commands from number *next (of
+ * 'total'), one on each of the 'nchunks' chunks at 'chunks' at most, and
+ * move *next past them.
+ * returns how many were started */
+int start_chunks(Chunk *chunks, int nchunks, int64 *next, int64 total) {
+	int c;
+	for (c = 0; c < nchunks && *next < total; c++) {
+		chunks[c].first = *next;
+		chunks[c].last = total - *next < CHUNK_COMMANDS
+			? total : *next + CHUNK_COMMANDS;
+		*next = chunks[c].last;
+		int error = pthread_create(&chunks[c].thread, NULL, generate_chunk,
+			&chunks[c]);
+		assert(error == 0);
+	}
+	return c;
+}
+
+/*************************************************************************/
+
+int main(int argc, char **argv) {
+	int64 i;
+
+	/* Get command line arguments. */
+	char *exe = argv[0];
+	BinaryWriter writer;
+	Workload workload = { .distribution = UNIFORM,
+		.exponent = DEFAULT_ZIPF_EXPONENT, .hit_ratio = DEFAULT_HIT_RATIO,
+		.mix = false, .seed = time(NULL), .key_bits = DEFAULT_KEY_BITS,
+		.collision = NO_COLLISIONS,
+		.bits = DEFAULT_COLLISION_BITS };
+	bool seeded = false;
+	int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	static struct option long_options[] = {
+		{ "dist", required_argument, NULL, 'd' },
+		{ "zipf", required_argument, NULL, 'z' },
+		{ "hit-ratio", required_argument, NULL, 'r' },
+		{ "mix", no_argument, NULL, 'm' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "key-bits", required_argument, NULL, 'k' },
+		{ "collide", required_argument, NULL, 'c' },
+		{ "bits", required_argument, NULL, 'x' },
+		{ "threads", required_argument, NULL, 'j' },
+		{ NULL, 0, NULL, 0 }
+	};
+	int option;
+	while ((option = getopt_long(argc, argv, "bd:z:r:ms:k:c:x:j:", long_options,
+		NULL)) != -1) {
+		switch (option) {
+			case 'b':
+				binary = &writer;
+				break;
+			case 'd':
+				for (i = 0; i < NDISTRIBUTIONS; i++) {
+					if (strcmp(optarg, distribution_names[i]) == 0) {
+						break;
+					}
+				}
+				if (i == NDISTRIBUTIONS) {
+					printusageexit(exe);
+				}
+				workload.distribution = i;
+				break;
+			case 'z':
+				workload.exponent = atof(optarg);
+				break;
+			case 'r':
+				workload.hit_ratio = atof(optarg);
+				break;
+			case 'm':
+				workload.mix = true;
+				break;
+			case 's':
+				workload.seed = strtoull(optarg, NULL, 10);
+				seeded = true;
+				break;
+			case 'k':
+				workload.key_bits = atoi(optarg);
+				break;
+			case 'c':
+				for (i = 0; i < NCOLLISIONS; i++) {
+					if (strcmp(optarg, collision_names[i]) == 0) {
+						break;
+					}
+				}
+				if (i == NCOLLISIONS) {
+					printusageexit(exe);
+				}
+				workload.collision = i;
+				break;
+			case 'x':
+				workload.bits = atoi(optarg);
+				break;
+			case 'j':
+				nthreads = atoi(optarg);
+				break;
+			default:
+				printusageexit(exe);
+		}
+	}
+	if (argc - optind < 2 || workload.exponent <= 0
+		|| workload.hit_ratio < 0 || workload.hit_ratio > 1
+		|| workload.key_bits < 1 || workload.key_bits > 64
+		|| workload.bits < 1 || workload.bits > MAX_COLLISION_BITS
+		|| nthreads < 1) {
+		printusageexit(exe);
+	}
+	workload.ninserts = strtoull(argv[optind], NULL, 10);
+	workload.nlookups = strtoull(argv[optind + 1], NULL, 10);
+	if (!seeded) {
+		fprintf(stderr, "seed: %llu\n", workload.seed);
+	}
+	start_workload(&workload);
+	if (binary != NULL) {
+		start_binary_commands(binary, stdout);
+	}
+
+	/* Print the insert and lookup commands, in order: two sets of chunks
+	 * take turns, one being written while the other is generated. */
+	Chunk *chunks = calloc(2 * nthreads, sizeof *chunks);
+	assert(chunks);
+	int c, set, started[2];
+	for (c = 0; c < 2 * nthreads; c++) {
+		chunks[c].workload = &workload;
+		chunks[c].bytes = malloc(CHUNK_COMMANDS * MAX_COMMAND_BYTES);
+		assert(chunks[c].bytes);
+	}
+	int64 total = workload.ninserts + workload.nlookups, next = 0;
+	started[0] = start_chunks(chunks, nthreads, &next, total);
+	for (set = 0; started[set] > 0; set = !set) {
+		started[!set] = start_chunks(chunks + !set * nthreads, nthreads,
+			&next, total);
+		for (c = set * nthreads; c < set * nthreads + started[set]; c++) {
+			pthread_join(chunks[c].thread, NULL);
+			write_chunk(&chunks[c]);
 		}
-		printf("l %llu\n", lookup);
 	}
 
 	/* Finish with commands to print the table, print statistics, and quit. */
 
-	printf("p\n");
-	printf("s\n");
-	printf("q\n"); 
+	command(&chunks[0], 'p', 1, 0);
+	command(&chunks[0], 's', 1, 0);
+	command(&chunks[0], 'q', 1, 0);
+	write_chunk(&chunks[0]);
+	if (binary != NULL) {
+		end_binary_commands(binary);
+	}
+	for (c = 0; c < 2 * nthreads; c++) {
+		free(chunks[c].bytes);
+	}
+	free(chunks);
+	free(workload.keys);
 
 	return 0;
 }
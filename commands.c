@@ -0,0 +1,599 @@
+/* * * * * * * * *
+ * Fast reading and parsing of interpreter commands, and buffered writing of
+ * their results
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "commands.h"
+
+// how many bytes to read at once from input that can't be mapped
+#define BLOCK_SIZE (1 << 20)
+
+// the most bytes a binary command (or the end of the commands) takes up: an
+// operation byte, and then a 10-byte varint key (or two 8-byte numbers)
+#define MAX_BINARY_COMMAND 17
+
+// the start of the checksum of binary commands (FNV-1a's offset basis), and
+// the number it's multiplied by after each byte
+#define CHECKSUM_START 14695981039346656037ULL
+#define CHECKSUM_PRIME 1099511628211ULL
+
+// the first bytes of every binary command file (see commands.h)
+const char binary_header[BINARY_HEADER_SIZE] = "a2cmds\n\001";
+
+struct command_reader {
+	int fd;				// the input's file descriptor
+	Output *output;		// results to write out before waiting (or NULL)
+	char *data;			// the mapped input, or the block read so far
+	size_t size;		// how many bytes of data there are
+	size_t next;		// the first byte of data not yet read as a line
+	bool mapped;		// is data a mapping of the whole input (or a block)?
+	bool ended;			// has the end of the input been read into the block?
+	bool binary;		// are the commands binary (or text lines)?
+	BinaryDecoder decoder;	// the binary commands read so far
+};
+
+
+/* * *
+ * HELPER FUNCTIONS
+ */
+
+static bool line_ready(CommandReader *reader);
+static void read_block(CommandReader *reader, size_t need);
+static int64 read_fixed(unsigned char *bytes);
+static void write_fixed(unsigned char *bytes, int64 value);
+static int read_binary_command(CommandReader *reader, char *operation,
+	int64 *key);
+static void make_room(Output *output, int bytes);
+
+
+// is there a whole line (as fgets would read it) left in the reader's data?
+static bool line_ready(CommandReader *reader) {
+	size_t left = reader->size - reader->next;
+	return left >= MAX_LINE_LEN - 1
+		|| memchr(reader->data + reader->next, '\n', left) != NULL;
+}
+
+// read more of the input into the reader's block, until there are at least
+// 'need' bytes left in it (or, for text, a whole line) or the input ends
+static void read_block(CommandReader *reader, size_t need) {
+	while (!reader->ended && reader->size - reader->next < need
+		&& (reader->binary || !line_ready(reader))) {
+
+		// move the partial line left over to the start of the block
+		size_t left = reader->size - reader->next;
+		memmove(reader->data, reader->data + reader->next, left);
+		reader->size = left;
+		reader->next = 0;
+
+		// don't keep earlier results back while waiting for more input
+		if (reader->output != NULL) {
+			flush_output(reader->output);
+			fflush(stdout);
+		}
+
+		ssize_t nread = read(reader->fd, reader->data + left,
+			BLOCK_SIZE - left);
+		if (nread > 0) {
+			reader->size += nread;
+		} else if (nread == 0 || errno != EINTR) {
+			reader->ended = true;
+		}
+	}
+}
+
+// read the 8-byte little-endian number at 'bytes'
+static int64 read_fixed(unsigned char *bytes) {
+	int64 value = 0;
+	int i;
+	for (i = 7; i >= 0; i--) {
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+// write 'value' to 'bytes' as an 8-byte little-endian number
+static void write_fixed(unsigned char *bytes, int64 value) {
+	int i;
+	for (i = 0; i < 8; i++) {
+		bytes[i] = value >> (8 * i);
+	}
+}
+
+// decode the next binary command from the reader's data (see
+// read_command), checking the count and checksum at the end
+static int read_binary_command(CommandReader *reader, char *operation,
+	int64 *key) {
+	if (!reader->mapped) {
+		read_block(reader, MAX_BINARY_COMMAND);
+	}
+	int argc;
+	int n = decode_binary_command(&reader->decoder,
+		reader->data + reader->next, reader->size - reader->next, operation,
+		key, &argc);
+	if (n == 0) {
+		return BAD_COMMANDS; // the input ended partway through a command
+	}
+
+	// anything after the end of the commands is ignored
+	reader->next = argc == NO_MORE_COMMANDS ? reader->size : reader->next + n;
+	return argc;
+}
+
+// write out the results collected so far, if adding 'bytes' more would
+// overflow the output buffer
+static void make_room(Output *output, int bytes) {
+	if (output->len + bytes > OUTPUT_BUFFER_SIZE) {
+		flush_output(output);
+	}
+}
+
+
+/* * *
+ * READING COMMANDS
+ */
+
+
+// start reading commands from 'input', from its current position.
+// any results collected in 'output' (unless it's NULL) are written out before
+// waiting on input that isn't available yet (so that interactive use still
+// works)
+CommandReader *new_command_reader(FILE *input, Output *output) {
+	assert(input != NULL);
+	CommandReader *reader = malloc(sizeof *reader);
+	assert(reader);
+	reader->fd = fileno(input);
+	reader->output = output;
+	reader->size = reader->next = 0;
+	reader->ended = false;
+	reader->binary = false;
+
+	// a regular file can be read straight from a mapping of the whole file,
+	// starting from wherever 'input' is up to
+	struct stat info;
+	off_t start = ftello(input);
+	if (fstat(reader->fd, &info) == 0 && S_ISREG(info.st_mode) && start >= 0
+		&& info.st_size > start) {
+		void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+			reader->fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, info.st_size, MADV_SEQUENTIAL);
+			reader->data = data;
+			reader->size = info.st_size;
+			reader->next = start;
+			reader->mapped = true;
+			return reader;
+		}
+	}
+
+	// anything else (e.g. a pipe) is read a block at a time. note: this reads
+	// from the underlying file descriptor, so nothing may have been read
+	// through 'input' itself yet
+	reader->data = malloc(BLOCK_SIZE);
+	assert(reader->data);
+	reader->mapped = false;
+	return reader;
+}
+
+// stop reading commands, and free the reader
+void free_command_reader(CommandReader *reader) {
+	assert(reader != NULL);
+	if (reader->mapped) {
+		munmap(reader->data, reader->size);
+	} else {
+		free(reader->data);
+	}
+	free(reader);
+}
+
+// read the header of binary commands from 'reader', and read binary
+// commands from then on
+// returns false if the input doesn't start with the header (or, for a
+// mapped file, if its commands are cut short or corrupt)
+bool read_binary_header(CommandReader *reader) {
+	assert(reader != NULL);
+	reader->binary = true;
+	start_binary_decoder(&reader->decoder);
+	if (!reader->mapped) {
+		read_block(reader, BINARY_HEADER_SIZE);
+	}
+	if (reader->size - reader->next < BINARY_HEADER_SIZE
+		|| memcmp(reader->data + reader->next, binary_header,
+			BINARY_HEADER_SIZE) != 0) {
+		return false;
+	}
+	reader->next += BINARY_HEADER_SIZE;
+
+	// a mapped file can be checked against its checksum before any of its
+	// commands are run (others are checked as they're read)
+	if (reader->mapped) {
+		size_t start = reader->next;
+		char operation;
+		int64 key;
+		int argc;
+		do {
+			argc = read_binary_command(reader, &operation, &key);
+		} while (argc > 0);
+		reader->next = start;
+		start_binary_decoder(&reader->decoder);
+		return argc == NO_MORE_COMMANDS;
+	}
+	return true;
+}
+
+// do the 'len' bytes at 'bytes' match the start of the header of binary
+// commands (as far as they go)?
+bool starts_binary_header(char *bytes, size_t len) {
+	if (len > BINARY_HEADER_SIZE) {
+		len = BINARY_HEADER_SIZE;
+	}
+	return memcmp(bytes, binary_header, len) == 0;
+}
+
+// start decoding binary commands from just after their header
+void start_binary_decoder(BinaryDecoder *decoder) {
+	decoder->count = 0;
+	decoder->checksum = CHECKSUM_START;
+}
+
+// decode the binary command at the start of the 'len' bytes at 'bytes',
+// storing its operation in *operation, its argument (if any) in *key, and the
+// number of tokens read in *argc (or, for the end marker, NO_MORE_COMMANDS if
+// the count and checksum that follow it match, and BAD_COMMANDS if not)
+// returns how many bytes the command takes up, or 0 if 'len' bytes aren't
+// enough to tell (so the commands are cut short, if no more are coming)
+int decode_binary_command(BinaryDecoder *decoder, char *bytes, size_t len,
+	char *operation, int64 *key, int *argc) {
+	unsigned char *start = (unsigned char *)bytes;
+	if (len == 0) {
+		return 0;
+	}
+
+	// the end marker is followed by the count and checksum of the commands
+	if (start[0] == BINARY_END) {
+		if (len < MAX_BINARY_COMMAND) {
+			return 0;
+		}
+		*argc = read_fixed(start + 1) == decoder->count
+			&& read_fixed(start + 9) == decoder->checksum
+			? NO_MORE_COMMANDS : BAD_COMMANDS;
+		return MAX_BINARY_COMMAND;
+	}
+
+	// otherwise, an operation byte, and a varint key if its top bit is set
+	size_t n = 1;
+	*argc = 1;
+	if (start[0] & BINARY_HAS_KEY) {
+		int64 value = 0;
+		int shift = 0;
+		do {
+			if (shift > 63) {
+				*argc = BAD_COMMANDS; // too long for a 64-bit key
+				return n;
+			}
+			if (n == len) {
+				return 0;
+			}
+			value |= (int64)(start[n] & 0x7f) << shift;
+			shift += 7;
+		} while (start[n++] & 0x80);
+		*key = value;
+		*argc = 2;
+	}
+	*operation = start[0] & ~BINARY_HAS_KEY;
+
+	// add the command's bytes to the checksum
+	size_t i;
+	for (i = 0; i < n; i++) {
+		decoder->checksum = (decoder->checksum ^ start[i]) * CHECKSUM_PRIME;
+	}
+	decoder->count++;
+	return n;
+}
+
+// read the rest of the commands from 'reader' without running them, so that
+// binary commands after a 'quit' are still checked against their checksum
+// returns NO_MORE_COMMANDS, or BAD_COMMANDS if they're cut short or corrupt
+int finish_commands(CommandReader *reader) {
+	assert(reader != NULL);
+	if (!reader->binary || reader->mapped) {
+		return NO_MORE_COMMANDS; // nothing to check, or checked already
+	}
+	char operation;
+	int64 key;
+	int argc;
+	do {
+		argc = read_binary_command(reader, &operation, &key);
+	} while (argc > 0);
+	return argc;
+}
+
+// read and parse the next command from 'reader', storing its operation in
+// *operation and its argument (if any) in *key or, if 'word' is not NULL,
+// in 'word' (see parse_command and parse_word_command)
+// returns the number of tokens successfully read (EOF for an empty line),
+// NO_MORE_COMMANDS at the end of the input, or BAD_COMMANDS if binary
+// commands are cut short or don't match their checksum
+int read_command(CommandReader *reader, char *operation, int64 *key,
+	char *word) {
+	if (reader->binary) {
+		assert(word == NULL);
+		return read_binary_command(reader, operation, key);
+	}
+	char *line;
+	int len;
+	if (!next_command_line(reader, &line, &len)) {
+		return NO_MORE_COMMANDS;
+	}
+	if (word != NULL) {
+		return parse_word_command(line, len, operation, word);
+	}
+	return parse_command(line, len, operation, key);
+}
+
+// get the next line from 'reader': sets *line to its first character and
+// *len to its length (up to MAX_LINE_LEN-1, including the newline, if any).
+// the line stays valid until the next call
+// returns false (and sets nothing) at the end of the input
+bool next_command_line(CommandReader *reader, char **line, int *len) {
+	assert(reader != NULL);
+	assert(!reader->binary);
+	if (!reader->mapped) {
+		read_block(reader, MAX_LINE_LEN - 1);
+	}
+
+	size_t left = reader->size - reader->next;
+	if (left == 0) {
+		return false;
+	}
+
+	// a line runs up to and including the next newline, but (like fgets) is
+	// cut off after MAX_LINE_LEN-1 characters, leaving the rest for later
+	size_t max = left < MAX_LINE_LEN - 1 ? left : MAX_LINE_LEN - 1;
+	char *start = reader->data + reader->next;
+	char *newline = memchr(start, '\n', max);
+	size_t n = newline != NULL ? newline - start + 1 : max;
+
+	reader->next += n;
+	*line = start;
+	*len = n;
+	return true;
+}
+
+
+/* * *
+ * PARSING COMMANDS
+ */
+
+
+// parse a line into an operation character and possibly a long long uinteger
+// argument, exactly as sscanf(line, "%c %llu", operation, key) would after
+// the line's last character (normally its newline) is stripped
+// returns the number of tokens successfully read (e.g. 0 for none,
+// 1 for operation only, 2 for both operation and integer)
+int parse_command(char *line, int len, char *operation, int64 *key) {
+
+	// as a string, the line would end at its first NUL character, and then
+	// lose its last character
+	char *end = memchr(line, '\0', len);
+	if (end != NULL) {
+		len = end - line;
+	}
+	if (len > 0) {
+		len--;
+	}
+	if (len == 0) {
+		return EOF;
+	}
+
+	// the operation is the first character, whatever it is
+	*operation = line[0];
+
+	// then skip any space, and read an optionally signed decimal number
+	int i = 1;
+	while (i < len && isspace((unsigned char)line[i])) {
+		i++;
+	}
+	bool negative = false;
+	if (i < len && (line[i] == '-' || line[i] == '+')) {
+		negative = (line[i] == '-');
+		i++;
+	}
+	if (i == len || !isdigit((unsigned char)line[i])) {
+		return 1;
+	}
+
+	int64 value = 0;
+	bool overflow = false;
+	for (; i < len && isdigit((unsigned char)line[i]); i++) {
+		int digit = line[i] - '0';
+		if (value > (ULLONG_MAX - digit) / 10) {
+			overflow = true;
+		} else {
+			value = value * 10 + digit;
+		}
+	}
+
+	// note: as with sscanf, a number too large for a long long uinteger is
+	// read as the largest one, and since llu is unsigned, a command like
+	// 'i -1' will overflow, resulting in *key = 18446744073709551615 (2^64-1).
+	// this is a feature.
+	*key = overflow ? ULLONG_MAX : negative ? -value : value;
+	return 2;
+}
+
+// parse a line into an operation character and possibly a word argument (a
+// string of up to MAX_LINE_LEN-1 non-space characters, stored in 'word'),
+// exactly as sscanf(line, "%c %s", operation, word) would after the line's
+// last character (normally its newline) is stripped
+// returns the number of tokens successfully read, as for parse_command
+int parse_word_command(char *line, int len, char *operation, char *word) {
+	char copy[MAX_LINE_LEN];
+	assert(len < MAX_LINE_LEN);
+	memcpy(copy, line, len);
+	copy[len] = '\0';
+
+	int length = strlen(copy);
+	if (length > 0) {
+		copy[length - 1] = '\0';
+	}
+	return sscanf(copy, "%c %s", operation, word);
+}
+
+
+/* * *
+ * WRITING BINARY COMMANDS
+ */
+
+
+// start writing binary commands to 'file', beginning with their header
+void start_binary_commands(BinaryWriter *writer, FILE *file) {
+	assert(writer != NULL && file != NULL);
+	writer->file = file;
+	writer->count = 0;
+	writer->checksum = CHECKSUM_START;
+	fwrite(binary_header, 1, BINARY_HEADER_SIZE, file);
+}
+
+// write a command with operation 'operation' (an ASCII character other
+// than NUL) and, if 'argc' is 2, argument 'key'
+void write_binary_command(BinaryWriter *writer, char operation, int argc,
+	int64 key) {
+	unsigned char bytes[MAX_ENCODED_COMMAND];
+	int n = encode_binary_command(bytes, operation, argc, key);
+	write_binary_commands(writer, bytes, n, 1);
+}
+
+// encode a command as write_binary_command would write it into 'bytes'
+// (with room for MAX_ENCODED_COMMAND bytes)
+// returns how many bytes it took
+int encode_binary_command(unsigned char *bytes, char operation, int argc,
+	int64 key) {
+	assert(operation > 0);
+	int n = 0;
+	if (argc < 2) {
+		bytes[n++] = operation;
+		return n;
+	}
+
+	// the key as a varint: 7 bits at a time, lowest first, with the top bit
+	// of every byte but the last set
+	bytes[n++] = operation | BINARY_HAS_KEY;
+	while (key >= 0x80) {
+		bytes[n++] = (key & 0x7f) | 0x80;
+		key >>= 7;
+	}
+	bytes[n++] = key;
+	return n;
+}
+
+// write the 'count' commands encoded one after another by
+// encode_binary_command into the 'len' bytes at 'bytes'
+void write_binary_commands(BinaryWriter *writer, unsigned char *bytes,
+	size_t len, int64 count) {
+
+	// (the checksum runs through every byte in order, so this part can't be
+	// split up)
+	int64 checksum = writer->checksum;
+	size_t i;
+	for (i = 0; i < len; i++) {
+		checksum = (checksum ^ bytes[i]) * CHECKSUM_PRIME;
+	}
+	writer->checksum = checksum;
+	writer->count += count;
+	fwrite(bytes, 1, len, writer->file);
+}
+
+// finish writing binary commands, with the end marker, the number of
+// commands and their checksum
+void end_binary_commands(BinaryWriter *writer) {
+	unsigned char bytes[MAX_BINARY_COMMAND];
+	bytes[0] = BINARY_END;
+	write_fixed(bytes + 1, writer->count);
+	write_fixed(bytes + 9, writer->checksum);
+	fwrite(bytes, 1, MAX_BINARY_COMMAND, writer->file);
+}
+
+
+/* * *
+ * COUNTING RESULTS
+ */
+
+
+// start counting results from scratch
+void initialise_results(Results *results) {
+	memset(results->count, 0, sizeof results->count);
+	results->checksum = CHECKSUM_START;
+}
+
+// count an insert or lookup of 'key' with outcome 'outcome'
+void add_result(Results *results, int64 key, Outcome outcome) {
+	results->count[outcome]++;
+
+	// fold in the key and then the outcome, like FNV-1a but a word at a time
+	results->checksum = (results->checksum ^ key) * CHECKSUM_PRIME;
+	results->checksum = (results->checksum ^ outcome) * CHECKSUM_PRIME;
+}
+
+// print the counts and checksum of the results to stdout
+void print_results(Results *results) {
+	printf("%llu inserted, %llu duplicates, %llu found, %llu not found\n",
+		results->count[INSERTED], results->count[DUPLICATE],
+		results->count[FOUND], results->count[NOT_FOUND]);
+	printf("result checksum: %016llx\n", results->checksum);
+}
+
+
+/* * *
+ * WRITING RESULTS
+ */
+
+
+// add the string 'text' to the results
+void output_text(Output *output, char *text) {
+	int len = strlen(text);
+	make_room(output, len);
+	if (len > OUTPUT_BUFFER_SIZE) {
+		fwrite(text, 1, len, stdout);
+		return;
+	}
+	memcpy(output->data + output->len, text, len);
+	output->len += len;
+}
+
+// add 'key', in decimal, to the results
+void output_key(Output *output, int64 key) {
+
+	// find the digits, last first
+	char digits[20];
+	int n = 0;
+	do {
+		digits[n++] = '0' + key % 10;
+		key /= 10;
+	} while (key > 0);
+
+	make_room(output, n);
+	while (n > 0) {
+		output->data[output->len++] = digits[--n];
+	}
+}
+
+// write every result collected so far to stdout
+void flush_output(Output *output) {
+	fwrite(output->data, 1, output->len, stdout);
+	output->len = 0;
+}
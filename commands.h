@@ -0,0 +1,200 @@
+/* * * * * * * * *
+ * Fast reading and parsing of interpreter commands, and buffered writing of
+ * their results
+ *
+ * commands are read from a file by mapping it into memory, or from anything
+ * else (e.g. a pipe) in large blocks, and split into lines and parsed exactly
+ * as fgets (into a buffer of MAX_LINE_LEN characters) and sscanf would, so
+ * the interpreter behaves the same as it would reading them one at a time
+ *
+ * commands can also be read and written in a compact binary form, which
+ * takes much less space and needs no parsing: a header (BINARY_HEADER_SIZE
+ * bytes), then each command as its operation character (with BINARY_HAS_KEY
+ * set if it has an argument) followed by its argument as a varint (7 bits
+ * per byte, lowest first, with the top bit set on every byte but the last),
+ * and finally a BINARY_END byte followed by the number of commands and a
+ * 64-bit FNV-1a checksum of their bytes (each 8 bytes, little-endian)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "inthash.h"
+
+// the longest line read at once (including its newline, plus one), as with
+// fgets: anything longer is read as several lines
+#define MAX_LINE_LEN 80
+
+// how many bytes of results to collect before writing them out
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+// binary command format (see above)
+#define BINARY_HEADER_SIZE 8
+#define BINARY_HAS_KEY 0x80
+#define BINARY_END 0x00
+
+// the first bytes of every binary command file: a name, a newline (so that
+// files mangled by newline conversion are caught), and a version number
+extern const char binary_header[BINARY_HEADER_SIZE];
+
+// what read_command returns (besides the number of tokens read) at the end
+// of the commands, and if binary commands turn out to be corrupt
+#define NO_MORE_COMMANDS (-2)
+#define BAD_COMMANDS (-3)
+
+// results waiting to be written to stdout
+typedef struct output {
+	char data[OUTPUT_BUFFER_SIZE];
+	int len;
+} Output;
+
+// the state of decoding binary commands: how many have been decoded, and
+// the checksum of their bytes so far
+typedef struct binary_decoder {
+	int64 count;
+	int64 checksum;
+} BinaryDecoder;
+
+// a source of commands
+typedef struct command_reader CommandReader;
+
+// start reading commands from 'input', from its current position.
+// any results collected in 'output' (unless it's NULL) are written out before
+// waiting on input that isn't available yet (so that interactive use still
+// works)
+CommandReader *new_command_reader(FILE *input, Output *output);
+
+// stop reading commands, and free the reader
+void free_command_reader(CommandReader *reader);
+
+// read the header of binary commands from 'reader', and read binary
+// commands from then on
+// returns false if the input doesn't start with the header (or, for a
+// mapped file, if its commands are cut short or corrupt)
+bool read_binary_header(CommandReader *reader);
+
+// do the 'len' bytes at 'bytes' match the start of the header of binary
+// commands (as far as they go)?
+bool starts_binary_header(char *bytes, size_t len);
+
+// start decoding binary commands from just after their header
+void start_binary_decoder(BinaryDecoder *decoder);
+
+// decode the binary command at the start of the 'len' bytes at 'bytes',
+// storing its operation in *operation, its argument (if any) in *key, and the
+// number of tokens read in *argc (or, for the end marker, NO_MORE_COMMANDS if
+// the count and checksum that follow it match, and BAD_COMMANDS if not)
+// returns how many bytes the command takes up, or 0 if 'len' bytes aren't
+// enough to tell (so the commands are cut short, if no more are coming)
+int decode_binary_command(BinaryDecoder *decoder, char *bytes, size_t len,
+	char *operation, int64 *key, int *argc);
+
+// read the rest of the commands from 'reader' without running them, so that
+// binary commands after a 'quit' are still checked against their checksum
+// returns NO_MORE_COMMANDS, or BAD_COMMANDS if they're cut short or corrupt
+int finish_commands(CommandReader *reader);
+
+// read and parse the next command from 'reader', storing its operation in
+// *operation and its argument (if any) in *key or, if 'word' is not NULL,
+// in 'word' (see parse_command and parse_word_command)
+// returns the number of tokens successfully read (EOF for an empty line),
+// NO_MORE_COMMANDS at the end of the input, or BAD_COMMANDS if binary
+// commands are cut short or don't match their checksum
+int read_command(CommandReader *reader, char *operation, int64 *key,
+	char *word);
+
+// get the next line from 'reader': sets *line to its first character and
+// *len to its length (up to MAX_LINE_LEN-1, including the newline, if any).
+// the line stays valid until the next call
+// returns false (and sets nothing) at the end of the input
+bool next_command_line(CommandReader *reader, char **line, int *len);
+
+// parse a line into an operation character and possibly a long long uinteger
+// argument, exactly as sscanf(line, "%c %llu", operation, key) would after
+// the line's last character (normally its newline) is stripped
+// returns the number of tokens successfully read (e.g. 0 for none,
+// 1 for operation only, 2 for both operation and integer)
+int parse_command(char *line, int len, char *operation, int64 *key);
+
+// parse a line into an operation character and possibly a word argument (a
+// string of up to MAX_LINE_LEN-1 non-space characters, stored in 'word'),
+// exactly as sscanf(line, "%c %s", operation, word) would after the line's
+// last character (normally its newline) is stripped
+// returns the number of tokens successfully read, as for parse_command
+int parse_word_command(char *line, int len, char *operation, char *word);
+
+// a destination for binary commands
+typedef struct binary_writer {
+	FILE *file;
+	int64 count;		// how many commands have been written
+	int64 checksum;		// the checksum of the commands written so far
+} BinaryWriter;
+
+// start writing binary commands to 'file', beginning with their header
+void start_binary_commands(BinaryWriter *writer, FILE *file);
+
+// write a command with operation 'operation' (an ASCII character other
+// than NUL) and, if 'argc' is 2, argument 'key'
+void write_binary_command(BinaryWriter *writer, char operation, int argc,
+	int64 key);
+
+// the most bytes encode_binary_command takes up (an operation byte, and then
+// a 10-byte varint key)
+#define MAX_ENCODED_COMMAND 11
+
+// encode a command as write_binary_command would write it into 'bytes'
+// (with room for MAX_ENCODED_COMMAND bytes), so that many can be encoded
+// elsewhere (e.g. on other threads) and written at once
+// returns how many bytes it took
+int encode_binary_command(unsigned char *bytes, char operation, int argc,
+	int64 key);
+
+// write the 'count' commands encoded one after another by
+// encode_binary_command into the 'len' bytes at 'bytes'
+void write_binary_commands(BinaryWriter *writer, unsigned char *bytes,
+	size_t len, int64 count);
+
+// finish writing binary commands, with the end marker, the number of
+// commands and their checksum
+void end_binary_commands(BinaryWriter *writer);
+
+// the outcomes of inserts and lookups
+typedef enum outcome {
+	INSERTED,
+	DUPLICATE,
+	FOUND,
+	NOT_FOUND
+} Outcome;
+
+// how many inserts and lookups had each outcome, and a checksum of every
+// outcome and key in order, so the results of a long run of commands can be
+// compared without keeping them all
+typedef struct results {
+	int64 count[NOT_FOUND + 1];
+	int64 checksum;
+} Results;
+
+// start counting results from scratch
+void initialise_results(Results *results);
+
+// count an insert or lookup of 'key' with outcome 'outcome'
+void add_result(Results *results, int64 key, Outcome outcome);
+
+// print the counts and checksum of the results to stdout
+void print_results(Results *results);
+
+// add the string 'text' to the results
+void output_text(Output *output, char *text);
+
+// add 'key', in decimal, to the results
+void output_key(Output *output, int64 key);
+
+// write every result collected so far to stdout
+void flush_output(Output *output);
+
+#endif
@@ -0,0 +1,250 @@
+/* * * * * * * * *
+ * Comparison runs: the same commands replayed against several types of hash
+ * table, reporting how each one did side by side
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "compare.h"
+#include "replay.h"
+#include "tables/latency.h"
+#include "tables/events.h"
+
+// how many seconds each table type gets to replay the commands before it is
+// reported as timed out (some types never finish some workloads: a cuckoo
+// table can keep growing without ever placing a key)
+#define COMPARE_TIMEOUT 60
+
+// the names of every table type, in TableType order
+static char *typenames[] = {
+	"linear", "xtndbl1", "cuckoo", "xtndbln", "xuckoo", "xuckoon"
+};
+
+// how one table type did, as sent back from its child process
+typedef struct report {
+	double insert_rate;		// inserts per second (counting only the time
+	double lookup_rate;		// spent in the table), and lookups per second
+	double max_insert;		// the slowest single insert and lookup, in ns
+	double max_lookup;
+	int64 memory;			// bytes in use after every command
+	int64 events[NEVENT_TYPES];	// how many structural changes of each kind
+	int64 checksum;			// checksum of the results (see Results)
+} Report;
+
+
+/* * *
+ * HELPER FUNCTIONS
+ */
+
+static void run_replay(HashTableConfig *config, int expected_keys,
+	Replay *replay, Report *report);
+static bool compare_type(HashTableConfig *config, int expected_keys,
+	Replay *replay, Report *report);
+static void print_rate(double rate);
+static void print_ns(double ns);
+
+
+// replay 'replay' against a new table set up as 'config' describes, storing
+// how it did in *report
+static void run_replay(HashTableConfig *config, int expected_keys,
+	Replay *replay, Report *report) {
+	HashTable *table = new_hash_table_ex(config);
+	if (expected_keys > 0) {
+		hash_table_reserve(table, expected_keys);
+	}
+	int64 events_before[NEVENT_TYPES];
+	int e;
+	for (e = 0; e < NEVENT_TYPES; e++) {
+		events_before[e] = count_events(e);
+	}
+
+	// time each insert and lookup on its own, so that the two can be told
+	// apart however they're mixed together
+	Latency inserts, lookups;
+	initialise_latency(&inserts);
+	initialise_latency(&lookups);
+	Results results;
+	initialise_results(&results);
+	int i;
+	for (i = 0; i < replay->n; i++) {
+		int64 key = replay->keys[i];
+		if (replay->ops[i] == 'i') {
+			int64 start = latency_start(&inserts);
+			bool inserted = hash_table_insert(table, key);
+			latency_stop(&inserts, start);
+			add_result(&results, key, inserted ? INSERTED : DUPLICATE);
+		} else {
+			int64 start = latency_start(&lookups);
+			bool found = hash_table_lookup(table, key);
+			latency_stop(&lookups, start);
+			add_result(&results, key, found ? FOUND : NOT_FOUND);
+		}
+	}
+
+#ifdef HT_NO_STATS
+	report->insert_rate = report->lookup_rate = 0;
+	report->max_insert = report->max_lookup = 0;
+#else
+	report->insert_rate = inserts.total ? inserts.timed * 1e9
+		/ ticks_to_ns(inserts.total) : 0;
+	report->lookup_rate = lookups.total ? lookups.timed * 1e9
+		/ ticks_to_ns(lookups.total) : 0;
+	report->max_insert = ticks_to_ns(inserts.max);
+	report->max_lookup = ticks_to_ns(lookups.max);
+#endif
+	report->memory = hash_table_memory_usage(table, NULL);
+	for (e = 0; e < NEVENT_TYPES; e++) {
+		report->events[e] = count_events(e) - events_before[e];
+	}
+	report->checksum = results.checksum;
+	free_hash_table(table);
+}
+
+// replay 'replay' against a table set up as 'config' describes in a child
+// process, storing how it did in *report
+// returns false (after saying why) if the child process didn't finish
+static bool compare_type(HashTableConfig *config, int expected_keys,
+	Replay *replay, Report *report) {
+	int fds[2];
+	if (pipe(fds) != 0) {
+		perror("error: can't compare tables");
+		exit(EXIT_FAILURE);
+	}
+	fflush(stdout);
+	pid_t child = fork();
+	if (child < 0) {
+		perror("error: can't compare tables");
+		exit(EXIT_FAILURE);
+	}
+
+	// the child replays the commands and sends back how it went, unless it
+	// runs out of time first (and is killed by SIGALRM)
+	if (child == 0) {
+		close(fds[0]);
+		alarm(COMPARE_TIMEOUT);
+		run_replay(config, expected_keys, replay, report);
+		bool sent = write(fds[1], report, sizeof *report)
+			== sizeof *report;
+		_exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fds[1]);
+	ssize_t got = read(fds[0], report, sizeof *report);
+	close(fds[0]);
+	int status;
+	waitpid(child, &status, 0);
+	if (got == sizeof *report) {
+		return true;
+	}
+	if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+		printf("%8s  failed (timed out after %d seconds)\n",
+			typenames[config->type], COMPARE_TIMEOUT);
+	} else if (WIFSIGNALED(status)) {
+		printf("%8s  failed (killed by signal %d)\n",
+			typenames[config->type], WTERMSIG(status));
+	} else {
+		printf("%8s  failed (exit status %d)\n",
+			typenames[config->type], WEXITSTATUS(status));
+	}
+	return false;
+}
+
+// print an operation rate in a column, in millions per second
+static void print_rate(double rate) {
+	if (rate > 0) {
+		printf(" %11.3f", rate / 1e6);
+	} else {
+		printf(" %11s", "-");
+	}
+}
+
+// print a time in a column, in ns
+static void print_ns(double ns) {
+	if (ns > 0) {
+		printf(" %11.0f", ns);
+	} else {
+		printf(" %11s", "-");
+	}
+}
+
+
+/* * *
+ * COMPARISON FUNCTION
+ */
+
+
+// read every command from 'reader' (up to the first 'quit'), then replay the
+// inserts and lookups among them against a new table set up as each of the
+// 'ntypes' configurations in 'configs' describes (each of a different type,
+// and with room made for 'expected_keys' keys up front, if it's not 0),
+// printing a table to stdout comparing their insert and lookup rates, final
+// memory use, resizes, splits and cuckoo cycles, and slowest single insert
+// and lookup, and whether they all gave the same results
+// returns false if binary commands turn out to be corrupt
+bool compare_tables(HashTableConfig *configs, int ntypes, int expected_keys,
+	CommandReader *reader) {
+	assert(ntypes > 0);
+	Replay replay;
+	if (!read_replay(reader, &replay)) {
+		return false;
+	}
+
+	// resizes, splits and cycles are counted from the event trace, and the
+	// tick rate is measured from here on, for every child at once
+	if (!events_enabled) {
+		enable_event_log(1);
+	}
+	Latency calibration;
+	initialise_latency(&calibration);
+
+	printf("comparing %d table types over %d inserts and %d lookups:\n",
+		ntypes, replay.ninserts, replay.n - replay.ninserts);
+	printf("%8s %11s %11s %11s %8s %8s %8s %11s %11s\n", "table", "Minserts/s",
+		"Mlookups/s", "bytes", "resizes", "splits", "cycles", "max ins ns",
+		"max lkp ns");
+
+	int64 first_checksum = 0;
+	bool first = true, same = true;
+	int t;
+	for (t = 0; t < ntypes; t++) {
+		Report report;
+		if (!compare_type(&configs[t], expected_keys, &replay, &report)) {
+			continue;
+		}
+		printf("%8s", typenames[configs[t].type]);
+		print_rate(report.insert_rate);
+		print_rate(report.lookup_rate);
+		printf(" %11llu %8llu %8llu %8llu", report.memory,
+			report.events[EVENT_RESIZE] + report.events[EVENT_DOUBLE],
+			report.events[EVENT_SPLIT], report.events[EVENT_CYCLE]);
+		print_ns(report.max_insert);
+		print_ns(report.max_lookup);
+		printf("\n");
+
+		if (first) {
+			first_checksum = report.checksum;
+			first = false;
+		} else if (report.checksum != first_checksum) {
+			same = false;
+		}
+	}
+	if (!first) {
+		printf(same ? "every table gave the same results\n"
+			: "the tables gave different results!\n");
+	}
+
+	free_replay(&replay);
+	return true;
+}
@@ -0,0 +1,36 @@
+/* * * * * * * * *
+ * Comparison runs: the same commands replayed against several types of hash
+ * table, reporting how each one did side by side
+ *
+ * the commands are read and parsed once, into memory, and then each table
+ * type replays their inserts and lookups in turn (in a child process of its
+ * own, so that each starts from the same fresh heap, and one table failing
+ * an assertion doesn't stop the others being compared)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <stdbool.h>
+#include "inthash.h"
+#include "hashtbl.h"
+#include "commands.h"
+
+// how many table types there are to compare
+#define NTABLE_TYPES (XUCKOON + 1)
+
+// read every command from 'reader' (up to the first 'quit'), then replay the
+// inserts and lookups among them against a new table set up as each of the
+// 'ntypes' configurations in 'configs' describes (each of a different type,
+// and with room made for 'expected_keys' keys up front, if it's not 0),
+// printing a table to stdout comparing their insert and lookup rates, final
+// memory use, resizes, splits and cuckoo cycles, and slowest single insert
+// and lookup, and whether they all gave the same results
+// returns false if binary commands turn out to be corrupt
+bool compare_tables(HashTableConfig *configs, int ntypes, int expected_keys,
+	CommandReader *reader);
+
+#endif
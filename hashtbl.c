@@ -6,6 +6,7 @@
  * by Matt Farrugia <matt.farrugia@unimelb.edu.au>
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -18,6 +19,21 @@
 #include "tables/xtndbln.h" // create for part 2
 #include "tables/xuckoo.h"	// create for part 3
 #include "tables/xuckoon.h" // create for part 4
+#include "tables/strlinear.h"
+#include "tables/strxtndbln.h"
+#include "tables/diskxtndbln.h"
+#include "tables/snapshot.h"
+#include "tables/latency.h"
+#include "shards.h"
+
+// the first section of every snapshot file, identifying the type of table
+// saved in the sections after it
+#define SNAPSHOT_MAGIC "HASHTBL"
+typedef struct snapshot_header {
+	char magic[8];	// SNAPSHOT_MAGIC, marking the file as a snapshot
+	int type;		// the table's TableType
+	int hash;		// the table's HashFamily
+} SnapshotHeader;
 
 // converts from a string representation to a TableType constant:
 // "linear"			->	LINEAR
@@ -52,12 +68,161 @@ TableType strtotype(char *str) {
 // and it also remembers is own type
 struct table {
 	TableType type;	// what type of hash table is this?
+	bool strings;	// does it hold string keys (rather than integers)?
+	bool disk;		// are its buckets stored on disk (XTNDBLN only)?
+	bool sharded;	// is it a set of locked shards (a ShardSet)?
+	HashFamily hash;	// are its keys scrambled before they're stored?
 	void *table;	// the hash table itself
 };
 
+// the key 'table' stores in place of 'key' (scrambled, if the table's keys
+// are)
+static inline int64 stored_key(HashTable *table, int64 key) {
+	return table->hash == HASH_MIXED ? mix_key(key) : key;
+}
+
+// the scan function and context a scan of a table with scrambled keys passes
+// each unscrambled key on to
+typedef struct unmixed_scan {
+	ScanFunc func;
+	void *ctx;
+} UnmixedScan;
+
+// pass the key 'key' (scrambled) and its value on to the scan function in
+// 'ctx' (an UnmixedScan), unscrambled
+static void unmix_scan(int64 key, int64 value, void *ctx) {
+	UnmixedScan *scan = ctx;
+	scan->func(unmix_key(key), value, scan->ctx);
+}
+
+// initialise a hash table of type 'type' with initial size 'size', storing
+// a value alongside each key if 'values' is true, and return its pointer
+static HashTable *new_table(TableType type, int size, bool values) {
+	
+	// allocate space for the table wrapper
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+
+	// store the table type, so we know which functions to call later
+	table->type = type;
+	table->strings = false;
+	table->disk = false;
+	table->sharded = false;
+	table->hash = HASH_AFFINE;
+
+	// create and store the table itself
+	switch (type) {
+		case LINEAR:
+			table->table = new_linear_hash_table(size, values);
+			break;
+		case XTNDBL1:
+			table->table = new_xtndbl1_hash_table(values);
+			break;
+		case CUCKOO:
+			table->table = new_cuckoo_hash_table(size, values);
+			break;
+		case XTNDBLN:
+			table->table = new_xtndbln_hash_table(size, values);
+			break;
+		case XUCKOO:
+			table->table = new_xuckoo_hash_table(values);
+			break;
+		case XUCKOON:
+			table->table = new_xuckoon_hash_table(size, values);
+			break;
+		default:
+			// no such table type? error. release memory and return NULL
+			free(table);
+			return NULL;
+	}
+
+	return table;
+}
+
+// the configuration new_hash_table(type, size) uses, with 'size' meaning
+// whatever it means to a table of type 'type'
+HashTableConfig default_hash_table_config(TableType type, int size) {
+	HashTableConfig config = { .type = type, .initial_size = 0,
+		.bucket_size = 1, .max_load = 1, .growth = 2, .hash = HASH_AFFINE,
+		.eviction = EVICT_RANDOM, .stats = STATS_ALL, .values = false };
+	if (type == LINEAR || type == CUCKOO) {
+		config.initial_size = size;
+	} else if (type == XTNDBLN || type == XUCKOON) {
+		config.bucket_size = size;
+	}
+	return config;
+}
+
+// initialise a hash table set up as 'config' describes, and return its
+// pointer (or NULL if 'config' has no valid table type)
+HashTable *new_hash_table_ex(HashTableConfig *config) {
+	assert(config != NULL);
+	bool sized = config->type == LINEAR || config->type == CUCKOO;
+	assert(config->initial_size > 0 || (!sized && config->initial_size == 0));
+	assert(config->bucket_size > 0);
+	assert(config->max_load > 0 && config->max_load <= 1);
+	assert(config->growth >= 2);
+	assert((config->hash != HASH_MIXED
+		|| (config->type != XTNDBL1 && config->type != XUCKOO))
+		&& "error: mixed hashing needs buckets of more than one key!");
+
+	// the table's stats time as many operations as asked from the start
+	static int sampling[] = { 0, STATS_SAMPLE_EVERY, HT_STATS_SAMPLE };
+	int previous = set_latency_sampling(sampling[config->stats]);
+	HashTable *table = new_table(config->type, sized ? config->initial_size
+		: config->bucket_size, config->values);
+	set_latency_sampling(previous);
+	if (table == NULL) {
+		return NULL;
+	}
+	table->hash = config->hash;
+
+	// pass on the settings that only some types of table have
+	switch (config->type) {
+		case LINEAR:
+			linear_hash_table_set_growth(table->table, config->max_load,
+				config->growth);
+			break;
+		case CUCKOO:
+			cuckoo_hash_table_set_growth(table->table, config->max_load,
+				config->growth);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_rotate_kicks(table->table,
+				config->eviction == EVICT_ROTATE);
+			break;
+		default:
+			break;
+	}
+
+	// extendible tables start out with room for the keys asked for
+	if (!sized && config->initial_size > 0) {
+		hash_table_reserve(table, config->initial_size);
+	}
+
+	return table;
+}
+
 // initialise a hash table of type 'type' with initial size 'size',
 // and return its pointer
 HashTable *new_hash_table(TableType type, int size) {
+	HashTableConfig config = default_hash_table_config(type, size);
+	return new_hash_table_ex(&config);
+}
+
+// initialise a hash table of type 'type' with initial size 'size' which also
+// stores a value inline alongside each key, and return its pointer
+HashTable *new_hash_map(TableType type, int size) {
+	HashTableConfig config = default_hash_table_config(type, size);
+	config.values = true;
+	return new_hash_table_ex(&config);
+}
+
+// initialise a hash table of type 'type' holding the 'n' keys in 'keys', and
+// return its pointer. 'size' means the same as for new_hash_table, but the
+// table is built at its final size in one pass rather than growing key by key
+HashTable *new_hash_table_from_keys(TableType type, int size, int64 *keys,
+	int n) {
 	
 	// allocate space for the table wrapper
 	HashTable *table = malloc(sizeof *table);
@@ -65,26 +230,30 @@ HashTable *new_hash_table(TableType type, int size) {
 
 	// store the table type, so we know which functions to call later
 	table->type = type;
+	table->strings = false;
+	table->disk = false;
+	table->sharded = false;
+	table->hash = HASH_AFFINE;
 
-	// create and store the table itself
+	// build and store the table itself
 	switch (type) {
 		case LINEAR:
-			table->table = new_linear_hash_table(size);
+			table->table = new_linear_hash_table_from_keys(size, keys, n);
 			break;
 		case XTNDBL1:
-			table->table = new_xtndbl1_hash_table();
+			table->table = new_xtndbl1_hash_table_from_keys(keys, n);
 			break;
 		case CUCKOO:
-			table->table = new_cuckoo_hash_table(size);
+			table->table = new_cuckoo_hash_table_from_keys(size, keys, n);
 			break;
 		case XTNDBLN:
-			table->table = new_xtndbln_hash_table(size);
+			table->table = new_xtndbln_hash_table_from_keys(size, keys, n);
 			break;
 		case XUCKOO:
-			table->table = new_xuckoo_hash_table();
+			table->table = new_xuckoo_hash_table_from_keys(keys, n);
 			break;
 		case XUCKOON:
-			table->table = new_xuckoon_hash_table(size);
+			table->table = new_xuckoon_hash_table_from_keys(size, keys, n);
 			break;
 		default:
 			// no such table type? error. release memory and return NULL
@@ -95,10 +264,124 @@ HashTable *new_hash_table(TableType type, int size) {
 	return table;
 }
 
+// initialise a hash table of type 'type' with initial size 'size' which holds
+// variable-length string keys rather than integers, and return its pointer
+HashTable *new_string_hash_table(TableType type, int size) {
+	
+	// allocate space for the table wrapper
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+
+	// store the table type, so we know which functions to call later
+	table->type = type;
+	table->strings = true;
+	table->disk = false;
+	table->sharded = false;
+	table->hash = HASH_AFFINE;
+
+	// create and store the table itself
+	switch (type) {
+		case LINEAR:
+			table->table = new_strlinear_hash_table(size);
+			break;
+		case XTNDBLN:
+			table->table = new_strxtndbln_hash_table(size);
+			break;
+		default:
+			// no string version of this table type? release memory and
+			// return NULL
+			free(table);
+			return NULL;
+	}
+
+	return table;
+}
+
+// open the disk-resident XTNDBLN hash table stored in files starting with
+// 'path', caching up to 'npages' of its buckets in memory, and return its
+// pointer. returns NULL if the files can't be opened
+HashTable *new_disk_hash_table(char *path, int npages) {
+	DiskXtndblNHashTable *disktable = new_diskxtndbln_hash_table(path, npages);
+	if (disktable == NULL) {
+		return NULL;
+	}
+
+	// allocate space for the table wrapper
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->type = XTNDBLN;
+	table->strings = false;
+	table->disk = true;
+	table->sharded = false;
+	table->hash = HASH_AFFINE;
+	table->table = disktable;
+	return table;
+}
+
+// initialise a set of 2^'shardbits' hash tables of type 'type' (each with
+// initial size 'size', and storing values if 'values' is true) which several
+// threads can use at once, and return its pointer
+static HashTable *new_sharded_table(TableType type, int size, int shardbits,
+	bool values, bool rwlocks) {
+	if (type < LINEAR || type > XUCKOON) {
+		return NULL;
+	}
+
+	// allocate space for the table wrapper
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->type = type;
+	table->strings = false;
+	table->disk = false;
+	table->sharded = true;
+	table->hash = HASH_AFFINE;
+	table->table = new_shard_set(type, size, shardbits, values, rwlocks);
+	return table;
+}
+
+// initialise a thread-safe hash table made of 2^'shardbits' shards of type
+// 'type', and return its pointer
+HashTable *new_sharded_hash_table(TableType type, int size, int shardbits,
+	bool rwlocks) {
+	return new_sharded_table(type, size, shardbits, false, rwlocks);
+}
+
+// initialise a thread-safe hash map made of 2^'shardbits' shards of type
+// 'type', and return its pointer
+HashTable *new_sharded_hash_map(TableType type, int size, int shardbits,
+	bool rwlocks) {
+	return new_sharded_table(type, size, shardbits, true, rwlocks);
+}
+
 // free all memory associated with 'table'
 void free_hash_table(HashTable *table) {
 	assert(table != NULL);
 
+	// sharded tables free each of their shards
+	if (table->sharded) {
+		free_shard_set(table->table);
+		free(table);
+		return;
+	}
+
+	// disk tables have their own free function (which also writes them back)
+	if (table->disk) {
+		free_diskxtndbln_hash_table(table->table);
+		free(table);
+		return;
+	}
+
+	// string tables have their own free functions
+	if (table->strings) {
+		if (table->type == LINEAR) {
+			free_strlinear_hash_table(table->table);
+		} else {
+			free_strxtndbln_hash_table(table->table);
+		}
+		free(table);
+		return;
+	}
+
 	// free the actual table, using the relevant free function for its type
 	switch (table->type) {
 		case LINEAR:
@@ -127,10 +410,137 @@ void free_hash_table(HashTable *table) {
 	free(table);
 }
 
+// write 'table' to a binary snapshot file at 'path'
+// returns true if the snapshot was saved, false if the file couldn't be written
+bool hash_table_save(HashTable *table, char *path) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+	assert(!table->sharded && "error: not supported by sharded tables!");
+
+	// write to a temporary file first, then move it into place: 'path' may be
+	// the snapshot this table is still using in place
+	char *temp = malloc(strlen(path) + sizeof ".tmp");
+	assert(temp);
+	sprintf(temp, "%s.tmp", path);
+	FILE *file = fopen(temp, "wb");
+	if (file == NULL) {
+		free(temp);
+		return false;
+	}
+
+	SnapshotHeader header = { SNAPSHOT_MAGIC, table->type, table->hash };
+	bool written = write_section(file, &header, sizeof header);
+
+	// forward the call onto the relevant save function
+	switch (written ? table->type : -1) {
+		case LINEAR:
+			written = linear_hash_table_save(table->table, file);
+			break;
+		case XTNDBL1:
+			written = xtndbl1_hash_table_save(table->table, file);
+			break;
+		case CUCKOO:
+			written = cuckoo_hash_table_save(table->table, file);
+			break;
+		case XTNDBLN:
+			written = xtndbln_hash_table_save(table->table, file);
+			break;
+		case XUCKOO:
+			written = xuckoo_hash_table_save(table->table, file);
+			break;
+		case XUCKOON:
+			written = xuckoon_hash_table_save(table->table, file);
+			break;
+		default:
+			break;
+	}
+
+	// still close the file if it couldn't all be written
+	bool closed = fclose(file) == 0;
+	bool saved = written && closed && rename(temp, path) == 0;
+	if (!saved) {
+		remove(temp);
+	}
+	free(temp);
+	return saved;
+}
+
+// load the table saved in the snapshot file at 'path', and return its pointer
+// returns NULL if the file can't be read, or doesn't hold a snapshot written
+// by this version of the program
+HashTable *hash_table_load(char *path) {
+	Snapshot *snapshot = map_snapshot(path);
+	if (snapshot == NULL) {
+		return NULL;
+	}
+
+	// check the file really is a snapshot before reading any further
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || memcmp(header->magic, SNAPSHOT_MAGIC,
+		sizeof header->magic) != 0) {
+		unmap_snapshot(snapshot);
+		return NULL;
+	}
+
+	// allocate space for the table wrapper
+	HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->type = header->type;
+	table->strings = false;
+	table->disk = false;
+	table->sharded = false;
+	table->hash = header->hash;
+
+	// load the table itself (which takes over the snapshot)
+	switch (table->type) {
+		case LINEAR:
+			table->table = linear_hash_table_load(snapshot);
+			break;
+		case XTNDBL1:
+			table->table = xtndbl1_hash_table_load(snapshot);
+			break;
+		case CUCKOO:
+			table->table = cuckoo_hash_table_load(snapshot);
+			break;
+		case XTNDBLN:
+			table->table = xtndbln_hash_table_load(snapshot);
+			break;
+		case XUCKOO:
+			table->table = xuckoo_hash_table_load(snapshot);
+			break;
+		case XUCKOON:
+			table->table = xuckoon_hash_table_load(snapshot);
+			break;
+		default:
+			table->table = NULL;
+			break;
+	}
+	if (table->table == NULL) {
+		unmap_snapshot(snapshot);
+		free(table);
+		return NULL;
+	}
+
+	return table;
+}
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool hash_table_insert(HashTable *table, int64 key) {
 	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	key = stored_key(table, key);
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_insert(table->table, key);
+	}
+
+	// disk tables have their own insert function
+	if (table->disk) {
+		return diskxtndbln_hash_table_insert(table->table, key);
+	}
 
 	// forward the call onto the relevant insert function
 	switch (table->type) {
@@ -151,10 +561,69 @@ bool hash_table_insert(HashTable *table, int64 key) {
 	}
 }
 
+// make room in 'table' for 'n' keys in total, growing it now (all at once)
+// rather than while those keys are being inserted
+void hash_table_reserve(HashTable *table, int n) {
+	assert(table != NULL);
+	assert(!table->disk && "error: not supported by disk tables!");
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_reserve(table->table, n);
+		return;
+	}
+
+	// string tables have their own reserve functions
+	if (table->strings) {
+		if (table->type == LINEAR) {
+			strlinear_hash_table_reserve(table->table, n);
+		} else {
+			strxtndbln_hash_table_reserve(table->table, n);
+		}
+		return;
+	}
+
+	// forward the call onto the relevant reserve function
+	switch (table->type) {
+		case LINEAR:
+			linear_hash_table_reserve(table->table, n);
+			break;
+		case XTNDBL1:
+			xtndbl1_hash_table_reserve(table->table, n);
+			break;
+		case CUCKOO:
+			cuckoo_hash_table_reserve(table->table, n);
+			break;
+		case XTNDBLN:
+			xtndbln_hash_table_reserve(table->table, n);
+			break;
+		case XUCKOO:
+			xuckoo_hash_table_reserve(table->table, n);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_reserve(table->table, n);
+			break;
+		default:
+			break;
+	}
+}
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool hash_table_lookup(HashTable *table, int64 key) {
 	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	key = stored_key(table, key);
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_lookup(table->table, key);
+	}
+
+	// disk tables have their own lookup function
+	if (table->disk) {
+		return diskxtndbln_hash_table_lookup(table->table, key);
+	}
 
 	// forward the call onto the relevant lookup function
 	switch (table->type) {
@@ -175,10 +644,352 @@ bool hash_table_lookup(HashTable *table, int64 key) {
 	}
 }
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void hash_table_insert_batch(HashTable *table, int64 *keys, int n,
+	bool *results) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+
+	// tables with scrambled keys are passed a scrambled copy of the batch
+	int64 *mixed = NULL;
+	if (table->hash == HASH_MIXED) {
+		mixed = malloc(sizeof *mixed * n);
+		assert(mixed);
+		int i;
+		for (i = 0; i < n; i++) {
+			mixed[i] = mix_key(keys[i]);
+		}
+		keys = mixed;
+	}
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_insert_batch(table->table, keys, n, results);
+	} else {
+		// forward the call onto the relevant batch insert function
+		switch (table->type) {
+			case LINEAR:
+				linear_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			case XTNDBL1:
+				xtndbl1_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			case CUCKOO:
+				cuckoo_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			case XTNDBLN:
+				xtndbln_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			case XUCKOO:
+				xuckoo_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			case XUCKOON:
+				xuckoon_hash_table_insert_batch(table->table, keys, n, results);
+				break;
+			default:
+				break;
+		}
+	}
+	free(mixed);
+}
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void hash_table_lookup_batch(HashTable *table, int64 *keys, int n,
+	bool *results) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+
+	// tables with scrambled keys are passed a scrambled copy of the batch
+	int64 *mixed = NULL;
+	if (table->hash == HASH_MIXED) {
+		mixed = malloc(sizeof *mixed * n);
+		assert(mixed);
+		int i;
+		for (i = 0; i < n; i++) {
+			mixed[i] = mix_key(keys[i]);
+		}
+		keys = mixed;
+	}
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_lookup_batch(table->table, keys, n, results);
+	} else {
+		// forward the call onto the relevant batch lookup function
+		switch (table->type) {
+			case LINEAR:
+				linear_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			case XTNDBL1:
+				xtndbl1_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			case CUCKOO:
+				cuckoo_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			case XTNDBLN:
+				xtndbln_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			case XUCKOO:
+				xuckoo_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			case XUCKOON:
+				xuckoon_hash_table_lookup_batch(table->table, keys, n, results);
+				break;
+			default:
+				break;
+		}
+	}
+	free(mixed);
+}
+
+// call 'func' on every key in 'table' (along with its value and 'ctx'), in
+// the order they are laid out in memory
+void hash_table_foreach(HashTable *table, ScanFunc func, void *ctx) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+
+	// tables with scrambled keys unscramble each one before passing it on
+	UnmixedScan unmixed = { func, ctx };
+	if (table->hash == HASH_MIXED) {
+		func = unmix_scan;
+		ctx = &unmixed;
+	}
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_foreach(table->table, func, ctx);
+		return;
+	}
+
+	// forward the call onto the relevant foreach function
+	switch (table->type) {
+		case LINEAR:
+			linear_hash_table_foreach(table->table, func, ctx);
+			break;
+		case XTNDBL1:
+			xtndbl1_hash_table_foreach(table->table, func, ctx);
+			break;
+		case CUCKOO:
+			cuckoo_hash_table_foreach(table->table, func, ctx);
+			break;
+		case XTNDBLN:
+			xtndbln_hash_table_foreach(table->table, func, ctx);
+			break;
+		case XUCKOO:
+			xuckoo_hash_table_foreach(table->table, func, ctx);
+			break;
+		case XUCKOON:
+			xuckoon_hash_table_foreach(table->table, func, ctx);
+			break;
+		default:
+			break;
+	}
+}
+
+// get the key after 'cursor' in 'table', storing it in *key (and its value in
+// *value, if 'value' isn't NULL), and move 'cursor' past it
+// returns false if there are no keys left
+bool hash_table_next(HashTable *table, Cursor *cursor, int64 *key,
+	int64 *value) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_next(table->table, cursor, key, value);
+	}
+
+	// forward the call onto the relevant next function (unscrambling the
+	// key it gets, if the table's keys are scrambled)
+	bool found;
+	switch (table->type) {
+		case LINEAR:
+			found = linear_hash_table_next(table->table, cursor, key, value);
+			break;
+		case XTNDBL1:
+			found = xtndbl1_hash_table_next(table->table, cursor, key, value);
+			break;
+		case CUCKOO:
+			found = cuckoo_hash_table_next(table->table, cursor, key, value);
+			break;
+		case XTNDBLN:
+			found = xtndbln_hash_table_next(table->table, cursor, key, value);
+			break;
+		case XUCKOO:
+			found = xuckoo_hash_table_next(table->table, cursor, key, value);
+			break;
+		case XUCKOON:
+			found = xuckoon_hash_table_next(table->table, cursor, key, value);
+			break;
+		default:
+			found = false;
+			break;
+	}
+	if (found && table->hash == HASH_MIXED) {
+		*key = unmix_key(*key);
+	}
+	return found;
+}
+
+// insert the 'len' byte string 'key' into string table 'table', if it's not
+// in there already. returns true if insertion succeeds, false if it was
+// already in there
+bool hash_table_insert_str(HashTable *table, char *key, int len) {
+	assert(table != NULL);
+	assert(table->strings && "error: table holds integer keys!");
+
+	// forward the call onto the relevant insert function
+	if (table->type == LINEAR) {
+		return strlinear_hash_table_insert(table->table, key, len);
+	} else {
+		return strxtndbln_hash_table_insert(table->table, key, len);
+	}
+}
+
+// lookup whether the 'len' byte string 'key' is inside string table 'table'
+// returns true if found, false if not
+bool hash_table_lookup_str(HashTable *table, char *key, int len) {
+	assert(table != NULL);
+	assert(table->strings && "error: table holds integer keys!");
+
+	// forward the call onto the relevant lookup function
+	if (table->type == LINEAR) {
+		return strlinear_hash_table_lookup(table->table, key, len);
+	} else {
+		return strxtndbln_hash_table_lookup(table->table, key, len);
+	}
+}
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool hash_table_put(HashTable *table, int64 key, int64 value) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+	key = stored_key(table, key);
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_put(table->table, key, value);
+	}
+
+	// forward the call onto the relevant put function
+	switch (table->type) {
+		case LINEAR:
+			return linear_hash_table_put(table->table, key, value);
+		case XTNDBL1:
+			return xtndbl1_hash_table_put(table->table, key, value);
+		case CUCKOO:
+			return cuckoo_hash_table_put(table->table, key, value);
+		case XTNDBLN:
+			return xtndbln_hash_table_put(table->table, key, value);
+		case XUCKOO:
+			return xuckoo_hash_table_put(table->table, key, value);
+		case XUCKOON:
+			return xuckoon_hash_table_put(table->table, key, value);
+		default:
+			return false;
+	}
+}
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool hash_table_get(HashTable *table, int64 key, int64 *value) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+	key = stored_key(table, key);
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_get(table->table, key, value);
+	}
+
+	// forward the call onto the relevant get function
+	switch (table->type) {
+		case LINEAR:
+			return linear_hash_table_get(table->table, key, value);
+		case XTNDBL1:
+			return xtndbl1_hash_table_get(table->table, key, value);
+		case CUCKOO:
+			return cuckoo_hash_table_get(table->table, key, value);
+		case XTNDBLN:
+			return xtndbln_hash_table_get(table->table, key, value);
+		case XUCKOO:
+			return xuckoo_hash_table_get(table->table, key, value);
+		case XUCKOON:
+			return xuckoon_hash_table_get(table->table, key, value);
+		default:
+			return false;
+	}
+}
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool hash_table_update(HashTable *table, int64 key, int64 value) {
+	assert(table != NULL);
+	assert(!table->strings && "error: table holds string keys!");
+	assert(!table->disk && "error: not supported by disk tables!");
+	key = stored_key(table, key);
+
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		return shard_set_update(table->table, key, value);
+	}
+
+	// forward the call onto the relevant update function
+	switch (table->type) {
+		case LINEAR:
+			return linear_hash_table_update(table->table, key, value);
+		case XTNDBL1:
+			return xtndbl1_hash_table_update(table->table, key, value);
+		case CUCKOO:
+			return cuckoo_hash_table_update(table->table, key, value);
+		case XTNDBLN:
+			return xtndbln_hash_table_update(table->table, key, value);
+		case XUCKOO:
+			return xuckoo_hash_table_update(table->table, key, value);
+		case XUCKOON:
+			return xuckoon_hash_table_update(table->table, key, value);
+		default:
+			return false;
+	}
+}
+
 // print the contents of 'table' to stdout
 void hash_table_print(HashTable *table) {
 	assert(table != NULL);
 
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_print(table->table);
+		return;
+	}
+
+	// disk tables have their own print function
+	if (table->disk) {
+		diskxtndbln_hash_table_print(table->table);
+		return;
+	}
+
+	// string tables have their own print functions
+	if (table->strings) {
+		if (table->type == LINEAR) {
+			strlinear_hash_table_print(table->table);
+		} else {
+			strxtndbln_hash_table_print(table->table);
+		}
+		return;
+	}
+
 	// call the relevant print function
 	switch (table->type) {
 		case LINEAR:
@@ -208,6 +1019,28 @@ void hash_table_print(HashTable *table) {
 void hash_table_stats(HashTable *table) {
 	assert(table != NULL);
 
+	// sharded tables lock and forward the call to the right shard(s)
+	if (table->sharded) {
+		shard_set_stats(table->table);
+		return;
+	}
+
+	// disk tables have their own print stats function
+	if (table->disk) {
+		diskxtndbln_hash_table_stats(table->table);
+		return;
+	}
+
+	// string tables have their own print stats functions
+	if (table->strings) {
+		if (table->type == LINEAR) {
+			strlinear_hash_table_stats(table->table);
+		} else {
+			strxtndbln_hash_table_stats(table->table);
+		}
+		return;
+	}
+
 	// call the relevant print stats function
 	switch (table->type) {
 		case LINEAR:
@@ -231,4 +1064,57 @@ void hash_table_stats(HashTable *table) {
 		default:
 			break;
 	}
-}
\ No newline at end of file
+}
+
+// count the bytes 'table' is using into *usage (if 'usage' isn't NULL), and
+// return the total
+size_t hash_table_memory_usage(HashTable *table, MemoryUsage *usage) {
+	assert(table != NULL);
+	MemoryUsage counted;
+	if (usage == NULL) {
+		usage = &counted;
+	}
+
+	// sharded, disk and string tables have their own memory usage functions
+	if (table->sharded) {
+		shard_set_memory_usage(table->table, usage);
+	} else if (table->disk) {
+		diskxtndbln_hash_table_memory_usage(table->table, usage);
+	} else if (table->strings) {
+		if (table->type == LINEAR) {
+			strlinear_hash_table_memory_usage(table->table, usage);
+		} else {
+			strxtndbln_hash_table_memory_usage(table->table, usage);
+		}
+	} else {
+		// forward the call onto the relevant memory usage function
+		switch (table->type) {
+			case LINEAR:
+				linear_hash_table_memory_usage(table->table, usage);
+				break;
+			case XTNDBL1:
+				xtndbl1_hash_table_memory_usage(table->table, usage);
+				break;
+			case CUCKOO:
+				cuckoo_hash_table_memory_usage(table->table, usage);
+				break;
+			case XTNDBLN:
+				xtndbln_hash_table_memory_usage(table->table, usage);
+				break;
+			case XUCKOO:
+				xuckoo_hash_table_memory_usage(table->table, usage);
+				break;
+			case XUCKOON:
+				xuckoon_hash_table_memory_usage(table->table, usage);
+				break;
+			default:
+				usage->directory = usage->buckets = usage->slack = 0;
+				usage->stats = 0;
+				break;
+		}
+	}
+
+	// the wrapper itself belongs to the directory side
+	usage->directory += sizeof *table;
+	return memory_total(usage);
+}
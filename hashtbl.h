@@ -11,6 +11,8 @@
 
 #include <stdbool.h>
 #include "inthash.h"
+#include "tables/scan.h"
+#include "tables/memory.h"
 
 // enumerated type containing constants for the various types of hash table
 // supported
@@ -29,25 +31,201 @@ TableType strtotype(char *str);
 
 typedef struct table HashTable;
 
+// which hash functions a table's keys go through
+typedef enum hash_family {
+	HASH_AFFINE,	// h1 and h2 alone (see inthash.h)
+	HASH_MIXED		// h1 and h2 of each key scrambled by mix_key first, for
+					// keys too regular for h1 and h2 alone. not for XTNDBL1
+					// or XUCKOO tables: scrambled keys span all 64 bits, so
+					// two of them can share a whole hash value, and buckets
+					// of one key can never be split to tell them apart
+} HashFamily;
+
+// which key a cuckoo table kicks out of a full bucket to make room (only
+// XUCKOON tables have more than one key to choose from)
+typedef enum eviction_policy {
+	EVICT_RANDOM,	// any of them, at random
+	EVICT_ROTATE	// each slot in turn (which is deterministic, and saves
+					// seeding the random number generator on every insert)
+} EvictionPolicy;
+
+// how many of a table's inserts and lookups are timed for its stats (see
+// tables/latency.h). every one of them is still counted
+typedef enum stats_level {
+	STATS_NONE,		// none
+	STATS_SAMPLED,	// one in every STATS_SAMPLE_EVERY
+	STATS_ALL		// all of them (or one in every HT_STATS_SAMPLE, if the
+					// program was built with that set)
+} StatsLevel;
+#define STATS_SAMPLE_EVERY 64
+
+// everything about how a table of integer keys is set up and grows
+typedef struct hash_table_config {
+	TableType type;
+	int initial_size;	// how many slots LINEAR and CUCKOO tables start with
+						// (in each of their tables, for CUCKOO). the other
+						// types start from a single bucket and grow by
+						// splitting, so for them this is how many keys to
+						// make room for up front instead (0 for none)
+	int bucket_size;	// how many keys fit in each bucket of XTNDBLN and
+						// XUCKOON tables (the others hold one per bucket)
+	double max_load;	// LINEAR and CUCKOO tables grow once more than this
+						// fraction of their slots would be in use (at most 1:
+						// they always grow once full)
+	int growth;			// what LINEAR and CUCKOO tables multiply their size
+						// by when they grow (at least 2: extendible tables
+						// always double their address space)
+	HashFamily hash;
+	EvictionPolicy eviction;
+	StatsLevel stats;
+	bool values;		// store a value alongside each key (as for
+						// new_hash_map)?
+} HashTableConfig;
+
+// the configuration new_hash_table(type, size) uses: 'size' is the initial
+// size of LINEAR and CUCKOO tables and the bucket size of XTNDBLN and XUCKOON
+// tables (and XTNDBL1 and XUCKOO tables don't need it), and every other
+// setting keeps the table's usual behaviour
+HashTableConfig default_hash_table_config(TableType type, int size);
+
+// initialise a hash table set up as 'config' describes, and return its
+// pointer (or NULL if 'config' has no valid table type)
+// note: the keys of HASH_MIXED tables are stored scrambled, so
+// hash_table_print shows them that way (every other function takes and
+// gives back the original keys)
+HashTable *new_hash_table_ex(HashTableConfig *config);
+
 // initialise a hash table of type 'type' with initial size 'size',
 // and return its pointer
 HashTable *new_hash_table(TableType type, int size);
 
+// initialise a hash table of type 'type' with initial size 'size' which also
+// stores a value inline alongside each key, and return its pointer
+// (tables created with new_hash_table() store keys only, and don't support
+// the put/get/update functions below)
+HashTable *new_hash_map(TableType type, int size);
+
+// initialise a hash table of type 'type' holding the 'n' keys in 'keys', and
+// return its pointer. 'size' means the same as for new_hash_table, but the
+// table is built at its final size in one pass rather than growing key by key
+HashTable *new_hash_table_from_keys(TableType type, int size, int64 *keys,
+	int n);
+
+// initialise a hash table of type 'type' with initial size 'size' which holds
+// variable-length string keys rather than integers, and return its pointer
+// (only LINEAR and XTNDBLN tables support string keys: returns NULL for other
+// types. string tables only support the _str insert and lookup functions)
+HashTable *new_string_hash_table(TableType type, int size);
+
+// open the disk-resident XTNDBLN hash table stored in the files 'path'.pages
+// (its buckets, one 4 KB page each) and 'path'.dir (its directory), creating
+// an empty table if they don't exist yet, and return its pointer. up to
+// 'npages' buckets are cached in memory at a time. returns NULL if the files
+// can't be opened. disk tables only support the insert, lookup, print and
+// stats functions, and are written back to their files when freed
+HashTable *new_disk_hash_table(char *path, int npages);
+
+// initialise a hash table of type 'type' which several threads can use at
+// once, and return its pointer. it is made of 2^'shardbits' independent tables
+// (shards) with initial size 'size', each holding the keys whose hash values
+// start with its number, and each with its own lock. if 'rwlocks' is true,
+// the locks are reader-writer locks, so lookups in the same shard can run at
+// the same time (updating their tables' stats atomically). sharded tables
+// support every function below except save.
+HashTable *new_sharded_hash_table(TableType type, int size, int shardbits,
+	bool rwlocks);
+
+// initialise a sharded hash table (as above) which also stores a value inline
+// alongside each key, and return its pointer
+HashTable *new_sharded_hash_map(TableType type, int size, int shardbits,
+	bool rwlocks);
+
 // free all memory associated with 'table'
 void free_hash_table(HashTable *table);
 
+// write 'table' to a binary snapshot file at 'path' (replacing the file only
+// once the whole snapshot has been written), from which it can be loaded again
+// with hash_table_load by a build of this same program
+// returns true if the snapshot was saved, false if the file couldn't be written
+bool hash_table_save(HashTable *table, char *path);
+
+// load the table saved in the snapshot file at 'path', and return its pointer
+// the file is mapped into memory and the table's arrays and buckets are used
+// from it in place (memory is only copied as it changes), so even a large
+// table is ready to use almost straight away. returns NULL if the file can't be
+// read, or doesn't hold a snapshot written by this version of the program
+HashTable *hash_table_load(char *path);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool hash_table_insert(HashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, growing it now (all at once)
+// rather than while those keys are being inserted (up to the largest size the
+// table can have, however large 'n' is)
+void hash_table_reserve(HashTable *table, int n);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool hash_table_lookup(HashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys'). equivalent to calling
+// hash_table_insert on each key in order, but faster for large batches
+void hash_table_insert_batch(HashTable *table, int64 *keys, int n,
+	bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not. equivalent to
+// calling hash_table_lookup on each key, but faster for large batches
+void hash_table_lookup_batch(HashTable *table, int64 *keys, int n,
+	bool *results);
+
+// call 'func' on every key in 'table' (along with its value, or 0 if the table
+// doesn't store values, and 'ctx'). keys are visited in the order they are
+// laid out in memory, so the order is unrelated to the order of insertion.
+// 'table' must not be changed until the scan is over
+void hash_table_foreach(HashTable *table, ScanFunc func, void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as
+// hash_table_foreach), storing it in *key (and its value in *value, if 'value'
+// isn't NULL), and move 'cursor' past it. returns false if there are no keys
+// left. start with a cursor initialised to CURSOR_START, and don't change
+// 'table' until the scan is over
+bool hash_table_next(HashTable *table, Cursor *cursor, int64 *key,
+	int64 *value);
+
+// insert the 'len' byte string 'key' into string table 'table', if it's not
+// in there already. returns true if insertion succeeds, false if it was
+// already in there
+bool hash_table_insert_str(HashTable *table, char *key, int len);
+
+// lookup whether the 'len' byte string 'key' is inside string table 'table'
+// returns true if found, false if not
+bool hash_table_lookup_str(HashTable *table, char *key, int len);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool hash_table_put(HashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool hash_table_get(HashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool hash_table_update(HashTable *table, int64 key, int64 value);
+
 // print the contents of 'table' to stdout
 void hash_table_print(HashTable *table);
 
 // print some statistics about 'table' to stdout
 void hash_table_stats(HashTable *table);
 
+// count the bytes 'table' is using, split up as described in tables/memory.h,
+// into *usage (if 'usage' isn't NULL), and return the total
+size_t hash_table_memory_usage(HashTable *table, MemoryUsage *usage);
+
 #endif
@@ -10,12 +10,21 @@
 // constants for first hash function
 #define A1 885390553
 #define B1 639360243
-#define p1 2147483629
+#define p1 H1_RANGE
+#define A1_INVERSE 131189358	// (A1 * A1_INVERSE) % p1 == 1
 
 // constants for second hash function
 #define A2 853977193
 #define B2 306837493
-#define p2 2147483563
+#define p2 H2_RANGE
+#define A2_INVERSE 1252661564	// (A2 * A2_INVERSE) % p2 == 1
+
+// multipliers for scrambling keys (from the SplitMix64 generator), and their
+// inverses modulo 2^64 for unscrambling them
+#define M1 0xbf58476d1ce4e5b9ULL
+#define M2 0x94d049bb133111ebULL
+#define M1_INVERSE 0x96de1b173f119089ULL
+#define M2_INVERSE 0x319642b2d24d8ec3ULL
 
 // first available hash function
 int h1(int64 k) {
@@ -26,3 +35,39 @@ int h1(int64 k) {
 int h2(int64 k) {
 	return (A2 * k + B2) % p2;
 }
+
+// get the n-th smallest key whose h1 hash value is 'hash': solve
+// A1 * key + B1 = hash (mod p1) for the smallest key, then add p1 n times
+// (every key below 2^64 / A1 avoids overflow, and these all stay below it)
+int64 h1_key(int hash, int n) {
+	int64 key = ((int64)hash + p1 - B1) % p1 * A1_INVERSE % p1;
+	return key + (int64)n * p1;
+}
+
+// get the n-th smallest key whose h2 hash value is 'hash', as for h1_key
+int64 h2_key(int hash, int n) {
+	int64 key = ((int64)hash + p2 - B2) % p2 * A2_INVERSE % p2;
+	return key + (int64)n * p2;
+}
+
+// scramble 'k' so that every bit of it affects every bit of the result
+// (each step can be undone, so no two keys scramble to the same result)
+int64 mix_key(int64 k) {
+	k ^= k >> 30;
+	k *= M1;
+	k ^= k >> 27;
+	k *= M2;
+	k ^= k >> 31;
+	return k;
+}
+
+// get back the key that mix_key scrambled into 'k', by undoing each of its
+// steps in reverse
+int64 unmix_key(int64 k) {
+	k ^= (k >> 31) ^ (k >> 62);
+	k *= M2_INVERSE;
+	k ^= (k >> 27) ^ (k >> 54);
+	k *= M1_INVERSE;
+	k ^= (k >> 30) ^ (k >> 60);
+	return k;
+}
@@ -30,10 +30,35 @@ typedef uint64_t int64;
 // when using these functions, remember to modulo by the size of your hash table
 // to get a valid address
 
+// every value h1 and h2 return is below these (they are the primes p)
+#define H1_RANGE 2147483629
+#define H2_RANGE 2147483563
+
 // first available hash function
 int h1(int64 k);
 
 // second available hash function
 int h2(int64 k);
 
+// how many keys h1_key and h2_key can find for each hash value: the keys
+// small enough that A * key + B doesn't overflow
+#define HASH_PREIMAGES 9
+
+// get the n-th smallest key (0 <= n < HASH_PREIMAGES) whose h1 hash value is
+// 'hash' (0 <= hash < H1_RANGE), for making sets of keys that collide
+int64 h1_key(int hash, int n);
+
+// get the n-th smallest key (0 <= n < HASH_PREIMAGES) whose h2 hash value is
+// 'hash' (0 <= hash < H2_RANGE)
+int64 h2_key(int hash, int n);
+
+// scramble 'k' so that every bit of it affects every bit of the result, for
+// tables whose keys are too regular for h1 and h2 alone (e.g. all multiples
+// of some large number). no two keys scramble to the same result, and
+// unmix_key gets the original key back
+int64 mix_key(int64 k);
+
+// get back the key that mix_key scrambled into 'k'
+int64 unmix_key(int64 k);
+
 #endif
@@ -0,0 +1,337 @@
+/* * * * * * * * *
+ * Load generator for the hash table server (a2 --listen): several clients
+ * at once each send pipelined batches of inserts and lookups over their own
+ * connection, then the throughput of the whole run and the latency of each
+ * command (from sending its batch to receiving its result) are reported
+ *
+ * usage:
+ *   make loadgen
+ *   ./loadgen [-b] [-c clients] [-n commands] [-d depth] [-r percent] socket
+ *       -b: send binary commands instead of text
+ *       -c: how many clients to connect at once (default 4)
+ *       -n: how many commands each client sends (default 100000)
+ *       -d: how many commands each client sends before waiting for their
+ *           results (default 64)
+ *       -r: what percentage of the commands are lookups (default 50), half
+ *           of them for keys the client has inserted and half for keys that
+ *           nobody inserts
+ *       socket: the path of the server's socket
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "inthash.h"
+#include "commands.h"
+#include "tables/latency.h"
+
+#define DEFAULT_CLIENTS 4
+#define DEFAULT_COMMANDS 100000
+#define DEFAULT_DEPTH 64
+#define DEFAULT_LOOKUP_PERCENT 50
+
+// the most bytes one text command takes up ("i ", 20 digits and a newline)
+#define MAX_TEXT_COMMAND 24
+
+// how many bytes of results to read at once
+#define READ_SIZE (1 << 16)
+
+// keys nobody inserts start here (inserted keys are all below it)
+#define MISSING_KEYS (1ULL << 62)
+
+// the percentiles of command latency to report
+static double percentiles[] = { 50, 90, 99, 99.9 };
+#define NPERCENTILES (sizeof percentiles / sizeof *percentiles)
+
+// the shape of the load, shared by every client
+typedef struct load {
+	char *path;
+	bool binary;
+	int depth;
+	int lookup_percent;
+	int ncommands;		// (per client)
+} Load;
+
+// one client, run on a thread of its own
+typedef struct client {
+	Load *load;
+	int number;
+	int64 *latencies;	// how long each command took, in ns
+	int64 outcomes[NOT_FOUND + 1];	// (binary only: text results aren't
+									// counted)
+	bool failed;
+	pthread_t thread;
+} Client;
+
+/*************************************************************************/
+
+void printusageexit(char *exe) {
+	fprintf(stderr, "usage: %s [-b] [-c clients] [-n commands] [-d depth] "
+		"[-r percent] socket\n", exe);
+	fprintf(stderr, " -b: send binary commands instead of text\n");
+	fprintf(stderr, " -c: how many clients to connect at once (default %d)\n",
+		DEFAULT_CLIENTS);
+	fprintf(stderr, " -n: how many commands each client sends (default %d)\n",
+		DEFAULT_COMMANDS);
+	fprintf(stderr, " -d: how many commands to send before waiting for their "
+		"results (default %d)\n", DEFAULT_DEPTH);
+	fprintf(stderr, " -r: what percentage of the commands are lookups "
+		"(default %d)\n", DEFAULT_LOOKUP_PERCENT);
+	fprintf(stderr, " socket: the path of the server's socket (a2 --listen)\n");
+	exit(1);
+}
+
+// a small xorshift pseudo-random number generator, one state per client, so
+// that every run sends exactly the same commands
+static int64 next_random(int64 *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// the i-th key inserted by client number 'c': distinct across every client
+static int64 client_key(int c, int64 i) {
+	return (((int64)c << 40) + i) * 2654435761ULL % MISSING_KEYS;
+}
+
+// add a command with operation 'op' and argument 'key' to 'bytes' (as text,
+// or in binary form if 'binary' is true), returning how many bytes it took
+static int encode_command(char *bytes, bool binary, char op, int64 key) {
+	if (!binary) {
+		return sprintf(bytes, "%c %llu\n", op, key);
+	}
+	int n = 0;
+	bytes[n++] = op | BINARY_HAS_KEY;
+	while (key >= 0x80) {
+		bytes[n++] = (key & 0x7f) | 0x80;
+		key >>= 7;
+	}
+	bytes[n++] = key;
+	return n;
+}
+
+// connect to the server's socket at 'path'
+// returns the connection, or -1 (after saying why) if it can't connect
+static int connect_to(char *path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof address);
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path, sizeof address.sun_path - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof address)
+		!= 0) {
+		perror("error: can't connect to server");
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+// write all 'len' bytes at 'bytes' to 'fd'
+// returns false if the connection has gone
+static bool write_all(int fd, char *bytes, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, bytes, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		len -= n;
+	}
+	return true;
+}
+
+/*************************************************************************/
+
+// send the client's commands in batches of 'depth', waiting for the results
+// of each batch before sending the next, and timing every command
+static void *run_client(void *arg) {
+	Client *client = arg;
+	Load *load = client->load;
+	int fd = connect_to(load->path);
+	if (fd < 0) {
+		client->failed = true;
+		return NULL;
+	}
+
+	char *batch = malloc((size_t)load->depth * MAX_TEXT_COMMAND);
+	char *results = malloc(READ_SIZE);
+	assert(batch && results);
+	if (load->binary && !write_all(fd, (char *)binary_header,
+		BINARY_HEADER_SIZE)) {
+		client->failed = true;
+	}
+
+	int64 state = 88172645463325252ULL + client->number, ninserted = 0;
+	int sent = 0;
+	while (sent < load->ncommands && !client->failed) {
+
+		// make up the next batch of commands
+		int n = load->ncommands - sent < load->depth
+			? load->ncommands - sent : load->depth, i;
+		size_t len = 0;
+		for (i = 0; i < n; i++) {
+			int64 r = next_random(&state);
+			if (r % 100 < load->lookup_percent && ninserted > 0) {
+				int64 key = (r >> 8) & 1
+					? client_key(client->number, (r >> 9) % ninserted)
+					: MISSING_KEYS + (r >> 9);
+				len += encode_command(batch + len, load->binary, 'l', key);
+			} else {
+				len += encode_command(batch + len, load->binary, 'i',
+					client_key(client->number, ninserted++));
+			}
+		}
+
+		// send them all, and time each one until its result arrives
+		int64 start = read_clock();
+		if (!write_all(fd, batch, len)) {
+			client->failed = true;
+			break;
+		}
+		int done = 0;
+		while (done < n) {
+			ssize_t got = read(fd, results, READ_SIZE);
+			if (got < 0 && errno == EINTR) {
+				continue;
+			}
+			if (got <= 0) {
+				client->failed = true;
+				break;
+			}
+			int64 now = read_clock();
+			for (i = 0; i < got; i++) {
+				if (load->binary) {
+					if (results[i] >= INSERTED && results[i] <= NOT_FOUND) {
+						client->outcomes[(int)results[i]]++;
+					}
+				} else if (results[i] != '\n') {
+					continue;
+				}
+				client->latencies[sent + done++] = now - start;
+			}
+		}
+		sent += n;
+	}
+
+	// say goodbye, and wait for the server to hang up
+	shutdown(fd, SHUT_WR);
+	while (read(fd, results, READ_SIZE) > 0) {
+	}
+	close(fd);
+	free(batch);
+	free(results);
+	return NULL;
+}
+
+// compare latencies, for sorting them
+static int compare_latencies(const void *a, const void *b) {
+	int64 x = *(const int64 *)a, y = *(const int64 *)b;
+	return (x > y) - (x < y);
+}
+
+/*************************************************************************/
+
+int main(int argc, char **argv) {
+	Load load = { .binary = false, .depth = DEFAULT_DEPTH,
+		.lookup_percent = DEFAULT_LOOKUP_PERCENT,
+		.ncommands = DEFAULT_COMMANDS };
+	int nclients = DEFAULT_CLIENTS, option;
+	while ((option = getopt(argc, argv, "bc:n:d:r:")) != -1) {
+		switch (option) {
+			case 'b':
+				load.binary = true;
+				break;
+			case 'c':
+				nclients = atoi(optarg);
+				break;
+			case 'n':
+				load.ncommands = atoi(optarg);
+				break;
+			case 'd':
+				load.depth = atoi(optarg);
+				break;
+			case 'r':
+				load.lookup_percent = atoi(optarg);
+				break;
+			default:
+				printusageexit(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || nclients <= 0 || load.ncommands <= 0
+		|| load.depth <= 0 || load.lookup_percent < 0
+		|| load.lookup_percent > 100) {
+		printusageexit(argv[0]);
+	}
+	load.path = argv[optind];
+
+	// run every client at once
+	Client *clients = calloc(nclients, sizeof *clients);
+	int64 *latencies = malloc(sizeof *latencies * nclients * load.ncommands);
+	assert(clients && latencies);
+	int64 start = read_clock();
+	int c;
+	for (c = 0; c < nclients; c++) {
+		clients[c].load = &load;
+		clients[c].number = c;
+		clients[c].latencies = latencies + (int64)c * load.ncommands;
+		pthread_create(&clients[c].thread, NULL, run_client, &clients[c]);
+	}
+	bool failed = false;
+	int64 outcomes[NOT_FOUND + 1] = { 0 };
+	for (c = 0; c < nclients; c++) {
+		pthread_join(clients[c].thread, NULL);
+		failed = failed || clients[c].failed;
+		int o;
+		for (o = 0; o <= NOT_FOUND; o++) {
+			outcomes[o] += clients[c].outcomes[o];
+		}
+	}
+	double seconds = (read_clock() - start) / 1e9;
+	if (failed) {
+		fprintf(stderr, "error: a client lost its connection\n");
+		exit(1);
+	}
+
+	// report throughput, and latency percentiles across every command
+	int64 total = (int64)nclients * load.ncommands;
+	qsort(latencies, total, sizeof *latencies, compare_latencies);
+	printf("%d clients sent %llu %s commands (in batches of %d) in %.3f s: "
+		"%.0f commands/s\n", nclients, total, load.binary ? "binary" : "text",
+		load.depth, seconds, seconds > 0 ? total / seconds : 0);
+	if (load.binary) {
+		printf("%llu inserted, %llu duplicates, %llu found, %llu not found\n",
+			outcomes[INSERTED], outcomes[DUPLICATE], outcomes[FOUND],
+			outcomes[NOT_FOUND]);
+	}
+	printf("latency (us):");
+	int p;
+	for (p = 0; p < NPERCENTILES; p++) {
+		int64 rank = (int64)(percentiles[p] / 100 * (total - 1));
+		printf(" p%g %.1f", percentiles[p], latencies[rank] / 1e3);
+	}
+	printf(" max %.1f\n", latencies[total - 1] / 1e3);
+
+	free(clients);
+	free(latencies);
+	return 0;
+}
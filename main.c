@@ -14,14 +14,51 @@
 
 #include "inthash.h"
 #include "hashtbl.h"
+#include "tables/events.h"
+#include "strhash.h"
+#include "commands.h"
+#include "pipeline.h"
+#include "compare.h"
+#include "server.h"
+#include "replay.h"
 
 // command line options
 #define DEFAULT_SIZE 4
+#define DEFAULT_POOL_PAGES 256
 typedef struct options {
 	TableType type;
+	TableType types[NTABLE_TYPES];	// every type to compare, with -t all
+	int ntypes;						// or a list (1 unless comparing)
 	int initial_size;
+	int capacity;		// initial capacity, overriding -s (0 if not given)
+	int bucket_size;	// keys per bucket, overriding -s (0 if not given)
+	double max_load;	// the fraction of slots to fill before growing
+	int growth;			// what to multiply the table's size by to grow it
+	HashFamily hash;
+	EvictionPolicy eviction;
+	StatsLevel stats;
+	bool tuned;			// were any of the seven settings above given?
+	bool grows;			// were --max-load or --growth given?
+	bool evicts;		// was --eviction given?
+	bool strings;		// use string keys instead of integers?
+	int expected_keys;	// how many keys to make room for up front (or 0)
+	bool prescan;		// count the insert commands first, to make room for?
+	char *load_path;	// snapshot to load the table from (NULL for none)
+	char *save_path;	// snapshot to save the table to on quit (NULL for none)
+	char *disk_path;	// files to keep the table's buckets in (NULL for none)
+	int pool_pages;		// how many of those buckets to cache in memory
+	int events;			// how many structural events to trace (0 for none)
+	bool binary;		// read binary commands instead of text?
+	bool convert;		// convert commands (text to binary, or back with -b)?
+	bool quiet;			// count results instead of printing each one?
+	int threads;		// how many threads to pipeline commands over (or 0)
+	char *listen_path;	// socket to serve commands on (NULL for stdin)
+	char *replay_path;	// commands to replay and time (NULL for none)
+	int window;			// how many replayed commands to report on together
 } Options;
 Options get_options(int argc, char** argv);
+int strtotypes(char *str, TableType *types);
+HashTableConfig table_config(Options *options, TableType type);
 
 
 // interpreter commands
@@ -30,30 +67,120 @@ Options get_options(int argc, char** argv);
 #define LOOKUP 'l'
 #define PRINT  'p'
 #define STATS  's'
+#define EVENTS 'e'
+#define EVENTS_JSON 'j'
 #define HELP   'h'
 #define QUIT   'q'
-#define MAX_LINE_LEN 80
-int get_command(char *operation, int64 *key);
+FILE *count_inserts(int *ninserts);
 
 
 // main program
 
-void run_interpreter(HashTable *table);
+bool run_interpreter(HashTable *table, Options *options, FILE *input);
+bool convert_commands(bool binary, FILE *input);
 
 int main(int argc, char **argv) {
 	
 	// get command line options (to determine table type, size, etc.)
 	Options options = get_options(argc, argv);
 
-	// create hashtable (of given type)
-	HashTable *table = new_hash_table(options.type, options.initial_size);
+	// converting commands doesn't need a table at all
+	if (options.convert) {
+		return convert_commands(options.binary, stdin) ? 0 : EXIT_FAILURE;
+	}
+
+	// comparing table types makes a table of each type in turn
+	if (options.ntypes > 1) {
+		HashTableConfig configs[NTABLE_TYPES];
+		int t;
+		for (t = 0; t < options.ntypes; t++) {
+			configs[t] = table_config(&options, options.types[t]);
+		}
+		CommandReader *reader = new_command_reader(stdin, NULL);
+		bool intact = (!options.binary || read_binary_header(reader))
+			&& compare_tables(configs, options.ntypes, options.expected_keys,
+				reader);
+		if (!intact) {
+			fprintf(stderr, "error: input isn't intact binary commands\n");
+		}
+		free_command_reader(reader);
+		free_event_log();
+		return intact ? 0 : EXIT_FAILURE;
+	}
+
+	// start tracing structural changes before the table makes any, if asked
+	if (options.events > 0) {
+		enable_event_log(options.events);
+	}
+
+	// create hashtable (of given type and key type), or load it from a
+	// snapshot
+	HashTable *table;
+	if (options.disk_path != NULL) {
+		table = new_disk_hash_table(options.disk_path, options.pool_pages);
+		if (table == NULL) {
+			fprintf(stderr, "can't open a disk table at %s\n",
+				options.disk_path);
+			exit(EXIT_FAILURE);
+		}
+	} else if (options.load_path != NULL) {
+		table = hash_table_load(options.load_path);
+		if (table == NULL) {
+			fprintf(stderr, "can't load a snapshot from %s\n",
+				options.load_path);
+			exit(EXIT_FAILURE);
+		}
+	} else if (options.strings) {
+		table = new_string_hash_table(options.type, options.initial_size);
+	} else {
+		HashTableConfig config = table_config(&options, options.type);
+		table = new_hash_table_ex(&config);
+	}
+	if (table == NULL) {
+		fprintf(stderr, "string keys are only supported by linear and "
+			"xtndbln tables\n");
+		exit(EXIT_FAILURE);
+	}
 
-	// start the interpreter loop
-	run_interpreter(table);
+	// make room for the keys we're expecting (counting the insert commands to
+	// find out how many, if asked to)
+	FILE *input = stdin;
+	if (options.prescan) {
+		input = count_inserts(&options.expected_keys);
+	}
+	if (options.expected_keys > 0) {
+		hash_table_reserve(table, options.expected_keys);
+	}
+
+	// start the interpreter loop (or serve clients' commands instead)
+	int status = 0;
+	if (options.listen_path != NULL) {
+		if (!serve_hash_table(table, options.listen_path, options.strings)) {
+			status = EXIT_FAILURE;
+		}
+	} else if (options.replay_path != NULL) {
+		if (!replay_file(table, options.replay_path, options.binary,
+			options.window)) {
+			status = EXIT_FAILURE;
+		}
+	} else if (!run_interpreter(table, &options, input)) {
+		status = EXIT_FAILURE;
+	}
+
+	// save the table for next time, if asked to
+	if (options.save_path != NULL
+		&& !hash_table_save(table, options.save_path)) {
+		fprintf(stderr, "can't save a snapshot to %s\n", options.save_path);
+		status = EXIT_FAILURE;
+	}
 
 	// done!
+	if (input != stdin) {
+		fclose(input);
+	}
 	free_hash_table(table);
-	return 0;
+	free_event_log();
+	return status;
 }
 
 // print out the valid operations
@@ -62,56 +189,158 @@ void print_operations() {
 	printf(" %c number: lookup is 'number' in table\n", LOOKUP);
 	printf(" %c: print table\n", PRINT);
 	printf(" %c: print stats\n", STATS);
+	printf(" %c: print traced events as CSV (run with -e)\n", EVENTS);
+	printf(" %c: print traced events as JSON (run with -e)\n", EVENTS_JSON);
 	printf(" %c: quit\n", QUIT);
 }
 
-// run the interpreter, reading and performing commands until 'quit'
-void run_interpreter(HashTable *table) {
+// where the results of inserts and lookups go: they're counted, and unless
+// 'quiet' is true, collected in 'output' to be written out in large blocks
+// (by the pipeline's writer thread, if it has one) rather than printed one
+// at a time
+typedef struct result_sink {
+	Output output;
+	Results results;
+	bool quiet;
+	Pipeline *pipeline;		// (NULL if commands aren't pipelined)
+} ResultSink;
+
+// count the result of an insert or lookup of 'key' (or 'word', if it's not
+// NULL) in 'sink', and add it to the results to write out: the key or word
+// followed by a description of 'outcome'
+static void output_result(ResultSink *sink, int64 key, char *word,
+	Outcome outcome) {
+	static char *descriptions[] = { " inserted\n", " already in table\n",
+		" found\n", " not found\n" };
+	add_result(&sink->results, word != NULL ? strhash(word, strlen(word))
+		: key, outcome);
+	if (sink->quiet) {
+		return;
+	}
+	if (sink->pipeline != NULL && pipeline_has_writer(sink->pipeline)) {
+		pipe_result(sink->pipeline, key, word, descriptions[outcome]);
+		return;
+	}
+	if (word != NULL) {
+		output_text(&sink->output, word);
+	} else {
+		output_key(&sink->output, key);
+	}
+	output_text(&sink->output, descriptions[outcome]);
+}
+
+// write out every result in 'sink' so far, so that something can be printed
+// after them
+static void flush_results(ResultSink *sink) {
+	if (sink->pipeline != NULL) {
+		drain_results(sink->pipeline);
+	} else {
+		flush_output(&sink->output);
+	}
+}
+
+// run the interpreter, reading and performing commands from 'input' until
+// 'quit' (or the end of the input). with string keys (-k string), the
+// arguments of insert and lookup commands are read as words rather than
+// numbers. with -b, the commands are read in binary form rather than as
+// text. with -q, the results of inserts and lookups are only counted, and
+// their totals printed at the end. with -p, commands are read (and results
+// written) by other threads while they are being performed
+// returns false if binary commands turn out to be corrupt
+bool run_interpreter(HashTable *table, Options *options, FILE *input) {
+	bool strings = options->strings;
 	
 	// print a prompt at the beginning
 	printf("enter a command (h for help):\n");
+
+	// set up where commands come from and where results go
+	static ResultSink sink;
+	sink.output.len = 0;
+	sink.quiet = options->quiet;
+	sink.pipeline = NULL;
+	initialise_results(&sink.results);
+	CommandReader *reader = new_command_reader(input,
+		options->threads > 0 ? NULL : &sink.output);
+	if (options->binary && !read_binary_header(reader)) {
+		fprintf(stderr, "error: input isn't intact binary commands\n");
+		free_command_reader(reader);
+		return false;
+	}
+	if (options->threads > 0) {
+		sink.pipeline = start_pipeline(options->threads, reader, strings,
+			&sink.output);
+	}
 	
 	char op;
+	int argc;
 	int64 key;
+	char word[MAX_LINE_LEN];
 	
 	// then loop, getting and executing commands, until 'quit'
-	while (true) {
-
-		// read a command, storing results in op and key variables
-		int argc = get_command(&op, &key);
+	bool running = true;
+	while (running) {
+
+		// read a command, storing results in op and key (or word) variables
+		if (sink.pipeline != NULL) {
+			argc = next_piped_command(sink.pipeline, &op, &key,
+				strings ? word : NULL);
+		} else {
+			argc = read_command(reader, &op, &key, strings ? word : NULL);
+		}
+		if (argc == NO_MORE_COMMANDS || argc == BAD_COMMANDS) {
+			break; // no commands left
+		}
 		if (argc < 1) {
 			continue; // no valid command entered, get another
 		}
 
+		// other commands print their own results, so write out everything
+		// before them first
+		if (op != INSERT && op != LOOKUP) {
+			flush_results(&sink);
+		}
+
 		// execute the command
 		switch (op) {
 			case INSERT:
 				if (argc < 2) {
 					// insert commands must have an argument
+					flush_results(&sink);
 					printf("syntax: %c number\n", INSERT);
 				
+				} else if (strings) {
+					// perform the insertion of a string key
+					bool inserted = hash_table_insert_str(table, word,
+						strlen(word));
+					output_result(&sink, 0, word,
+						inserted ? INSERTED : DUPLICATE);
+
 				} else {
 					// perform the insertion
-					if (hash_table_insert(table, key)) {
-						printf("%llu inserted\n", key);
-					} else {
-						printf("%llu already in table\n", key);
-					}
+					bool inserted = hash_table_insert(table, key);
+					output_result(&sink, key, NULL,
+						inserted ? INSERTED : DUPLICATE);
 				}
 				break;
 
 			case LOOKUP:
 				if (argc < 2) {
 					// lookup commands must have an argument
+					flush_results(&sink);
 					printf("syntax: %c number\n", LOOKUP);
 
+				} else if (strings) {
+					// perform the lookup of a string key
+					bool found = hash_table_lookup_str(table, word,
+						strlen(word));
+					output_result(&sink, 0, word,
+						found ? FOUND : NOT_FOUND);
+
 				} else {
 					// perform the lookup
-					if (hash_table_lookup(table, key)) {
-						printf("%llu found\n", key);
-					} else {
-						printf("%llu not found\n", key);
-					}
+					bool found = hash_table_lookup(table, key);
+					output_result(&sink, key, NULL,
+						found ? FOUND : NOT_FOUND);
 				}
 				break;
 
@@ -125,6 +354,12 @@ void run_interpreter(HashTable *table) {
 				hash_table_stats(table);
 				break;
 
+			case EVENTS:
+			case EVENTS_JSON:
+				// print the resizes and splits traced so far
+				print_event_log(op == EVENTS_JSON);
+				break;
+
 			default:
 				// display error
 				printf("unknown operation '%c'\n", op);
@@ -138,52 +373,338 @@ void run_interpreter(HashTable *table) {
 			case QUIT:
 				// leave the interpreter loop
 				printf("exiting\n");
-				return;
+				if (sink.pipeline == NULL) {
+					argc = finish_commands(reader);
+				}
+				running = false;
+				break;
 		}
 	}
+
+	// stop any other threads (still checking binary commands after a 'quit')
+	if (sink.pipeline != NULL) {
+		argc = stop_pipeline(sink.pipeline, options->binary);
+	}
+
+	// write out the last results (if the input ended without a 'quit'), or
+	// just their totals
+	flush_output(&sink.output);
+	if (options->quiet) {
+		print_results(&sink.results);
+	}
+	free_command_reader(reader);
+	if (argc == BAD_COMMANDS) {
+		fprintf(stderr, "error: binary commands are cut short or corrupt\n");
+		return false;
+	}
+	return true;
 }
 
-// reads a line from stdin, parses it into an operation character and possibly
-// a long long uinteger argument. store results in *operation and *key, resp.
-//
-// returns the number of tokens successfully read (e.g. 0 for none,
-// 1 for operation only, 2 for both operation and integer)
-int get_command(char *operation, int64 *key) {
-	
-	// read a line from stdin, up to MAX_LINE_LENGTH, into character buffer
-	char line[MAX_LINE_LEN];
-	fgets(line, MAX_LINE_LEN, stdin);
-	line[strlen(line)-1] = '\0'; // strip trailing newline
-
-	// attempt to parse the line string into *operation and *key
-	int argc = sscanf(line, "%c %llu", operation, key);
-	// note: since llu is unsigned, a command like 'i -1' will overflow,
-	// resulting in *key = 18446744073709551615 (2^64-1). this is a feature.
-	
-	// return the number of variables successfully read, as required
-	return argc;
+// convert the commands on 'input' to binary form, or from binary form back
+// to text if 'binary' is true, writing them to stdout. commands are converted
+// as they would be read by the interpreter, so blank lines are left out (and
+// overlong lines are split up)
+// returns false if binary commands turn out to be corrupt
+bool convert_commands(bool binary, FILE *input) {
+	static Output output;
+	output.len = 0;
+	CommandReader *reader = new_command_reader(input, &output);
+	if (binary && !read_binary_header(reader)) {
+		fprintf(stderr, "error: input isn't intact binary commands\n");
+		free_command_reader(reader);
+		return false;
+	}
+
+	BinaryWriter writer;
+	if (!binary) {
+		start_binary_commands(&writer, stdout);
+	}
+
+	char op, text[2] = { 0 };
+	int argc;
+	int64 key;
+	while ((argc = read_command(reader, &op, &key, NULL)) != NO_MORE_COMMANDS
+		&& argc != BAD_COMMANDS) {
+		if (argc < 1) {
+			continue; // nothing to convert
+		}
+
+		if (!binary) {
+			// binary commands have room for ASCII operations only
+			if (op <= 0) {
+				fprintf(stderr, "skipping a command with operation byte %d\n",
+					(unsigned char)op);
+				continue;
+			}
+			write_binary_command(&writer, op, argc, key);
+		} else {
+			text[0] = op;
+			output_text(&output, text);
+			if (argc == 2) {
+				output_text(&output, " ");
+				output_key(&output, key);
+			}
+			output_text(&output, "\n");
+		}
+	}
+
+	if (!binary) {
+		end_binary_commands(&writer);
+	}
+	flush_output(&output);
+	free_command_reader(reader);
+	if (argc == BAD_COMMANDS) {
+		fprintf(stderr, "error: binary commands are cut short or corrupt\n");
+		return false;
+	}
+	return true;
 }
 
+// counts the insert commands on stdin (lines starting with the insert
+// operation), storing the count in *ninserts, without losing any commands
+// returns the stream to read the commands from: stdin itself rewound, if it
+// is a file, or otherwise a temporary copy of everything read from it
+FILE *count_inserts(int *ninserts) {
+
+	// if stdin can't be rewound (e.g. it's a pipe), copy it as we go
+	FILE *input = stdin, *copy = NULL;
+	if (fseek(stdin, 0, SEEK_CUR) != 0) {
+		copy = tmpfile();
+		if (copy == NULL) {
+			perror("error: can't pre-scan commands");
+			exit(EXIT_FAILURE);
+		}
+		input = copy;
+	}
+
+	// count the lines whose first character is the insert operation
+	int c, count = 0;
+	bool line_start = true;
+	while ((c = getchar()) != EOF) {
+		if (line_start && c == INSERT) {
+			count++;
+		}
+		line_start = (c == '\n');
+		if (copy != NULL) {
+			putc(c, copy);
+		}
+	}
 
+	// then go back to the first command
+	rewind(input);
+	*ninserts = count;
+	return input;
+}
 
 
+
+
+// converts a table type option into the types it names, stored in 'types':
+// a single type (see strtotype), a comma-separated list of them, or "all"
+// for every type
+// returns how many types there are, 0 if any of them isn't a type, or -1 if
+// there are more than NTABLE_TYPES of them
+int strtotypes(char *str, TableType *types) {
+	int n = 0;
+	if (strcmp(str, "all") == 0) {
+		for (n = 0; n < NTABLE_TYPES; n++) {
+			types[n] = n;
+		}
+		return n;
+	}
+
+	char copy[MAX_LINE_LEN];
+	strncpy(copy, str, MAX_LINE_LEN - 1);
+	copy[MAX_LINE_LEN - 1] = '\0';
+	char *name;
+	for (name = strtok(copy, ","); name != NULL; name = strtok(NULL, ",")) {
+		if (n == NTABLE_TYPES) {
+			return -1;
+		}
+		types[n] = strtotype(name);
+		if (types[n] == NOTYPE) {
+			return 0;
+		}
+		n++;
+	}
+	return n;
+}
+
+// the configuration of a new table of type 'type', as set by 'options'
+HashTableConfig table_config(Options *options, TableType type) {
+	HashTableConfig config = default_hash_table_config(type,
+		options->initial_size);
+	if (options->capacity > 0) {
+		config.initial_size = options->capacity;
+	}
+	if (options->bucket_size > 0) {
+		config.bucket_size = options->bucket_size;
+	}
+	config.max_load = options->max_load;
+	config.growth = options->growth;
+	config.hash = options->hash;
+	config.eviction = options->eviction;
+	config.stats = options->stats;
+	return config;
+}
+
+// converts a name from 'names' (the 'n' names of the constants of some
+// enumerated type, in order) to the constant it names
+// returns -1 if it isn't one of them
+int strtosetting(char *str, char **names, int n) {
+	int i;
+	for (i = 0; i < n; i++) {
+		if (strcmp(str, names[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 // scans command line arguments for program options,
 // prints usage info and exits if commands are missing or otherwise invalid
 Options get_options(int argc, char** argv) {
 	
 	// create the Options structure with defaults
-	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE };
-
-	// use C's built-in getopt function to scan inputs by flag
+	Options options = { .type = NOTYPE, .initial_size = DEFAULT_SIZE,
+		.strings = false, .expected_keys = 0, .prescan = false,
+		.load_path = NULL, .save_path = NULL, .disk_path = NULL,
+		.pool_pages = DEFAULT_POOL_PAGES, .events = 0, .binary = false,
+		.convert = false, .quiet = false, .threads = 0, .ntypes = 0,
+		.listen_path = NULL, .replay_path = NULL,
+		.window = DEFAULT_REPLAY_WINDOW, .capacity = 0, .bucket_size = 0,
+		.max_load = 1, .growth = 2, .hash = HASH_AFFINE,
+		.eviction = EVICT_RANDOM, .stats = STATS_ALL, .tuned = false,
+		.grows = false, .evicts = false };
+	static char *hash_names[] = { "affine", "mixed" };
+	static char *eviction_names[] = { "random", "rotate" };
+	static char *stats_names[] = { "none", "sampled", "all" };
+
+	// use C's built-in getopt function to scan inputs by flag (with long
+	// names for some of them)
+	static struct option long_options[] = {
+		{ "listen", required_argument, NULL, 'L' },
+		{ "replay", required_argument, NULL, 'R' },
+		{ "window", required_argument, NULL, 'W' },
+		{ "capacity", required_argument, NULL, 'C' },
+		{ "bucket-size", required_argument, NULL, 'B' },
+		{ "max-load", required_argument, NULL, 'M' },
+		{ "growth", required_argument, NULL, 'G' },
+		{ "hash", required_argument, NULL, 'H' },
+		{ "eviction", required_argument, NULL, 'E' },
+		{ "stats", required_argument, NULL, 'S' },
+		{ NULL, 0, NULL, 0 }
+	};
 	char option;
-	while ((option = getopt(argc, argv, "t:s:")) != EOF){
+	int setting;
+	while ((option = getopt_long(argc, argv,
+		"t:s:k:n:l:w:f:m:e:bcqp:L:R:W:C:B:M:G:H:E:S:", long_options, NULL))
+		!= EOF){
 		switch (option){
-			case 't': // set hash table type
-				options.type = strtotype(optarg);
+			case 't': // set hash table type (or types to compare)
+				options.ntypes = strtotypes(optarg, options.types);
+				options.type = options.ntypes > 0 ? options.types[0] : NOTYPE;
 				break;
 			case 's': // set hash table size
 				options.initial_size = atoi(optarg);
 				break;
+			case 'k': // set key type
+				if (strcmp(optarg, "string") == 0) {
+					options.strings = true;
+				} else if (strcmp(optarg, "int") != 0) {
+					fprintf(stderr, "key type must be int or string (-k)\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'n': // set number of expected keys
+				if (strcmp(optarg, "scan") == 0) {
+					options.prescan = true;
+				} else {
+					options.expected_keys = atoi(optarg);
+				}
+				break;
+			case 'l': // set snapshot to load
+				options.load_path = optarg;
+				break;
+			case 'w': // set snapshot to save
+				options.save_path = optarg;
+				break;
+			case 'f': // set files to keep the table on disk in
+				options.disk_path = optarg;
+				break;
+			case 'm': // set how many pages of the disk table to cache
+				options.pool_pages = atoi(optarg);
+				break;
+			case 'e': // set how many structural events to trace
+				options.events = atoi(optarg);
+				break;
+			case 'b': // read binary commands
+				options.binary = true;
+				break;
+			case 'c': // convert commands instead of running them
+				options.convert = true;
+				break;
+			case 'q': // count results instead of printing them
+				options.quiet = true;
+				break;
+			case 'p': // set how many threads to pipeline commands over
+				options.threads = atoi(optarg);
+				break;
+			case 'L': // set socket to serve commands on
+				options.listen_path = optarg;
+				break;
+			case 'R': // set commands to replay and time
+				options.replay_path = optarg;
+				break;
+			case 'W': // set how many replayed commands to report on together
+				options.window = atoi(optarg);
+				break;
+			case 'C': // set the table's initial capacity
+				options.capacity = atoi(optarg);
+				options.tuned = true;
+				break;
+			case 'B': // set how many keys fit in each bucket
+				options.bucket_size = atoi(optarg);
+				options.tuned = true;
+				break;
+			case 'M': // set how full the table gets before growing
+				options.max_load = atof(optarg);
+				options.tuned = options.grows = true;
+				break;
+			case 'G': // set what the table's size is multiplied by to grow
+				options.growth = atoi(optarg);
+				options.tuned = options.grows = true;
+				break;
+			case 'H': // set the hash functions keys go through
+				setting = strtosetting(optarg, hash_names, 2);
+				options.tuned = true;
+				if (setting < 0) {
+					fprintf(stderr, "hash family must be affine or mixed "
+						"(--hash)\n");
+					exit(EXIT_FAILURE);
+				}
+				options.hash = setting;
+				break;
+			case 'E': // set which key to kick out of a full bucket
+				setting = strtosetting(optarg, eviction_names, 2);
+				options.tuned = options.evicts = true;
+				if (setting < 0) {
+					fprintf(stderr, "eviction policy must be random or rotate "
+						"(--eviction)\n");
+					exit(EXIT_FAILURE);
+				}
+				options.eviction = setting;
+				break;
+			case 'S': // set how many operations to time
+				setting = strtosetting(optarg, stats_names, 3);
+				options.tuned = true;
+				if (setting < 0) {
+					fprintf(stderr, "stats level must be none, sampled or all "
+						"(--stats)\n");
+					exit(EXIT_FAILURE);
+				}
+				options.stats = setting;
+				break;
 			default:
 				break;
 		}
@@ -192,8 +713,14 @@ Options get_options(int argc, char** argv) {
 	// validation and printing error / usage messages
 	bool valid = true;
 		
-	// check part validity
-	if(options.type == NOTYPE){
+	// check part validity (a loaded table already has a type, and converting
+	// commands doesn't need a table)
+	if(options.ntypes < 0) {
+		fprintf(stderr, "please compare at most %d table types using the -t "
+			"flag\n", NTABLE_TYPES);
+		valid = false;
+	} else if(options.type == NOTYPE && options.load_path == NULL
+		&& !options.convert){
 		fprintf(stderr,
 			"please specify which table type to use, using the -t flag:\n");
 		fprintf(stderr, " -t linear:  linear hash table\n");
@@ -204,6 +731,8 @@ Options get_options(int argc, char** argv) {
 		fprintf(stderr, " -t 3 or xuckoo:  extendible cuckoo table (part 3)\n");
 		fprintf(stderr, 
 			" -t 4 or xuckoon: n-key extendible cuckoo table (part 4)\n");
+		fprintf(stderr, " -t all, or a list like linear,cuckoo: compare "
+			"several types of table\n");
 		valid = false;
 	}
 
@@ -214,6 +743,149 @@ Options get_options(int argc, char** argv) {
 		valid = false;
 	}
 
+	// validate table settings (loaded tables keep the settings they were
+	// saved with)
+	if(options.tuned && (options.strings || options.load_path
+		|| options.disk_path)) {
+		fprintf(stderr, "table settings (--capacity, --bucket-size, "
+			"--max-load, --growth, --hash, --eviction, --stats) only apply to "
+			"new tables of int keys, without -k string, -l or -f\n");
+		valid = false;
+	}
+	if(options.capacity < 0 || options.bucket_size < 0) {
+		fprintf(stderr, "please specify an initial capacity and bucket size "
+			"(>0) using the --capacity and --bucket-size flags\n");
+		valid = false;
+	}
+	if(options.max_load <= 0 || options.max_load > 1) {
+		fprintf(stderr, "please specify a maximum load factor (>0 and <=1) "
+			"using the --max-load flag\n");
+		valid = false;
+	}
+	if(options.growth < 2) {
+		fprintf(stderr,
+			"please specify a growth factor (>=2) using the --growth flag\n");
+		valid = false;
+	}
+
+	// each setting has to apply to the table type chosen (or, when comparing
+	// types, to at least one of them), and mixed hashing can't be used with
+	// a type that has only one key per bucket (see hashtbl.h)
+	bool bucketed = false, growing = false, evicting = false, single = false;
+	int t;
+	for (t = 0; t < options.ntypes; t++) {
+		TableType type = options.types[t];
+		bucketed = bucketed || type == XTNDBLN || type == XUCKOON;
+		growing = growing || type == LINEAR || type == CUCKOO;
+		evicting = evicting || type == XUCKOON;
+		single = single || type == XTNDBL1 || type == XUCKOO;
+	}
+	if(options.ntypes > 0 && options.bucket_size > 0 && !bucketed) {
+		fprintf(stderr, "--bucket-size only applies to xtndbln and xuckoon "
+			"tables\n");
+		valid = false;
+	}
+	if(options.ntypes > 0 && options.grows && !growing) {
+		fprintf(stderr, "--max-load and --growth only apply to linear and "
+			"cuckoo tables\n");
+		valid = false;
+	}
+	if(options.ntypes > 0 && options.evicts && !evicting) {
+		fprintf(stderr, "--eviction only applies to xuckoon tables\n");
+		valid = false;
+	}
+	if(options.hash == HASH_MIXED && single) {
+		fprintf(stderr, "--hash mixed can't be used with xtndbl1 or xuckoo "
+			"tables (they have only one key per bucket)\n");
+		valid = false;
+	}
+
+	// validate expected number of keys
+	if(options.expected_keys < 0) {
+		fprintf(stderr, "please specify expected number of keys (>=0) or "
+			"'scan' using the -n flag\n");
+		valid = false;
+	}
+
+	// validate snapshot options
+	if(options.strings && (options.load_path || options.save_path)) {
+		fprintf(stderr, "snapshots (-l, -w) only support int keys\n");
+		valid = false;
+	}
+
+	// validate disk table options
+	if(options.disk_path != NULL && (options.type != XTNDBLN || options.strings
+		|| options.load_path || options.save_path || options.expected_keys
+		|| options.prescan)) {
+		fprintf(stderr, "disk tables (-f) only support -t xtndbln with int "
+			"keys, without -l, -w or -n\n");
+		valid = false;
+	}
+	if(options.pool_pages < 2) {
+		fprintf(stderr,
+			"please specify a buffer pool size (>=2 pages) "
+			"using the -m flag\n");
+		valid = false;
+	}
+
+	// validate event tracing options
+	if(options.events < 0) {
+		fprintf(stderr,
+			"please specify how many events to trace (>=0) "
+			"using the -e flag\n");
+		valid = false;
+	}
+
+	// validate binary command options
+	if((options.binary || options.convert)
+		&& (options.strings || options.prescan)) {
+		fprintf(stderr, "binary commands (-b, -c) only support int keys, "
+			"without -n scan\n");
+		valid = false;
+	}
+
+	// validate comparison options
+	if(options.ntypes > 1 && (options.strings || options.prescan
+		|| options.load_path || options.save_path || options.disk_path
+		|| options.threads || options.convert)) {
+		fprintf(stderr, "comparisons (-t all, or a list of types) only support "
+			"int keys, without -n scan, -l, -w, -f, -p or -c\n");
+		valid = false;
+	}
+
+	// validate pipelining options
+	if(options.threads != 0 && (options.threads < MIN_PIPELINE_THREADS
+		|| options.threads > MAX_PIPELINE_THREADS)) {
+		fprintf(stderr, "please specify how many threads to pipeline commands "
+			"over (%d or %d) using the -p flag\n", MIN_PIPELINE_THREADS,
+			MAX_PIPELINE_THREADS);
+		valid = false;
+	}
+
+	// validate server options (clients choose text or binary commands for
+	// themselves)
+	if(options.listen_path != NULL && (options.ntypes > 1 || options.prescan
+		|| options.binary || options.convert || options.quiet
+		|| options.threads)) {
+		fprintf(stderr, "serving commands (--listen) can't be combined with "
+			"comparisons, -n scan, -b, -c, -q or -p\n");
+		valid = false;
+	}
+
+	// validate replay options
+	if(options.replay_path != NULL && (options.strings || options.ntypes > 1
+		|| options.prescan || options.convert || options.quiet
+		|| options.threads || options.listen_path)) {
+		fprintf(stderr, "replays (--replay) only support int keys, and can't "
+			"be combined with comparisons, -n scan, -c, -q, -p or --listen\n");
+		valid = false;
+	}
+	if(options.window <= 0) {
+		fprintf(stderr, "please specify how many replayed commands to report "
+			"on together (>0) using the --window flag\n");
+		valid = false;
+	}
+
 	// check overall validity before continuing
 	if(!valid){
 		exit(EXIT_FAILURE);
@@ -0,0 +1,411 @@
+/* * * * * * * * *
+ * Pipelined running of interpreter commands, with lock-free rings between a
+ * reader thread, the executor and a writer thread
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+#include "tables/latency.h"
+
+// how many items each ring holds (a power of two)
+#define RING_SLOTS 4096
+
+// how many bytes apart to keep a ring's head and tail, so that the threads
+// on either side don't fight over the same cache line
+#define CACHE_LINE 64
+
+// how many times to give up the CPU while waiting on a ring before sleeping
+// between checks instead, and how long to sleep for (in ns)
+#define WAIT_YIELDS 100
+#define WAIT_SLEEP 20000
+
+// a ring of RING_SLOTS items of 'slot_size' bytes each, passed from one
+// (producer) thread to one other (consumer) thread. item number n (counting
+// from 0) goes in slot n % RING_SLOTS. only the producer changes head, and only
+// the consumer changes tail, so the ring holds the items from tail to head
+typedef struct ring {
+	char *slots;
+	size_t slot_size;
+	int64 head;				// how many items have been put in
+	char head_padding[CACHE_LINE];
+	int64 tail;				// how many items have been taken out
+	char tail_padding[CACHE_LINE];
+} Ring;
+
+// a command, as parsed by the reader thread
+typedef struct piped_command {
+	int argc;					// as returned by read_command
+	char operation;
+	int64 key;
+	char word[MAX_LINE_LEN];	// (only used for string keys)
+} PipedCommand;
+
+// a result for the writer thread to write, or (if text is NULL) a request to
+// write out every result so far, or (if stop is true) to finish
+typedef struct piped_result {
+	bool stop;
+	char *text;
+	int64 key;
+	char word[MAX_LINE_LEN];	// (only used if word_len is not 0)
+	int word_len;
+} PipedResult;
+
+// the pipeline's threads, and how each one spent its time
+typedef enum stage_name {
+	READER,
+	EXECUTOR,
+	WRITER
+} StageName;
+static char *stage_names[] = { "reader", "executor", "writer" };
+
+typedef struct stage {
+	int64 start;			// when the thread started (in ns)
+	int64 end;				// when it finished
+	int64 input_wait;		// time spent waiting for something to do
+	int64 output_wait;		// time spent waiting for the next thread
+} Stage;
+
+struct pipeline {
+	int nthreads;
+	CommandReader *reader;
+	bool strings;			// are commands' arguments words?
+	Output *output;			// where results are written
+	Ring commands;			// from the reader thread to the executor
+	Ring results;			// from the executor to the writer thread
+	pthread_t reader_thread;
+	pthread_t writer_thread;
+	bool stopping;			// has the executor stopped taking commands?
+	int last;				// how the reader thread stopped
+	Stage stages[MAX_PIPELINE_THREADS];
+};
+
+
+/* * *
+ * HELPER FUNCTIONS
+ */
+
+static void initialise_ring(Ring *ring, size_t slot_size);
+static void *slot_to_fill(Ring *ring, Stage *stage, bool *stopping);
+static void *slot_to_take(Ring *ring, Stage *stage, Output *idle_output);
+static void wait_a_while(int *tries);
+static void *run_reader(void *arg);
+static void *run_writer(void *arg);
+static void print_stage(StageName name, Stage *stage);
+
+
+// set up an empty ring of slots of 'slot_size' bytes
+static void initialise_ring(Ring *ring, size_t slot_size) {
+	ring->slots = malloc(slot_size * RING_SLOTS);
+	assert(ring->slots);
+	ring->slot_size = slot_size;
+	ring->head = ring->tail = 0;
+}
+
+// give up the CPU for now, having already waited 'tries' times: at first
+// only briefly, but then for long enough not to keep the CPU busy
+static void wait_a_while(int *tries) {
+	if (++*tries < WAIT_YIELDS) {
+		sched_yield();
+	} else {
+		struct timespec pause = { 0, WAIT_SLEEP };
+		nanosleep(&pause, NULL);
+	}
+}
+
+// the slot for the producer of 'ring' to put its next item in, waiting until
+// there's room (and counting the time waited in 'stage'). the item is passed
+// on by incrementing head (with __atomic_store_n)
+// returns NULL instead if *stopping becomes true while waiting
+static void *slot_to_fill(Ring *ring, Stage *stage, bool *stopping) {
+	int64 head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == RING_SLOTS) {
+		int64 start = read_clock();
+		int tries = 0;
+		while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)
+			== RING_SLOTS) {
+			if (stopping != NULL
+				&& __atomic_load_n(stopping, __ATOMIC_ACQUIRE)) {
+				return NULL;
+			}
+			wait_a_while(&tries);
+		}
+		stage->output_wait += read_clock() - start;
+	}
+	return ring->slots + (head % RING_SLOTS) * ring->slot_size;
+}
+
+// the slot holding the next item for the consumer of 'ring' to take, waiting
+// until there is one (and counting the time waited in 'stage'). if it has to
+// wait, the results in 'idle_output' (unless it's NULL) are written out
+// first. the item is released by incrementing tail (with __atomic_store_n)
+static void *slot_to_take(Ring *ring, Stage *stage, Output *idle_output) {
+	int64 tail = ring->tail;
+	if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+		if (idle_output != NULL) {
+			flush_output(idle_output);
+			fflush(stdout);
+		}
+		int64 start = read_clock();
+		int tries = 0;
+		while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+			wait_a_while(&tries);
+		}
+		stage->input_wait += read_clock() - start;
+	}
+	return ring->slots + (tail % RING_SLOTS) * ring->slot_size;
+}
+
+// the reader thread: read and parse commands into the commands ring until
+// there are none left (or the executor stops taking them)
+static void *run_reader(void *arg) {
+	Pipeline *pipeline = arg;
+	Stage *stage = &pipeline->stages[READER];
+	stage->start = read_clock();
+	while (true) {
+		PipedCommand *command = slot_to_fill(&pipeline->commands, stage,
+			&pipeline->stopping);
+		if (command == NULL) {
+			break;
+		}
+		command->argc = read_command(pipeline->reader, &command->operation,
+			&command->key, pipeline->strings ? command->word : NULL);
+		if (command->argc == EOF) {
+			continue; // an empty line, nothing to pass on
+		}
+		__atomic_store_n(&pipeline->commands.head,
+			pipeline->commands.head + 1, __ATOMIC_RELEASE);
+		if (command->argc == NO_MORE_COMMANDS
+			|| command->argc == BAD_COMMANDS) {
+			break;
+		}
+	}
+	stage->end = read_clock();
+	return NULL;
+}
+
+// the writer thread: write out results from the results ring until told to
+// stop
+static void *run_writer(void *arg) {
+	Pipeline *pipeline = arg;
+	Stage *stage = &pipeline->stages[WRITER];
+	Output *output = pipeline->output;
+	stage->start = read_clock();
+	while (true) {
+		PipedResult *result = slot_to_take(&pipeline->results, stage, output);
+		if (result->stop) {
+			break;
+		}
+		if (result->text == NULL) {
+			flush_output(output);
+		} else {
+			if (result->word_len > 0) {
+				output_text(output, result->word);
+			} else {
+				output_key(output, result->key);
+			}
+			output_text(output, result->text);
+		}
+		__atomic_store_n(&pipeline->results.tail, pipeline->results.tail + 1,
+			__ATOMIC_RELEASE);
+	}
+	flush_output(output);
+	stage->end = read_clock();
+	return NULL;
+}
+
+// print a line about how stage 'name' spent its time
+static void print_stage(StageName name, Stage *stage) {
+	double total = stage->end > stage->start ? stage->end - stage->start : 1;
+	double input = 100.0 * stage->input_wait / total;
+	double output = 100.0 * stage->output_wait / total;
+	fprintf(stderr, "%9s: %5.1f%% busy, %5.1f%% waiting for input, "
+		"%5.1f%% waiting for the next stage (%.3f s)\n", stage_names[name],
+		100.0 - input - output, input, output, total / 1e9);
+}
+
+
+/* * *
+ * PIPELINE FUNCTIONS
+ */
+
+
+// start a pipeline of 'nthreads' threads, with a new thread reading commands
+// from 'reader' (reading words rather than numbers as arguments, if
+// 'strings' is true). with 3 threads, a new writer thread writes results
+// passed to pipe_result, using 'output'; otherwise results are left to the
+// executor, and 'output' is written out whenever it runs out of commands
+Pipeline *start_pipeline(int nthreads, CommandReader *reader, bool strings,
+	Output *output) {
+	assert(nthreads >= MIN_PIPELINE_THREADS
+		&& nthreads <= MAX_PIPELINE_THREADS);
+	Pipeline *pipeline = malloc(sizeof *pipeline);
+	assert(pipeline);
+	memset(pipeline->stages, 0, sizeof pipeline->stages);
+	pipeline->nthreads = nthreads;
+	pipeline->reader = reader;
+	pipeline->strings = strings;
+	pipeline->output = output;
+	pipeline->stopping = false;
+	pipeline->last = NO_MORE_COMMANDS;
+	initialise_ring(&pipeline->commands, sizeof (PipedCommand));
+	pipeline->stages[EXECUTOR].start = read_clock();
+
+	if (pthread_create(&pipeline->reader_thread, NULL, run_reader, pipeline)
+		!= 0) {
+		perror("error: can't start the reader thread");
+		exit(EXIT_FAILURE);
+	}
+	if (nthreads == MAX_PIPELINE_THREADS) {
+		initialise_ring(&pipeline->results, sizeof (PipedResult));
+		if (pthread_create(&pipeline->writer_thread, NULL, run_writer,
+			pipeline) != 0) {
+			perror("error: can't start the writer thread");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return pipeline;
+}
+
+// does the pipeline have a writer thread (so that results must be passed to
+// pipe_result, and 'output' left alone)?
+bool pipeline_has_writer(Pipeline *pipeline) {
+	return pipeline->nthreads == MAX_PIPELINE_THREADS;
+}
+
+// take the next command from the reader thread, storing its operation in
+// *operation and its argument (if any) in *key or, if reading strings, in
+// 'word'. waits until there is one if necessary
+// returns the number of tokens read, NO_MORE_COMMANDS or BAD_COMMANDS, as
+// for read_command (but never EOF: empty lines are skipped)
+int next_piped_command(Pipeline *pipeline, char *operation, int64 *key,
+	char *word) {
+	PipedCommand *command = slot_to_take(&pipeline->commands,
+		&pipeline->stages[EXECUTOR],
+		pipeline_has_writer(pipeline) ? NULL : pipeline->output);
+	int argc = command->argc;
+	*operation = command->operation;
+	*key = command->key;
+	if (word != NULL && argc == 2) {
+		strcpy(word, command->word);
+	}
+
+	// the end of the commands stays in the ring, for stop_pipeline
+	if (argc == NO_MORE_COMMANDS || argc == BAD_COMMANDS) {
+		pipeline->last = argc;
+	} else {
+		__atomic_store_n(&pipeline->commands.tail, pipeline->commands.tail + 1,
+			__ATOMIC_RELEASE);
+	}
+	return argc;
+}
+
+// pass the result of an insert or lookup of 'key' (or 'word', if it's not
+// NULL) to the writer thread, to be written as the key or word followed by
+// 'text'
+void pipe_result(Pipeline *pipeline, int64 key, char *word, char *text) {
+	assert(pipeline_has_writer(pipeline) && text != NULL);
+	PipedResult *result = slot_to_fill(&pipeline->results,
+		&pipeline->stages[EXECUTOR], NULL);
+	result->stop = false;
+	result->text = text;
+	result->key = key;
+	result->word_len = 0;
+	if (word != NULL) {
+		result->word_len = strlen(word);
+		memcpy(result->word, word, result->word_len + 1);
+	}
+	__atomic_store_n(&pipeline->results.head, pipeline->results.head + 1,
+		__ATOMIC_RELEASE);
+}
+
+// wait until the writer thread has written out every result passed to it
+// so far (so that the executor can print something after them)
+void drain_results(Pipeline *pipeline) {
+	if (!pipeline_has_writer(pipeline)) {
+		flush_output(pipeline->output);
+		return;
+	}
+
+	// ask the writer to write out its output, then wait for it to get there
+	Ring *ring = &pipeline->results;
+	PipedResult *result = slot_to_fill(ring, &pipeline->stages[EXECUTOR],
+		NULL);
+	result->stop = false;
+	result->text = NULL;
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+	if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head) {
+		int64 start = read_clock();
+		int tries = 0;
+		while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head) {
+			wait_a_while(&tries);
+		}
+		pipeline->stages[EXECUTOR].output_wait += read_clock() - start;
+	}
+}
+
+// stop the pipeline and wait for its threads to finish, then print how busy
+// each thread was to stderr, and free the pipeline. if 'finish' is true, the
+// rest of the commands are read (but not run) first, as finish_commands
+// does; otherwise the reader thread is stopped wherever it's up to
+// returns NO_MORE_COMMANDS, or BAD_COMMANDS if the reader thread found that
+// binary commands were cut short or corrupt
+int stop_pipeline(Pipeline *pipeline, bool finish) {
+	char operation;
+	int64 key;
+	char word[MAX_LINE_LEN];
+
+	// skip the rest of the commands, or stop the reader where it is (it may
+	// be waiting for input that will never come)
+	if (finish) {
+		while (next_piped_command(pipeline, &operation, &key,
+			pipeline->strings ? word : NULL) >= 0);
+	} else {
+		__atomic_store_n(&pipeline->stopping, true, __ATOMIC_RELEASE);
+		pthread_cancel(pipeline->reader_thread);
+	}
+	pthread_join(pipeline->reader_thread, NULL);
+
+	// then let the writer finish what it's been given
+	if (pipeline_has_writer(pipeline)) {
+		PipedResult *result = slot_to_fill(&pipeline->results,
+			&pipeline->stages[EXECUTOR], NULL);
+		result->stop = true;
+		__atomic_store_n(&pipeline->results.head, pipeline->results.head + 1,
+			__ATOMIC_RELEASE);
+		pthread_join(pipeline->writer_thread, NULL);
+	}
+	pipeline->stages[EXECUTOR].end = read_clock();
+
+	// a cancelled reader never got as far as recording its end
+	Stage *reader = &pipeline->stages[READER];
+	if (reader->end == 0) {
+		reader->end = pipeline->stages[EXECUTOR].end;
+	}
+
+	fflush(stdout);
+	fprintf(stderr, "pipeline stages:\n");
+	print_stage(READER, reader);
+	print_stage(EXECUTOR, &pipeline->stages[EXECUTOR]);
+	if (pipeline_has_writer(pipeline)) {
+		print_stage(WRITER, &pipeline->stages[WRITER]);
+		free(pipeline->results.slots);
+	}
+
+	int last = pipeline->last;
+	free(pipeline->commands.slots);
+	free(pipeline);
+	return last;
+}
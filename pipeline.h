@@ -0,0 +1,68 @@
+/* * * * * * * * *
+ * Pipelined running of interpreter commands: a reader thread reads and
+ * parses commands into a ring, for the interpreter's own thread (the
+ * executor) to run on the table, optionally handing the results of inserts
+ * and lookups on through a second ring to a writer thread that formats and
+ * writes them out, so that reading, hashing and writing overlap
+ *
+ * each ring has exactly one thread putting items in and one thread taking
+ * them out, so neither needs a lock: the two threads only share the ring's
+ * head and tail counters, each of which only one of them ever changes.
+ * commands (and results) come out of a ring in the order they went in
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include "inthash.h"
+#include "commands.h"
+
+// the fewest and most threads a pipeline can have (reader and executor, and
+// then a writer)
+#define MIN_PIPELINE_THREADS 2
+#define MAX_PIPELINE_THREADS 3
+
+typedef struct pipeline Pipeline;
+
+// start a pipeline of 'nthreads' threads, with a new thread reading commands
+// from 'reader' (reading words rather than numbers as arguments, if
+// 'strings' is true). with 3 threads, a new writer thread writes results
+// passed to pipe_result, using 'output'; otherwise results are left to the
+// executor, and 'output' is written out whenever it runs out of commands
+Pipeline *start_pipeline(int nthreads, CommandReader *reader, bool strings,
+	Output *output);
+
+// does the pipeline have a writer thread (so that results must be passed to
+// pipe_result, and 'output' left alone)?
+bool pipeline_has_writer(Pipeline *pipeline);
+
+// take the next command from the reader thread, storing its operation in
+// *operation and its argument (if any) in *key or, if reading strings, in
+// 'word'. waits until there is one if necessary
+// returns the number of tokens read, NO_MORE_COMMANDS or BAD_COMMANDS, as
+// for read_command (but never EOF: empty lines are skipped)
+int next_piped_command(Pipeline *pipeline, char *operation, int64 *key,
+	char *word);
+
+// pass the result of an insert or lookup of 'key' (or 'word', if it's not
+// NULL) to the writer thread, to be written as the key or word followed by
+// 'text'
+void pipe_result(Pipeline *pipeline, int64 key, char *word, char *text);
+
+// wait until the writer thread has written out every result passed to it
+// so far (so that the executor can print something after them)
+void drain_results(Pipeline *pipeline);
+
+// stop the pipeline and wait for its threads to finish, then print how busy
+// each thread was to stderr, and free the pipeline. if 'finish' is true, the
+// rest of the commands are read (but not run) first, as finish_commands
+// does; otherwise the reader thread is stopped wherever it's up to
+// returns NO_MORE_COMMANDS, or BAD_COMMANDS if the reader thread found that
+// binary commands were cut short or corrupt
+int stop_pipeline(Pipeline *pipeline, bool finish);
+
+#endif
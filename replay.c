@@ -0,0 +1,242 @@
+/* * * * * * * * *
+ * Replays: inserts and lookups read into memory, then run against a table
+ * with each one timed
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "replay.h"
+#include "tables/latency.h"
+#include "tables/events.h"
+
+// the commands replayed (any others are skipped)
+#define INSERT 'i'
+#define LOOKUP 'l'
+#define QUIT   'q'
+
+// how many commands to make room for at first
+#define INITIAL_COMMANDS 1024
+
+
+/* * *
+ * HELPER FUNCTIONS
+ */
+
+#ifndef HT_NO_STATS
+static void print_window(int number, int ops, Latency *latencies,
+	int64 nkeys, size_t bytes, int64 ticks, int64 *events_before);
+static void print_latency_columns(Latency *lat);
+static void print_histogram(char *name, Latency *lat);
+
+
+// print the CSV row for window number 'number', of 'ops' commands whose
+// inserts and lookups took 'latencies' (taking 'ticks' ticks altogether),
+// after which 'nkeys' keys had been inserted and the table used 'bytes'
+// bytes, and since which each type of event had happened (in total)
+// count_events times, from 'events_before' times (which are then updated)
+static void print_window(int number, int ops, Latency *latencies,
+	int64 nkeys, size_t bytes, int64 ticks, int64 *events_before) {
+	double seconds = ticks_to_ns(ticks) / 1e9;
+	printf("%d,%d,%llu,%llu,%llu,%llu,%.9f,%.0f", number, ops,
+		latencies[0].ops, latencies[1].ops, nkeys, (int64)bytes, seconds,
+		seconds > 0 ? ops / seconds : 0);
+	print_latency_columns(&latencies[0]);
+	print_latency_columns(&latencies[1]);
+
+	int64 events[NEVENT_TYPES];
+	int e;
+	for (e = 0; e < NEVENT_TYPES; e++) {
+		events[e] = count_events(e) - events_before[e];
+		events_before[e] += events[e];
+	}
+	printf(",%llu,%llu,%llu\n", events[EVENT_RESIZE] + events[EVENT_DOUBLE],
+		events[EVENT_SPLIT], events[EVENT_CYCLE]);
+}
+
+// print the mean, p50, p99 and max of the times in 'lat' as CSV columns (left
+// empty if nothing was timed)
+static void print_latency_columns(Latency *lat) {
+	if (lat->timed == 0) {
+		printf(",,,,");
+		return;
+	}
+	printf(",%.0f,%.0f,%.0f,%.0f", ticks_to_ns(lat->total) / lat->timed,
+		latency_percentile(lat, 0.5), latency_percentile(lat, 0.99),
+		ticks_to_ns(lat->max));
+}
+
+// print a CSV row for each bucket of the histogram of the times in 'lat' that
+// holds any, for the operations called 'name'
+static void print_histogram(char *name, Latency *lat) {
+	int bucket;
+	for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		if (lat->histogram[bucket] > 0) {
+			double min_ns, max_ns;
+			latency_bucket_range(bucket, &min_ns, &max_ns);
+			printf("%s,%.1f,%.1f,%llu\n", name, min_ns, max_ns,
+				lat->histogram[bucket]);
+		}
+	}
+}
+#endif
+
+
+/* * *
+ * REPLAY FUNCTIONS
+ */
+
+
+// read the inserts and lookups from 'reader' (up to the first 'quit', and
+// skipping any other commands) into 'replay'
+// returns false if binary commands turn out to be corrupt (leaving nothing
+// to free)
+bool read_replay(CommandReader *reader, Replay *replay) {
+	int capacity = INITIAL_COMMANDS;
+	replay->ops = malloc(capacity * sizeof *replay->ops);
+	replay->keys = malloc(capacity * sizeof *replay->keys);
+	assert(replay->ops && replay->keys);
+	replay->n = replay->ninserts = 0;
+
+	char op;
+	int64 key;
+	int argc;
+	while ((argc = read_command(reader, &op, &key, NULL)) != NO_MORE_COMMANDS
+		&& argc != BAD_COMMANDS) {
+		if (argc >= 1 && op == QUIT) {
+			argc = finish_commands(reader);
+			break;
+		}
+		if (argc < 2 || (op != INSERT && op != LOOKUP)) {
+			continue;
+		}
+
+		if (replay->n == capacity) {
+			capacity *= 2;
+			replay->ops = realloc(replay->ops, capacity * sizeof *replay->ops);
+			replay->keys = realloc(replay->keys,
+				capacity * sizeof *replay->keys);
+			assert(replay->ops && replay->keys);
+		}
+		replay->ops[replay->n] = op;
+		replay->keys[replay->n] = key;
+		replay->n++;
+		if (op == INSERT) {
+			replay->ninserts++;
+		}
+	}
+	if (argc == BAD_COMMANDS) {
+		free_replay(replay);
+		return false;
+	}
+	return true;
+}
+
+// free the commands in 'replay'
+void free_replay(Replay *replay) {
+	free(replay->ops);
+	free(replay->keys);
+}
+
+// replay the inserts and lookups in the file at 'path' (of binary commands if
+// 'binary' is true) against 'table', timing each one, and print two CSV
+// tables to stdout: one row for every 'window' commands (with their
+// throughput, the mean, p50, p99 and max latency of their inserts and of
+// their lookups, the keys inserted and bytes in use by the end of them, and
+// how many resizes, splits and cuckoo cycles happened during them), then the
+// histogram of every insert's and every lookup's latency
+// returns false (after saying why) if the file can't be read, or its binary
+// commands are corrupt
+bool replay_file(HashTable *table, char *path, bool binary, int window) {
+	assert(table != NULL && window > 0);
+#ifdef HT_NO_STATS
+	fprintf(stderr, "error: can't time a replay in a build without timing "
+		"(HT_NO_STATS)\n");
+	return false;
+#else
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		perror("error: can't read replay file");
+		return false;
+	}
+	CommandReader *reader = new_command_reader(file, NULL);
+	Replay replay;
+	bool intact = (!binary || read_binary_header(reader))
+		&& read_replay(reader, &replay);
+	free_command_reader(reader);
+	fclose(file);
+	if (!intact) {
+		fprintf(stderr, "error: %s isn't intact binary commands\n", path);
+		return false;
+	}
+
+	// resizes, splits and cycles are counted from the event trace
+	if (!events_enabled) {
+		enable_event_log(1);
+	}
+	int64 events_before[NEVENT_TYPES];
+	int e;
+	for (e = 0; e < NEVENT_TYPES; e++) {
+		events_before[e] = count_events(e);
+	}
+
+	// time every command, both for its own window and overall (inserts
+	// first, then lookups)
+	Latency latencies[2], totals[2];
+	initialise_latency(&latencies[0]);
+	initialise_latency(&latencies[1]);
+	initialise_latency(&totals[0]);
+	initialise_latency(&totals[1]);
+	printf("window,ops,inserts,lookups,keys_inserted,bytes,seconds,ops_per_sec,"
+		"insert_mean_ns,insert_p50_ns,insert_p99_ns,insert_max_ns,"
+		"lookup_mean_ns,lookup_p50_ns,lookup_p99_ns,lookup_max_ns,"
+		"resizes,splits,cycles\n");
+	int64 nkeys = 0, window_start = read_ticks();
+	int i, ops = 0, number = 0;
+	for (i = 0; i < replay.n; i++) {
+		int64 key = replay.keys[i];
+		if (replay.ops[i] == INSERT) {
+			int64 start = latency_start(&latencies[0]);
+			bool inserted = hash_table_insert(table, key);
+			int64 end = read_ticks();
+			if (start) {
+				latency_record(&latencies[0], end - start, 1);
+				latency_record(&totals[0], end - start, 1);
+			}
+			nkeys += inserted;
+		} else {
+			int64 start = latency_start(&latencies[1]);
+			hash_table_lookup(table, key);
+			int64 end = read_ticks();
+			if (start) {
+				latency_record(&latencies[1], end - start, 1);
+				latency_record(&totals[1], end - start, 1);
+			}
+		}
+
+		// finish the window every 'window' commands, and at the end
+		if (++ops == window || i == replay.n - 1) {
+			int64 ticks = read_ticks() - window_start;
+			print_window(number++, ops, latencies, nkeys,
+				hash_table_memory_usage(table, NULL), ticks, events_before);
+			initialise_latency(&latencies[0]);
+			initialise_latency(&latencies[1]);
+			ops = 0;
+			window_start = read_ticks();
+		}
+	}
+
+	printf("\nop,min_ns,max_ns,count\n");
+	print_histogram("insert", &totals[0]);
+	print_histogram("lookup", &totals[1]);
+	fprintf(stderr, "replayed %d inserts and %d lookups from %s\n",
+		replay.ninserts, replay.n - replay.ninserts, path);
+	free_replay(&replay);
+	return true;
+#endif
+}
@@ -0,0 +1,49 @@
+/* * * * * * * * *
+ * Replays: the inserts and lookups from a file of commands, read into memory
+ * up front and then run against a table with each one timed, to show how
+ * latency changes as the table grows (and across its resizes and splits)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include "inthash.h"
+#include "hashtbl.h"
+#include "commands.h"
+
+// how many inserts and lookups to report on together, by default
+#define DEFAULT_REPLAY_WINDOW 1000
+
+// the inserts and lookups to replay, in order
+typedef struct replay {
+	char *ops;		// 'i' (insert) or 'l' (lookup)
+	int64 *keys;
+	int n;
+	int ninserts;
+} Replay;
+
+// read the inserts and lookups from 'reader' (up to the first 'quit', and
+// skipping any other commands) into 'replay'
+// returns false if binary commands turn out to be corrupt (leaving nothing
+// to free)
+bool read_replay(CommandReader *reader, Replay *replay);
+
+// free the commands in 'replay'
+void free_replay(Replay *replay);
+
+// replay the inserts and lookups in the file at 'path' (of binary commands if
+// 'binary' is true) against 'table', timing each one, and print two CSV
+// tables to stdout: one row for every 'window' commands (with their
+// throughput, the mean, p50, p99 and max latency of their inserts and of
+// their lookups, the keys inserted and bytes in use by the end of them, and
+// how many resizes, splits and cuckoo cycles happened during them), then the
+// histogram of every insert's and every lookup's latency
+// returns false (after saying why) if the file can't be read, or its binary
+// commands are corrupt
+bool replay_file(HashTable *table, char *path, bool binary, int window);
+
+#endif
@@ -0,0 +1,567 @@
+/* * * * * * * * *
+ * Server mode: the interpreter's commands served to many clients over a
+ * Unix domain socket, from an epoll event loop
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <stdint.h>
+
+#include "server.h"
+#include "commands.h"
+#include "tables/events.h"
+
+// interpreter commands (as in main.c)
+#define INSERT 'i'
+#define LOOKUP 'l'
+#define PRINT  'p'
+#define STATS  's'
+#define EVENTS 'e'
+#define EVENTS_JSON 'j'
+#define HELP   'h'
+#define QUIT   'q'
+
+// how many bytes of commands to read from a client at once, and how many
+// bytes of results to let pile up for a client before waiting for it to
+// take some of them (rather than running more of its commands)
+#define INPUT_SIZE (1 << 16)
+#define OUTPUT_LIMIT (1 << 20)
+
+// how many results to make room for at first
+#define INITIAL_OUTPUT 4096
+
+// how many events to handle per call to epoll_wait, and how many clients
+// may be waiting to be accepted
+#define MAX_EVENTS 64
+#define BACKLOG 128
+
+// how a client is sending its commands
+typedef enum mode {
+	UNKNOWN,	// (not enough has arrived to tell yet)
+	TEXT,
+	BINARY
+} Mode;
+
+typedef struct client {
+	int fd;
+	Mode mode;
+	BinaryDecoder decoder;	// (for binary clients)
+	char input[INPUT_SIZE];	// commands received but not yet run
+	size_t input_len;
+	char *output;			// results not yet sent
+	size_t output_len;
+	size_t output_sent;		// how many of them have been sent
+	size_t output_size;
+	bool ended;				// has the client closed its side?
+	bool closing;			// close the connection once the results are sent?
+	uint32_t watching;		// the epoll events the client is watched for
+} Client;
+
+typedef struct server {
+	HashTable *table;
+	bool strings;			// are text clients' arguments words?
+	int listener;			// the listening socket
+	int epoll;
+	int capture;			// a temporary file catching stdout while
+	int saved_stdout;		// commands that print are run (and stdout)
+	int nclients;			// how many clients are connected
+	int64 served;			// how many clients have connected altogether
+	int64 commands;			// how many commands have been run
+} Server;
+
+// set by the signal handler when it's time to stop
+static volatile sig_atomic_t stopping = 0;
+
+
+/* * *
+ * HELPER FUNCTIONS
+ */
+
+static void stop_serving(int signal);
+static bool start_listening(Server *server, char *path);
+static void accept_clients(Server *server);
+static void close_client(Server *server, Client *client);
+static void serve_client(Server *server, Client *client, uint32_t events);
+static bool send_results(Client *client);
+static void run_commands(Server *server, Client *client);
+static size_t run_next_command(Server *server, Client *client, char *bytes,
+	size_t len);
+static void run_command(Server *server, Client *client, char op, int argc,
+	int64 key, char *word);
+static void reply(Client *client, char *bytes, size_t len);
+static void reply_key(Client *client, int64 key);
+static void start_capture(Server *server);
+static void end_capture(Server *server, Client *client);
+
+
+// note that the server has been asked to stop (epoll_wait returns early)
+static void stop_serving(int signal) {
+	stopping = 1;
+}
+
+// create the listening socket at 'path' and the epoll instance watching it
+// returns false (after saying why) if either can't be set up
+static bool start_listening(Server *server, char *path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof address);
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof address.sun_path) {
+		fprintf(stderr, "error: socket path %s is too long\n", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+
+	server->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->listener < 0) {
+		perror("error: can't create socket");
+		return false;
+	}
+
+	// clear away a socket left behind by an earlier server, but never
+	// anything else that happens to be at 'path'
+	struct stat existing;
+	if (lstat(path, &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			fprintf(stderr, "error: %s already exists and isn't a socket\n",
+				path);
+			close(server->listener);
+			return false;
+		}
+		unlink(path);
+	}
+	if (bind(server->listener, (struct sockaddr *)&address, sizeof address)
+		!= 0 || listen(server->listener, BACKLOG) != 0) {
+		perror("error: can't listen on socket");
+		close(server->listener);
+		return false;
+	}
+	fcntl(server->listener, F_SETFL, O_NONBLOCK);
+
+	server->epoll = epoll_create1(0);
+	assert(server->epoll >= 0);
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+	epoll_ctl(server->epoll, EPOLL_CTL_ADD, server->listener, &event);
+	return true;
+}
+
+// accept every client waiting to connect, and start watching them
+static void accept_clients(Server *server) {
+	int fd;
+	while ((fd = accept(server->listener, NULL, NULL)) >= 0) {
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		Client *client = malloc(sizeof *client);
+		assert(client);
+		client->fd = fd;
+		client->mode = UNKNOWN;
+		client->input_len = 0;
+		client->output_size = INITIAL_OUTPUT;
+		client->output = malloc(client->output_size);
+		assert(client->output);
+		client->output_len = client->output_sent = 0;
+		client->ended = client->closing = false;
+		client->watching = EPOLLIN;
+
+		struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+		epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event);
+		server->nclients++;
+		server->served++;
+	}
+}
+
+// disconnect 'client' and free it
+static void close_client(Server *server, Client *client) {
+	epoll_ctl(server->epoll, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	free(client->output);
+	free(client);
+	server->nclients--;
+}
+
+// handle 'events' on 'client's connection: read whatever commands have
+// arrived (once), run every whole one and send back all of their results
+// together, as far as the client will take them. the client isn't read
+// from while it has OUTPUT_LIMIT bytes of results waiting, and is
+// disconnected once it's finished and every result is sent
+static void serve_client(Server *server, Client *client, uint32_t events) {
+	if ((client->watching & EPOLLIN)
+		&& (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+		ssize_t nread = read(client->fd, client->input + client->input_len,
+			INPUT_SIZE - client->input_len);
+		if (nread > 0) {
+			client->input_len += nread;
+		} else if (nread == 0 || (errno != EAGAIN && errno != EINTR)) {
+			client->ended = true;
+		}
+	}
+
+	// (commands held back by a full output run once it has all been sent)
+	bool full;
+	do {
+		run_commands(server, client);
+		full = client->output_len >= OUTPUT_LIMIT;
+		if (!send_results(client)) {
+			close_client(server, client); // nobody to send the rest to
+			return;
+		}
+	} while (full && client->output_len == 0);
+
+	size_t waiting = client->output_len - client->output_sent;
+	if (waiting == 0 && (client->closing || client->ended)) {
+		close_client(server, client);
+		return;
+	}
+	uint32_t watching = 0;
+	if (waiting < OUTPUT_LIMIT && !client->closing && !client->ended) {
+		watching |= EPOLLIN;
+	}
+	if (waiting > 0) {
+		watching |= EPOLLOUT;
+	}
+	if (watching != client->watching) {
+		struct epoll_event event = { .events = watching, .data.ptr = client };
+		epoll_ctl(server->epoll, EPOLL_CTL_MOD, client->fd, &event);
+		client->watching = watching;
+	}
+}
+
+// send as many of the results waiting for 'client' as it will take right
+// now (forgetting them once they've all been sent)
+// returns false if the client has gone away
+static bool send_results(Client *client) {
+	while (client->output_sent < client->output_len) {
+		ssize_t nsent = send(client->fd, client->output + client->output_sent,
+			client->output_len - client->output_sent, MSG_NOSIGNAL);
+		if (nsent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (nsent < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		client->output_sent += nsent;
+	}
+	client->output_len = client->output_sent = 0;
+	return true;
+}
+
+// run every whole command received from 'client' (stopping early if it
+// already has too many results waiting, or has finished), keeping any
+// partial command left over for when the rest arrives
+static void run_commands(Server *server, Client *client) {
+	size_t start = 0;
+	while (start < client->input_len && !client->closing
+		&& client->output_len < OUTPUT_LIMIT) {
+		char *bytes = client->input + start;
+		size_t len = client->input_len - start;
+
+		// the first bytes say whether the commands are text or binary
+		if (client->mode == UNKNOWN) {
+			if (len < BINARY_HEADER_SIZE && starts_binary_header(bytes, len)
+				&& !client->ended) {
+				break;
+			}
+			if (len >= BINARY_HEADER_SIZE
+				&& starts_binary_header(bytes, len)) {
+				client->mode = BINARY;
+				start_binary_decoder(&client->decoder);
+				start += BINARY_HEADER_SIZE;
+				continue;
+			}
+			client->mode = TEXT;
+		}
+
+		size_t used = run_next_command(server, client, bytes, len);
+		if (used == 0) {
+			break; // the rest of the command hasn't arrived yet
+		}
+		start += used;
+	}
+	memmove(client->input, client->input + start, client->input_len - start);
+	client->input_len -= start;
+
+	// once the client has closed its side, nothing more will complete a
+	// partial binary command
+	if (client->ended && client->input_len > 0 && !client->closing
+		&& client->output_len < OUTPUT_LIMIT && client->mode == BINARY) {
+		start_capture(server);
+		printf("error: binary commands are cut short or corrupt\n");
+		end_capture(server, client);
+		client->input_len = 0;
+		client->closing = true;
+	}
+}
+
+// run the command at the start of the 'len' bytes of input at 'bytes' from
+// 'client', if the whole of it has arrived (or, for text, if it's the last
+// of the input)
+// returns how many bytes it took up, or 0 if it hasn't all arrived
+static size_t run_next_command(Server *server, Client *client, char *bytes,
+	size_t len) {
+	char op, word[MAX_LINE_LEN];
+	int64 key;
+	int argc;
+
+	if (client->mode == BINARY) {
+		int n = decode_binary_command(&client->decoder, bytes, len, &op, &key,
+			&argc);
+		if (n == 0) {
+			return 0;
+		}
+		if (argc == NO_MORE_COMMANDS || argc == BAD_COMMANDS) {
+			if (argc == BAD_COMMANDS) {
+				start_capture(server);
+				printf("error: binary commands are cut short or corrupt\n");
+				end_capture(server, client);
+			}
+			client->closing = true;
+			return len; // (anything after the end is ignored)
+		}
+		run_command(server, client, op, argc, key, NULL);
+		return n;
+	}
+
+	// a line runs up to and including the next newline, but (like fgets) is
+	// cut off after MAX_LINE_LEN-1 characters, as for the interpreter
+	size_t max = len < MAX_LINE_LEN - 1 ? len : MAX_LINE_LEN - 1;
+	char *newline = memchr(bytes, '\n', max);
+	size_t n = newline != NULL ? newline - bytes + 1 : max;
+	if (newline == NULL && n < MAX_LINE_LEN - 1 && !client->ended) {
+		return 0;
+	}
+	if (server->strings) {
+		argc = parse_word_command(bytes, n, &op, word);
+	} else {
+		argc = parse_command(bytes, n, &op, &key);
+	}
+	if (argc >= 1) {
+		run_command(server, client, op, argc, key,
+			server->strings ? word : NULL);
+	}
+	return n;
+}
+
+// run the command with operation 'op' (and, if 'argc' is 2, argument 'key'
+// or, if it's not NULL, 'word') for 'client', adding its results to the
+// client's output
+static void run_command(Server *server, Client *client, char op, int argc,
+	int64 key, char *word) {
+	static char *descriptions[] = { " inserted\n", " already in table\n",
+		" found\n", " not found\n" };
+	server->commands++;
+
+	// inserts and lookups send their results straight back
+	if ((op == INSERT || op == LOOKUP) && argc == 2) {
+		Outcome outcome;
+		if (op == INSERT) {
+			bool inserted = word != NULL
+				? hash_table_insert_str(server->table, word, strlen(word))
+				: hash_table_insert(server->table, key);
+			outcome = inserted ? INSERTED : DUPLICATE;
+		} else {
+			bool found = word != NULL
+				? hash_table_lookup_str(server->table, word, strlen(word))
+				: hash_table_lookup(server->table, key);
+			outcome = found ? FOUND : NOT_FOUND;
+		}
+
+		if (client->mode == BINARY) {
+			char byte = outcome;
+			reply(client, &byte, 1);
+		} else {
+			if (word != NULL) {
+				reply(client, word, strlen(word));
+			} else {
+				reply_key(client, key);
+			}
+			reply(client, descriptions[outcome],
+				strlen(descriptions[outcome]));
+		}
+		return;
+	}
+
+	// anything else prints its results, which are caught and sent back
+	start_capture(server);
+	switch (op) {
+		case INSERT:
+		case LOOKUP:
+			printf("syntax: %c number\n", op);
+			break;
+		case PRINT:
+			hash_table_print(server->table);
+			break;
+		case STATS:
+			hash_table_stats(server->table);
+			break;
+		case EVENTS:
+		case EVENTS_JSON:
+			print_event_log(op == EVENTS_JSON);
+			break;
+		default:
+			printf("unknown operation '%c'\n", op);
+			// fall through!
+		case HELP:
+			printf("available operations:\n");
+			printf(" %c number: insert 'number' into table\n",  INSERT);
+			printf(" %c number: lookup is 'number' in table\n", LOOKUP);
+			printf(" %c: print table\n", PRINT);
+			printf(" %c: print stats\n", STATS);
+			printf(" %c: print traced events as CSV (run with -e)\n", EVENTS);
+			printf(" %c: print traced events as JSON (run with -e)\n",
+				EVENTS_JSON);
+			printf(" %c: quit (closes the connection)\n", QUIT);
+			break;
+		case QUIT:
+			printf("exiting\n");
+			client->closing = true;
+			break;
+	}
+	end_capture(server, client);
+}
+
+// add the 'len' bytes at 'bytes' to the results waiting for 'client'
+static void reply(Client *client, char *bytes, size_t len) {
+	if (client->output_len + len > client->output_size) {
+		while (client->output_len + len > client->output_size) {
+			client->output_size *= 2;
+		}
+		client->output = realloc(client->output, client->output_size);
+		assert(client->output);
+	}
+	memcpy(client->output + client->output_len, bytes, len);
+	client->output_len += len;
+}
+
+// add 'key', in decimal, to the results waiting for 'client'
+static void reply_key(Client *client, int64 key) {
+
+	// find the digits, last first
+	char digits[20], text[20];
+	int n = 0, i;
+	do {
+		digits[n++] = '0' + key % 10;
+		key /= 10;
+	} while (key > 0);
+	for (i = 0; i < n; i++) {
+		text[i] = digits[n - 1 - i];
+	}
+	reply(client, text, n);
+}
+
+// start catching everything printed to stdout, for end_capture to send to a
+// client instead
+static void start_capture(Server *server) {
+	fflush(stdout);
+	dup2(server->capture, STDOUT_FILENO);
+}
+
+// stop catching stdout, and add everything printed since start_capture to
+// the results waiting for 'client' (after REPLY_TEXT and the text's length,
+// for binary clients)
+static void end_capture(Server *server, Client *client) {
+	fflush(stdout);
+	dup2(server->saved_stdout, STDOUT_FILENO);
+
+	off_t len = lseek(server->capture, 0, SEEK_CUR);
+	if (client->mode == BINARY) {
+		char header[11];
+		int n = 0;
+		header[n++] = REPLY_TEXT;
+		int64 left = len;
+		while (left >= 0x80) {
+			header[n++] = (left & 0x7f) | 0x80;
+			left >>= 7;
+		}
+		header[n++] = left;
+		reply(client, header, n);
+	}
+
+	// read the text straight into the client's results
+	if (client->output_len + len > client->output_size) {
+		while (client->output_len + len > client->output_size) {
+			client->output_size *= 2;
+		}
+		client->output = realloc(client->output, client->output_size);
+		assert(client->output);
+	}
+	ssize_t got = pread(server->capture, client->output + client->output_len,
+		len, 0);
+	if (got > 0) {
+		client->output_len += got;
+	}
+	lseek(server->capture, 0, SEEK_SET);
+	int truncated = ftruncate(server->capture, 0);
+	assert(truncated == 0);
+}
+
+
+/* * *
+ * SERVER FUNCTION
+ */
+
+
+// serve the commands of clients connecting to a new Unix domain socket at
+// 'path' (replacing anything already there) on 'table', reading the
+// arguments of text clients' insert and lookup commands as words rather
+// than numbers if 'strings' is true, until the program is interrupted or
+// terminated (SIGINT or SIGTERM). the socket is removed afterwards
+// returns false (after saying why) if the socket can't be set up
+bool serve_hash_table(HashTable *table, char *path, bool strings) {
+	assert(table != NULL && path != NULL);
+	Server server = { .table = table, .strings = strings, .nclients = 0,
+		.served = 0, .commands = 0 };
+	if (!start_listening(&server, path)) {
+		return false;
+	}
+	FILE *capture = tmpfile();
+	assert(capture);
+	server.capture = fileno(capture);
+	server.saved_stdout = dup(STDOUT_FILENO);
+
+	// stop (between events) when interrupted or terminated
+	struct sigaction action;
+	memset(&action, 0, sizeof action);
+	action.sa_handler = stop_serving;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	fprintf(stderr, "listening on %s\n", path);
+
+	struct epoll_event events[MAX_EVENTS];
+	while (!stopping) {
+		int nevents = epoll_wait(server.epoll, events, MAX_EVENTS, -1);
+		int i;
+		for (i = 0; i < nevents; i++) {
+			Client *client = events[i].data.ptr;
+			if (client == NULL) {
+				accept_clients(&server);
+			} else {
+				serve_client(&server, client, events[i].events);
+			}
+		}
+	}
+
+	// the clients still connected are cut off, results and all
+	fprintf(stderr, "served %llu commands from %llu clients (%d still "
+		"connected)\n", server.commands, server.served, server.nclients);
+	close(server.listener);
+	close(server.epoll);
+	unlink(path);
+	fclose(capture);
+	close(server.saved_stdout);
+	return true;
+}
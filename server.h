@@ -0,0 +1,42 @@
+/* * * * * * * * *
+ * Server mode: the hash table interpreter's commands served to any number of
+ * clients at once over a Unix domain socket
+ *
+ * each client sends commands exactly as the interpreter would read them,
+ * either as text lines or (if it starts with their header) in binary form,
+ * and can send many commands without waiting for their results. the server
+ * runs every whole command it has received, in order, and sends back all of
+ * their results together. text clients get the same text the interpreter
+ * prints (without the prompt). binary clients get one byte per insert or
+ * lookup (its Outcome), and any other text (e.g. from 'p' or 's') as a
+ * REPLY_TEXT byte followed by the text's length as a varint and then the
+ * text itself
+ *
+ * a client's connection is closed after it sends 'quit' (or the end marker
+ * of binary commands) or closes its side of the connection, once every
+ * result has been sent. all clients share one table, and one thread serves
+ * them all (from an epoll event loop), so their commands never run at the
+ * same time
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include "hashtbl.h"
+
+// the byte before text sent to binary clients (after the Outcome bytes)
+#define REPLY_TEXT 0x04
+
+// serve the commands of clients connecting to a new Unix domain socket at
+// 'path' (replacing anything already there) on 'table', reading the
+// arguments of text clients' insert and lookup commands as words rather
+// than numbers if 'strings' is true, until the program is interrupted or
+// terminated (SIGINT or SIGTERM). the socket is removed afterwards
+// returns false (after saying why) if the socket can't be set up
+bool serve_hash_table(HashTable *table, char *path, bool strings);
+
+#endif
@@ -0,0 +1,314 @@
+/* * * * * * * * *
+ * A set of independent hash tables (shards) of one type, each protected by its
+ * own lock
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "shards.h"
+#include "tables/latency.h"
+
+// how many bytes apart to keep the locks of neighbouring shards, so that
+// threads using different shards don't fight over the same cache line
+#define CACHE_LINE 64
+
+// a shard is one of the set's tables, along with the lock protecting it
+typedef struct shard {
+	HashTable *table;
+	pthread_mutex_t mutex;		// the lock, unless the set uses rwlocks
+	pthread_rwlock_t rwlock;	// the lock, if the set uses rwlocks
+	char padding[CACHE_LINE];
+} Shard;
+
+struct shard_set {
+	Shard *shards;	// array of 2^shardbits shards
+	int nshards;	// how many shards there are
+	int shardbits;	// how many high bits of a hash value choose its shard
+	bool rwlocks;	// do the shards have reader-writer locks, or mutexes?
+};
+
+// the shard of 'set' that 'key' belongs to: h1 values are 31 bits long, and
+// the tables themselves address keys by the low bits of the same value, so
+// the top bits spread keys evenly without making each shard's keys cluster
+#define shard_of(set, key) \
+	(&(set)->shards[(set)->shardbits ? h1(key) >> (31 - (set)->shardbits) : 0])
+
+// lock 'shard' (only against writers, if 'write' is false and it has a
+// reader-writer lock)
+static void lock_shard(ShardSet *set, Shard *shard, bool write);
+
+// unlock 'shard', locked by lock_shard
+static void unlock_shard(ShardSet *set, Shard *shard);
+
+// run a batch of inserts (if 'insert' is true) or lookups on 'set', one
+// shard's keys at a time
+static void run_batch(ShardSet *set, int64 *keys, int n, bool *results,
+	bool insert);
+
+// initialise a set of 2^'shardbits' hash tables of type 'type', each with
+// initial size 'size'
+ShardSet *new_shard_set(TableType type, int size, int shardbits, bool values,
+	bool rwlocks) {
+	assert(shardbits >= 0 && shardbits <= MAX_SHARD_BITS);
+	ShardSet *set = malloc(sizeof *set);
+	assert(set);
+	set->shardbits = shardbits;
+	set->nshards = 1 << shardbits;
+	set->rwlocks = rwlocks;
+
+	set->shards = malloc(sizeof *set->shards * set->nshards);
+	assert(set->shards);
+
+	// lookups in a shard with a reader-writer lock can run at the same time,
+	// so its table's stats have to be updated atomically
+	bool previous = set_latency_shared(rwlocks);
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		shard->table = values ? new_hash_map(type, size)
+			: new_hash_table(type, size);
+		if (rwlocks) {
+			pthread_rwlock_init(&shard->rwlock, NULL);
+		} else {
+			pthread_mutex_init(&shard->mutex, NULL);
+		}
+	}
+	set_latency_shared(previous);
+
+	return set;
+}
+
+// free all memory associated with 'set'
+void free_shard_set(ShardSet *set) {
+	assert(set);
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		free_hash_table(shard->table);
+		if (set->rwlocks) {
+			pthread_rwlock_destroy(&shard->rwlock);
+		} else {
+			pthread_mutex_destroy(&shard->mutex);
+		}
+	}
+	free(set->shards);
+	free(set);
+}
+
+// insert 'key' into its shard
+bool shard_set_insert(ShardSet *set, int64 key) {
+	Shard *shard = shard_of(set, key);
+	lock_shard(set, shard, true);
+	bool inserted = hash_table_insert(shard->table, key);
+	unlock_shard(set, shard);
+	return inserted;
+}
+
+// make room for 'n' keys in total, expecting them to be spread evenly over
+// the shards
+void shard_set_reserve(ShardSet *set, int n) {
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		lock_shard(set, shard, true);
+		hash_table_reserve(shard->table, (n + set->nshards - 1) / set->nshards);
+		unlock_shard(set, shard);
+	}
+}
+
+// lookup whether 'key' is in its shard
+bool shard_set_lookup(ShardSet *set, int64 key) {
+	Shard *shard = shard_of(set, key);
+	lock_shard(set, shard, false);
+	bool found = hash_table_lookup(shard->table, key);
+	unlock_shard(set, shard);
+	return found;
+}
+
+// associate 'value' with 'key' in its shard
+bool shard_set_put(ShardSet *set, int64 key, int64 value) {
+	Shard *shard = shard_of(set, key);
+	lock_shard(set, shard, true);
+	bool inserted = hash_table_put(shard->table, key, value);
+	unlock_shard(set, shard);
+	return inserted;
+}
+
+// lookup the value associated with 'key' in its shard
+bool shard_set_get(ShardSet *set, int64 key, int64 *value) {
+	Shard *shard = shard_of(set, key);
+	lock_shard(set, shard, false);
+	bool found = hash_table_get(shard->table, key, value);
+	unlock_shard(set, shard);
+	return found;
+}
+
+// replace the value associated with 'key' in its shard
+bool shard_set_update(ShardSet *set, int64 key, int64 value) {
+	Shard *shard = shard_of(set, key);
+	lock_shard(set, shard, true);
+	bool updated = hash_table_update(shard->table, key, value);
+	unlock_shard(set, shard);
+	return updated;
+}
+
+// print the contents of every shard to stdout
+void shard_set_print(ShardSet *set) {
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		lock_shard(set, shard, true);
+		printf("--- shard %d of %d ---\n", i, set->nshards);
+		hash_table_print(shard->table);
+		unlock_shard(set, shard);
+	}
+}
+
+// print some statistics about every shard to stdout
+void shard_set_stats(ShardSet *set) {
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		lock_shard(set, shard, true);
+		printf("--- shard %d of %d ---\n", i, set->nshards);
+		hash_table_stats(shard->table);
+		unlock_shard(set, shard);
+	}
+}
+
+// count the bytes used by every shard (and the set itself) into *usage
+void shard_set_memory_usage(ShardSet *set, MemoryUsage *usage) {
+	usage->directory = sizeof *set + sizeof *set->shards * set->nshards;
+	usage->buckets = usage->slack = usage->stats = 0;
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		MemoryUsage shard_usage;
+		lock_shard(set, shard, false);
+		hash_table_memory_usage(shard->table, &shard_usage);
+		unlock_shard(set, shard);
+		add_memory_usage(usage, &shard_usage);
+	}
+}
+
+// insert each of the 'n' keys in 'keys' into its shard
+void shard_set_insert_batch(ShardSet *set, int64 *keys, int n, bool *results) {
+	run_batch(set, keys, n, results, true);
+}
+
+// lookup whether each of the 'n' keys in 'keys' is in its shard
+void shard_set_lookup_batch(ShardSet *set, int64 *keys, int n, bool *results) {
+	run_batch(set, keys, n, results, false);
+}
+
+// call 'func' on every key in every shard
+void shard_set_foreach(ShardSet *set, ScanFunc func, void *ctx) {
+	int i;
+	for (i = 0; i < set->nshards; i++) {
+		Shard *shard = &set->shards[i];
+		lock_shard(set, shard, false);
+		hash_table_foreach(shard->table, func, ctx);
+		unlock_shard(set, shard);
+	}
+}
+
+// get the key after 'cursor', moving on to the next shard whenever one runs
+// out of keys
+bool shard_set_next(ShardSet *set, Cursor *cursor, int64 *key, int64 *value) {
+	while (cursor->shard < set->nshards) {
+		if (hash_table_next(set->shards[cursor->shard].table, cursor, key,
+			value)) {
+			return true;
+		}
+		cursor->shard++;
+		cursor->part = cursor->block = cursor->entry = 0;
+	}
+	return false;
+}
+
+// lock 'shard' (only against writers, if 'write' is false and it has a
+// reader-writer lock)
+static void lock_shard(ShardSet *set, Shard *shard, bool write) {
+	if (!set->rwlocks) {
+		pthread_mutex_lock(&shard->mutex);
+	} else if (write) {
+		pthread_rwlock_wrlock(&shard->rwlock);
+	} else {
+		pthread_rwlock_rdlock(&shard->rwlock);
+	}
+}
+
+// unlock 'shard', locked by lock_shard
+static void unlock_shard(ShardSet *set, Shard *shard) {
+	if (set->rwlocks) {
+		pthread_rwlock_unlock(&shard->rwlock);
+	} else {
+		pthread_mutex_unlock(&shard->mutex);
+	}
+}
+
+// run a batch of inserts (if 'insert' is true) or lookups on 'set', one
+// shard's keys at a time
+static void run_batch(ShardSet *set, int64 *keys, int n, bool *results,
+	bool insert) {
+	if (n <= 0) {
+		return;
+	}
+
+	// count the keys in each shard, then sort them by shard (keeping their
+	// order within each shard, which matters for repeated inserts) and
+	// remember where each one came from
+	int *starts = calloc(set->nshards + 1, sizeof *starts);
+	int64 *sorted = malloc(sizeof *sorted * n);
+	int *origin = malloc(sizeof *origin * n);
+	bool *sorted_results = malloc(sizeof *sorted_results * n);
+	assert(starts && sorted && origin && sorted_results);
+	int i, s;
+	for (i = 0; i < n; i++) {
+		starts[shard_of(set, keys[i]) - set->shards + 1]++;
+	}
+	for (s = 0; s < set->nshards; s++) {
+		starts[s + 1] += starts[s];
+	}
+	for (i = 0; i < n; i++) {
+		int pos = starts[shard_of(set, keys[i]) - set->shards]++;
+		sorted[pos] = keys[i];
+		origin[pos] = i;
+	}
+
+	// (the placement loop moved each start along to the next shard's start)
+	int start = 0;
+	for (s = 0; s < set->nshards; s++) {
+		int count = starts[s] - start;
+		if (count > 0) {
+			Shard *shard = &set->shards[s];
+			lock_shard(set, shard, insert);
+			if (insert) {
+				hash_table_insert_batch(shard->table, sorted + start, count,
+					sorted_results + start);
+			} else {
+				hash_table_lookup_batch(shard->table, sorted + start, count,
+					sorted_results + start);
+			}
+			unlock_shard(set, shard);
+		}
+		start = starts[s];
+	}
+
+	for (i = 0; i < n; i++) {
+		results[origin[i]] = sorted_results[i];
+	}
+
+	free(starts);
+	free(sorted);
+	free(origin);
+	free(sorted_results);
+}
@@ -0,0 +1,56 @@
+/* * * * * * * * *
+ * A set of independent hash tables (shards) of one type, each protected by its
+ * own lock, so that several threads can use the set at once: each key belongs
+ * to the shard chosen by the high bits of its hash value, and only that
+ * shard's lock is held while it is being inserted or looked up
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include <stdbool.h>
+#include "inthash.h"
+#include "hashtbl.h"
+
+// the most shards a set can have is 2 to the power of this
+#define MAX_SHARD_BITS 16
+
+typedef struct shard_set ShardSet;
+
+// initialise a set of 2^'shardbits' hash tables of type 'type', each with
+// initial size 'size' (and storing a value alongside each key, if 'values' is
+// true). if 'rwlocks' is true, each shard has a reader-writer lock, so that
+// lookups and gets in the same shard can run at the same time (their tables
+// update their stats atomically); otherwise each shard has a mutex
+ShardSet *new_shard_set(TableType type, int size, int shardbits, bool values,
+	bool rwlocks);
+
+// free all memory associated with 'set' (no other thread may be using it)
+void free_shard_set(ShardSet *set);
+
+// the hashtbl.h functions, each locking the shard (or shards) it uses
+bool shard_set_insert(ShardSet *set, int64 key);
+void shard_set_reserve(ShardSet *set, int n);
+bool shard_set_lookup(ShardSet *set, int64 key);
+bool shard_set_put(ShardSet *set, int64 key, int64 value);
+bool shard_set_get(ShardSet *set, int64 key, int64 *value);
+bool shard_set_update(ShardSet *set, int64 key, int64 value);
+void shard_set_print(ShardSet *set);
+void shard_set_stats(ShardSet *set);
+void shard_set_memory_usage(ShardSet *set, MemoryUsage *usage);
+
+// the hashtbl.h batch functions: the batch is split up by shard, and each
+// shard's part of it is run with that shard's lock held just once
+void shard_set_insert_batch(ShardSet *set, int64 *keys, int n, bool *results);
+void shard_set_lookup_batch(ShardSet *set, int64 *keys, int n, bool *results);
+
+// the hashtbl.h scan functions, visiting one shard after another. other
+// threads may use the set during a foreach (each shard is locked while it is
+// visited), but not during a scan with a cursor
+void shard_set_foreach(ShardSet *set, ScanFunc func, void *ctx);
+bool shard_set_next(ShardSet *set, Cursor *cursor, int64 *key, int64 *value);
+
+#endif
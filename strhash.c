@@ -0,0 +1,23 @@
+/* * * * * * * * *
+ * Module containing a hash function for variable-length string keys
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include "strhash.h"
+
+// constants for the FNV-1a hash function
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+// hash the 'len' bytes starting at 'str' into a 64-bit integer
+int64 strhash(char *str, int len) {
+	int64 hash = FNV_OFFSET;
+	int i;
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
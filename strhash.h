@@ -0,0 +1,19 @@
+/* * * * * * * * *
+ * Module containing a hash function for variable-length string keys
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef STRHASH_H
+#define STRHASH_H
+
+#include "inthash.h"
+
+// the following function takes the 'len' bytes starting at 'str' and returns
+// a 64-bit hash of them (using the FNV-1a algorithm). every byte affects every
+// bit of the result, so it can be passed to h1() or h2() just like any other
+// 64-bit key to get a table address
+int64 strhash(char *str, int len);
+
+#endif
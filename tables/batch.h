@@ -0,0 +1,37 @@
+/* * * * * * * * *
+ * Shared settings for the batch insert and lookup functions of the various
+ * hash table types
+ *
+ * batches are processed in blocks: every key in a block is hashed first, then
+ * the keys are probed in order while the memory for keys a few places ahead
+ * is prefetched, so that several cache misses are in flight at once instead
+ * of stalling on each key in turn
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+// how many keys to hash at a time before probing them
+#define BATCH_BLOCK 64
+
+// how many keys ahead of the probe to prefetch memory for. tables that need
+// to follow a pointer (a directory entry, then a bucket, then its keys)
+// prefetch each level one multiple of this distance closer to the probe
+#define PREFETCH_DISTANCE 4
+
+// hint that the memory at 'addr' will be read soon. does nothing on compilers
+// without a prefetch builtin
+#ifdef __GNUC__
+#define prefetch(addr) __builtin_prefetch(addr)
+#else
+#define prefetch(addr) ((void)(addr))
+#endif
+
+// the number of keys in the block of a batch of 'n' keys starting at 'start'
+#define block_size(n, start) \
+	((n) - (start) < BATCH_BLOCK ? (n) - (start) : BATCH_BLOCK)
+
+#endif
@@ -12,22 +12,43 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "cuckoo.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
 
 #define USED true // To indicate the slot is used
 #define NOT_USED false // To indicate the slot is still available
 #define FOUND true // To indicate the key can be found in the table
 #define NOT_FOUND false // To indicate the key cannot be found in the table
 
+// The version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
+// Macros to access the key and value stored in slot i of an inner table whose
+// entries are 'w' words wide (keys are interleaved with their values, if any)
+#define KEY(t, w, i) (t)->slots[(i) * (w)]
+#define VALUE(t, w, i) (t)->slots[(i) * (w) + 1]
+
+// Macro to prefetch the slots (and in-use markers) at address H1 of table 1
+// and address H2 of table 2, ahead of a batch probe
+#define prefetch_slots(table, H1, H2) do { \
+	prefetch(&KEY((table)->table1, (table)->width, H1)); \
+	prefetch(&KEY((table)->table2, (table)->width, H2)); \
+	prefetch(&(table)->table1->inuse[H1]); \
+	prefetch(&(table)->table2->inuse[H2]); \
+} while (0)
+
 
 /*********************************** STRUCT **********************************/
 // an inner table represents one of the two internal tables for a cuckoo
 // hash table. it stores two parallel arrays: 'slots' for storing keys and
 // 'inuse' for marking which entries are occupied
 typedef struct inner_table {
-	int64 *slots;	// array of slots holding keys
+	int64 *slots;	// array of slots holding keys (each followed by its value,
+					// if the table stores values)
 	bool  *inuse;	// is this slot in use or not?
 } InnerTable;
 
@@ -35,8 +56,11 @@ typedef struct inner_table {
 typedef struct stats {
 	int load_table1; // number of keys that have been inserted into Table 1
 	int load_table2; // number of keys that have been inserted into Table 2
-	int time;		// how much CPU time has been used to insert/lookup 
-					// keys in this table
+	Latency inserts;	// how long inserts (and puts) have taken
+	Latency lookups;	// how long lookups (and gets and updates) have taken
+	int resizes_avoided; // how many doublings were done up front by
+						 // cuckoo_hash_table_reserve instead of when full
+	Histogram kicks; // how many keys each insert kicked out of their slots
 } Stats;
 
 // a cuckoo hash table stores its keys in two inner tables
@@ -44,10 +68,32 @@ struct cuckoo_table {
 	InnerTable *table1; // first table
 	InnerTable *table2; // second table
 	int size;			// size of each table
+	int width;			// how many int64 words each slot takes up (1 or 2)
 	int load;			 // total number of keys that have been inserted
+	double max_load;	 // the most of their slots the tables fill before
+						 // growing
+	int growth;			 // what the tables' size is multiplied by when they
+						 // grow
 	Stats stats;		 // collection of statistic about this hash table
+	Snapshot *snapshot;	 // the snapshot the inner tables' arrays are being
+						 // used in place from, or NULL if they were allocated
 };
 
+// the first section of a snapshot of a cuckoo hash table, followed by a
+// section holding each of the 'slots' and 'inuse' arrays of table 1 and then
+// table 2, as they are in memory
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	int size;
+	int width;
+	int load;
+	double max_load;
+	int growth;
+	Stats stats;
+} SnapshotHeader;
+
 /****************************** HELPER FUNCTIONS *****************************/
 // The initialise_cuckoo_table and double_cuckoo_table is cited from Matt
 // Farrugia with some modifications
@@ -57,21 +103,69 @@ struct cuckoo_table {
 static void initialise_cuckoo_table(CuckooHashTable *table, int size);
 
 // Helper function to initialise the InnerTable
-static InnerTable *initialise_inner_table(InnerTable *innertable, int size);
+static InnerTable *initialise_inner_table(InnerTable *innertable, int size,
+	int width);
 
-// Helper function to double the size of the cuckoo hash table
+// Helper function to double the size of the cuckoo hash table (or grow it by
+// its own growth factor)
 static void double_cuckoo_table(CuckooHashTable *table);
 
+// Helper function to change the size of each of the cuckoo hash table's
+// tables to 'size', reinserting all of its keys
+static void resize_cuckoo_table(CuckooHashTable *table, int size);
+
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(CuckooHashTable *table, int64 key, int64 value,
+	bool overwrite);
+
+// Helper function to find the slot holding 'key' in 'table', returning a
+// pointer to it (the key's value, if any, is the next word), or NULL
+static int64 *find_entry(CuckooHashTable *table, int64 key);
+
+// Helper function to search for 'key' at addresses 'H1' and 'H2' of the two
+// tables, returning a pointer to its slot as for find_entry (without timing)
+static int64 *search_entry(CuckooHashTable *table, int64 key, int H1, int H2);
+
 /**************************** FUNCTION DEFINITIONS ***************************/
-// initialise a cuckoo hash table with 'size' slots in each table
-CuckooHashTable *new_cuckoo_hash_table(int size) {
+// initialise a cuckoo hash table with 'size' slots in each table, storing
+// a value alongside each key if 'values' is true
+CuckooHashTable *new_cuckoo_hash_table(int size, bool values) {
 	CuckooHashTable *table = malloc(sizeof *table);
 	assert(table);
+	table->width = values ? 2 : 1;
+	table->max_load = 1;
+	table->growth = 2;
+	table->snapshot = NULL;
 	
 	// Set up the internals of the table struct with arrays of size 'size'
 	initialise_cuckoo_table(table, size);
 	
-	table->stats.time = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.kicks);
+	
+	return table;
+}
+
+// initialise a cuckoo hash table holding the 'n' keys in 'keys', with at
+// least 'size' slots in each table, doubled up front until the tables will
+// be at most half full
+CuckooHashTable *new_cuckoo_hash_table_from_keys(int size, int64 *keys, int n) {
+	assert(size > 0);
+	
+	// Below half full, cycles are rare enough that the tables should almost
+	// never need to double while these keys go in
+	while (size < n) {
+		size *= 2;
+	}
+	CuckooHashTable *table = new_cuckoo_hash_table(size, false);
+	
+	int i;
+	for (i = 0; i < n; i++) {
+		insert_entry(table, keys[i], 0, false);
+	}
 	
 	return table;
 }
@@ -80,12 +174,16 @@ CuckooHashTable *new_cuckoo_hash_table(int size) {
 void free_cuckoo_hash_table(CuckooHashTable *table) {
 	assert(table);
 	
-	// Free the slots and inuse arrays
-	free(table->table1->slots);
-	free(table->table1->inuse);
-		
-	free(table->table2->slots);
-	free(table->table2->inuse);
+	// Free the slots and inuse arrays (or the snapshot they're in)
+	if (table->snapshot) {
+		unmap_snapshot(table->snapshot);
+	} else {
+		free(table->table1->slots);
+		free(table->table1->inuse);
+			
+		free(table->table2->slots);
+		free(table->table2->inuse);
+	}
 	
 	// Free the array of inner tables
 	free(table->table1);
@@ -95,128 +193,283 @@ void free_cuckoo_hash_table(CuckooHashTable *table) {
 	free(table);
 }
 
-// insert 'key' into 'table', if it's not in there already
-// returns true if insertion succeeds, false if it was already in there
-bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key) {
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool cuckoo_hash_table_save(CuckooHashTable *table, FILE *file) {
 	assert(table);
-	int start_time = clock(); // Start timing
 	
-	int H1 = h1(key) % table->size, H2 = h2(key) % table->size, H = H1;
-	int insert_table = 1, time_kicked_keys = 0;
-	int64 kick_key;
-	InnerTable *temp_table = table->table1;
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->size,
+		table->width, table->load, table->max_load, table->growth,
+		table->stats };
+	bool written = write_section(file, &header, sizeof header);
 	
-	// Double the size of the table if it has been full
-	if (table->load == 2*table->size - 1) {
-		double_cuckoo_table(table);
-		table->stats.time = clock() - start_time; // Add time elapsed
-		return cuckoo_hash_table_insert(table, key);
+	// The inner tables' arrays are written exactly as they are
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	int t;
+	for (t = 0; t < 2 && written; t++) {
+		written = write_section(file, innertables[t]->slots,
+				(table->size)*(table->width)*sizeof (int64))
+			&& write_section(file, innertables[t]->inuse,
+				(table->size)*sizeof (bool));
+	}
+	return written;
+}
+
+// load a table written by cuckoo_hash_table_save from the next sections of
+// 'snapshot', using its arrays in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+CuckooHashTable *cuckoo_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)
+		|| header->size <= 0 || header->size >= MAX_TABLE_SIZE
+		|| header->width < 1 || header->width > 2
+		|| header->load < 0 || header->load > 2 * header->size) {
+		return NULL;
 	}
 	
-	// Check whether the key has been inserted or not in Table 1
-	if (table->table1->slots[H1] == key && table->table1->inuse[H1] == USED) {
-		table->stats.time = clock() - start_time; // Add time elapsed
-		return false;
+	CuckooHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->size = header->size;
+	table->width = header->width;
+	table->load = header->load;
+	table->max_load = header->max_load;
+	table->growth = header->growth;
+	table->stats = header->stats;
+	
+	// The arrays are used straight from the snapshot, until the table grows
+	table->table1 = malloc(sizeof (InnerTable));
+	table->table2 = malloc(sizeof (InnerTable));
+	assert(table->table1 && table->table2);
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	bool intact = true;
+	int t;
+	for (t = 0; t < 2; t++) {
+		innertables[t]->slots = read_section(snapshot,
+			(table->size)*(table->width)*sizeof (int64));
+		innertables[t]->inuse = read_section(snapshot,
+			(table->size)*sizeof (bool));
+		intact = intact && innertables[t]->slots && innertables[t]->inuse;
+	}
+	if (!intact) {
+		free(table->table1);
+		free(table->table2);
+		free(table);
+		return NULL;
 	}
+	table->snapshot = snapshot;
 	
-	// Check whether the key has been inserted or not in Table 2
-	else if (table->table2->slots[H2] == key && 
-		table->table2->inuse[H2] == USED) {
-		table->stats.time = clock() - start_time; // Add time elapsed
-		return false;
+	return table;
+}
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key) {
+	assert(table);
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+// make room in 'table' for 'n' keys in total, doubling the tables up front
+// until they will be at most half full once all the keys are in
+void cuckoo_hash_table_reserve(CuckooHashTable *table, int n) {
+	assert(table);
+	
+	// Grow the tables all in one go, to the size they would have doubled
+	// their way up to (and past the load they're allowed to grow at), but no
+	// further than the largest table size
+	int size = table->size;
+	while ((size < n || table->max_load * 2*size <= n)
+		&& (int64)size * table->growth < MAX_TABLE_SIZE) {
+		size *= table->growth;
+		table->stats.resizes_avoided++;
 	}
-		
-	// The table has not been inserted before, try to insert the key
-	else {
-			
-		// Try to find an empty slot
-		while (temp_table->inuse[H] == USED  && 
-			time_kicked_keys != 2*(table->size)) {		
-			kick_key = temp_table->slots[H];
-			time_kicked_keys++;
-				
-			temp_table->slots[H] = key;
-			key = kick_key;
-			
-			// If it kicked the key from the Table 1, need to insert 
-			// the kicked key to the Table 2 
-			if (insert_table == 1) {
-				
-				// Mark the next table that will be visited is table 2
-				insert_table = 2;
-				
-				// Update the temp_table and the hash
-				temp_table = table->table2;
-				H = h2(key) % table->size;
-				
-			}
-				
-			// If it kicked the key from the Table 2, need to insert 
-			// the kicked key to the Table 1
-			else if (insert_table == 2) {
-				
-				// Mark the next table that will be visited is table 1
-				insert_table = 1;
-				
-				// Update the temp_table and the hash
-				temp_table = table->table1;
-				H = h1(key) % table->size;
+	if (size > table->size) {
+		resize_cuckoo_table(table, size);
+	}
+}
+
+// make 'table' grow once more than the fraction 'max_load' of its slots are
+// in use (rather than only once they are all but full), multiplying the size
+// of its tables by 'growth' (rather than 2) each time
+void cuckoo_hash_table_set_growth(CuckooHashTable *table, double max_load,
+	int growth) {
+	assert(table);
+	assert(max_load > 0 && max_load <= 1 && growth >= 2);
+	table->max_load = max_load;
+	table->growth = growth;
+}
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order of the slots of the first and then
+// the second table
+void cuckoo_hash_table_foreach(CuckooHashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table);
+	
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	int t, i, w = table->width;
+	for (t = 0; t < 2; t++) {
+		for (i = 0; i < table->size; i++) {
+			if (innertables[t]->inuse[i] == USED) {
+				func(KEY(innertables[t], w, i),
+					w > 1 ? VALUE(innertables[t], w, i) : 0, ctx);
 			}
-		}	
-		
-		// The number of kicked key is equal to the 2 times the table size,
-		// indicates that there is a cycling, so we need to grow the table
-		if (time_kicked_keys == 2*(table->size)) {
-			double_cuckoo_table(table);
-			table->stats.time = clock() - start_time; // Add time elapsed
-			return cuckoo_hash_table_insert(table, key);
 		}
-		
-		// Otherwise, just insert the key to the empty slot
-		else {
+	}
+}
 
-			// We have found the empty slot, try to insert it
-			temp_table->slots[H] = key;
-			temp_table->inuse[H] = USED;
-			table->load++;
-			
-			// Update the loaded keys 
-			if (insert_table == 1) {
-				table->stats.load_table1++;
-			}
-			else if (insert_table == 2) {
-				table->stats.load_table2++;
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool cuckoo_hash_table_next(CuckooHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table);
+	
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	int w = table->width;
+	while (cursor->part < 2) {
+		InnerTable *innertable = innertables[cursor->part];
+		
+		// The next used slot in this table, if it has any left
+		while (cursor->block < table->size) {
+			int i = cursor->block++;
+			if (innertable->inuse[i] == USED) {
+				*key = KEY(innertable, w, i);
+				if (value != NULL) {
+					*value = w > 1 ? VALUE(innertable, w, i) : 0;
+				}
+				return true;
 			}
-			
-			table->stats.time = clock() - start_time; // Add time elapsed
-			return true;
 		}
+		
+		// Otherwise, move on to the next table
+		cursor->part++;
+		cursor->block = 0;
 	}
-	
+	return false;
 }
 
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool cuckoo_hash_table_lookup(CuckooHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // Start timing
+	return find_entry(table, key) != NULL;
+}
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool cuckoo_hash_table_put(CuckooHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool cuckoo_hash_table_get(CuckooHashTable *table, int64 key, int64 *value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
+	
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	*value = entry[1];
+	return FOUND;
+}
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool cuckoo_hash_table_update(CuckooHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
 	
-	int H1 = h1(key) % table->size, H2 = h2(key) % table->size;
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	entry[1] = value;
+	return FOUND;
+}
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void cuckoo_hash_table_insert_batch(CuckooHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
 	
-	// Check whether the key is available on Table 1
-	if (table->table1->slots[H1] == key && table->table1->inuse[H1] == USED) {
-		table->stats.time = clock() - start_time; // Add time elapsed
-		return FOUND;
+	int hashes1[BATCH_BLOCK], hashes2[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes1[i] = h1(keys[start + i]);
+			hashes2[i] = h2(keys[start + i]);
+		}
+		
+		// Then insert each key, while prefetching both of the slots a few 
+		// keys ahead (an insertion may double the tables, so addresses are 
+		// recalculated from the hash values each time)
+		for (i = 0; i < m; i++) {
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch_slots(table, hashes1[i + PREFETCH_DISTANCE] % 
+					table->size, hashes2[i + PREFETCH_DISTANCE] % table->size);
+			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
+		}
 	}
 	
-	// Check whether the key is avaialbe on Table 2
-	if (table->table2->slots[H2] == key && table->table2->inuse[H2] == USED) {\
-		table->stats.time = clock() - start_time; // Add time elapsed
-		return FOUND;
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void cuckoo_hash_table_lookup_batch(CuckooHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+	
+	int H1[BATCH_BLOCK], H2[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first, prefetching the first few keys' slots
+		for (i = 0; i < m; i++) {
+			H1[i] = h1(keys[start + i]) % table->size;
+			H2[i] = h2(keys[start + i]) % table->size;
+			if (i < PREFETCH_DISTANCE) {
+				prefetch_slots(table, H1[i], H2[i]);
+			}
+		}
+		
+		// Then probe for each key, while prefetching the slots a few keys
+		// ahead
+		for (i = 0; i < m; i++) {
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch_slots(table, H1[i + PREFETCH_DISTANCE],
+					H2[i + PREFETCH_DISTANCE]);
+			}
+			results[start + i] = search_entry(table, keys[start + i], H1[i],
+				H2[i]) != NULL;
+		}
 	}
 	
-	table->stats.time = clock() - start_time; // Add time elapsed
-	return NOT_FOUND;
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
 }
 
 // print the contents of 'table' to stdout
@@ -234,7 +487,7 @@ void cuckoo_hash_table_print(CuckooHashTable *table) {
 
 		// table 1 key
 		if (table->table1->inuse[i]) {
-			printf(" %20llu ", table->table1->slots[i]);
+			printf(" %20llu ", KEY(table->table1, table->width, i));
 		} else {
 			printf(" %20s ", "-");
 		}
@@ -244,7 +497,7 @@ void cuckoo_hash_table_print(CuckooHashTable *table) {
 
 		// table 2 key
 		if (table->table2->inuse[i]) {
-			printf(" %llu\n", table->table2->slots[i]);
+			printf(" %llu\n", KEY(table->table2, table->width, i));
 		} else {
 			printf(" %s\n",  "-");
 		}
@@ -266,10 +519,22 @@ void cuckoo_hash_table_stats(CuckooHashTable *table) {
 	printf("total number of keys in table 1 and table 2: %d\n", table->load);
 	printf("                                load factor: %.3f%%\n", 
 		table->load * 100.0 / (2*table->size));
+	if (table->stats.resizes_avoided > 0) {
+		printf("                            resizes avoided: %d\n",
+			table->stats.resizes_avoided);
+	}
+	if (table->max_load < 1 || table->growth != 2) {
+		printf("                          grows (x%d) past: %.1f%% load\n",
+			table->growth, table->max_load * 100);
+	}
+	
+	// Print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
 	
-	// Calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf(" 			     CPU time spent: %.6f sec\n\n", seconds);
+	// Print how many keys inserts have had to kick out of their slots
+	print_histogram("kicks per insert", &table->stats.kicks);
+	printf("\n");
 	
 	// Print some stats about state of the table 1
 	printf("--- table 1 stats ---\n");
@@ -285,9 +550,26 @@ void cuckoo_hash_table_stats(CuckooHashTable *table) {
 	printf("                    load factor: %.3f%%\n\n", 
 		table->stats.load_table2 * 100.0 / table->size);
 	
+	MemoryUsage usage;
+	cuckoo_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->load);
+	
 	printf("--- end stats ---\n");
 }
 
+// count the bytes 'table' is using into *usage
+void cuckoo_hash_table_memory_usage(CuckooHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	size_t slot_bytes = sizeof *table->table1->slots * table->width
+		+ sizeof *table->table1->inuse;
+	usage->directory = sizeof *table
+		+ 2 * sizeof *table->table1;
+	usage->stats = sizeof table->stats;
+	usage->buckets = slot_bytes * 2 * table->size;
+	usage->slack = slot_bytes * (2 * table->size - table->load);
+}
+
 /************************** INITIALISE CUCKOO TABLE **************************/
 // Helper functions to set up the internals of a cuckoo hash table struct with
 // new arrays of size 'size'
@@ -296,8 +578,8 @@ static void initialise_cuckoo_table(CuckooHashTable *table, int size) {
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 	
 	// Initialise the new memory allocation for Table 1 and Table 2
-	table->table1 = initialise_inner_table(table->table1, size);
-	table->table2 = initialise_inner_table(table->table2, size);
+	table->table1 = initialise_inner_table(table->table1, size, table->width);
+	table->table2 = initialise_inner_table(table->table2, size, table->width);
 		
 	// Update the new size of the hash table
 	table->size = size;
@@ -314,11 +596,12 @@ static void initialise_cuckoo_table(CuckooHashTable *table, int size) {
 
 /************************** INITIALISE INNER TABLE ***************************/
 // Helper function to initialise the InnerTable
-static InnerTable *initialise_inner_table(InnerTable *innertable, int size) {
-	innertable = malloc((size)*sizeof (InnerTable));
+static InnerTable *initialise_inner_table(InnerTable *innertable, int size,
+	int width) {
+	innertable = malloc(sizeof (InnerTable));
 	assert(innertable);
 	
-	innertable->slots = malloc((size)*sizeof (int64));
+	innertable->slots = malloc((size)*(width)*sizeof (int64));
 	innertable->inuse = malloc((size)*sizeof (bool));
 	assert(innertable->slots);
 	assert(innertable->inuse);
@@ -327,32 +610,206 @@ static InnerTable *initialise_inner_table(InnerTable *innertable, int size) {
 	
 }
 /**************************** DOUBLE CUCKOO TABLE  ***************************/ 
-// Helper function to double the size of the cuckoo hash table
+// Helper function to double the size of the cuckoo hash table (or grow it by
+// its own growth factor)
 static void double_cuckoo_table(CuckooHashTable *table) {
-	int64 *oldslots1 = table->table1->slots;
-	int64 *oldslots2 = table->table2->slots;
-	bool *oldinuse1 = table->table1->inuse;
-	bool *oldinuse2 = table->table2->inuse;
+	resize_cuckoo_table(table, table->size * table->growth);
+}
+
+/**************************** RESIZE CUCKOO TABLE  ***************************/ 
+// Helper function to change the size of each of the cuckoo hash table's
+// tables to 'size', reinserting all of its keys
+static void resize_cuckoo_table(CuckooHashTable *table, int size) {
+	int64 start = event_start();
+	InnerTable *oldtable1 = table->table1, *oldtable2 = table->table2;
+	int64 *oldslots1 = oldtable1->slots;
+	int64 *oldslots2 = oldtable2->slots;
+	bool *oldinuse1 = oldtable1->inuse;
+	bool *oldinuse2 = oldtable2->inuse;
 	int oldsize = table->size, i;
 	
-	initialise_cuckoo_table(table, table->size * 2);
+	// The old arrays may be in the snapshot: keep it mapped until they've
+	// been reinserted, even if reinserting grows the tables again
+	Snapshot *snapshot = table->snapshot;
+	table->snapshot = NULL;
+	
+	initialise_cuckoo_table(table, size);
 	
 	// Insert the data to the new hash table
 	for (i = 0; i < oldsize; i++) {
 		
 		if (oldinuse1[i] == USED) {
-			cuckoo_hash_table_insert(table, oldslots1[i]);
+			insert_entry(table, oldslots1[i*table->width],
+				oldslots1[i*table->width + table->width - 1], false);
 		}
 		
 		if (oldinuse2[i] == USED) {
-			cuckoo_hash_table_insert(table, oldslots2[i]);
+			insert_entry(table, oldslots2[i*table->width],
+				oldslots2[i*table->width + table->width - 1], false);
 		}
 	}
 	
-	// Free the pointers after being used
-	free(oldslots1);
-	free(oldslots2);
-	free(oldinuse1);
-	free(oldinuse2);
+	// Free the pointers after being used (the old arrays were all the table
+	// was using its snapshot for)
+	if (snapshot) {
+		unmap_snapshot(snapshot);
+	} else {
+		free(oldslots1);
+		free(oldslots2);
+		free(oldinuse1);
+		free(oldinuse2);
+	}
+	free(oldtable1);
+	free(oldtable2);
+	
+	// (reinserting may itself have grown the tables further)
+	record_event(EVENT_RESIZE, "cuckoo", start, oldsize, table->size,
+		table->load);
 }
 
+/******************************** INSERT ENTRY *******************************/
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(CuckooHashTable *table, int64 key, int64 value,
+	bool overwrite) {
+	int H1 = h1(key) % table->size, H2 = h2(key) % table->size, H = H1;
+	int insert_table = 1, time_kicked_keys = 0, w = table->width;
+	int64 kick_key, kick_value;
+	InnerTable *temp_table = table->table1;
+	
+	// Double the size of the table if it has been full (or as full as it's
+	// allowed to get)
+	if (table->load >= table->max_load * 2*table->size - 1) {
+		double_cuckoo_table(table);
+		return insert_entry(table, key, value, overwrite);
+	}
+	
+	// Check whether the key has been inserted or not in Table 1
+	if (KEY(table->table1, w, H1) == key && table->table1->inuse[H1] == USED) {
+		if (overwrite) {
+			VALUE(table->table1, w, H1) = value;
+		}
+		return false;
+	}
+	
+	// Check whether the key has been inserted or not in Table 2
+	else if (KEY(table->table2, w, H2) == key && 
+		table->table2->inuse[H2] == USED) {
+		if (overwrite) {
+			VALUE(table->table2, w, H2) = value;
+		}
+		return false;
+	}
+		
+	// The table has not been inserted before, try to insert the key
+	else {
+			
+		// Try to find an empty slot
+		while (temp_table->inuse[H] == USED  && 
+			time_kicked_keys != 2*(table->size)) {		
+			kick_key = KEY(temp_table, w, H);
+			time_kicked_keys++;
+				
+			// The kicked key's value (if any) travels along with it
+			KEY(temp_table, w, H) = key;
+			key = kick_key;
+			if (w > 1) {
+				kick_value = VALUE(temp_table, w, H);
+				VALUE(temp_table, w, H) = value;
+				value = kick_value;
+			}
+			
+			// If it kicked the key from the Table 1, need to insert 
+			// the kicked key to the Table 2 
+			if (insert_table == 1) {
+				
+				// Mark the next table that will be visited is table 2
+				insert_table = 2;
+				
+				// Update the temp_table and the hash
+				temp_table = table->table2;
+				H = h2(key) % table->size;
+				
+			}
+				
+			// If it kicked the key from the Table 2, need to insert 
+			// the kicked key to the Table 1
+			else if (insert_table == 2) {
+				
+				// Mark the next table that will be visited is table 1
+				insert_table = 1;
+				
+				// Update the temp_table and the hash
+				temp_table = table->table1;
+				H = h1(key) % table->size;
+			}
+		}	
+		
+		// The number of kicked key is equal to the 2 times the table size,
+		// indicates that there is a cycling, so we need to grow the table
+		if (time_kicked_keys == 2*(table->size)) {
+			int64 start = event_start();
+			int oldsize = table->size;
+			double_cuckoo_table(table);
+			record_event(EVENT_CYCLE, "cuckoo", start, oldsize, table->size,
+				time_kicked_keys);
+			return insert_entry(table, key, value, false);
+		}
+		
+		// Otherwise, just insert the key to the empty slot
+		else {
+
+			// We have found the empty slot, try to insert it
+			KEY(temp_table, w, H) = key;
+			if (w > 1) {
+				VALUE(temp_table, w, H) = value;
+			}
+			temp_table->inuse[H] = USED;
+			table->load++;
+			
+			// Update the loaded keys 
+			if (insert_table == 1) {
+				table->stats.load_table1++;
+			}
+			else if (insert_table == 2) {
+				table->stats.load_table2++;
+			}
+			histogram_add(&table->stats.kicks, time_kicked_keys);
+			
+			return true;
+		}
+	}
+	
+}
+
+/********************************* FIND ENTRY ********************************/
+// Helper function to find the slot holding 'key' in 'table', returning a
+// pointer to it (the key's value, if any, is the next word), or NULL
+static int64 *find_entry(CuckooHashTable *table, int64 key) {
+	int64 start = latency_start(&table->stats.lookups);
+	
+	int64 *entry = search_entry(table, key, h1(key) % table->size,
+		h2(key) % table->size);
+	
+	latency_stop(&table->stats.lookups, start);
+	return entry;
+}
+
+/******************************** SEARCH ENTRY *******************************/
+// Helper function to search for 'key' at addresses 'H1' and 'H2' of the two
+// tables, returning a pointer to its slot as for find_entry (without timing)
+static int64 *search_entry(CuckooHashTable *table, int64 key, int H1, int H2) {
+	int w = table->width;
+	
+	// Check whether the key is available on Table 1
+	if (KEY(table->table1, w, H1) == key && table->table1->inuse[H1] == USED) {
+		return &KEY(table->table1, w, H1);
+	}
+	
+	// Check whether the key is avaialbe on Table 2
+	if (KEY(table->table2, w, H2) == key && table->table2->inuse[H2] == USED) {
+		return &KEY(table->table2, w, H2);
+	}
+	
+	return NULL;
+}
@@ -14,27 +14,97 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "scan.h"
+#include "snapshot.h"
+#include "memory.h"
 
 typedef struct cuckoo_table CuckooHashTable;
 
-// initialise a cuckoo hash table with 'size' slots in each table
-CuckooHashTable *new_cuckoo_hash_table(int size);
+// initialise a cuckoo hash table with 'size' slots in each table, storing
+// a value alongside each key if 'values' is true
+CuckooHashTable *new_cuckoo_hash_table(int size, bool values);
+
+// initialise a cuckoo hash table holding the 'n' keys in 'keys', with at
+// least 'size' slots in each table, doubled up front until the tables will
+// be at most half full
+CuckooHashTable *new_cuckoo_hash_table_from_keys(int size, int64 *keys, int n);
 
 // free all memory associated with 'table'
 void free_cuckoo_hash_table(CuckooHashTable *table);
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool cuckoo_hash_table_save(CuckooHashTable *table, FILE *file);
+
+// load a table written by cuckoo_hash_table_save from the next sections of
+// 'snapshot', using its arrays in place. the table takes over 'snapshot',
+// unmapping it once it's no longer needed. returns NULL (leaving 'snapshot'
+// alone) if it was written with a different snapshot layout, or is cut short
+// or corrupted
+CuckooHashTable *cuckoo_hash_table_load(Snapshot *snapshot);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool cuckoo_hash_table_insert(CuckooHashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, doubling the tables up front
+// until they will be at most half full once all the keys are in
+void cuckoo_hash_table_reserve(CuckooHashTable *table, int n);
+
+// make 'table' grow once more than the fraction 'max_load' of its slots are
+// in use (rather than only once they are all but full), multiplying the size
+// of its tables by 'growth' (rather than 2) each time
+void cuckoo_hash_table_set_growth(CuckooHashTable *table, double max_load,
+	int growth);
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order of the slots of the first and then
+// the second table
+void cuckoo_hash_table_foreach(CuckooHashTable *table, ScanFunc func,
+	void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool cuckoo_hash_table_next(CuckooHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool cuckoo_hash_table_lookup(CuckooHashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void cuckoo_hash_table_insert_batch(CuckooHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void cuckoo_hash_table_lookup_batch(CuckooHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool cuckoo_hash_table_put(CuckooHashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool cuckoo_hash_table_get(CuckooHashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool cuckoo_hash_table_update(CuckooHashTable *table, int64 key, int64 value);
+
 // print the contents of 'table' to stdout
 void cuckoo_hash_table_print(CuckooHashTable *table);
 
 // print some statistics about 'table' to stdout
 void cuckoo_hash_table_stats(CuckooHashTable *table);
 
+// count the bytes 'table' is using into *usage
+void cuckoo_hash_table_memory_usage(CuckooHashTable *table,
+	MemoryUsage *usage);
+
 #endif
@@ -0,0 +1,444 @@
+/* * * * * * * * *
+ * Disk-resident dynamic hash table using extendible hashing with multiple
+ * keys per bucket, resolving collisions by incrementally growing the hash
+ * table one page at a time
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from xtndbln.c and xtndbln.h with some modifications
+ * to suit the purpose.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "diskxtndbln.h"
+#include "pager.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
+
+// Macro to calculate the rightmost n bits of a number x
+#define rightmostnbits(n, x) (x) & ((1 <<(n)) - 1)
+
+#define FOUND true // To indicate the key can be found in the table
+#define NOT_FOUND false // To indicate the key cannot be found in the table
+
+// How many keys fit in a bucket, once its header takes up the start of a page
+#define BUCKET_KEYS ((PAGE_SIZE - 4 * sizeof (int)) / sizeof (int64))
+
+/*********************************** STRUCT **********************************/
+// a bucket is exactly one page of the data file, storing an array of keys
+// it also knows how many bits are shared between possible keys, and the first 
+// table address that references it
+typedef struct diskxtndbln_bucket {
+	int id;			// a unique id for this bucket, equal to the first address
+					// in the table which points to it
+	int depth;		// how many hash value bits are being used by this bucket
+	int nkeys;		// number of keys currently contained in this bucket
+	int64 keys[BUCKET_KEYS];	// the keys stored in this bucket
+} Bucket;
+
+// the start of the directory file, followed by the page number of the bucket
+// at each table address
+typedef struct directory_header {
+	int depth;		// how many bits of the hash value to use (log2(size))
+	int nkeys;		// how many keys are being stored in the table
+} DirectoryHeader;
+
+// helper structure to store statistics gathered
+typedef struct stats {
+	int nbuckets;	// how many distinct buckets does the table point to
+	int nkeys;		// how many keys are being stored in the table
+	Latency inserts;	// how long inserts have taken
+	Latency lookups;	// how long lookups have taken
+	Histogram splits;	// how many buckets each insert had to split
+	long dirwrites;	// how many times the directory file has been written to
+} Stats;
+
+// a hash table is an array of page numbers of buckets holding up to 
+// BUCKET_KEYS keys each, along with some information about the number of hash
+// value bits to use for addressing. the directory is kept in memory as well as
+// in its file, which is updated whenever the directory changes
+struct diskxtndbln_table {
+	Pager *pager;		// the data file of buckets, and the pool caching them
+	int dirfd;			// the directory file
+	int *directory;		// the page number of the bucket at each address
+	int size;			// how many entries in the directory (2^depth)
+	int depth;			// how many bits of the hash value to use (log2(size))
+	Stats stats;		// collection of statistics about this hash table
+};
+
+/****************************** HELPER FUNCTIONS *****************************/
+// Helper function to write the entries of the directory from address 'from'
+// up to (but not including) address 'to' to the directory file
+static void write_directory(DiskXtndblNHashTable *table, int from, int to);
+
+// Helper function to write the directory file's header
+static void write_header(DiskXtndblNHashTable *table);
+
+// Helper function to double the directory, duplicating the page numbers in
+// the first half into the new second half of the directory
+static void double_directory(DiskXtndblNHashTable *table);
+
+// Helper function to split the bucket at address 'address' into a new page,
+// growing the directory if necessary. only the two buckets' pages and one
+// stretch of the directory are changed
+static void split_bucket(DiskXtndblNHashTable *table, int address);
+
+// Helper function to search 'bucket' for 'key'
+static bool search_bucket(Bucket *bucket, int64 key);
+
+/**************************** FUNCTION DEFINITIONS ***************************/
+// open the disk-resident extendible hash table stored in the files 'path'.pages
+// and 'path'.dir, creating an empty table if they don't exist yet, and caching
+// up to 'npages' buckets in memory
+// returns NULL if the files can't be opened
+DiskXtndblNHashTable *new_diskxtndbln_hash_table(char *path, int npages) {
+	assert(sizeof (Bucket) == PAGE_SIZE);
+	
+	// Open (or create) both files
+	char *filename = malloc(strlen(path) + sizeof ".pages");
+	assert(filename);
+	sprintf(filename, "%s.pages", path);
+	Pager *pager = open_pager(filename, npages);
+	sprintf(filename, "%s.dir", path);
+	int dirfd = open(filename, O_RDWR | O_CREAT, 0644);
+	free(filename);
+	if (pager == NULL || dirfd < 0) {
+		if (pager != NULL) {
+			close_pager(pager);
+		}
+		if (dirfd >= 0) {
+			close(dirfd);
+		}
+		return NULL;
+	}
+	
+	DiskXtndblNHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->pager = pager;
+	table->dirfd = dirfd;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	initialise_histogram(&table->stats.splits);
+	table->stats.dirwrites = 0;
+	
+	// Read the directory of an existing table
+	DirectoryHeader header;
+	if (pread(dirfd, &header, sizeof header, 0) == sizeof header) {
+		table->depth = header.depth;
+		table->size = 1 << header.depth;
+		table->directory = malloc((sizeof *table->directory) * table->size);
+		assert(table->directory);
+		ssize_t bytes = (sizeof *table->directory) * table->size;
+		ssize_t nread = pread(dirfd, table->directory, bytes, sizeof header);
+		assert(nread == bytes && "error: directory file is truncated!");
+		table->stats.nbuckets = pager->npages;
+		table->stats.nkeys = header.nkeys;
+		return table;
+	}
+	
+	// Otherwise, start with one empty bucket
+	table->size = 1;
+	table->depth = 0;
+	table->directory = malloc(sizeof *table->directory);
+	assert(table->directory);
+	Bucket *bucket = new_page(pager, &table->directory[0]);
+	bucket->id = 0;
+	bucket->depth = 0;
+	bucket->nkeys = 0;
+	release_page(pager, table->directory[0], true);
+	table->stats.nbuckets = 1;
+	table->stats.nkeys = 0;
+	
+	write_header(table);
+	write_directory(table, 0, table->size);
+	
+	return table;
+}
+
+// write every changed bucket and the directory back to the table's files, and
+// free all memory associated with 'table'
+void free_diskxtndbln_hash_table(DiskXtndblNHashTable *table) {
+	assert(table);
+	
+	// The number of keys is only kept up to date in the file from here
+	write_header(table);
+	close(table->dirfd);
+	close_pager(table->pager);
+	
+	free(table->directory);
+	free(table);
+}
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool diskxtndbln_hash_table_insert(DiskXtndblNHashTable *table, int64 key) {
+	assert(table);
+	int64 start = latency_start(&table->stats.inserts);
+	int hash = h1(key), splits = 0;
+	
+	while (true) {
+		int address = rightmostnbits(table->depth, hash);
+		int page_no = table->directory[address];
+		Bucket *bucket = get_page(table->pager, page_no);
+		
+		// Check whether the key has been inserted or not
+		if (search_bucket(bucket, key) == FOUND) {
+			release_page(table->pager, page_no, false);
+			latency_stop(&table->stats.inserts, start);
+			return false;
+		}
+		
+		// If there is space in the bucket, insert the key there
+		if (bucket->nkeys < BUCKET_KEYS) {
+			bucket->keys[bucket->nkeys++] = key;
+			release_page(table->pager, page_no, true);
+			table->stats.nkeys++;
+			histogram_add(&table->stats.splits, splits);
+			latency_stop(&table->stats.inserts, start);
+			return true;
+		}
+		
+		// Otherwise, split the bucket and try again
+		release_page(table->pager, page_no, false);
+		split_bucket(table, address);
+		splits++;
+	}
+}
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool diskxtndbln_hash_table_lookup(DiskXtndblNHashTable *table, int64 key) {
+	assert(table);
+	int64 start = latency_start(&table->stats.lookups);
+	
+	int address = rightmostnbits(table->depth, h1(key));
+	int page_no = table->directory[address];
+	Bucket *bucket = get_page(table->pager, page_no);
+	bool found = search_bucket(bucket, key);
+	release_page(table->pager, page_no, false);
+	
+	latency_stop(&table->stats.lookups, start);
+	return found;
+}
+
+// print the contents of 'table' to stdout
+void diskxtndbln_hash_table_print(DiskXtndblNHashTable *table) {
+	assert(table);
+	printf("--- table size: %d\n", table->size);
+
+	// print header
+	printf("  table:               buckets:\n");
+	printf("  address | bucketid   bucketid [key]\n");
+	
+	// print table and buckets
+	int i, j;
+	for (i = 0; i < table->size; i++) {
+		// table entry
+		Bucket *bucket = get_page(table->pager, table->directory[i]);
+		printf("%9d | %-9d ", i, bucket->id);
+
+		// if this is the first address at which a bucket occurs, print it now
+		if (bucket->id == i) {
+			printf("%9d ", bucket->id);
+
+			// print the bucket's contents
+			printf("[");
+			for (j = 0; j < BUCKET_KEYS; j++) {
+				if (j < bucket->nkeys) {
+					printf(" %llu", bucket->keys[j]);
+				} else {
+					printf(" -");
+				}
+			}
+			printf(" ]");
+		}
+		release_page(table->pager, table->directory[i], false);
+		
+		// end the line
+		printf("\n");
+	}
+
+	printf("--- end table ---\n");
+}
+
+// print some statistics about 'table' to stdout
+void diskxtndbln_hash_table_stats(DiskXtndblNHashTable *table) {
+	assert(table);
+	
+	printf("--- table stats ---\n");
+	
+	// print some stats about state of the table
+	printf("        current table size: %d\n", table->size);
+	printf("            number of keys: %d\n", table->stats.nkeys);
+	printf("         number of buckets: %d\n", table->stats.nbuckets);
+	printf(" number of keys per bucket: %d\n", (int)BUCKET_KEYS);
+	
+	// and about the traffic to and from the files
+	PagerStats *io = &table->pager->stats;
+	long requests = io->hits + io->reads;
+	printf("  buffer pool size (pages): %d\n", table->pager->nframes);
+	printf("     buffer pool hit ratio: %.3f\n",
+		requests > 0 ? io->hits * 1.0 / requests : 0);
+	printf("                pages read: %ld\n", io->reads);
+	printf("             pages written: %ld\n", io->writes);
+	printf("          directory writes: %ld\n", table->stats.dirwrites);
+	
+	// also print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	
+	// and how many buckets inserts have had to split
+	print_histogram("splits per insert", &table->stats.splits);
+	
+	MemoryUsage usage;
+	diskxtndbln_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->stats.nkeys);
+	
+	printf("--- end stats ---\n");
+}
+
+// count the bytes 'table' is using into *usage
+void diskxtndbln_hash_table_memory_usage(DiskXtndblNHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	Pager *pager = table->pager;
+	usage->directory = sizeof *table
+		+ sizeof *table->directory * table->size;
+	usage->stats = sizeof table->stats;
+	usage->buckets = sizeof *pager + sizeof *pager->frame_of * pager->capacity
+		+ (sizeof *pager->frames + PAGE_SIZE) * (size_t)pager->nframes;
+
+	// frames not holding a page yet are slack
+	usage->slack = 0;
+	int i;
+	for (i = 0; i < pager->nframes; i++) {
+		if (pager->frames[i].page_no < 0) {
+			usage->slack += PAGE_SIZE;
+		}
+	}
+}
+
+/****************************** WRITE DIRECTORY ******************************/
+// Helper function to write the entries of the directory from address 'from'
+// up to (but not including) address 'to' to the directory file
+static void write_directory(DiskXtndblNHashTable *table, int from, int to) {
+	ssize_t bytes = (sizeof *table->directory) * (to - from);
+	off_t offset = sizeof (DirectoryHeader)
+		+ (sizeof *table->directory) * (off_t)from;
+	ssize_t nwritten = pwrite(table->dirfd, &table->directory[from], bytes,
+		offset);
+	assert(nwritten == bytes && "error: can't write directory!");
+	table->stats.dirwrites++;
+}
+
+/******************************** WRITE HEADER *******************************/
+// Helper function to write the directory file's header
+static void write_header(DiskXtndblNHashTable *table) {
+	DirectoryHeader header = { table->depth, table->stats.nkeys };
+	ssize_t nwritten = pwrite(table->dirfd, &header, sizeof header, 0);
+	assert(nwritten == sizeof header && "error: can't write directory!");
+}
+
+/****************************** DOUBLE DIRECTORY *****************************/
+// Helper function to double the directory, duplicating the page numbers in
+// the first half into the new second half of the directory
+static void double_directory(DiskXtndblNHashTable *table) {
+	int64 start = event_start();
+	int size = table->size * 2;
+	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+	
+	// Get a new array of twice as many page numbers, and copy them down
+	table->directory = realloc(table->directory,
+		(sizeof *table->directory) * size);
+	assert(table->directory);
+	memcpy(table->directory + table->size, table->directory,
+		(sizeof *table->directory) * table->size);
+	
+	// Only the new half of the directory (and its depth) need to be written
+	int oldsize = table->size;
+	table->size = size;
+	table->depth++;
+	write_directory(table, oldsize, size);
+	write_header(table);
+	record_event(EVENT_DOUBLE, "diskxtndbln", start, oldsize, size, 0);
+}
+
+/******************************** SPLIT BUCKET *******************************/
+// Helper function to split the bucket at address 'address' into a new page,
+// growing the directory if necessary
+static void split_bucket(DiskXtndblNHashTable *table, int address) {
+	int page_no = table->directory[address];
+	Bucket *bucket = get_page(table->pager, page_no);
+	
+	// FIRST,
+	// Do we need to grow the table?
+	if (bucket->depth == table->depth) {
+		double_directory(table);
+	}
+	int64 start = event_start();
+	
+	// SECOND,
+	// Create the new bucket in a new page and update our bucket's depth
+	int depth = bucket->depth;
+	int new_depth = depth + 1;
+	bucket->depth = new_depth;
+	
+	int new_page_no;
+	Bucket *newbucket = new_page(table->pager, &new_page_no);
+	newbucket->id = 1 << depth | bucket->id;
+	newbucket->depth = new_depth;
+	newbucket->nkeys = 0;
+	table->stats.nbuckets++;
+	
+	// THIRD,
+	// Redirect every second address pointing to this bucket to the new bucket
+	// (every address ending in the new bucket's bits), then write the stretch
+	// of the directory between the first and last of them in one go
+	int a, last = newbucket->id;
+	for (a = newbucket->id; a < table->size; a += 1 << new_depth) {
+		table->directory[a] = new_page_no;
+		last = a;
+	}
+	write_directory(table, newbucket->id, last + 1);
+	
+	// FINALLY,
+	// Move the keys with a 1 at the new bit of their hash value into the new
+	// bucket, and pack the others down
+	int i, nkept = 0;
+	for (i = 0; i < bucket->nkeys; i++) {
+		int64 key = bucket->keys[i];
+		if ((h1(key) >> depth) & 1) {
+			newbucket->keys[newbucket->nkeys++] = key;
+		} else {
+			bucket->keys[nkept++] = key;
+		}
+	}
+	bucket->nkeys = nkept;
+	record_event(EVENT_SPLIT, "diskxtndbln", start, i, nkept,
+		newbucket->nkeys);
+	
+	release_page(table->pager, page_no, true);
+	release_page(table->pager, new_page_no, true);
+}
+
+/******************************* SEARCH BUCKET *******************************/
+// Helper function to search 'bucket' for 'key'
+static bool search_bucket(Bucket *bucket, int64 key) {
+	int i;
+	for (i = 0; i < bucket->nkeys; i++) {
+		if (bucket->keys[i] == key) {
+			return FOUND;
+		}
+	}
+	return NOT_FOUND;
+}
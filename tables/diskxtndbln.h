@@ -0,0 +1,53 @@
+/* * * * * * * * *
+ * Disk-resident dynamic hash table using extendible hashing with multiple
+ * keys per bucket: each bucket is a page of a data file, read and written
+ * through a bounded buffer pool, and the directory is an array of page
+ * numbers kept in a file of its own
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from xtndbln.c and xtndbln.h with some modifications
+ * to suit the purpose.
+ */
+
+#ifndef DISKXTNDBLN_H
+#define DISKXTNDBLN_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "memory.h"
+
+typedef struct diskxtndbln_table DiskXtndblNHashTable;
+
+// open the disk-resident extendible hash table stored in the files 'path'.pages
+// (the buckets) and 'path'.dir (the directory), creating an empty table if
+// they don't exist yet, and caching up to 'npages' buckets in memory
+// returns NULL if the files can't be opened
+DiskXtndblNHashTable *new_diskxtndbln_hash_table(char *path, int npages);
+
+// write every changed bucket and the directory back to the table's files, and
+// free all memory associated with 'table' (the files are kept, so the table can
+// be opened again later)
+void free_diskxtndbln_hash_table(DiskXtndblNHashTable *table);
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool diskxtndbln_hash_table_insert(DiskXtndblNHashTable *table, int64 key);
+
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool diskxtndbln_hash_table_lookup(DiskXtndblNHashTable *table, int64 key);
+
+// print the contents of 'table' to stdout
+void diskxtndbln_hash_table_print(DiskXtndblNHashTable *table);
+
+// print some statistics about 'table' to stdout
+void diskxtndbln_hash_table_stats(DiskXtndblNHashTable *table);
+
+// count the bytes 'table' is using into *usage: the bytes of its directory
+// and buffer pool held in memory, not of its files
+void diskxtndbln_hash_table_memory_usage(DiskXtndblNHashTable *table,
+	MemoryUsage *usage);
+
+#endif
@@ -0,0 +1,123 @@
+/* * * * * * * * *
+ * Shared trace of the structural changes the various hash table types make
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "events.h"
+
+// the name of each kind of event, as printed
+static char *event_names[] = { "resize", "double", "split", "cycle" };
+
+// is tracing on?
+bool events_enabled = false;
+
+// the ring buffer of the most recent events: event number n (counting from 0
+// since tracing was enabled) is kept in ring[n % capacity]
+static Event *ring = NULL;
+static int capacity = 0;
+static int64 nrecorded = 0;
+
+// how many events of each kind have been recorded
+static int64 counts[NEVENT_TYPES];
+
+// when tracing was enabled, which event times are measured from
+static int64 first_ns = 0;
+
+// held while recording or printing events, for tables used by several threads
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// start keeping the most recent 'n' structural changes
+void enable_event_log(int n) {
+	assert(n > 0);
+	free_event_log();
+	ring = malloc((sizeof *ring) * n);
+	assert(ring);
+	capacity = n;
+	nrecorded = 0;
+	memset(counts, 0, sizeof counts);
+	first_ns = read_clock();
+	events_enabled = true;
+}
+
+// stop tracing, and free the events kept so far
+void free_event_log(void) {
+	events_enabled = false;
+	free(ring);
+	ring = NULL;
+	capacity = 0;
+}
+
+// record a structural change of kind 'type' to a table of type 'table',
+// started (with event_start) at 'start', if tracing is on
+void record_event(EventType type, char *table, int64 start, int old_size,
+	int new_size, int moved) {
+	if (!events_enabled || start == 0) {
+		return;
+	}
+	Event event = { type, table, start - first_ns, read_clock() - start,
+		old_size, new_size, moved };
+
+	pthread_mutex_lock(&ring_lock);
+	ring[nrecorded % capacity] = event;
+	nrecorded++;
+	counts[type]++;
+	pthread_mutex_unlock(&ring_lock);
+}
+
+// print every event kept to stdout, oldest first, as CSV (with a header
+// line) or, if 'json' is true, as a JSON object
+void print_event_log(bool json) {
+	if (!events_enabled) {
+		printf("event tracing is off\n");
+		return;
+	}
+	pthread_mutex_lock(&ring_lock);
+
+	// the oldest event kept is 'capacity' events before the latest one
+	int64 first = nrecorded > capacity ? nrecorded - capacity : 0;
+	if (json) {
+		printf("{\"recorded\": %llu, \"dropped\": %llu, \"events\": [",
+			nrecorded, first);
+	} else {
+		printf("event,table,time_ns,duration_ns,old_size,new_size,"
+			"keys_moved\n");
+	}
+
+	int64 n;
+	for (n = first; n < nrecorded; n++) {
+		Event *e = &ring[n % capacity];
+		if (json) {
+			printf("%s\n {\"event\": \"%s\", \"table\": \"%s\", "
+				"\"time_ns\": %llu, \"duration_ns\": %llu, \"old_size\": %d, "
+				"\"new_size\": %d, \"keys_moved\": %d}", n > first ? "," : "",
+				event_names[e->type], e->table, e->time, e->duration,
+				e->old_size, e->new_size, e->moved);
+		} else {
+			printf("%s,%s,%llu,%llu,%d,%d,%d\n", event_names[e->type],
+				e->table, e->time, e->duration, e->old_size, e->new_size,
+				e->moved);
+		}
+	}
+
+	if (json) {
+		printf("%s]}\n", nrecorded > first ? "\n" : "");
+	}
+	pthread_mutex_unlock(&ring_lock);
+}
+
+// how many events of kind 'type' have been recorded since tracing was
+// enabled (including any no longer kept)
+int64 count_events(EventType type) {
+	pthread_mutex_lock(&ring_lock);
+	int64 count = counts[type];
+	pthread_mutex_unlock(&ring_lock);
+	return count;
+}
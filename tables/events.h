@@ -0,0 +1,76 @@
+/* * * * * * * * *
+ * Shared trace of the structural changes the various hash table types make
+ * (resizes, directory doublings, bucket splits, and growth forced by a cuckoo
+ * cycle), so that slow operations can be matched up with what caused them
+ *
+ * tracing is off unless enable_event_log is called, and costs a single test
+ * per structural change while off. while on, the most recent events are kept
+ * in a ring buffer of fixed capacity, shared by every table in the program
+ * (and safe to record into from several threads at once)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+
+// the kinds of structural change. the meaning of an event's sizes depends on
+// its kind:
+// RESIZE: slots in the table before and after (keys moved: keys rehashed)
+// DOUBLE: entries in the directory before and after (no keys move)
+// SPLIT:  keys in the bucket before and after (keys moved: to the new bucket)
+// CYCLE:  slots or directory entries before and after the growth a cuckoo
+//         cycle forced (keys moved: keys kicked before the cycle was found)
+typedef enum event_type {
+	EVENT_RESIZE,
+	EVENT_DOUBLE,
+	EVENT_SPLIT,
+	EVENT_CYCLE
+} EventType;
+#define NEVENT_TYPES (EVENT_CYCLE + 1)
+
+// one structural change to a table
+typedef struct event {
+	EventType type;
+	char *table;		// the type of table that changed ("linear", ...)
+	int64 time;			// when it started, in ns since tracing was enabled
+	int64 duration;		// how long it took, in ns
+	int old_size;		// the size of what changed, before and after (see
+	int new_size;		// EventType above)
+	int moved;			// how many keys had to move
+} Event;
+
+// is tracing on? (checked before anything else is done for an event)
+extern bool events_enabled;
+
+// start keeping the most recent 'n' structural changes
+void enable_event_log(int n);
+
+// stop tracing, and free the events kept so far
+void free_event_log(void);
+
+// start timing a structural change
+// returns the time to pass to record_event (0 if tracing is off)
+#define event_start() (events_enabled ? read_clock() : 0)
+
+// record a structural change of kind 'type' to a table of type 'table',
+// started (with event_start) at 'start', if tracing is on
+void record_event(EventType type, char *table, int64 start, int old_size,
+	int new_size, int moved);
+
+// print every event kept to stdout, oldest first, as CSV (with a header
+// line) or, if 'json' is true, as a JSON object
+void print_event_log(bool json);
+
+// how many events of kind 'type' have been recorded since tracing was
+// enabled (including any no longer kept)
+int64 count_events(EventType type);
+
+// the current time in nanoseconds (defined with the latency timers)
+int64 read_clock(void);
+
+#endif
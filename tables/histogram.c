@@ -0,0 +1,53 @@
+/* * * * * * * * *
+ * Shared type for recording how a count is distributed, for the stats of the
+ * various hash table types
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "histogram.h"
+
+// set up 'hist' with nothing recorded yet
+void initialise_histogram(Histogram *hist) {
+	memset(hist, 0, sizeof *hist);
+}
+
+// print the counts recorded in 'hist', labelled 'name', to stdout as
+// "group:times" pairs for each group that was recorded at least once
+void print_histogram(char *name, Histogram *hist) {
+	printf("%24s histogram:", name);
+	
+	int64 recorded = 0;
+	int bucket;
+	for (bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+		if (hist->count[bucket] == 0) {
+			continue;
+		}
+		recorded += hist->count[bucket];
+		
+		// group 'bucket' holds the counts with exactly 'bucket' bits (the
+		// last one holds all larger counts too), none of them more than the
+		// largest count recorded
+		int low = bucket == 0 ? 0 : 1 << (bucket - 1);
+		int high = bucket == 0 ? 0 : (1 << bucket) - 1;
+		if (high > hist->max || bucket == HISTOGRAM_BUCKETS - 1) {
+			high = hist->max;
+		}
+		if (low == high) {
+			printf(" %d:%llu", low, hist->count[bucket]);
+		} else {
+			printf(" %d-%d:%llu", low, high, hist->count[bucket]);
+		}
+	}
+	
+	if (recorded == 0) {
+		printf(" none\n");
+	} else {
+		printf(" (mean %.2f, max %d)\n", hist->total * 1.0 / recorded,
+			hist->max);
+	}
+}
@@ -0,0 +1,49 @@
+/* * * * * * * * *
+ * Shared type for recording how a count (probe lengths, kicks, splits, keys
+ * per bucket) is distributed, for the stats of the various hash table types
+ *
+ * counts are grouped by powers of two (0, 1, 2-3, 4-7, ...), so recording
+ * one is only a few shifts and an increment, and printing the whole
+ * distribution takes a single line
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "../inthash.h"
+
+// how many groups of counts there are: 0, then one per power of two, with
+// the last group also holding every count larger than that
+#define HISTOGRAM_BUCKETS 16
+
+// how a count is distributed across the times it was recorded
+typedef struct histogram {
+	int64 count[HISTOGRAM_BUCKETS];	// how many times a count in each group
+									// was recorded
+	int64 total;	// the sum of all of the counts recorded
+	int max;		// the largest count recorded
+} Histogram;
+
+// record 'value' (at least 0) in 'hist': its group is its number of bits
+static inline void histogram_add(Histogram *hist, int value) {
+	int bucket = 0;
+	while ((value >> bucket) != 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+		bucket++;
+	}
+	hist->count[bucket]++;
+	hist->total += value;
+	if (value > hist->max) {
+		hist->max = value;
+	}
+}
+
+// set up 'hist' with nothing recorded yet
+void initialise_histogram(Histogram *hist);
+
+// print the counts recorded in 'hist', labelled 'name', as one line of stats
+void print_histogram(char *name, Histogram *hist);
+
+#endif
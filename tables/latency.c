@@ -0,0 +1,228 @@
+/* * * * * * * * *
+ * Shared instrumentation for timing the operations of the various hash table
+ * types
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+
+#ifndef HT_NO_STATS
+
+// how long to measure the tick rate against the clock for, at least
+#define CALIBRATION_NS 10000000
+
+// the percentiles to print, as fractions and as labels
+static double percentiles[] = { 0.5, 0.99, 0.999 };
+static char *percentile_names[] = { "p50", "p99", "p99.9" };
+#define NPERCENTILES (sizeof percentiles / sizeof *percentiles)
+
+// the tick count and clock reading when the first table was set up, against
+// which the tick rate is measured
+static int64 first_ticks, first_ns;
+
+// how many operations each new Latency times one of (0 for none)
+static int sampling = HT_STATS_SAMPLE;
+
+// are new Latencies shared between threads?
+static bool sharing = false;
+
+// the histogram bucket that 'ticks' belongs to
+static int bucket_of(int64 ticks);
+
+// the largest tick count belonging to histogram bucket 'bucket'
+static int64 bucket_limit(int bucket);
+
+// how many ticks there are per nanosecond
+static double ticks_per_ns(void);
+
+#endif
+
+// set up 'lat' with no operations recorded yet
+void initialise_latency(Latency *lat) {
+	memset(lat, 0, sizeof *lat);
+#ifndef HT_NO_STATS
+	// (with no sampling, the countdown starts from 0 and so never gets back
+	// there)
+	lat->sample = sampling;
+	lat->countdown = sampling > 0 ? 1 : 0;
+	lat->shared = sharing;
+	if (first_ns == 0) {
+		first_ticks = read_ticks();
+		first_ns = read_clock();
+	}
+#endif
+}
+
+// make every Latency set up from now on time one operation in every 'every'
+// (or none of them, if 'every' is 0)
+// returns the previous setting
+int set_latency_sampling(int every) {
+#ifdef HT_NO_STATS
+	return every;
+#else
+	int previous = sampling;
+	sampling = every;
+	return previous;
+#endif
+}
+
+// make every Latency set up from now on shared between threads, if 'shared'
+// is true
+// returns the previous setting
+bool set_latency_shared(bool shared) {
+#ifdef HT_NO_STATS
+	return shared;
+#else
+	bool previous = sharing;
+	sharing = shared;
+	return previous;
+#endif
+}
+
+// print the timings in 'lat' for the operations called 'name' to stdout
+void print_latency(char *name, Latency *lat) {
+#ifdef HT_NO_STATS
+	printf("%16s latency: not recorded (built with HT_NO_STATS)\n", name);
+#else
+	double scale = ticks_per_ns();
+	printf("%16s latency: %llu ops, %llu timed, %.6f sec in total\n", name,
+		lat->ops, lat->timed, lat->total / scale / 1e9);
+	if (lat->timed == 0) {
+		return;
+	}
+
+	printf("%16s latency:", name);
+	int p;
+	for (p = 0; p < NPERCENTILES; p++) {
+		printf(" %s %.0f ns,", percentile_names[p],
+			latency_percentile(lat, percentiles[p]));
+	}
+	printf(" max %.0f ns\n", lat->max / scale);
+#endif
+}
+
+// convert 'ticks' ticks (as recorded in a Latency) to nanoseconds
+double ticks_to_ns(int64 ticks) {
+#ifdef HT_NO_STATS
+	return ticks;
+#else
+	return ticks / ticks_per_ns();
+#endif
+}
+
+// the current time in nanoseconds, from the system's monotonic clock
+int64 read_clock(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#ifndef HT_NO_STATS
+
+// add an operation taking 'ticks' ticks, or a batch of 'n' operations taking
+// 'ticks' ticks in total, to 'lat'
+void latency_record(Latency *lat, int64 ticks, int n) {
+	int64 each = ticks / n;
+	if (lat->shared) {
+		__atomic_fetch_add(&lat->timed, n, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&lat->total, ticks, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&lat->histogram[bucket_of(each)], n,
+			__ATOMIC_RELAXED);
+		int64 max = __atomic_load_n(&lat->max, __ATOMIC_RELAXED);
+		while (each > max && !__atomic_compare_exchange_n(&lat->max, &max,
+			each, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		}
+		return;
+	}
+	lat->timed += n;
+	lat->total += ticks;
+	lat->histogram[bucket_of(each)] += n;
+	if (each > lat->max) {
+		lat->max = each;
+	}
+}
+
+// latency_start for a shared Latency: the operations timed are picked by
+// their place in the count instead of by the countdown, so that each thread
+// can tell from its own atomic increment whether its operation is one of
+// them
+int64 latency_start_shared(Latency *lat) {
+	int64 ops = __atomic_add_fetch(&lat->ops, 1, __ATOMIC_RELAXED);
+	if (lat->sample == 0 || ops % lat->sample != 0) {
+		return 0;
+	}
+	return read_ticks();
+}
+
+// the time (in ns) within which the fraction 'fraction' of the operations
+// timed in 'lat' finished (never more than 1/8 above the true value)
+double latency_percentile(Latency *lat, double fraction) {
+
+	// walk up the histogram to the bucket the percentile falls in, and use
+	// its limit (or the slowest time, if that's less)
+	int64 rank = (int64)(fraction * lat->timed), seen = 0;
+	int bucket = 0;
+	while (seen + lat->histogram[bucket] <= rank
+		&& bucket < LATENCY_BUCKETS - 1) {
+		seen += lat->histogram[bucket];
+		bucket++;
+	}
+	int64 limit = bucket_limit(bucket);
+	return (limit < lat->max ? limit : lat->max) / ticks_per_ns();
+}
+
+// the shortest and longest times (in ns) counted in histogram bucket
+// 'bucket' of a Latency
+void latency_bucket_range(int bucket, double *min_ns, double *max_ns) {
+	double scale = ticks_per_ns();
+	*min_ns = (bucket == 0 ? 0 : bucket_limit(bucket - 1) + 1) / scale;
+	*max_ns = bucket_limit(bucket) / scale;
+}
+
+// the histogram bucket that 'ticks' belongs to: small counts get a bucket
+// each, and larger ones share a bucket with the counts that have the same
+// leading bit and the same LATENCY_SUB_BITS bits after it
+static int bucket_of(int64 ticks) {
+	if (ticks < (1 << LATENCY_SUB_BITS)) {
+		return ticks;
+	}
+	int top = 63 - __builtin_clzll(ticks);
+	int shift = top - LATENCY_SUB_BITS;
+	return ((shift + 1) << LATENCY_SUB_BITS)
+		+ ((ticks >> shift) & ((1 << LATENCY_SUB_BITS) - 1));
+}
+
+// the largest tick count belonging to histogram bucket 'bucket'
+static int64 bucket_limit(int bucket) {
+	if (bucket < (1 << LATENCY_SUB_BITS)) {
+		return bucket;
+	}
+	int shift = (bucket >> LATENCY_SUB_BITS) - 1;
+	int64 sub = bucket & ((1 << LATENCY_SUB_BITS) - 1);
+	return ((((int64)1 << LATENCY_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+// how many ticks there are per nanosecond, measured over everything since
+// the first table was set up (waiting a little if that was only just now, or
+// if every table so far was loaded from a snapshot rather than set up)
+static double ticks_per_ns(void) {
+	if (first_ns == 0) {
+		first_ticks = read_ticks();
+		first_ns = read_clock();
+	}
+	int64 ns;
+	while ((ns = read_clock()) - first_ns < CALIBRATION_NS) {
+		// wait for long enough to measure the tick rate accurately
+	}
+	return (read_ticks() - first_ticks) * 1.0 / (ns - first_ns);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/* * * * * * * * *
+ * Shared instrumentation for timing the operations of the various hash table
+ * types: each kind of operation keeps a count, a 64-bit total and a histogram
+ * of how long each operation took, from which percentiles are reported
+ *
+ * operations are timed with the CPU's timestamp counter where there is one
+ * (converted to nanoseconds against the system clock when printed), and with
+ * clock_gettime otherwise. compile with -DHT_STATS_SAMPLE=n to time only one
+ * operation in every n by default (set_latency_sampling changes this for the
+ * tables set up after it), or with -DHT_NO_STATS to leave timing out entirely
+ *
+ * a Latency set up while set_latency_shared is on is updated with atomic
+ * operations, so that several threads can record operations in it at once
+ * (such as lookups in a table they only hold a read lock on)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+
+// time one operation in every HT_STATS_SAMPLE (the others are only counted),
+// unless set_latency_sampling says otherwise
+#ifndef HT_STATS_SAMPLE
+#define HT_STATS_SAMPLE 1
+#endif
+
+// the histogram splits each power of two into 2^LATENCY_SUB_BITS buckets, so
+// a percentile is never reported more than 1/8 above the true value
+#define LATENCY_SUB_BITS 3
+#define LATENCY_BUCKETS (64 << LATENCY_SUB_BITS)
+
+// the current time in nanoseconds, from the system's monotonic clock
+int64 read_clock(void);
+
+#ifndef HT_NO_STATS
+
+// the timings of one kind of operation on a table
+typedef struct latency {
+	int64 ops;		// how many operations there have been
+	int64 timed;	// how many of them were timed
+	int64 total;	// how many ticks the timed operations took altogether
+	int64 max;		// the most ticks any one operation took
+	int64 sample;	// time one operation in every 'sample' (0 for none)
+	int64 countdown;	// how many operations until the next one timed (unless
+						// shared: see latency_start_shared)
+	bool shared;	// may several threads update it at once?
+	int64 histogram[LATENCY_BUCKETS];	// how many timed operations took
+										// each range of ticks
+} Latency;
+
+// the current time in ticks
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define read_ticks() ((int64)__builtin_ia32_rdtsc())
+#else
+#define read_ticks() read_clock()
+#endif
+
+// add an operation taking 'ticks' ticks, or a batch of 'n' operations taking
+// 'ticks' ticks in total, to 'lat'
+void latency_record(Latency *lat, int64 ticks, int n);
+
+// latency_start for a shared Latency
+int64 latency_start_shared(Latency *lat);
+
+// start timing an operation of the kind 'lat' keeps the timings of
+// returns the tick count to pass to latency_stop (0 if this operation is not
+// one of the sampled ones)
+static inline int64 latency_start(Latency *lat) {
+	if (lat->shared) {
+		return latency_start_shared(lat);
+	}
+	lat->ops++;
+	if (--lat->countdown != 0) {
+		return 0;
+	}
+	lat->countdown = lat->sample;
+	return read_ticks();
+}
+
+// finish timing the operation started with latency_start
+static inline void latency_stop(Latency *lat, int64 start) {
+	if (start) {
+		latency_record(lat, read_ticks() - start, 1);
+	}
+}
+
+// finish timing a batch of 'n' operations started with latency_start,
+// recording each as taking an equal share of the batch's time
+static inline void latency_stop_batch(Latency *lat, int64 start, int n) {
+	if (lat->shared) {
+		__atomic_fetch_add(&lat->ops, n - 1, __ATOMIC_RELAXED);
+	} else {
+		lat->ops += n - 1;
+	}
+	if (start && n > 0) {
+		latency_record(lat, read_ticks() - start, n);
+	}
+}
+
+// the time (in ns) within which the fraction 'fraction' of the operations
+// timed in 'lat' finished (never more than 1/8 above the true value)
+double latency_percentile(Latency *lat, double fraction);
+
+// the shortest and longest times (in ns) counted in histogram bucket
+// 'bucket' of a Latency
+void latency_bucket_range(int bucket, double *min_ns, double *max_ns);
+
+#else
+
+// with HT_NO_STATS, nothing is kept and nothing is timed
+typedef struct latency {
+	char unused;
+} Latency;
+#define latency_start(lat) ((void)(lat), (int64)0)
+#define latency_stop(lat, start) ((void)(start))
+#define latency_stop_batch(lat, start, n) ((void)(start))
+
+#endif
+
+// set up 'lat' with no operations recorded yet
+void initialise_latency(Latency *lat);
+
+// make every Latency set up from now on time one operation in every 'every'
+// (or none of them, if 'every' is 0), rather than one in every
+// HT_STATS_SAMPLE. returns the previous setting, to restore afterwards
+int set_latency_sampling(int every);
+
+// make every Latency set up from now on shared between threads (see above),
+// if 'shared' is true. returns the previous setting, to restore afterwards
+bool set_latency_shared(bool shared);
+
+// print the timings in 'lat' for the operations called 'name' to stdout
+void print_latency(char *name, Latency *lat);
+
+// convert 'ticks' ticks (as recorded in a Latency) to nanoseconds
+double ticks_to_ns(int64 ticks);
+
+#endif
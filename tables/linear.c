@@ -10,10 +10,29 @@
 #include <assert.h>
 
 #include "linear.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
 
 // how many cells to advance at a time while looking for a free slot
 #define STEP_SIZE 1
 
+// the version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
+// macros to access the key and value stored at slot i: entries are stored
+// inline, so a table with values interleaves each key with its value
+#define KEY(t, i) (t)->slots[(i) * (t)->width]
+#define VALUE(t, i) (t)->slots[(i) * (t)->width + 1]
+
+// macro to prefetch the slot (and in-use marker) at address h, ahead of a
+// batch probe
+#define prefetch_slot(t, h) do { \
+	prefetch(&KEY(t, h)); \
+	prefetch(&(t)->inuse[h]); \
+} while (0)
+
 // helper structure to store statistics gathered
 typedef struct stats {
 	int collisions; // calculate how many collisions that happen
@@ -21,6 +40,12 @@ typedef struct stats {
 					// checked before all keys are inserted to a free space
 	int is_recorded_collisions; // a flag whether the number of collisions have
 						   // recorded or not
+	int resizes_avoided; // how many doublings were done up front by
+						 // linear_hash_table_reserve instead of when full
+	Latency inserts; // how long inserts (and puts) have taken
+	Latency lookups; // how long lookups (and gets and updates) have taken
+	Histogram probes; // how many slots each insert stepped past before
+					  // finding a free one
 } Stats;
 
 // a hash table is an array of slots holding keys, along with a parallel array
@@ -28,13 +53,33 @@ typedef struct stats {
 // important because not-in-use slots might hold garbage data, as they may
 // not have been initialised
 struct linear_table {
-	int64 *slots;	// array of slots holding keys
+	int64 *slots;	// array of slots holding keys (each followed by its value,
+					// if this table stores values)
 	bool  *inuse;	// is this slot in use or not?
+	int width;		// how many int64 words each slot takes up (1 or 2)
 	int size;		// the size of both of these arrays right now
 	int load;		// number of keys in the table right now
+	double max_load;	// the most of its slots the table fills before growing
+	int growth;		// what the table's size is multiplied by when it grows
 	Stats stats;	// collection of statistics about this hash table
+	Snapshot *snapshot;	// the snapshot 'slots' and 'inuse' are being used
+						// in place from, or NULL if they were allocated
 };
 
+// the first section of a snapshot of a linear hash table, followed by a
+// section holding each of the 'slots' and 'inuse' arrays as they are in memory
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	int width;
+	int size;
+	int load;
+	double max_load;
+	int growth;
+	Stats stats;
+} SnapshotHeader;
+
 
 /* * * *
  * helper functions
@@ -45,7 +90,7 @@ struct linear_table {
 static void initialise_table(LinearHashTable *table, int size) {
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 
-	table->slots = malloc((sizeof *table->slots) * size);
+	table->slots = malloc((sizeof *table->slots) * size * table->width);
 	assert(table->slots);
 	table->inuse = malloc((sizeof *table->inuse) * size);
 	assert(table->inuse);
@@ -59,18 +104,21 @@ static void initialise_table(LinearHashTable *table, int size) {
 }
 
 
-// reinsert a ke into the hash table after doubling the table --- we can assume
-// that there will definitely be space for this key because it was already
-// inside the hash table previously
-static void reinsert_key(LinearHashTable *table, int64 key) {
-	int h = h1(key) % table->size, steps = 0;
+// reinsert a key (and its value) into the hash table after doubling the
+// table --- we can assume that there will definitely be space for this key
+// because it was already inside the hash table previously
+static void reinsert_key(LinearHashTable *table, int64 *entry) {
+	int h = h1(entry[0]) % table->size, steps = 0;
 	
 	while (table->inuse[h]) {
 		h = (h + STEP_SIZE) % table->size;
 		steps++;
 	}
 	
-	table->slots[h] = key;
+	int w;
+	for (w = 0; w < table->width; w++) {
+		table->slots[h * table->width + w] = entry[w];
+	}
 	table->inuse[h] = true;
 	table->load++;
 	table->stats.total_probe += steps+1;
@@ -78,66 +126,50 @@ static void reinsert_key(LinearHashTable *table, int64 key) {
 }
 
 
-// double the size of the internal table arrays and re-hash all
+// change the size of the internal table arrays to 'size' and re-hash all
 // keys in the old tables
-static void double_table(LinearHashTable *table) {
+static void resize_table(LinearHashTable *table, int size) {
+	int64 start = event_start();
 	int64 *oldslots = table->slots;
 	bool  *oldinuse = table->inuse;
 	int oldsize = table->size;
 	
-	initialise_table(table, table->size * 2);
+	initialise_table(table, size);
 
 	int i;
 	for (i = 0; i < oldsize; i++) {
 		if (oldinuse[i] == true) {
 			
-			reinsert_key(table, oldslots[i]);
+			reinsert_key(table, &oldslots[i * table->width]);
 			//linear_hash_table_insert(table, oldslots[i]);
 		}
 	}
 
-	free(oldslots);
-	free(oldinuse);
-}
-
-
-/* * * *
- * all functions
- */
+	// the old arrays were all the table was using its snapshot for
+	if (table->snapshot != NULL) {
+		unmap_snapshot(table->snapshot);
+		table->snapshot = NULL;
+	} else {
+		free(oldslots);
+		free(oldinuse);
+	}
 
-// initialise a linear probing hash table with initial size 'size'
-LinearHashTable *new_linear_hash_table(int size) {
-	LinearHashTable *table = malloc(sizeof *table);
-	assert(table);
-	
-	// set up the internals of the table struct with arrays of size 'size'
-	initialise_table(table, size);
-	
-	table->stats.collisions = 0;
-	table->stats.total_probe = 0;
-	table->stats.is_recorded_collisions = 0;
-	
-	return table;
+	record_event(EVENT_RESIZE, "linear", start, oldsize, size, table->load);
 }
 
 
-// free all memory associated with 'table'
-void free_linear_hash_table(LinearHashTable *table) {
-	assert(table != NULL);
-
-	// free the table's arrays
-	free(table->slots);
-	free(table->inuse);
-
-	// free the table struct itself
-	free(table);
+// grow the internal table arrays (doubling them, unless the table was set up
+// to grow by some other factor) and re-hash all keys in the old tables
+static void double_table(LinearHashTable *table) {
+	resize_table(table, table->size * table->growth);
 }
 
 
-// insert 'key' into 'table', if it's not in there already
+// insert 'key' into 'table' with 'value', if it's not in there already
+// if it is, and 'overwrite' is true, its value is replaced with 'value'
 // returns true if insertion succeeds, false if it was already in there
-bool linear_hash_table_insert(LinearHashTable *table, int64 key) {
-	assert(table != NULL);
+static bool insert_entry(LinearHashTable *table, int64 key, int64 value,
+	bool overwrite) {
 
 	// need to count our steps to make sure we recognise when the table is full
 	int steps = 0;
@@ -148,8 +180,11 @@ bool linear_hash_table_insert(LinearHashTable *table, int64 key) {
 	// step along the array until we find a free space (inuse[]==false),
 	// or until we visit every cell
 	while (table->inuse[h] && steps < table->size) {
-		if (table->slots[h] == key) {
+		if (KEY(table, h) == key) {
 			// this key already exists in the table! no need to insert
+			if (overwrite) {
+				VALUE(table, h) = value;
+			}
 			return false;
 		}
 		
@@ -166,8 +201,9 @@ bool linear_hash_table_insert(LinearHashTable *table, int64 key) {
 	}
 
 	// if we used up all of our steps, then we're back where we started and the
-	// table is full
-	if (steps == table->size) {
+	// table is full (or if it's only been allowed to get so full, it is now)
+	if (steps == table->size
+		|| table->load + 1 > table->max_load * table->size) {
 		
 		// When doubling the table, it indicates that the number of collisions
 		// has been recorded
@@ -176,41 +212,44 @@ bool linear_hash_table_insert(LinearHashTable *table, int64 key) {
 		// let's make some more space and then try to insert this key again!
 		double_table(table);
 		
-		return linear_hash_table_insert(table, key);
+		return insert_entry(table, key, value, overwrite);
 
 	} else {
 		// otherwise, we have found a free slot! insert this key right here
-		table->slots[h] = key;
+		KEY(table, h) = key;
+		if (table->width > 1) {
+			VALUE(table, h) = value;
+		}
 		table->inuse[h] = true;
 		table->load++;
 		
 		// Sum up the total probe and reset the is_recorded_collisions flag		
 		table->stats.total_probe += steps+1;
 		table->stats.is_recorded_collisions = 0;
+		histogram_add(&table->stats.probes, steps);
 		
 		return true;
 	}
 }
 
 
-// lookup whether 'key' is inside 'table'
-// returns true if found, false if not
-bool linear_hash_table_lookup(LinearHashTable *table, int64 key) {
-	assert(table != NULL);
+// find the slot holding 'key', whose hash value is 'hash', in 'table'
+// returns its address if found, or -1 if not
+static int find_slot(LinearHashTable *table, int64 key, int hash) {
 
 	// need to count our steps to make sure we recognise when the table is full
 	int steps = 0;
 
 	// calculate the initial address for this key
-	int h = h1(key) % table->size;
+	int h = hash % table->size;
 
 	// step along until we find a free space (inuse[]==false), or until we
 	// visit every cell
 	while (table->inuse[h] && steps < table->size) {
 
-		if (table->slots[h] == key) {
+		if (KEY(table, h) == key) {
 			// found the key!
-			return true;
+			return h;
 		}
 
 		// keep stepping
@@ -220,10 +259,370 @@ bool linear_hash_table_lookup(LinearHashTable *table, int64 key) {
 
 	// we have either searched the whole table or come back to where we started
 	// either way, the key is not in the hash table
+	return -1;
+}
+
+
+// record the length of every run of consecutive slots in use in 'table' in
+// *clusters (the run a key lands in is the furthest it might have to probe)
+static void cluster_lengths(LinearHashTable *table, Histogram *clusters) {
+	initialise_histogram(clusters);
+
+	// start just after a free slot, so that no run wraps around the end
+	int first = 0;
+	while (first < table->size && table->inuse[first]) {
+		first++;
+	}
+	if (first == table->size) {
+		histogram_add(clusters, table->size);
+		return;
+	}
+
+	int i, run = 0;
+	for (i = 1; i <= table->size; i++) {
+		if (table->inuse[(first + i) % table->size]) {
+			run++;
+		} else if (run > 0) {
+			histogram_add(clusters, run);
+			run = 0;
+		}
+	}
+}
+
+
+
+/* * * *
+ * all functions
+ */
+
+// initialise a linear probing hash table with initial size 'size', storing
+// a value alongside each key if 'values' is true
+LinearHashTable *new_linear_hash_table(int size, bool values) {
+	LinearHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->width = values ? 2 : 1;
+	table->max_load = 1;
+	table->growth = 2;
+	table->snapshot = NULL;
+	
+	// set up the internals of the table struct with arrays of size 'size'
+	initialise_table(table, size);
+	
+	table->stats.collisions = 0;
+	table->stats.total_probe = 0;
+	table->stats.is_recorded_collisions = 0;
+	table->stats.resizes_avoided = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	initialise_histogram(&table->stats.probes);
+	
+	return table;
+}
+
+
+// initialise a linear probing hash table holding the 'n' keys in 'keys',
+// sized up front to the size that inserting them one at a time into a table
+// of initial size 'size' would have grown to
+LinearHashTable *new_linear_hash_table_from_keys(int size, int64 *keys, int n) {
+	assert(size > 0);
+	
+	// the table only doubles once it is completely full
+	while (size < n) {
+		size *= 2;
+	}
+	LinearHashTable *table = new_linear_hash_table(size, false);
+
+	// every key now has a free slot waiting for it, so none of these
+	// insertions will ever need to double the table
+	int i;
+	for (i = 0; i < n; i++) {
+		insert_entry(table, keys[i], 0, false);
+	}
+
+	return table;
+}
+
+
+// free all memory associated with 'table'
+void free_linear_hash_table(LinearHashTable *table) {
+	assert(table != NULL);
+
+	// free the table's arrays (or the snapshot they're in)
+	if (table->snapshot != NULL) {
+		unmap_snapshot(table->snapshot);
+	} else {
+		free(table->slots);
+		free(table->inuse);
+	}
+
+	// free the table struct itself
+	free(table);
+}
+
+
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool linear_hash_table_save(LinearHashTable *table, FILE *file) {
+	assert(table != NULL);
+
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->width,
+		table->size, table->load, table->max_load, table->growth,
+		table->stats };
+	return write_section(file, &header, sizeof header)
+		&& write_section(file, table->slots,
+			(sizeof *table->slots) * table->size * table->width)
+		&& write_section(file, table->inuse,
+			(sizeof *table->inuse) * table->size);
+}
+
+
+// load a table written by linear_hash_table_save from the next sections of
+// 'snapshot', using its arrays in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+LinearHashTable *linear_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)
+		|| header->size <= 0 || header->size >= MAX_TABLE_SIZE
+		|| header->width < 1 || header->width > 2
+		|| header->load < 0 || header->load > header->size) {
+		return NULL;
+	}
+
+	LinearHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->width = header->width;
+	table->size = header->size;
+	table->load = header->load;
+	table->max_load = header->max_load;
+	table->growth = header->growth;
+	table->stats = header->stats;
+
+	// the arrays are used straight from the snapshot, until the table grows
+	table->slots = read_section(snapshot,
+		(sizeof *table->slots) * table->size * table->width);
+	table->inuse = read_section(snapshot, (sizeof *table->inuse) * table->size);
+	if (table->slots == NULL || table->inuse == NULL) {
+		free(table);
+		return NULL;
+	}
+	table->snapshot = snapshot;
+
+	return table;
+}
+
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool linear_hash_table_insert(LinearHashTable *table, int64 key) {
+	assert(table != NULL);
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// make room in 'table' for 'n' keys in total, so that inserting them will
+// never need to double the table
+void linear_hash_table_reserve(LinearHashTable *table, int n) {
+	assert(table != NULL);
+
+	// the table only doubles once it is completely full (or as full as it's
+	// allowed to get), so grow it (all in one go) to the size it would have
+	// doubled its way up to (but no further than the largest table size: the
+	// inserts themselves fail once they need more than that)
+	int size = table->size;
+	while (size * table->max_load < n
+		&& (int64)size * table->growth < MAX_TABLE_SIZE) {
+		size *= table->growth;
+		table->stats.resizes_avoided++;
+	}
+	if (size > table->size) {
+		resize_table(table, size);
+	}
+}
+
+
+// make 'table' grow once more than the fraction 'max_load' of its slots are
+// in use (rather than only once every slot is), multiplying its size by
+// 'growth' (rather than 2) each time
+void linear_hash_table_set_growth(LinearHashTable *table, double max_load,
+	int growth) {
+	assert(table != NULL);
+	assert(max_load > 0 && max_load <= 1 && growth >= 2);
+	table->max_load = max_load;
+	table->growth = growth;
+}
+
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order of the slots they are stored in
+void linear_hash_table_foreach(LinearHashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table != NULL);
+
+	int i;
+	for (i = 0; i < table->size; i++) {
+		if (table->inuse[i]) {
+			func(KEY(table, i), table->width > 1 ? VALUE(table, i) : 0, ctx);
+		}
+	}
+}
+
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool linear_hash_table_next(LinearHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table != NULL);
+
+	while (cursor->block < table->size) {
+		int i = cursor->block++;
+		if (table->inuse[i]) {
+			*key = KEY(table, i);
+			if (value != NULL) {
+				*value = table->width > 1 ? VALUE(table, i) : 0;
+			}
+			return true;
+		}
+	}
 	return false;
 }
 
 
+// lookup whether 'key' is inside 'table'
+// returns true if found, false if not
+bool linear_hash_table_lookup(LinearHashTable *table, int64 key) {
+	assert(table != NULL);
+	int64 start = latency_start(&table->stats.lookups);
+	bool found = find_slot(table, key, h1(key)) >= 0;
+	latency_stop(&table->stats.lookups, start);
+	return found;
+}
+
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool linear_hash_table_put(LinearHashTable *table, int64 key, int64 value) {
+	assert(table != NULL);
+	assert(table->width > 1 && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool linear_hash_table_get(LinearHashTable *table, int64 key, int64 *value) {
+	assert(table != NULL);
+	assert(table->width > 1 && "error: table does not store values!");
+
+	int64 start = latency_start(&table->stats.lookups);
+	int h = find_slot(table, key, h1(key));
+	latency_stop(&table->stats.lookups, start);
+	if (h < 0) {
+		return false;
+	}
+	*value = VALUE(table, h);
+	return true;
+}
+
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool linear_hash_table_update(LinearHashTable *table, int64 key, int64 value) {
+	assert(table != NULL);
+	assert(table->width > 1 && "error: table does not store values!");
+
+	int64 start = latency_start(&table->stats.lookups);
+	int h = find_slot(table, key, h1(key));
+	latency_stop(&table->stats.lookups, start);
+	if (h < 0) {
+		return false;
+	}
+	VALUE(table, h) = value;
+	return true;
+}
+
+
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void linear_hash_table_insert_batch(LinearHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table != NULL);
+	// start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
+
+	int hashes[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+
+		// hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+		}
+
+		// then insert each key, while prefetching the slot a few keys ahead
+		// (an insertion may double the table, so addresses are recalculated
+		// from the hash values each time)
+		for (i = 0; i < m; i++) {
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch_slot(table,
+					hashes[i + PREFETCH_DISTANCE] % table->size);
+			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
+		}
+	}
+
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void linear_hash_table_lookup_batch(LinearHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table != NULL);
+	// start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+
+	int hashes[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+
+		// hash the whole block first, prefetching the first few slots
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+			if (i < PREFETCH_DISTANCE) {
+				prefetch_slot(table, hashes[i] % table->size);
+			}
+		}
+
+		// then probe for each key, while prefetching the slot a few keys ahead
+		for (i = 0; i < m; i++) {
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch_slot(table,
+					hashes[i + PREFETCH_DISTANCE] % table->size);
+			}
+			results[start + i] = find_slot(table, keys[start + i], hashes[i])
+				>= 0;
+		}
+	}
+
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
+}
+
+
 // print the contents of 'table' to stdout
 void linear_hash_table_print(LinearHashTable *table) {
 	assert(table != NULL);
@@ -241,8 +640,10 @@ void linear_hash_table_print(LinearHashTable *table) {
 		printf(" %9d | ", i);
 
 		// print the contents of the slot
-		if (table->inuse[i]) {
-			printf("%llu\n", table->slots[i]);
+		if (table->inuse[i] && table->width > 1) {
+			printf("%llu: %llu\n", KEY(table, i), VALUE(table, i));
+		} else if (table->inuse[i]) {
+			printf("%llu\n", KEY(table, i));
 		} else {
 			printf("-\n");
 		}
@@ -266,6 +667,40 @@ void linear_hash_table_stats(LinearHashTable *table) {
 	
 	printf("   collisions: %d\n", table->stats.collisions);
 	printf("average probe: %.1lf\n", table->stats.total_probe/table->load*1.0);
+	if (table->stats.resizes_avoided > 0) {
+		printf("resizes avoided: %d\n", table->stats.resizes_avoided);
+	}
+	if (table->max_load < 1 || table->growth != 2) {
+		printf("  grows (x%d) past: %.1f%% load\n", table->growth,
+			table->max_load * 100);
+	}
+	
+	// print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	
+	// print how far inserts have had to probe, and how long the runs of
+	// used slots they probe along have grown
+	print_histogram("insert probes", &table->stats.probes);
+	Histogram clusters;
+	cluster_lengths(table, &clusters);
+	print_histogram("cluster lengths", &clusters);
+	
+	MemoryUsage usage;
+	linear_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->load);
 	
 	printf("--- end stats ---\n");
 }
+
+// count the bytes 'table' is using into *usage
+void linear_hash_table_memory_usage(LinearHashTable *table,
+	MemoryUsage *usage) {
+	assert(table != NULL);
+	size_t slot_bytes = sizeof *table->slots * table->width
+		+ sizeof *table->inuse;
+	usage->directory = sizeof *table;
+	usage->stats = sizeof table->stats;
+	usage->buckets = slot_bytes * table->size;
+	usage->slack = slot_bytes * (table->size - table->load);
+}
@@ -7,26 +7,95 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "scan.h"
+#include "snapshot.h"
+#include "memory.h"
 
 typedef struct linear_table LinearHashTable;
 
-// initialise a linear probing hash table with initial size 'size'
-LinearHashTable *new_linear_hash_table(int size);
+// initialise a linear probing hash table with initial size 'size', storing
+// a value alongside each key if 'values' is true
+LinearHashTable *new_linear_hash_table(int size, bool values);
+
+// initialise a linear probing hash table holding the 'n' keys in 'keys',
+// sized up front to the size that inserting them one at a time into a table
+// of initial size 'size' would have grown to
+LinearHashTable *new_linear_hash_table_from_keys(int size, int64 *keys, int n);
 
 // free all memory associated with 'table'
 void free_linear_hash_table(LinearHashTable *table);
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool linear_hash_table_save(LinearHashTable *table, FILE *file);
+
+// load a table written by linear_hash_table_save from the next sections of
+// 'snapshot', using its arrays in place. the table takes over 'snapshot',
+// unmapping it once it's no longer needed. returns NULL (leaving 'snapshot'
+// alone) if it was written with a different snapshot layout, or is cut short
+// or corrupted
+LinearHashTable *linear_hash_table_load(Snapshot *snapshot);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool linear_hash_table_insert(LinearHashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, so that inserting them will
+// never need to double the table
+void linear_hash_table_reserve(LinearHashTable *table, int n);
+
+// make 'table' grow once more than the fraction 'max_load' of its slots are
+// in use (rather than only once every slot is), multiplying its size by
+// 'growth' (rather than 2) each time
+void linear_hash_table_set_growth(LinearHashTable *table, double max_load,
+	int growth);
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order of the slots they are stored in
+void linear_hash_table_foreach(LinearHashTable *table, ScanFunc func,
+	void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool linear_hash_table_next(LinearHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool linear_hash_table_lookup(LinearHashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void linear_hash_table_insert_batch(LinearHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void linear_hash_table_lookup_batch(LinearHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool linear_hash_table_put(LinearHashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool linear_hash_table_get(LinearHashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool linear_hash_table_update(LinearHashTable *table, int64 key, int64 value);
+
 // print the contents of 'table' to stdout
 void linear_hash_table_print(LinearHashTable *table);
 
 // print some statistics about 'table' to stdout
 void linear_hash_table_stats(LinearHashTable *table);
 
+// count the bytes 'table' is using into *usage
+void linear_hash_table_memory_usage(LinearHashTable *table,
+	MemoryUsage *usage);
+
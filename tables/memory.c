@@ -0,0 +1,28 @@
+/* * * * * * * * *
+ * Shared type for reporting how much memory a hash table is using
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdio.h>
+
+#include "memory.h"
+
+// add the bytes counted in 'from' to those counted in 'to'
+void add_memory_usage(MemoryUsage *to, MemoryUsage *from) {
+	to->directory += from->directory;
+	to->buckets += from->buckets;
+	to->slack += from->slack;
+	to->stats += from->stats;
+}
+
+// print the memory usage of a table holding 'nkeys' keys to stdout
+void print_memory_usage(MemoryUsage *usage, int nkeys) {
+	size_t total = memory_total(usage);
+	printf("              memory usage: %zu bytes (%.1f bytes per key)\n",
+		total, nkeys > 0 ? total * 1.0 / nkeys : 0);
+	printf("   directory / bucket bytes: %zu / %zu (%zu bytes slack)\n",
+		usage->directory, usage->buckets, usage->slack);
+	printf(" stats bytes (in directory): %zu\n", usage->stats);
+}
@@ -0,0 +1,43 @@
+/* * * * * * * * *
+ * Shared type for reporting how much memory a hash table is using
+ *
+ * every table type counts the bytes it has asked for from its structure
+ * (not the allocator's own overhead), split into the part that finds keys
+ * (directories of bucket pointers, and the table structs themselves) and the
+ * part that holds them (slot arrays, buckets, key arrays and string arenas).
+ * the statistics a table keeps about itself (mostly latency histograms) live
+ * inside its table structs, so they are part of the directory (and the
+ * total), but how many bytes they take is reported too. the memory of a table
+ * loaded from a snapshot is counted the same way as the memory of a table
+ * built up key by key
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+
+// the memory used by a hash table, in bytes
+typedef struct memory_usage {
+	size_t directory;	// the table structs and directories of pointers
+	size_t buckets;		// the slots, buckets and key storage
+	size_t slack;		// how much of 'buckets' holds no key right now
+						// (empty slots, unfilled buckets, unused slab space)
+	size_t stats;		// how much of 'directory' is the statistics kept
+						// inside the table structs
+} MemoryUsage;
+
+// the total number of bytes counted in the MemoryUsage 'usage' points to
+#define memory_total(usage) ((usage)->directory + (usage)->buckets)
+
+// add the bytes counted in 'from' to those counted in 'to'
+void add_memory_usage(MemoryUsage *to, MemoryUsage *from);
+
+// print the memory usage of a table holding 'nkeys' keys to stdout, as the
+// last lines of its stats
+void print_memory_usage(MemoryUsage *usage, int nkeys);
+
+#endif
@@ -0,0 +1,199 @@
+/* * * * * * * * *
+ * Pager for disk-resident hash tables: a data file of fixed-size pages, read
+ * and written through a bounded buffer pool
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pager.h"
+
+// the memory of frame 'f' of 'pager'
+#define frame_memory(pager, f) ((pager)->memory + (size_t)(f) * PAGE_SIZE)
+
+// find a frame for a new page, evicting (and writing back) the page in it
+static int claim_frame(Pager *pager, int page_no);
+
+// write the page in frame 'f' back to the data file, if it has changed
+static void write_frame(Pager *pager, int f);
+
+// open the data file at 'path' (creating it if it doesn't exist), caching up
+// to 'nframes' of its pages in memory (at least 2)
+// returns NULL if the file can't be opened
+Pager *open_pager(const char *path, int nframes) {
+	assert(nframes >= 2 && "error: buffer pool needs at least 2 pages!");
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size % PAGE_SIZE != 0) {
+		close(fd);
+		return NULL;
+	}
+
+	Pager *pager = malloc(sizeof *pager);
+	assert(pager);
+	pager->fd = fd;
+	pager->npages = info.st_size / PAGE_SIZE;
+
+	// every frame starts empty
+	pager->nframes = nframes;
+	pager->frames = malloc(sizeof *pager->frames * nframes);
+	pager->memory = malloc((size_t)nframes * PAGE_SIZE);
+	assert(pager->frames && pager->memory);
+	int f;
+	for (f = 0; f < nframes; f++) {
+		pager->frames[f].page_no = -1;
+		pager->frames[f].pins = 0;
+		pager->frames[f].dirty = false;
+		pager->frames[f].used = false;
+	}
+	pager->hand = 0;
+
+	// and so does every page
+	pager->capacity = pager->npages > 1 ? pager->npages : 1;
+	pager->frame_of = malloc(sizeof *pager->frame_of * pager->capacity);
+	assert(pager->frame_of);
+	int p;
+	for (p = 0; p < pager->capacity; p++) {
+		pager->frame_of[p] = -1;
+	}
+
+	pager->stats.hits = 0;
+	pager->stats.reads = 0;
+	pager->stats.writes = 0;
+	return pager;
+}
+
+// write every dirty page back to the data file, close it, and free 'pager'
+void close_pager(Pager *pager) {
+	assert(pager);
+	flush_pages(pager);
+	close(pager->fd);
+	free(pager->frames);
+	free(pager->memory);
+	free(pager->frame_of);
+	free(pager);
+}
+
+// get page 'page_no' of the file, reading it into the buffer pool if it isn't
+// there already
+void *get_page(Pager *pager, int page_no) {
+	assert(pager);
+	assert(page_no >= 0 && page_no < pager->npages && "error: no such page!");
+
+	int f = pager->frame_of[page_no];
+	if (f >= 0) {
+		pager->stats.hits++;
+	} else {
+		f = claim_frame(pager, page_no);
+		ssize_t nread = pread(pager->fd, frame_memory(pager, f), PAGE_SIZE,
+			(off_t)page_no * PAGE_SIZE);
+		assert(nread == PAGE_SIZE && "error: can't read page!");
+		pager->stats.reads++;
+	}
+
+	pager->frames[f].pins++;
+	pager->frames[f].used = true;
+	return frame_memory(pager, f);
+}
+
+// add a new page (filled with zeros) to the end of the file, storing its
+// number in *page_no
+void *new_page(Pager *pager, int *page_no) {
+	assert(pager);
+
+	// make room to record where the new page is cached
+	if (pager->npages == pager->capacity) {
+		pager->capacity *= 2;
+		pager->frame_of = realloc(pager->frame_of,
+			sizeof *pager->frame_of * pager->capacity);
+		assert(pager->frame_of);
+		int p;
+		for (p = pager->npages; p < pager->capacity; p++) {
+			pager->frame_of[p] = -1;
+		}
+	}
+	*page_no = pager->npages++;
+
+	// the page only reaches the file once it is written back, so it starts
+	// out dirty
+	int f = claim_frame(pager, *page_no);
+	memset(frame_memory(pager, f), 0, PAGE_SIZE);
+	pager->frames[f].pins++;
+	pager->frames[f].used = true;
+	pager->frames[f].dirty = true;
+	return frame_memory(pager, f);
+}
+
+// release page 'page_no', got from get_page or new_page, marking it as
+// changed if 'dirty' is true
+void release_page(Pager *pager, int page_no, bool dirty) {
+	assert(pager);
+	int f = pager->frame_of[page_no];
+	assert(f >= 0 && pager->frames[f].pins > 0 && "error: page not in use!");
+	pager->frames[f].pins--;
+	pager->frames[f].dirty |= dirty;
+}
+
+// write every dirty page in the buffer pool back to the data file
+void flush_pages(Pager *pager) {
+	assert(pager);
+	int f;
+	for (f = 0; f < pager->nframes; f++) {
+		write_frame(pager, f);
+	}
+}
+
+// find a frame for a new page, evicting (and writing back) the page in it
+static int claim_frame(Pager *pager, int page_no) {
+
+	// sweep the clock hand around, giving each recently used page a second
+	// chance, until it reaches a page that nothing is using
+	int swept = 0;
+	while (true) {
+		Frame *frame = &pager->frames[pager->hand];
+		if (frame->pins == 0 && !frame->used) {
+			break;
+		}
+		frame->used = false;
+		pager->hand = (pager->hand + 1) % pager->nframes;
+		swept++;
+		assert(swept <= 2 * pager->nframes && "error: every page is in use!");
+	}
+
+	int f = pager->hand;
+	pager->hand = (pager->hand + 1) % pager->nframes;
+	Frame *frame = &pager->frames[f];
+	if (frame->page_no >= 0) {
+		write_frame(pager, f);
+		pager->frame_of[frame->page_no] = -1;
+	}
+	frame->page_no = page_no;
+	frame->dirty = false;
+	pager->frame_of[page_no] = f;
+	return f;
+}
+
+// write the page in frame 'f' back to the data file, if it has changed
+static void write_frame(Pager *pager, int f) {
+	Frame *frame = &pager->frames[f];
+	if (frame->page_no < 0 || !frame->dirty) {
+		return;
+	}
+	ssize_t nwritten = pwrite(pager->fd, frame_memory(pager, f), PAGE_SIZE,
+		(off_t)frame->page_no * PAGE_SIZE);
+	assert(nwritten == PAGE_SIZE && "error: can't write page!");
+	frame->dirty = false;
+	pager->stats.writes++;
+}
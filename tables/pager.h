@@ -0,0 +1,70 @@
+/* * * * * * * * *
+ * Pager for disk-resident hash tables: a data file of fixed-size pages, read
+ * and written through a bounded buffer pool that keeps the most recently used
+ * pages in memory (evicting with the clock algorithm, and writing pages back
+ * to the file only when they are evicted or flushed)
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include <stdbool.h>
+
+// how many bytes each page takes up, in the file and in memory
+#define PAGE_SIZE 4096
+
+// statistics about the pages read and written by a pager
+typedef struct pager_stats {
+	long hits;		// how many page requests were found in the buffer pool
+	long reads;		// how many pages were read from the file (misses)
+	long writes;	// how many dirty pages were written back to the file
+} PagerStats;
+
+// a buffer pool frame: a page's worth of memory, and the page it's holding
+typedef struct frame {
+	int page_no;	// the page in this frame (or -1 if it's empty)
+	int pins;		// how many callers are using the page right now
+	bool dirty;		// has the page changed since it was read from the file?
+	bool used;		// has the page been used since the clock hand passed it?
+} Frame;
+
+// a pager reads and writes the pages of one data file through a buffer pool
+typedef struct pager {
+	int fd;				// the data file
+	int npages;			// how many pages the file holds
+	Frame *frames;		// the buffer pool's frames
+	char *memory;		// the memory for every frame, one page after another
+	int nframes;		// how many frames the buffer pool has
+	int hand;			// the frame the clock hand is pointing at
+	int *frame_of;		// the frame holding each page (or -1 if not cached)
+	int capacity;		// how many pages there's space for in 'frame_of'
+	PagerStats stats;	// collection of statistics about this pager
+} Pager;
+
+// open the data file at 'path' (creating it if it doesn't exist), caching up
+// to 'nframes' of its pages in memory (at least 2)
+// returns NULL if the file can't be opened
+Pager *open_pager(const char *path, int nframes);
+
+// write every dirty page back to the data file, close it, and free 'pager'
+void close_pager(Pager *pager);
+
+// get page 'page_no' of the file, reading it into the buffer pool if it isn't
+// there already. the page stays where it is in memory until it is released
+void *get_page(Pager *pager, int page_no);
+
+// add a new page (filled with zeros) to the end of the file, storing its
+// number in *page_no. the page must be released like one from get_page
+void *new_page(Pager *pager, int *page_no);
+
+// release page 'page_no', got from get_page or new_page, marking it as
+// changed if 'dirty' is true. it may be evicted once nothing is using it
+void release_page(Pager *pager, int page_no, bool dirty);
+
+// write every dirty page in the buffer pool back to the data file
+void flush_pages(Pager *pager);
+
+#endif
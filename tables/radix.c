@@ -0,0 +1,180 @@
+/* * * * * * * * *
+ * Radix partitioning of keys by the rightmost bits of their hash values, for
+ * building the directory and buckets of an extendible hash table bottom-up
+ * from a whole array of keys at once
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "radix.h"
+
+// how many partitions to allocate space for at first
+#define INITIAL_NPARTS 16
+
+// hash values have 31 bits, so no two different hashes share more than that
+#define HASH_BITS 31
+
+/*********************************** STRUCT **********************************/
+// the growing list of partitions found so far, along with what is being
+// partitioned
+typedef struct partitioner {
+	int64 *keys;		// the keys being partitioned
+	int *hashes;		// their hash values
+	int bucketsize;		// maximum number of keys per partition
+	Partition *parts;	// the partitions found so far
+	int nparts;			// how many partitions have been found
+	int capacity;		// how many partitions there is space for
+} Partitioner;
+
+/****************************** HELPER FUNCTIONS *****************************/
+// Helper function to partition the keys from 'start' up to (not including)
+// 'end', which all share their rightmost 'depth' hash bits 'prefix'
+static void partition_range(Partitioner *p, int start, int end, int prefix,
+	int depth);
+
+// Helper function to record the keys from 'start' up to 'end' as a partition
+static void add_partition(Partitioner *p, int start, int end, int prefix,
+	int depth);
+
+// Helper function to compare two keys, for sorting with qsort
+static int compare_keys(const void *a, const void *b);
+
+/**************************** FUNCTION DEFINITIONS ***************************/
+// partition the 'n' keys in 'keys', whose hash values are 'hashes', into
+// groups of at most 'bucketsize' distinct keys sharing their rightmost hash
+// bits, splitting groups on one more bit at a time as extendible hashing
+// would. both arrays are reordered in place (and duplicate keys dropped)
+// returns the groups in an array to be freed by the caller, storing how many
+// there are in *nparts and the deepest group's depth in *depth
+Partition *radix_partition(int64 *keys, int *hashes, int n, int bucketsize,
+	int *nparts, int *depth) {
+	assert(keys && hashes && bucketsize > 0);
+	
+	Partitioner p;
+	p.keys = keys;
+	p.hashes = hashes;
+	p.bucketsize = bucketsize;
+	p.parts = malloc(sizeof *p.parts * INITIAL_NPARTS);
+	assert(p.parts);
+	p.nparts = 0;
+	p.capacity = INITIAL_NPARTS;
+	
+	// Start from a single group holding every key, sharing no bits at all
+	partition_range(&p, 0, n, 0, 0);
+	
+	// The table needs as many bits as the deepest group uses
+	int i;
+	*depth = 0;
+	for (i = 0; i < p.nparts; i++) {
+		if (p.parts[i].depth > *depth) {
+			*depth = p.parts[i].depth;
+		}
+	}
+	
+	*nparts = p.nparts;
+	return p.parts;
+}
+
+/****************************** PARTITION RANGE ******************************/
+// Helper function to partition the keys from 'start' up to (not including)
+// 'end', which all share their rightmost 'depth' hash bits 'prefix'
+static void partition_range(Partitioner *p, int start, int end, int prefix,
+	int depth) {
+	
+	// Few enough keys for a single bucket? Then this group is done
+	if (end - start <= p->bucketsize) {
+		add_partition(p, start, end, prefix, depth);
+		return;
+	}
+	
+	// If every key here has the same hash value, splitting on more bits can
+	// never separate them: they had better be duplicates of fewer keys
+	int i;
+	for (i = start + 1; i < end && p->hashes[i] == p->hashes[start]; i++);
+	if (i == end || depth == HASH_BITS) {
+		add_partition(p, start, end, prefix, depth);
+		assert(p->parts[p->nparts - 1].nkeys <= p->bucketsize
+			&& "error: table has grown too large!");
+		return;
+	}
+	
+	// Otherwise, move the keys whose next hash bit is 0 to the front and the
+	// keys whose next bit is 1 to the back (swapping keys and hashes together)
+	int bit = 1 << depth, lo = start, hi = end - 1;
+	while (lo <= hi) {
+		if ((p->hashes[lo] & bit) == 0) {
+			lo++;
+		} else {
+			int hash = p->hashes[lo];
+			int64 key = p->keys[lo];
+			p->hashes[lo] = p->hashes[hi];
+			p->keys[lo] = p->keys[hi];
+			p->hashes[hi] = hash;
+			p->keys[hi] = key;
+			hi--;
+		}
+	}
+	
+	// And split the group in two, sharing one more bit each
+	int nparts = p->nparts;
+	partition_range(p, start, lo, prefix, depth + 1);
+	partition_range(p, lo, end, prefix | bit, depth + 1);
+	
+	// Duplicate keys may have made this group look bigger than it was: if
+	// both halves stayed whole and their distinct keys fit in one bucket
+	// together, join them back up, as extendible hashing would never have
+	// split them in the first place
+	if (p->nparts == nparts + 2) {
+		Partition *zero = &p->parts[nparts], *one = &p->parts[nparts + 1];
+		if (zero->nkeys + one->nkeys <= p->bucketsize) {
+			for (i = 0; i < one->nkeys; i++) {
+				p->keys[zero->start + zero->nkeys + i]
+					= p->keys[one->start + i];
+			}
+			zero->nkeys += one->nkeys;
+			zero->depth = depth;
+			p->nparts--;
+		}
+	}
+}
+
+/******************************* ADD PARTITION *******************************/
+// Helper function to record the keys from 'start' up to 'end' as a partition
+static void add_partition(Partitioner *p, int start, int end, int prefix,
+	int depth) {
+	
+	// Make room for another partition if necessary
+	if (p->nparts == p->capacity) {
+		p->capacity *= 2;
+		p->parts = realloc(p->parts, sizeof *p->parts * p->capacity);
+		assert(p->parts);
+	}
+	
+	// Drop any duplicate keys by sorting them next to each other
+	int nkeys = 0, i;
+	qsort(&p->keys[start], end - start, sizeof *p->keys, compare_keys);
+	for (i = start; i < end; i++) {
+		if (nkeys == 0 || p->keys[i] != p->keys[start + nkeys - 1]) {
+			p->keys[start + nkeys] = p->keys[i];
+			nkeys++;
+		}
+	}
+	
+	Partition *part = &p->parts[p->nparts++];
+	part->prefix = prefix;
+	part->depth = depth;
+	part->start = start;
+	part->nkeys = nkeys;
+}
+
+/******************************** COMPARE KEYS *******************************/
+// Helper function to compare two keys, for sorting with qsort
+static int compare_keys(const void *a, const void *b) {
+	int64 x = *(const int64 *)a, y = *(const int64 *)b;
+	return (x > y) - (x < y);
+}
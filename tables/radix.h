@@ -0,0 +1,35 @@
+/* * * * * * * * *
+ * Radix partitioning of keys by the rightmost bits of their hash values, for
+ * building the directory and buckets of an extendible hash table bottom-up
+ * from a whole array of keys at once
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef RADIX_H
+#define RADIX_H
+
+#include "../inthash.h"
+
+// a group of keys that share their rightmost 'depth' hash value bits, and fit
+// in a single bucket. this is exactly the bucket that inserting the keys one
+// at a time would have put them in
+typedef struct partition {
+	int prefix;		// the last 'depth' bits shared by these keys' hashes
+					// (also the first table address pointing to the bucket)
+	int depth;		// how many hash value bits this group shares
+	int start;		// index of the first key of this group in the key array
+	int nkeys;		// how many distinct keys are in this group
+} Partition;
+
+// partition the 'n' keys in 'keys', whose hash values are 'hashes', into
+// groups of at most 'bucketsize' distinct keys sharing their rightmost hash
+// bits, splitting groups on one more bit at a time as extendible hashing
+// would. both arrays are reordered in place (and duplicate keys dropped)
+// returns the groups in an array to be freed by the caller, storing how many
+// there are in *nparts and the deepest group's depth in *depth
+Partition *radix_partition(int64 *keys, int *hashes, int n, int bucketsize,
+	int *nparts, int *depth);
+
+#endif
@@ -0,0 +1,34 @@
+/* * * * * * * * *
+ * Shared types for scanning through every key in a hash table, either by
+ * having a function called for each key (foreach) or by pulling keys out one
+ * at a time with a cursor
+ *
+ * every table type visits its keys in the order they are laid out in memory
+ * (array order for the open addressing tables, bucket allocation order for
+ * the extendible tables), so a full scan reads memory front to back
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "../inthash.h"
+
+// a function to call on each key during a scan, along with the key's value
+// (or 0, if the table doesn't store values) and a caller-supplied context
+typedef void (*ScanFunc)(int64 key, int64 value, void *ctx);
+
+// where a cursor has got up to in its scan of a table
+typedef struct cursor {
+	int shard;	// which shard of a sharded table it is up to
+	int part;	// which of the table's inner tables it is up to
+	int block;	// which slot (or bucket) of that inner table it is up to
+	int entry;	// which key of that bucket it is up to
+} Cursor;
+
+// the value to initialise a cursor with, to start at the beginning
+#define CURSOR_START { 0, 0, 0, 0 }
+
+#endif
@@ -0,0 +1,212 @@
+/* * * * * * * * *
+ * Slab allocator for the buckets of the extendible hash tables: buckets are
+ * carved out of large chunks of memory in the order they are created, and
+ * are only ever freed all together along with their table
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "slab.h"
+
+// where a slab starts in memory, for looking up which slab an item is in
+typedef struct slab_start {
+	char *start;
+	int slab;
+} SlabStart;
+
+// compare slab starts by address, for qsort
+static int cmp_slab_start(const void *a, const void *b);
+
+// roughly how many bytes to allocate for each slab
+#define SLAB_BYTES 16384
+
+// how many slab pointers to allocate space for at first
+#define INITIAL_NSLABS 4
+
+// set up an empty slab allocator for items of 'itemsize' bytes
+void initialise_slabs(Slabs *slabs, int itemsize) {
+	assert(itemsize > 0);
+	slabs->slabs = malloc(sizeof *slabs->slabs * INITIAL_NSLABS);
+	assert(slabs->slabs);
+	slabs->nslabs = 0;
+	slabs->capacity = INITIAL_NSLABS;
+	slabs->itemsize = itemsize;
+	slabs->per_slab = itemsize < SLAB_BYTES ? SLAB_BYTES / itemsize : 1;
+	slabs->nitems = 0;
+	slabs->nmapped = 0;
+}
+
+// free every slab (and so every item) in 'slabs'
+void free_slabs(Slabs *slabs) {
+	assert(slabs);
+	int i;
+	for (i = slabs->nmapped; i < slabs->nslabs; i++) {
+		free(slabs->slabs[i]);
+	}
+	free(slabs->slabs);
+}
+
+// write every slab in 'slabs' to 'file' as one snapshot section (padding
+// the last slab with zeros), so that it can be loaded with load_slabs
+bool save_slabs(Slabs *slabs, FILE *file) {
+	assert(slabs);
+	size_t slab_bytes = (size_t)slabs->per_slab * slabs->itemsize;
+	
+	// the items are all a multiple of 8 bytes, so writing the slabs one 
+	// after another adds no padding between them
+	assert(slab_bytes % 8 == 0);
+	int i;
+	bool written = true;
+	for (i = 0; i < slabs->nslabs && written; i++) {
+		int nused = slabs->nitems - i * slabs->per_slab;
+		if (nused >= slabs->per_slab) {
+			written = write_section(file, slabs->slabs[i], slab_bytes);
+		} else {
+			// the unused end of the last slab is uninitialised
+			size_t used_bytes = (size_t)nused * slabs->itemsize;
+			written = write_section(file, slabs->slabs[i], used_bytes)
+				&& write_zeros(file, slab_bytes - used_bytes);
+		}
+	}
+	return written;
+}
+
+// set up 'slabs' to hand out items of 'itemsize' bytes, with the 'nitems'
+// items written by save_slabs in the next section of 'snapshot' used in place
+// as the items handed out so far
+// returns false (leaving nothing to free) if the snapshot is cut short
+bool load_slabs(Slabs *slabs, int itemsize, int nitems, Snapshot *snapshot) {
+	if (itemsize <= 0 || nitems < 0) {
+		return false;
+	}
+	initialise_slabs(slabs, itemsize);
+	int nslabs = (nitems + (size_t)slabs->per_slab - 1) / slabs->per_slab;
+	size_t slab_bytes = (size_t)slabs->per_slab * itemsize;
+	char *items = read_section(snapshot, nslabs * slab_bytes);
+	if (items == NULL) {
+		free(slabs->slabs);
+		return false;
+	}
+	
+	// point each slab at its part of the section. the last slab was saved
+	// in full, so new items can still be handed out from the end of it
+	slabs->capacity = nslabs > INITIAL_NSLABS ? nslabs : INITIAL_NSLABS;
+	slabs->slabs = realloc(slabs->slabs,
+		sizeof *slabs->slabs * slabs->capacity);
+	assert(slabs->slabs);
+	int i;
+	for (i = 0; i < nslabs; i++) {
+		slabs->slabs[i] = items + i * slab_bytes;
+	}
+	slabs->nslabs = nslabs;
+	slabs->nmapped = nslabs;
+	slabs->nitems = nitems;
+	return true;
+}
+
+// write 'directory', an array of 'n' pointers to items handed out by 'slabs',
+// to 'file' as a snapshot section holding the number of each item instead
+bool save_directory(Slabs *slabs, void **directory, int n, FILE *file) {
+	assert(slabs);
+
+	// sort the slabs by address, so each item's slab can be binary searched
+	SlabStart *starts = malloc(sizeof *starts * (slabs->nslabs + 1));
+	int *numbers = malloc(sizeof *numbers * (n > 0 ? n : 1));
+	assert(starts && numbers);
+	int i;
+	for (i = 0; i < slabs->nslabs; i++) {
+		starts[i].start = slabs->slabs[i];
+		starts[i].slab = i;
+	}
+	qsort(starts, slabs->nslabs, sizeof *starts, cmp_slab_start);
+
+	for (i = 0; i < n; i++) {
+		char *item = directory[i];
+
+		// find the last slab starting at or before the item
+		int lo = 0, hi = slabs->nslabs - 1;
+		while (lo < hi) {
+			int mid = (lo + hi + 1) / 2;
+			if (starts[mid].start <= item) {
+				lo = mid;
+			} else {
+				hi = mid - 1;
+			}
+		}
+		assert(starts[lo].start <= item && "error: item isn't in slabs!");
+		numbers[i] = starts[lo].slab * slabs->per_slab
+			+ (int)((item - starts[lo].start) / slabs->itemsize);
+	}
+
+	bool written = write_section(file, numbers, sizeof *numbers * n);
+	free(numbers);
+	free(starts);
+	return written;
+}
+
+// fill 'directory' with pointers to the 'n' items of 'slabs' numbered in the
+// next section of 'snapshot' (as written by save_directory)
+// returns false if the snapshot is cut short or numbers an item 'slabs'
+// doesn't have
+bool load_directory(Slabs *slabs, void **directory, int n,
+	Snapshot *snapshot) {
+	assert(slabs);
+	int *numbers = read_section(snapshot, sizeof *numbers * n);
+	if (numbers == NULL) {
+		return false;
+	}
+	int i;
+	for (i = 0; i < n; i++) {
+		if (numbers[i] < 0 || numbers[i] >= slabs->nitems) {
+			return false;
+		}
+		directory[i] = slab_item(slabs, numbers[i]);
+	}
+	return true;
+}
+
+// compare slab starts by address, for qsort
+static int cmp_slab_start(const void *a, const void *b) {
+	const SlabStart *x = a, *y = b;
+	return (x->start > y->start) - (x->start < y->start);
+}
+
+// how many bytes 'slabs' is using: its slabs and its list of them
+size_t slabs_bytes(Slabs *slabs) {
+	return (size_t)slabs->nslabs * slabs->per_slab * slabs->itemsize
+		+ sizeof *slabs->slabs * slabs->capacity;
+}
+
+// how many bytes of the slabs in 'slabs' are in items not handed out yet
+size_t slabs_unused_bytes(Slabs *slabs) {
+	return (size_t)(slabs->nslabs * slabs->per_slab - slabs->nitems)
+		* slabs->itemsize;
+}
+
+// hand out a new item from 'slabs'. it stays where it is until the slabs
+// are freed
+void *slab_alloc(Slabs *slabs) {
+	assert(slabs);
+
+	// start a new slab once the last one is full
+	if (slabs->nitems == slabs->nslabs * slabs->per_slab) {
+		if (slabs->nslabs == slabs->capacity) {
+			slabs->capacity *= 2;
+			slabs->slabs = realloc(slabs->slabs,
+				sizeof *slabs->slabs * slabs->capacity);
+			assert(slabs->slabs);
+		}
+		slabs->slabs[slabs->nslabs] =
+			malloc((size_t)slabs->per_slab * slabs->itemsize);
+		assert(slabs->slabs[slabs->nslabs]);
+		slabs->nslabs++;
+	}
+
+	void *item = slab_item(slabs, slabs->nitems);
+	slabs->nitems++;
+	return item;
+}
@@ -0,0 +1,77 @@
+/* * * * * * * * *
+ * Slab allocator for the buckets of the extendible hash tables: buckets are
+ * carved out of large chunks of memory in the order they are created, and
+ * are only ever freed all together along with their table
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "snapshot.h"
+
+// a slab allocator hands out fixed-size items from a list of slabs, each
+// holding the same number of items one after another
+typedef struct slabs {
+	char **slabs;		// the slabs allocated so far
+	int nslabs;			// how many slabs have been allocated
+	int capacity;		// how many slab pointers there is space for
+	int itemsize;		// how many bytes each item takes up
+	int per_slab;		// how many items fit in each slab
+	int nitems;			// how many items have been handed out in total
+	int nmapped;		// how many of the first slabs are sections of a
+						// snapshot, rather than allocated (and freed) here
+} Slabs;
+
+// set up an empty slab allocator for items of 'itemsize' bytes
+void initialise_slabs(Slabs *slabs, int itemsize);
+
+// free every slab (and so every item) in 'slabs'
+void free_slabs(Slabs *slabs);
+
+// write every slab in 'slabs' to 'file' as one snapshot section (padding
+// the last slab with zeros), so that it can be loaded with load_slabs
+// returns false if the section couldn't be written
+bool save_slabs(Slabs *slabs, FILE *file);
+
+// set up 'slabs' to hand out items of 'itemsize' bytes, with the 'nitems'
+// items written by save_slabs in the next section of 'snapshot' used in place
+// as the items handed out so far
+// returns false (leaving nothing to free) if the snapshot is cut short
+bool load_slabs(Slabs *slabs, int itemsize, int nitems, Snapshot *snapshot);
+
+// write 'directory', an array of 'n' pointers to items handed out by 'slabs',
+// to 'file' as a snapshot section holding the number of each item instead
+// returns false if the section couldn't be written
+bool save_directory(Slabs *slabs, void **directory, int n, FILE *file);
+
+// fill 'directory' with pointers to the 'n' items of 'slabs' numbered in the
+// next section of 'snapshot' (as written by save_directory)
+// returns false if the snapshot is cut short or numbers an item 'slabs'
+// doesn't have
+bool load_directory(Slabs *slabs, void **directory, int n,
+	Snapshot *snapshot);
+
+// how many bytes 'slabs' is using: its slabs (allocated or mapped) and its
+// list of them
+size_t slabs_bytes(Slabs *slabs);
+
+// how many bytes of the slabs in 'slabs' are in items not handed out yet
+size_t slabs_unused_bytes(Slabs *slabs);
+
+// hand out a new item from 'slabs'. it stays where it is until the slabs
+// are freed
+void *slab_alloc(Slabs *slabs);
+
+// the i-th item handed out by 'slabs' (items are numbered in the order they
+// were handed out, which is also the order they are laid out in memory)
+#define slab_item(s, i) \
+	((void *)((s)->slabs[(i) / (s)->per_slab] + \
+		(size_t)((i) % (s)->per_slab) * (s)->itemsize))
+
+#endif
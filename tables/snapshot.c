@@ -0,0 +1,107 @@
+/* * * * * * * * *
+ * Helpers for saving hash tables to binary snapshot files and loading them
+ * back by mapping the file into memory
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+// every section is padded to a multiple of this many bytes, so that the
+// sections after it stay aligned for any type
+#define SECTION_ALIGN 8
+
+// the number of bytes 'bytes' takes up once padded
+#define padded(bytes) \
+	(((bytes) + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN)
+
+// write the 'bytes' bytes at 'data' to 'file' as the next section
+// returns false if they couldn't all be written
+bool write_section(FILE *file, const void *data, size_t bytes) {
+	assert(file);
+	static const char zeros[SECTION_ALIGN] = { 0 };
+	size_t written = fwrite(data, 1, bytes, file);
+	written += fwrite(zeros, 1, padded(bytes) - bytes, file);
+	return written == padded(bytes);
+}
+
+// write 'bytes' zero bytes to 'file' as the next section
+// returns false if they couldn't all be written
+bool write_zeros(FILE *file, size_t bytes) {
+	assert(file);
+	static const char zeros[4096] = { 0 };
+	size_t left = padded(bytes);
+	while (left > 0) {
+		size_t chunk = left < sizeof zeros ? left : sizeof zeros;
+		if (fwrite(zeros, 1, chunk, file) != chunk) {
+			return false;
+		}
+		left -= chunk;
+	}
+	return true;
+}
+
+// map the snapshot file at 'path' into memory, ready to read its first
+// section. returns NULL if the file can't be opened or mapped
+Snapshot *map_snapshot(const char *path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	// map the file privately, so that pages are only copied if they are
+	// written to (the mapping stays valid after the file is closed)
+	void *base = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		return NULL;
+	}
+
+	Snapshot *snapshot = malloc(sizeof *snapshot);
+	assert(snapshot);
+	snapshot->base = base;
+	snapshot->size = info.st_size;
+	snapshot->offset = 0;
+	return snapshot;
+}
+
+// get a pointer to the next section of 'snapshot', which is 'bytes' long, and
+// move on to the section after it
+// returns NULL (without moving on) if the section would run past the end of
+// the file
+void *read_section(Snapshot *snapshot, size_t bytes) {
+	assert(snapshot);
+
+	// (checking 'bytes' first, so that padding it can't overflow)
+	size_t left = snapshot->size - snapshot->offset;
+	if (bytes > left || padded(bytes) > left) {
+		return NULL;
+	}
+	void *section = snapshot->base + snapshot->offset;
+	snapshot->offset += padded(bytes);
+	return section;
+}
+
+// unmap 'snapshot', invalidating every section read from it, and free it
+void unmap_snapshot(Snapshot *snapshot) {
+	assert(snapshot);
+	munmap(snapshot->base, snapshot->size);
+	free(snapshot);
+}
@@ -0,0 +1,52 @@
+/* * * * * * * * *
+ * Helpers for saving hash tables to binary snapshot files and loading them
+ * back: a snapshot is written as a series of sections (each padded to a
+ * multiple of 8 bytes), and is read back by mapping the whole file into
+ * memory, so a table's arrays can be used in place rather than copied
+ *
+ * snapshots store each table's memory as it is laid out by this program, so
+ * they can only be loaded by a build of the same program on the same kind of
+ * machine
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// a snapshot file mapped into memory, being read one section at a time
+// the mapping is private: changes made to it in memory (e.g. by inserting
+// into a table using it in place) are never written back to the file
+typedef struct snapshot {
+	char *base;		// where the file is mapped in memory
+	size_t size;	// how many bytes long the file is
+	size_t offset;	// where the next section to be read starts
+} Snapshot;
+
+// write the 'bytes' bytes at 'data' to 'file' as the next section
+// returns false if they couldn't all be written
+bool write_section(FILE *file, const void *data, size_t bytes);
+
+// write 'bytes' zero bytes to 'file' as the next section
+// returns false if they couldn't all be written
+bool write_zeros(FILE *file, size_t bytes);
+
+// map the snapshot file at 'path' into memory, ready to read its first
+// section. returns NULL if the file can't be opened or mapped
+Snapshot *map_snapshot(const char *path);
+
+// get a pointer to the next section of 'snapshot', which is 'bytes' long, and
+// move on to the section after it. the section stays mapped until the
+// snapshot is unmapped. returns NULL (without moving on) if the section would
+// run past the end of the file, as it does in a truncated or foreign file
+void *read_section(Snapshot *snapshot, size_t bytes);
+
+// unmap 'snapshot', invalidating every section read from it, and free it
+void unmap_snapshot(Snapshot *snapshot);
+
+#endif
@@ -0,0 +1,47 @@
+/* * * * * * * * *
+ * Append-only byte arena for storing the bytes of variable-length string
+ * keys, and the fixed-size record a table slot uses to refer to one of them
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "strarena.h"
+
+// how many bytes to allocate for an arena's first keys
+#define INITIAL_CAPACITY 256
+
+// set up an empty arena
+void initialise_arena(Arena *arena) {
+	arena->bytes = malloc(INITIAL_CAPACITY);
+	assert(arena->bytes);
+	arena->used = 0;
+	arena->capacity = INITIAL_CAPACITY;
+}
+
+// free the memory used by the bytes in 'arena'
+void free_arena(Arena *arena) {
+	assert(arena);
+	free(arena->bytes);
+}
+
+// append the 'len' bytes at 'str' to 'arena', returning their offset
+int64 arena_append(Arena *arena, char *str, int len) {
+	assert(arena);
+
+	// double the arena until there's room for these bytes
+	while (arena->used + len > arena->capacity) {
+		arena->capacity *= 2;
+		arena->bytes = realloc(arena->bytes, arena->capacity);
+		assert(arena->bytes);
+	}
+
+	int64 offset = arena->used;
+	memcpy(arena->bytes + offset, str, len);
+	arena->used += len;
+	return offset;
+}
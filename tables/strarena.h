@@ -0,0 +1,55 @@
+/* * * * * * * * *
+ * Append-only byte arena for storing the bytes of variable-length string
+ * keys, and the fixed-size record a table slot uses to refer to one of them
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ */
+
+#ifndef STRARENA_H
+#define STRARENA_H
+
+#include <stdbool.h>
+#include <string.h>
+#include "../inthash.h"
+
+// an arena holds the bytes of every key in a table, one after another. keys
+// are only ever appended, so a key's offset stays valid as the arena grows
+// (even though the arena's memory itself may move)
+typedef struct arena {
+	char *bytes;		// the bytes of all keys appended so far
+	int64 used;			// how many bytes have been appended
+	int64 capacity;		// how many bytes have been allocated
+} Arena;
+
+// a string key as stored in a table: everything needed to rule out a match
+// without touching the arena, plus where to find the bytes if we need them
+typedef struct strkey {
+	int tag;		// hash value of the key: h1() of its strhash()
+	int len;		// length of the key in bytes
+	int64 offset;	// where the key's bytes start in the arena
+} StrKey;
+
+// set up an empty arena
+void initialise_arena(Arena *arena);
+
+// free the memory used by the bytes in 'arena'
+void free_arena(Arena *arena);
+
+// append the 'len' bytes at 'str' to 'arena', returning their offset
+int64 arena_append(Arena *arena, char *str, int len);
+
+// a pointer to the bytes of 'key' within 'arena' (only valid until the next
+// call to arena_append)
+#define arena_bytes(arena, key) ((arena)->bytes + (key)->offset)
+
+// does 'key' hold the 'len' bytes at 'str', which have hash value 'tag'?
+// the tag and length are checked first, so the arena is only read (and the
+// bytes compared) when the key is very likely to match
+static inline bool strkey_equals(Arena *arena, StrKey *key, int tag,
+	char *str, int len) {
+	return key->tag == tag && key->len == len
+		&& memcmp(arena_bytes(arena, key), str, len) == 0;
+}
+
+#endif
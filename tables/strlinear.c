@@ -0,0 +1,320 @@
+/* * * * * * * * *
+ * Dynamic hash table for variable-length string keys, using linear probing
+ * to resolve collisions
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from linear.c and linear.h by Matt Farrugia with
+ * some modifications to suit the purpose
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "strlinear.h"
+#include "strarena.h"
+#include "histogram.h"
+#include "events.h"
+#include "../strhash.h"
+
+// how many cells to advance at a time while looking for a free slot
+#define STEP_SIZE 1
+
+// helper structure to store statistics gathered
+typedef struct stats {
+	double total_probe;	// total number of slots checked while inserting keys
+	int resizes_avoided;	// how many doublings were done up front by
+							// strlinear_hash_table_reserve instead of when full
+	Histogram probes;	// how many slots each insert stepped past before
+						// finding a free one
+} Stats;
+
+// a hash table is an array of slots holding fixed-size records of keys (their
+// hash value, length and where their bytes are), along with a parallel array
+// of boolean markers recording which slots are in use (true) or free (false)
+// the bytes of the keys themselves are stored one after another in an arena
+struct strlinear_table {
+	StrKey *slots;	// array of slots holding keys
+	bool   *inuse;	// is this slot in use or not?
+	int size;		// the size of both of these arrays right now
+	int load;		// number of keys in the table right now
+	Arena arena;	// the bytes of every key in the table
+	Stats stats;	// collection of statistics about this hash table
+};
+
+
+/* * * *
+ * helper functions
+ */
+
+// set up the internals of a linear hash table struct with new
+// arrays of size 'size'
+static void initialise_table(StrLinearHashTable *table, int size) {
+	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+
+	table->slots = malloc((sizeof *table->slots) * size);
+	assert(table->slots);
+	table->inuse = malloc((sizeof *table->inuse) * size);
+	assert(table->inuse);
+	int i;
+	for (i = 0; i < size; i++) {
+		table->inuse[i] = false;
+	}
+
+	table->size = size;
+	table->load = 0;
+}
+
+
+// reinsert a key into the hash table after doubling the table --- we can
+// assume that there will definitely be space for this key because it was
+// already inside the hash table previously, and its tag is its hash value so
+// we never need to look at its bytes
+static void reinsert_key(StrLinearHashTable *table, StrKey key) {
+	int h = key.tag % table->size;
+
+	while (table->inuse[h]) {
+		h = (h + STEP_SIZE) % table->size;
+	}
+
+	table->slots[h] = key;
+	table->inuse[h] = true;
+	table->load++;
+}
+
+
+// change the size of the internal table arrays to 'size' and re-hash all
+// keys in the old tables
+static void resize_table(StrLinearHashTable *table, int size) {
+	int64 start = event_start();
+	StrKey *oldslots = table->slots;
+	bool   *oldinuse = table->inuse;
+	int oldsize = table->size;
+
+	initialise_table(table, size);
+
+	int i;
+	for (i = 0; i < oldsize; i++) {
+		if (oldinuse[i] == true) {
+			reinsert_key(table, oldslots[i]);
+		}
+	}
+
+	free(oldslots);
+	free(oldinuse);
+
+	record_event(EVENT_RESIZE, "strlinear", start, oldsize, size, table->load);
+}
+
+
+// double the size of the internal table arrays and re-hash all
+// keys in the old tables
+static void double_table(StrLinearHashTable *table) {
+	resize_table(table, table->size * 2);
+}
+
+
+/* * * *
+ * all functions
+ */
+
+// initialise a linear probing string hash table with initial size 'size'
+StrLinearHashTable *new_strlinear_hash_table(int size) {
+	StrLinearHashTable *table = malloc(sizeof *table);
+	assert(table);
+
+	// set up the internals of the table struct with arrays of size 'size'
+	initialise_table(table, size);
+	initialise_arena(&table->arena);
+
+	table->stats.total_probe = 0;
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.probes);
+
+	return table;
+}
+
+
+// free all memory associated with 'table'
+void free_strlinear_hash_table(StrLinearHashTable *table) {
+	assert(table != NULL);
+
+	// free the table's arrays and its keys' bytes
+	free(table->slots);
+	free(table->inuse);
+	free_arena(&table->arena);
+
+	// free the table struct itself
+	free(table);
+}
+
+
+// insert the 'len' byte string 'key' into 'table', if it's not in there
+// already (the bytes are copied, so 'key' doesn't need to be kept around)
+// returns true if insertion succeeds, false if it was already in there
+bool strlinear_hash_table_insert(StrLinearHashTable *table, char *key,
+	int len) {
+	assert(table != NULL);
+
+	// need to count our steps to make sure we recognise when the table is full
+	int steps = 0;
+
+	// calculate the initial address for this key
+	int tag = h1(strhash(key, len));
+	int h = tag % table->size;
+
+	// step along the array until we find a free space (inuse[]==false),
+	// or until we visit every cell
+	while (table->inuse[h] && steps < table->size) {
+		if (strkey_equals(&table->arena, &table->slots[h], tag, key, len)) {
+			// this key already exists in the table! no need to insert
+			return false;
+		}
+
+		// else, keep stepping through the table looking for a free slot
+		h = (h + STEP_SIZE) % table->size;
+		steps++;
+	}
+
+	// if we used up all of our steps, then we're back where we started and the
+	// table is full
+	if (steps == table->size) {
+		// let's make some more space and then try to insert this key again!
+		double_table(table);
+		return strlinear_hash_table_insert(table, key, len);
+	}
+
+	// otherwise, we have found a free slot! copy the key's bytes into the
+	// arena, and record where they are right here
+	table->slots[h].tag = tag;
+	table->slots[h].len = len;
+	table->slots[h].offset = arena_append(&table->arena, key, len);
+	table->inuse[h] = true;
+	table->load++;
+	table->stats.total_probe += steps+1;
+	histogram_add(&table->stats.probes, steps);
+
+	return true;
+}
+
+
+// make room in 'table' for 'n' keys in total, so that inserting them will
+// never need to double the table
+void strlinear_hash_table_reserve(StrLinearHashTable *table, int n) {
+	assert(table != NULL);
+
+	// the table only doubles once it is completely full, so grow it (all in
+	// one go) to the size it would have doubled its way up to (but no
+	// further than the largest table size)
+	int size = table->size;
+	while (size < n && (int64)size * 2 < MAX_TABLE_SIZE) {
+		size *= 2;
+		table->stats.resizes_avoided++;
+	}
+	if (size > table->size) {
+		resize_table(table, size);
+	}
+}
+
+
+// lookup whether the 'len' byte string 'key' is inside 'table'
+// returns true if found, false if not
+bool strlinear_hash_table_lookup(StrLinearHashTable *table, char *key,
+	int len) {
+	assert(table != NULL);
+
+	// need to count our steps to make sure we recognise when the table is full
+	int steps = 0;
+
+	// calculate the initial address for this key
+	int tag = h1(strhash(key, len));
+	int h = tag % table->size;
+
+	// step along until we find a free space (inuse[]==false), or until we
+	// visit every cell
+	while (table->inuse[h] && steps < table->size) {
+
+		if (strkey_equals(&table->arena, &table->slots[h], tag, key, len)) {
+			// found the key!
+			return true;
+		}
+
+		// keep stepping
+		h = (h + STEP_SIZE) % table->size;
+		steps++;
+	}
+
+	// we have either searched the whole table or come back to where we started
+	// either way, the key is not in the hash table
+	return false;
+}
+
+
+// print the contents of 'table' to stdout
+void strlinear_hash_table_print(StrLinearHashTable *table) {
+	assert(table != NULL);
+
+	printf("--- table size: %d\n", table->size);
+
+	// print header
+	printf("   address | key\n");
+
+	// print the rows of the hash table
+	int i;
+	for (i = 0; i < table->size; i++) {
+
+		// print the address
+		printf(" %9d | ", i);
+
+		// print the contents of the slot
+		if (table->inuse[i]) {
+			printf("%.*s\n", table->slots[i].len,
+				arena_bytes(&table->arena, &table->slots[i]));
+		} else {
+			printf("-\n");
+		}
+	}
+
+	printf("--- end table ---\n");
+}
+
+
+// print some statistics about 'table' to stdout
+void strlinear_hash_table_stats(StrLinearHashTable *table) {
+	assert(table != NULL);
+	double load_factor = table->load * 100.0 / table->size;
+	printf("--- table stats ---\n");
+
+	// print some information about the table
+	printf(" current size: %d slots\n", table->size);
+	printf(" current load: %d items\n", table->load);
+	printf("  load factor: %.3f%%\n", load_factor);
+	printf("    step size: %d slots\n", STEP_SIZE);
+	printf("average probe: %.1lf\n", table->stats.total_probe/table->load*1.0);
+	printf("    key arena: %lld bytes used, %lld allocated\n",
+		table->arena.used, table->arena.capacity);
+	if (table->stats.resizes_avoided > 0) {
+		printf("resizes avoided: %d\n", table->stats.resizes_avoided);
+	}
+	print_histogram("insert probes", &table->stats.probes);
+
+	MemoryUsage usage;
+	strlinear_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->load);
+	
+	printf("--- end stats ---\n");
+}
+
+// count the bytes 'table' is using into *usage
+void strlinear_hash_table_memory_usage(StrLinearHashTable *table,
+	MemoryUsage *usage) {
+	assert(table != NULL);
+	size_t slot_bytes = sizeof *table->slots + sizeof *table->inuse;
+	usage->directory = sizeof *table;
+	usage->stats = sizeof table->stats;
+	usage->buckets = slot_bytes * table->size + table->arena.capacity;
+	usage->slack = slot_bytes * (table->size - table->load)
+		+ (table->arena.capacity - table->arena.used);
+}
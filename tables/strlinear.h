@@ -0,0 +1,52 @@
+/* * * * * * * * *
+ * Dynamic hash table for variable-length string keys, using linear probing
+ * to resolve collisions
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from linear.c and linear.h by Matt Farrugia with
+ * some modifications to suit the purpose
+ */
+
+#ifndef STRLINEAR_H
+#define STRLINEAR_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "memory.h"
+
+typedef struct strlinear_table StrLinearHashTable;
+
+// initialise a linear probing string hash table with initial size 'size'
+StrLinearHashTable *new_strlinear_hash_table(int size);
+
+// free all memory associated with 'table'
+void free_strlinear_hash_table(StrLinearHashTable *table);
+
+// insert the 'len' byte string 'key' into 'table', if it's not in there
+// already (the bytes are copied, so 'key' doesn't need to be kept around)
+// returns true if insertion succeeds, false if it was already in there
+bool strlinear_hash_table_insert(StrLinearHashTable *table, char *key,
+	int len);
+
+// make room in 'table' for 'n' keys in total, so that inserting them will
+// never need to double the table
+void strlinear_hash_table_reserve(StrLinearHashTable *table, int n);
+
+// lookup whether the 'len' byte string 'key' is inside 'table'
+// returns true if found, false if not
+bool strlinear_hash_table_lookup(StrLinearHashTable *table, char *key,
+	int len);
+
+// print the contents of 'table' to stdout
+void strlinear_hash_table_print(StrLinearHashTable *table);
+
+// print some statistics about 'table' to stdout
+void strlinear_hash_table_stats(StrLinearHashTable *table);
+
+// count the bytes 'table' is using into *usage
+void strlinear_hash_table_memory_usage(StrLinearHashTable *table,
+	MemoryUsage *usage);
+
+#endif
@@ -0,0 +1,420 @@
+/* * * * * * * * *
+ * Dynamic hash table for variable-length string keys, using extendible
+ * hashing with multiple keys per bucket to resolve collisions by
+ * incrementally growing the hash table
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from xtndbln.c and xtndbln.h with some modifications
+ * to suit the purpose.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "strxtndbln.h"
+#include "strarena.h"
+#include "histogram.h"
+#include "events.h"
+#include "../strhash.h"
+
+// Macro to calculate the rightmost n bits of a number x
+#define rightmostnbits(n, x) (x) & ((1 <<(n)) - 1)
+
+#define FOUND true // To indicate the key can be found in the table
+#define NOT_FOUND false // To indicate the key cannot be found in the table
+
+/*********************************** STRUCT **********************************/
+// a bucket stores an array of string key records
+// it also knows how many bits are shared between possible keys, and the first 
+// table address that references it
+typedef struct strxtndbln_bucket {
+	int id;			// a unique id for this bucket, equal to the first address
+					// in the table which points to it
+	int depth;		// how many hash value bits are being used by this bucket
+	int nkeys;		// number of keys currently contained in this bucket
+	StrKey *keys;	// the keys stored in this bucket
+} Bucket;
+
+// helper structure to store statistics gathered
+typedef struct stats {
+	int nbuckets;	// how many distinct buckets does the table point to
+	int nkeys;		// how many keys are being stored in the table
+	int resizes_avoided;	// how many doublings and splits were done up
+							// front by strxtndbln_hash_table_reserve
+	Histogram splits;	// how many buckets each insert had to split
+} Stats;
+
+// a hash table is an array of slots pointing to buckets holding up to 
+// bucketsize keys, along with some information about the number of hash value 
+// bits to use for addressing, and an arena holding the bytes of every key
+struct strxtndbln_table {
+	Bucket **buckets;	// array of pointers to buckets
+	int size;			// how many entries in the table of pointers (2^depth)
+	int depth;			// how many bits of the hash value to use (log2(size))
+	int bucketsize;		// maximum number of keys per bucket
+	Arena arena;		// the bytes of every key in the table
+	Stats stats;		// collection of statistics about this hash table
+};
+
+/****************************** HELPER FUNCTIONS *****************************/
+// Helper function to create a new bucket first referenced from 
+// 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(int first_address, int depth, int bucketsize);
+
+// Helper function to double the table of bucket pointers, duplicating the 
+// bucket pointers in the first half into the new second half of the table
+static void double_extnd_table(StrXtndblNHashTable *table);
+
+// Helper function to split the bucket in 'table' at address 'address',
+// growing table if necessary
+static void split_bucket(StrXtndblNHashTable *table, int address);
+
+// Helper function to reinsert a key into the hash table after splitting a
+// bucket - its tag is its hash value, so its bytes are never needed
+static void reinsert_key(StrXtndblNHashTable *table, StrKey key);
+
+/**************************** FUNCTION DEFINITIONS ***************************/
+// initialise an extendible string hash table with 'bucketsize' keys per bucket
+StrXtndblNHashTable *new_strxtndbln_hash_table(int bucketsize) {
+	StrXtndblNHashTable *table = malloc(sizeof *table);
+	assert(table);
+	
+	table->size = 1;
+	table->buckets = malloc(sizeof *table->buckets);
+	assert(table->buckets);
+	table->buckets[0] = new_bucket(0, 0, bucketsize);
+	
+	// Initialise the initial value
+	table->depth = 0;
+	table->bucketsize = bucketsize;
+	initialise_arena(&table->arena);
+	
+	table->stats.nbuckets = 1;
+	table->stats.nkeys = 0;
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.splits);
+
+	return table;
+}
+
+
+// free all memory associated with 'table'
+void free_strxtndbln_hash_table(StrXtndblNHashTable *table) {
+	assert(table);
+
+	// Loop backwards through the array of pointers, freeing buckets only as we
+	// reach their first reference
+	int i;
+	for (i = table->size-1; i >= 0; i--) {
+		if (table->buckets[i]->id == i) {
+			free(table->buckets[i]->keys);
+			free(table->buckets[i]);
+		}
+	}
+
+	// Free the array of bucket pointers and the keys' bytes
+	free(table->buckets);
+	free_arena(&table->arena);
+	
+	// Free the table struct itself
+	free(table);
+}
+
+
+// insert the 'len' byte string 'key' into 'table', if it's not in there
+// already (the bytes are copied, so 'key' doesn't need to be kept around)
+// returns true if insertion succeeds, false if it was already in there
+bool strxtndbln_hash_table_insert(StrXtndblNHashTable *table, char *key,
+	int len) {
+	assert(table);
+	
+	// Calculate table address
+	int tag = h1(strhash(key, len));
+	int address = rightmostnbits(table->depth, tag);
+	int i;
+	
+	// Check whether the key have been inserted or not
+	Bucket *bucket = table->buckets[address];
+	for (i = 0; i < bucket->nkeys; i++) {
+		if (strkey_equals(&table->arena, &bucket->keys[i], tag, key, len)) {
+			return false;
+		}
+	}
+	
+	// If not, make space in the table until our target bucket has space
+	int splits = 0;
+	while (table->buckets[address]->nkeys == table->bucketsize) {
+		split_bucket(table, address);
+		splits++;
+		
+		// and recalculate address because we might now need more bits
+		address = rightmostnbits(table->depth, tag);
+	}
+	
+	// There is now space! Copy the key's bytes into the arena, and record
+	// where they are in the bucket
+	StrKey record = { tag, len, arena_append(&table->arena, key, len) };
+	bucket = table->buckets[address];
+	bucket->keys[bucket->nkeys] = record;
+	bucket->nkeys++;
+	table->stats.nkeys++;
+	histogram_add(&table->stats.splits, splits);
+
+	return true;
+}
+
+
+// make room in 'table' for 'n' keys in total, by doubling the table and
+// splitting buckets up front until there is a bucket for every 'bucketsize'
+// keys. keys whose hash values crowd into the same bits will still need
+// more splits
+void strxtndbln_hash_table_reserve(StrXtndblNHashTable *table, int n) {
+	assert(table);
+	
+	// How many hash value bits give every 'bucketsize' keys a bucket?
+	int depth = 0;
+	while (((int64)table->bucketsize << depth) < n) {
+		depth++;
+	}
+	
+	// Double the table until it uses that many bits
+	while (table->depth < depth) {
+		double_extnd_table(table);
+		table->stats.resizes_avoided++;
+	}
+	
+	// And split every bucket until it does too
+	int address;
+	for (address = 0; address < table->size; address++) {
+		while (table->buckets[address]->depth < depth) {
+			split_bucket(table, address);
+			table->stats.resizes_avoided++;
+		}
+	}
+}
+
+
+// lookup whether the 'len' byte string 'key' is inside 'table'
+// returns true if found, false if not
+bool strxtndbln_hash_table_lookup(StrXtndblNHashTable *table, char *key,
+	int len) {
+	assert(table);
+	
+	// Calculate table address for this key
+	int tag = h1(strhash(key, len));
+	int address = rightmostnbits(table->depth, tag);
+	
+	// Look for the key in that bucket
+	Bucket *bucket = table->buckets[address];
+	int i;
+	for (i = 0; i < bucket->nkeys; i++) {
+		if (strkey_equals(&table->arena, &bucket->keys[i], tag, key, len)) {
+			return FOUND;
+		}
+	}
+	
+	return NOT_FOUND;
+}
+
+
+// print the contents of 'table' to stdout
+void strxtndbln_hash_table_print(StrXtndblNHashTable *table) {
+	assert(table);
+	printf("--- table size: %d\n", table->size);
+
+	// print header
+	printf("  table:               buckets:\n");
+	printf("  address | bucketid   bucketid [key]\n");
+	
+	// print table and buckets
+	int i;
+	for (i = 0; i < table->size; i++) {
+		// table entry
+		Bucket *bucket = table->buckets[i];
+		printf("%9d | %-9d ", i, bucket->id);
+
+		// if this is the first address at which a bucket occurs, print it now
+		if (bucket->id == i) {
+			printf("%9d ", bucket->id);
+
+			// print the bucket's contents
+			printf("[");
+			for (int j = 0; j < table->bucketsize; j++) {
+				if (j < bucket->nkeys) {
+					printf(" %.*s", bucket->keys[j].len,
+						arena_bytes(&table->arena, &bucket->keys[j]));
+				} else {
+					printf(" -");
+				}
+			}
+			printf(" ]");
+		}
+		// end the line
+		printf("\n");
+	}
+
+	printf("--- end table ---\n");
+}
+
+
+// print some statistics about 'table' to stdout
+void strxtndbln_hash_table_stats(StrXtndblNHashTable *table) {
+	assert(table);
+	
+	printf("--- table stats ---\n");
+	
+	// print some stats about state of the table
+	printf("        current table size: %d\n", table->size);
+	printf("            number of keys: %d\n", table->stats.nkeys);
+	printf("         number of buckets: %d\n", table->stats.nbuckets);
+	printf(" number of keys per bucket: %d\n", table->bucketsize);
+	printf("                 key arena: %lld bytes used, %lld allocated\n",
+		table->arena.used, table->arena.capacity);
+	if (table->stats.resizes_avoided > 0) {
+		printf("           resizes avoided: %d\n",
+			table->stats.resizes_avoided);
+	}
+	
+	// print how many buckets inserts have had to split, and how full the
+	// buckets are now (each bucket's id is the first address pointing to it)
+	print_histogram("splits per insert", &table->stats.splits);
+	Histogram occupancy;
+	initialise_histogram(&occupancy);
+	int address;
+	for (address = 0; address < table->size; address++) {
+		if (table->buckets[address]->id == address) {
+			histogram_add(&occupancy, table->buckets[address]->nkeys);
+		}
+	}
+	print_histogram("keys per bucket", &occupancy);
+	
+	MemoryUsage usage;
+	strxtndbln_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->stats.nkeys);
+	
+	printf("--- end stats ---\n");
+}
+
+// count the bytes 'table' is using into *usage
+void strxtndbln_hash_table_memory_usage(StrXtndblNHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	size_t bucket_bytes = sizeof (Bucket) + sizeof (StrKey) * table->bucketsize;
+	usage->directory = sizeof *table
+		+ sizeof *table->buckets * table->size;
+	usage->stats = sizeof table->stats;
+	usage->buckets = bucket_bytes * table->stats.nbuckets
+		+ table->arena.capacity;
+	usage->slack = sizeof (StrKey) * ((size_t)table->stats.nbuckets
+			* table->bucketsize - table->stats.nkeys)
+		+ (table->arena.capacity - table->arena.used);
+}
+
+/********************************* NEW BUCKET ********************************/
+// Helper function to create a new bucket first referenced from 
+// 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
+	Bucket *bucket = malloc(sizeof *bucket);
+	assert(bucket);
+
+	bucket->id = first_address;
+	bucket->depth = depth;
+	
+	bucket->keys = malloc(bucketsize * sizeof (StrKey));
+	assert(bucket->keys);
+	
+	bucket->nkeys = 0;
+	
+	return bucket;
+}
+ 
+/*************************** DOUBLE EXTENDED TABLE ***************************/
+// Helper function to double the table of bucket pointers, duplicating the 
+// bucket pointers in the first half into the new second half of the table
+static void double_extnd_table(StrXtndblNHashTable *table) {
+	int64 start = event_start();
+	int size = table->size * 2, i;
+	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
+	
+	// Get a new array of twice as many bucket pointers
+	table->buckets = realloc(table->buckets, (sizeof *table->buckets) * size);
+	assert(table->buckets);
+	
+	// Copy pointers down
+	for (i = 0; i < table->size; i++) {
+		table->buckets[table->size + i] = table->buckets[i];
+	}
+	
+	// finally, increase the table size and the depth we are using to hash keys
+	table->size = size;
+	table->depth++;
+	record_event(EVENT_DOUBLE, "strxtndbln", start, size / 2, size, 0);
+}
+
+/******************************* REINSERT KEY ********************************/
+// Helper function to reinsert a key into the hash table after splitting a
+// bucket - its tag is its hash value, so its bytes are never needed
+static void reinsert_key(StrXtndblNHashTable *table, StrKey key) {
+	int address = rightmostnbits(table->depth, key.tag);
+	Bucket *bucket = table->buckets[address];
+	bucket->keys[bucket->nkeys] = key;
+	bucket->nkeys++;
+}
+
+/******************************** SPLIT BUCKET *******************************/
+// Helper function to split the bucket in 'table' at address 'address',
+// growing table if necessary
+static void split_bucket(StrXtndblNHashTable *table, int address) {
+	
+	// FIRST,
+	// check whether we need to grow the table or not
+	if (table->buckets[address]->depth == table->depth) {
+		double_extnd_table(table);
+	}
+	int64 start = event_start();
+	
+	// SECOND
+	// create a new bucket and update both buckets' depth
+	Bucket *bucket = table->buckets[address];
+	int depth = bucket->depth;
+	int first_address = bucket->id;
+	
+	int new_depth = depth + 1;
+	bucket->depth = new_depth;
+	
+	// New bucket's first address will be a 1 bit plus the old first address
+	int new_first_address = 1 << depth | first_address;
+	Bucket *newbucket = new_bucket(new_first_address, new_depth, 
+		table->bucketsize);
+	table->stats.nbuckets++;
+
+	// THIRD,
+	// redirect every second address pointing to this bucket to the new
+	// bucket, constructing addresses by joining a bit 'prefix' and 'suffix'
+	int bit_address = rightmostnbits(depth, first_address);
+	int suffix = (1 << depth) | bit_address;
+	int maxprefix = 1 << (table->depth - new_depth);
+	
+	int prefix;
+	for (prefix = 0; prefix < maxprefix; prefix++) {
+		int a = (prefix << new_depth) | suffix;
+		table->buckets[a] = newbucket;
+	}
+	
+	// FINALLY,
+	// Filter the keys from the old bucket into their rightful place in the new
+	// table (which may be the old bucket, or may be the new bucket)
+	StrKey *keys = bucket->keys;
+	int i, total_keys = bucket->nkeys;
+	bucket->nkeys = 0;
+
+	for (i = 0; i < total_keys; i++) {
+		reinsert_key(table, keys[i]);
+	}
+	
+	record_event(EVENT_SPLIT, "strxtndbln", start, total_keys, bucket->nkeys,
+		newbucket->nkeys);
+}
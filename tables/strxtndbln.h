@@ -0,0 +1,55 @@
+/* * * * * * * * *
+ * Dynamic hash table for variable-length string keys, using extendible
+ * hashing with multiple keys per bucket to resolve collisions by
+ * incrementally growing the hash table
+ *
+ * created for COMP20007 Design of Algorithms - Assignment 2, 2017
+ * by William Liandri (wliandri@student.unimelb.edu.au)
+ *
+ * The program is cited from xtndbln.c and xtndbln.h with some modifications
+ * to suit the purpose.
+ */
+
+#ifndef STRXTNDBLN_H
+#define STRXTNDBLN_H
+
+#include <stdbool.h>
+#include "../inthash.h"
+#include "memory.h"
+
+typedef struct strxtndbln_table StrXtndblNHashTable;
+
+// initialise an extendible string hash table with 'bucketsize' keys per bucket
+StrXtndblNHashTable *new_strxtndbln_hash_table(int bucketsize);
+
+// free all memory associated with 'table'
+void free_strxtndbln_hash_table(StrXtndblNHashTable *table);
+
+// insert the 'len' byte string 'key' into 'table', if it's not in there
+// already (the bytes are copied, so 'key' doesn't need to be kept around)
+// returns true if insertion succeeds, false if it was already in there
+bool strxtndbln_hash_table_insert(StrXtndblNHashTable *table, char *key,
+	int len);
+
+// make room in 'table' for 'n' keys in total, by doubling the table and
+// splitting buckets up front until there is a bucket for every 'bucketsize'
+// keys. keys whose hash values crowd into the same bits will still need
+// more splits
+void strxtndbln_hash_table_reserve(StrXtndblNHashTable *table, int n);
+
+// lookup whether the 'len' byte string 'key' is inside 'table'
+// returns true if found, false if not
+bool strxtndbln_hash_table_lookup(StrXtndblNHashTable *table, char *key,
+	int len);
+
+// print the contents of 'table' to stdout
+void strxtndbln_hash_table_print(StrXtndblNHashTable *table);
+
+// print some statistics about 'table' to stdout
+void strxtndbln_hash_table_stats(StrXtndblNHashTable *table);
+
+// count the bytes 'table' is using into *usage
+void strxtndbln_hash_table_memory_usage(StrXtndblNHashTable *table,
+	MemoryUsage *usage);
+
+#endif
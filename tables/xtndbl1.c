@@ -9,30 +9,44 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xtndbl1.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
+#include "radix.h"
+#include "slab.h"
 
 // macro to calculate the rightmost n bits of a number x
 #define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
 
+// the version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
 // a bucket stores a single key (full=true) or is empty (full=false)
 // it also knows how many bits are shared between possible keys, and the first 
 // table address that references it
+// if the table stores values, the key's value is allocated inline right after
+// it; otherwise the bucket has no space for a value at all
 typedef struct bucket {
 	int id;		// a unique id for this bucket, equal to the first address
 				// in the table which points to it
 	int depth;	// how many hash value bits are being used by this bucket
 	bool full;	// does this bucket contain a key
 	int64 key;	// the key stored in this bucket
+	int64 value[];	// the key's value (only present if the table has values)
 } Bucket;
 
 // helper structure to store statistics gathered
 typedef struct stats {
 	int nbuckets;	// how many distinct buckets does the table point to
 	int nkeys;		// how many keys are being stored in the table
-	int time;		// how much CPU time has been used to insert/lookup keys
-					// in this table
+	Latency inserts;	// how long inserts (and puts) have taken
+	Latency lookups;	// how long lookups (and gets and updates) have taken
+	int resizes_avoided;	// how many doublings and splits were done up
+							// front by xtndbl1_hash_table_reserve
+	Histogram splits;	// how many buckets each insert had to split
 } Stats;
 
 // a hash table is an array of slots pointing to buckets holding up to 1 key,
@@ -42,18 +56,39 @@ struct xtndbl1_table {
 	Bucket **buckets;	// array of pointers to buckets
 	int size;			// how many entries in the table of pointers (2^depth)
 	int depth;			// how many bits of the hash value to use (log2(size))
+	bool values;		// does this table store a value alongside each key?
+	Slabs slabs;		// the memory every bucket is allocated from, in the
+						// order the buckets were created
 	Stats stats;		// collection of statistics about this hash table
+	Snapshot *snapshot;	// the snapshot some of the slabs are being used in
+						// place from, or NULL if they were all allocated
 };
 
+// the first section of a snapshot of a single-key extendible hash table,
+// followed by a section holding the slabs (and so every bucket, exactly as
+// it is in memory) and a section holding the number of the bucket each table
+// address points to
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	int size;
+	int depth;
+	bool values;
+	int itemsize;	// how many bytes each bucket takes up
+	int nitems;		// how many buckets there are in the slabs
+	Stats stats;
+} SnapshotHeader;
+
 /* * * *
  * helper functions
  */
 
-// create a new bucket first referenced from 'first_address', based on 'depth'
-// bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth) {
-	Bucket *bucket = malloc(sizeof *bucket);
-	assert(bucket);
+// create a new bucket in 'table' first referenced from 'first_address', based
+// on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(Xtndbl1HashTable *table, int first_address,
+	int depth) {
+	Bucket *bucket = slab_alloc(&table->slabs);
 
 	bucket->id = first_address;
 	bucket->depth = depth;
@@ -65,6 +100,7 @@ static Bucket *new_bucket(int first_address, int depth) {
 // double the table of bucket pointers, duplicating the bucket pointers in the
 // first half into the new second half of the table
 static void double_table(Xtndbl1HashTable *table) {
+	int64 start = event_start();
 	int size = table->size * 2;
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 
@@ -79,15 +115,19 @@ static void double_table(Xtndbl1HashTable *table) {
 	// finally, increase the table size and the depth we are using to hash keys
 	table->size = size;
 	table->depth++;
+	record_event(EVENT_DOUBLE, "xtndbl1", start, size / 2, size, 0);
 }
 
 // reinsert a key into the hash table after splitting a bucket --- we can assume
 // that there will definitely be space for this key because it was already
 // inside the hash table previously
 // use 'xtndbl1_hash_table_insert()' instead for inserting new keys
-static void reinsert_key(Xtndbl1HashTable *table, int64 key) {
+static void reinsert_key(Xtndbl1HashTable *table, int64 key, int64 value) {
 	int address = rightmostnbits(table->depth, h1(key));
 	table->buckets[address]->key = key;
+	if (table->values) {
+		table->buckets[address]->value[0] = value;
+	}
 	table->buckets[address]->full = true;
 }
 
@@ -101,6 +141,7 @@ static void split_bucket(Xtndbl1HashTable *table, int address) {
 		double_table(table);
 	}
 	// either way, now it's time to split this bucket
+	int64 start = event_start();
 
 
 	// SECOND,
@@ -114,7 +155,7 @@ static void split_bucket(Xtndbl1HashTable *table, int address) {
 
 	// new bucket's first address will be a 1 bit plus the old first address
 	int new_first_address = 1 << depth | first_address;
-	Bucket *newbucket = new_bucket(new_first_address, new_depth);
+	Bucket *newbucket = new_bucket(table, new_first_address, new_depth);
 	table->stats.nbuckets++;
 	
 	// THIRD,
@@ -145,10 +186,83 @@ static void split_bucket(Xtndbl1HashTable *table, int address) {
 	// filter the key from the old bucket into its rightful place in the new 
 	// table (which may be the old bucket, or may be the new bucket)
 
-	// remove and reinsert the key
-	int64 key = bucket->key;
-	bucket->full = false;
-	reinsert_key(table, key);
+	// remove and reinsert the key (if there is one: buckets can be split
+	// while still empty when reserving space)
+	if (bucket->full) {
+		int64 key = bucket->key;
+		int64 value = table->values ? bucket->value[0] : 0;
+		bucket->full = false;
+		reinsert_key(table, key, value);
+	}
+
+	// (between them, the two buckets now hold what the old bucket held)
+	record_event(EVENT_SPLIT, "xtndbl1", start, bucket->full + newbucket->full,
+		bucket->full, newbucket->full);
+}
+
+// insert 'key' into 'table' with 'value', if it's not in there already
+// if it is, and 'overwrite' is true, its value is replaced with 'value'
+// returns true if insertion succeeds, false if it was already in there
+static bool insert_entry(Xtndbl1HashTable *table, int64 key, int64 value,
+	bool overwrite) {
+	// calculate table address
+	int hash = h1(key);
+	int address = rightmostnbits(table->depth, hash);
+	
+	// is this key already there?
+	if (table->buckets[address]->full && table->buckets[address]->key == key) {
+		if (overwrite) {
+			table->buckets[address]->value[0] = value;
+		}
+		return false;
+	}
+
+	// if not, make space in the table until our target bucket has space
+	int splits = 0;
+	while (table->buckets[address]->full) {
+		split_bucket(table, address);
+		splits++;
+
+		// and recalculate address because we might now need more bits
+		address = rightmostnbits(table->depth, hash);
+	}
+
+	// there's now space! we can insert this key
+	table->buckets[address]->key = key;
+	if (table->values) {
+		table->buckets[address]->value[0] = value;
+	}
+	table->buckets[address]->full = true;
+	table->stats.nkeys++;
+	histogram_add(&table->stats.splits, splits);
+
+	return true;
+}
+
+// search for 'key', whose hash value is 'hash', in 'table' (without timing)
+// returns the bucket holding it if found, NULL if not
+static Bucket *search_bucket(Xtndbl1HashTable *table, int64 key, int hash) {
+
+	// calculate table address for this key
+	int address = rightmostnbits(table->depth, hash);
+	
+	// look for the key in that bucket (unless it's empty)
+	if (table->buckets[address]->full && table->buckets[address]->key == key) {
+		// found it!
+		return table->buckets[address];
+	}
+	return NULL;
+}
+
+// find the bucket holding 'key' in 'table'
+// returns the bucket if found, NULL if not
+static Bucket *find_bucket(Xtndbl1HashTable *table, int64 key) {
+	int64 start = latency_start(&table->stats.lookups);
+
+	Bucket *found = search_bucket(table, key, h1(key));
+
+	latency_stop(&table->stats.lookups, start);
+	return found;
 }
 
 
@@ -156,20 +270,86 @@ static void split_bucket(Xtndbl1HashTable *table, int address) {
  * all functions
  */
 
-// initialise a single-key extendible hash table
-Xtndbl1HashTable *new_xtndbl1_hash_table() {
+// initialise a single-key extendible hash table, storing a value alongside
+// each key if 'values' is true
+Xtndbl1HashTable *new_xtndbl1_hash_table(bool values) {
 	Xtndbl1HashTable *table = malloc(sizeof *table);
 	assert(table);
 
 	table->size = 1;
+	table->values = values;
+	table->snapshot = NULL;
+	initialise_slabs(&table->slabs,
+		sizeof (Bucket) + (values ? sizeof (int64) : 0));
 	table->buckets = malloc(sizeof *table->buckets);
 	assert(table->buckets);
-	table->buckets[0] = new_bucket(0, 0);
+	table->buckets[0] = new_bucket(table, 0, 0);
 	table->depth = 0;
 
 	table->stats.nbuckets = 1;
 	table->stats.nkeys = 0;
-	table->stats.time = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.splits);
+
+	return table;
+}
+
+
+// initialise a single-key extendible hash table holding the 'n' keys in
+// 'keys', building its buckets and directory directly rather than splitting
+// buckets one key at a time
+Xtndbl1HashTable *new_xtndbl1_hash_table_from_keys(int64 *keys, int n) {
+	// group the keys by the rightmost bits of their hash values: each group
+	// becomes one bucket (partitioning reorders the keys, so use a copy)
+	int64 *sorted = malloc((sizeof *sorted) * (n > 0 ? n : 1));
+	int *hashes = malloc((sizeof *hashes) * (n > 0 ? n : 1));
+	assert(sorted && hashes);
+	int i;
+	for (i = 0; i < n; i++) {
+		sorted[i] = keys[i];
+		hashes[i] = h1(keys[i]);
+	}
+	int nparts, depth;
+	Partition *parts = radix_partition(sorted, hashes, n, 1, &nparts, &depth);
+	assert((1 << depth) < MAX_TABLE_SIZE
+		&& "error: table has grown too large!");
+
+	Xtndbl1HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->size = 1 << depth;
+	table->depth = depth;
+	table->values = false;
+	table->snapshot = NULL;
+	initialise_slabs(&table->slabs, sizeof (Bucket));
+	table->buckets = malloc((sizeof *table->buckets) * table->size);
+	assert(table->buckets);
+	table->stats.nbuckets = nparts;
+	table->stats.nkeys = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.splits);
+
+	// create each bucket, and point every address ending in its bits at it
+	int p, address;
+	for (p = 0; p < nparts; p++) {
+		Bucket *bucket = new_bucket(table, parts[p].prefix, parts[p].depth);
+		if (parts[p].nkeys > 0) {
+			bucket->key = sorted[parts[p].start];
+			bucket->full = true;
+			table->stats.nkeys++;
+		}
+		for (address = parts[p].prefix; address < table->size;
+			address += 1 << parts[p].depth) {
+			table->buckets[address] = bucket;
+		}
+	}
+
+	free(parts);
+	free(sorted);
+	free(hashes);
 
 	return table;
 }
@@ -179,14 +359,11 @@ Xtndbl1HashTable *new_xtndbl1_hash_table() {
 void free_xtndbl1_hash_table(Xtndbl1HashTable *table) {
 	assert(table);
 
-	// loop backwards through the array of pointers, freeing buckets only as we
-	// reach their first reference
-	// (if we loop through forwards, we wouldn't know which reference was last)
-	int i;
-	for (i = table->size-1; i >= 0; i--) {
-		if (table->buckets[i]->id == i) {
-			free(table->buckets[i]);
-		}
+	// free every bucket at once, along with the slabs they were allocated from
+	// (and the snapshot the rest of them are in)
+	free_slabs(&table->slabs);
+	if (table->snapshot) {
+		unmap_snapshot(table->snapshot);
 	}
 
 	// free the array of bucket pointers
@@ -197,38 +374,142 @@ void free_xtndbl1_hash_table(Xtndbl1HashTable *table) {
 }
 
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xtndbl1_hash_table_save(Xtndbl1HashTable *table, FILE *file) {
+	assert(table);
+
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->size,
+		table->depth, table->values, table->slabs.itemsize,
+		table->slabs.nitems, table->stats };
+	return write_section(file, &header, sizeof header)
+		&& save_slabs(&table->slabs, file)
+		&& save_directory(&table->slabs, (void **)table->buckets, table->size,
+			file);
+}
+
+
+// load a table written by xtndbl1_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+Xtndbl1HashTable *xtndbl1_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)
+		|| header->itemsize != sizeof (Bucket)
+			+ (header->values ? sizeof (int64) : 0)
+		|| header->depth < 0 || header->depth >= 31
+		|| header->size != 1 << header->depth) {
+		return NULL;
+	}
+
+	Xtndbl1HashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->size = header->size;
+	table->depth = header->depth;
+	table->values = header->values;
+	table->stats = header->stats;
+
+	// the buckets are used straight from the snapshot, so only the table of
+	// pointers to them needs to be rebuilt
+	if (!load_slabs(&table->slabs, header->itemsize, header->nitems,
+		snapshot)) {
+		free(table);
+		return NULL;
+	}
+	table->buckets = malloc((sizeof *table->buckets) * table->size);
+	assert(table->buckets);
+	if (!load_directory(&table->slabs, (void **)table->buckets, table->size,
+		snapshot)) {
+		free(table->buckets);
+		free_slabs(&table->slabs);
+		free(table);
+		return NULL;
+	}
+	table->snapshot = snapshot;
+
+	return table;
+}
+
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xtndbl1_hash_table_insert(Xtndbl1HashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // start timing
-	
-	// calculate table address
-	int hash = h1(key);
-	int address = rightmostnbits(table->depth, hash);
-	
-	// is this key already there?
-	if (table->buckets[address]->full && table->buckets[address]->key == key) {
-		table->stats.time += clock() - start_time; // add time elapsed
-		return false;
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// make room in 'table' for 'n' keys in total, by doubling the table and
+// splitting buckets up front until there is a bucket for every key. keys
+// whose hash values collide in those bits will still need more splits
+void xtndbl1_hash_table_reserve(Xtndbl1HashTable *table, int n) {
+	assert(table);
+
+	// how many hash value bits give every key a bucket of its own?
+	int depth = 0;
+	while ((1 << depth) < n) {
+		depth++;
 	}
 
-	// if not, make space in the table until our target bucket has space
-	while (table->buckets[address]->full) {
-		split_bucket(table, address);
+	// double the table until it uses that many bits
+	while (table->depth < depth) {
+		double_table(table);
+		table->stats.resizes_avoided++;
+	}
 
-		// and recalculate address because we might now need more bits
-		address = rightmostnbits(table->depth, hash);
+	// and split every bucket until it does too
+	int address;
+	for (address = 0; address < table->size; address++) {
+		while (table->buckets[address]->depth < depth) {
+			split_bucket(table, address);
+			table->stats.resizes_avoided++;
+		}
 	}
+}
 
-	// there's now space! we can insert this key
-	table->buckets[address]->key = key;
-	table->buckets[address]->full = true;
-	table->stats.nkeys++;
 
-	// add time elapsed to total CPU time before returning
-	table->stats.time += clock() - start_time;
-	return true;
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets were created
+void xtndbl1_hash_table_foreach(Xtndbl1HashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table);
+
+	// every bucket was allocated from the slabs, so walking them visits each
+	// bucket exactly once without going through the table of pointers
+	int i;
+	for (i = 0; i < table->slabs.nitems; i++) {
+		Bucket *bucket = slab_item(&table->slabs, i);
+		if (bucket->full) {
+			func(bucket->key, table->values ? bucket->value[0] : 0, ctx);
+		}
+	}
+}
+
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xtndbl1_hash_table_next(Xtndbl1HashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table);
+
+	while (cursor->block < table->slabs.nitems) {
+		Bucket *bucket = slab_item(&table->slabs, cursor->block);
+		cursor->block++;
+		if (bucket->full) {
+			*key = bucket->key;
+			if (value != NULL) {
+				*value = table->values ? bucket->value[0] : 0;
+			}
+			return true;
+		}
+	}
+	return false;
 }
 
 
@@ -236,21 +517,129 @@ bool xtndbl1_hash_table_insert(Xtndbl1HashTable *table, int64 key) {
 // returns true if found, false if not
 bool xtndbl1_hash_table_lookup(Xtndbl1HashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // start timing
+	return find_bucket(table, key) != NULL;
+}
 
-	// calculate table address for this key
-	int address = rightmostnbits(table->depth, h1(key));
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xtndbl1_hash_table_put(Xtndbl1HashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->values && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xtndbl1_hash_table_get(Xtndbl1HashTable *table, int64 key, int64 *value) {
+	assert(table);
+	assert(table->values && "error: table does not store values!");
+
+	Bucket *bucket = find_bucket(table, key);
+	if (bucket == NULL) {
+		return false;
+	}
+	*value = bucket->value[0];
+	return true;
+}
+
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xtndbl1_hash_table_update(Xtndbl1HashTable *table, int64 key,
+	int64 value) {
+	assert(table);
+	assert(table->values && "error: table does not store values!");
+
+	Bucket *bucket = find_bucket(table, key);
+	if (bucket == NULL) {
+		return false;
+	}
+	bucket->value[0] = value;
+	return true;
+}
+
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xtndbl1_hash_table_insert_batch(Xtndbl1HashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
+
+	int hashes[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+
+		// hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+		}
+
+		// then insert each key, while prefetching the directory entry two
+		// distances ahead and the bucket it points to one distance ahead
+		// (an insertion may split buckets and double the directory, so
+		// addresses are recalculated from the hash values each time)
+		for (i = 0; i < m; i++) {
+			if (i + 2*PREFETCH_DISTANCE < m) {
+				prefetch(&table->buckets[rightmostnbits(table->depth,
+					hashes[i + 2*PREFETCH_DISTANCE])]);
+			}
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch(table->buckets[rightmostnbits(table->depth,
+					hashes[i + PREFETCH_DISTANCE])]);
+			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
+		}
+	}
 	
-	// look for the key in that bucket (unless it's empty)
-	bool found = false;
-	if (table->buckets[address]->full) {
-		// found it?
-		found = table->buckets[address]->key == key;
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xtndbl1_hash_table_lookup_batch(Xtndbl1HashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+
+	int hashes[BATCH_BLOCK];
+	int start, i, m;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+
+		// hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+		}
+
+		// then probe for each key, while prefetching the directory entry two
+		// distances ahead and the bucket it points to one distance ahead
+		for (i = 0; i < m; i++) {
+			if (i + 2*PREFETCH_DISTANCE < m) {
+				prefetch(&table->buckets[rightmostnbits(table->depth,
+					hashes[i + 2*PREFETCH_DISTANCE])]);
+			}
+			if (i + PREFETCH_DISTANCE < m) {
+				prefetch(table->buckets[rightmostnbits(table->depth,
+					hashes[i + PREFETCH_DISTANCE])]);
+			}
+			results[start + i] = search_bucket(table, keys[start + i],
+				hashes[i]) != NULL;
+		}
 	}
 
-	// add time elapsed to total CPU time before returning result
-	table->stats.time += clock() - start_time;
-	return found;
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
 }
 
 
@@ -272,7 +661,10 @@ void xtndbl1_hash_table_print(Xtndbl1HashTable *table) {
 		// if this is the first address at which a bucket occurs, print it
 		if (table->buckets[i]->id == i) {
 			printf("%9d ", table->buckets[i]->id);
-			if (table->buckets[i]->full) {
+			if (table->buckets[i]->full && table->values) {
+				printf("[%llu: %llu]", table->buckets[i]->key,
+					table->buckets[i]->value[0]);
+			} else if (table->buckets[i]->full) {
 				printf("[%llu]", table->buckets[i]->key);
 			} else {
 				printf("[ ]");
@@ -297,10 +689,33 @@ void xtndbl1_hash_table_stats(Xtndbl1HashTable *table) {
 	printf("current table size: %d\n", table->size);
 	printf("    number of keys: %d\n", table->stats.nkeys);
 	printf(" number of buckets: %d\n", table->stats.nbuckets);
+	if (table->stats.resizes_avoided > 0) {
+		printf("   resizes avoided: %d\n", table->stats.resizes_avoided);
+	}
 
-	// also calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf("    CPU time spent: %.6f sec\n", seconds);
+	// print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	
+	// print how many buckets inserts have had to split
+	print_histogram("splits per insert", &table->stats.splits);
+	
+	MemoryUsage usage;
+	xtndbl1_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->stats.nkeys);
 	
 	printf("--- end stats ---\n");
 }
+
+// count the bytes 'table' is using into *usage
+void xtndbl1_hash_table_memory_usage(Xtndbl1HashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	size_t key_bytes = sizeof (int64) * (table->values ? 2 : 1);
+	usage->directory = sizeof *table
+		+ sizeof *table->buckets * table->size;
+	usage->stats = sizeof table->stats;
+	usage->buckets = slabs_bytes(&table->slabs);
+	usage->slack = slabs_unused_bytes(&table->slabs)
+		+ key_bytes * (table->slabs.nitems - table->stats.nkeys);
+}
@@ -11,27 +11,92 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "scan.h"
+#include "snapshot.h"
+#include "memory.h"
 
 typedef struct xtndbl1_table Xtndbl1HashTable;
 
-// initialise a single-key extendible hash table
-Xtndbl1HashTable *new_xtndbl1_hash_table();
+// initialise a single-key extendible hash table, storing a value alongside
+// each key if 'values' is true
+Xtndbl1HashTable *new_xtndbl1_hash_table(bool values);
+
+// initialise a single-key extendible hash table holding the 'n' keys in
+// 'keys', building its buckets and directory directly rather than splitting
+// buckets one key at a time
+Xtndbl1HashTable *new_xtndbl1_hash_table_from_keys(int64 *keys, int n);
 
 // free all memory associated with 'table'
 void free_xtndbl1_hash_table(Xtndbl1HashTable *table);
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xtndbl1_hash_table_save(Xtndbl1HashTable *table, FILE *file);
+
+// load a table written by xtndbl1_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place. the table takes over 'snapshot',
+// unmapping it when the table is freed. returns NULL (leaving 'snapshot'
+// alone) if it was written with a different snapshot layout, or is cut short
+// or corrupted
+Xtndbl1HashTable *xtndbl1_hash_table_load(Snapshot *snapshot);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xtndbl1_hash_table_insert(Xtndbl1HashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, by doubling the table and
+// splitting buckets up front until there is a bucket for every key. keys
+// whose hash values collide in those bits will still need more splits
+void xtndbl1_hash_table_reserve(Xtndbl1HashTable *table, int n);
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets were created
+void xtndbl1_hash_table_foreach(Xtndbl1HashTable *table, ScanFunc func,
+	void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xtndbl1_hash_table_next(Xtndbl1HashTable *table, Cursor *cursor,
+	int64 *key, int64 *value);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool xtndbl1_hash_table_lookup(Xtndbl1HashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xtndbl1_hash_table_insert_batch(Xtndbl1HashTable *table, int64 *keys,
+	int n, bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xtndbl1_hash_table_lookup_batch(Xtndbl1HashTable *table, int64 *keys,
+	int n, bool *results);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xtndbl1_hash_table_put(Xtndbl1HashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xtndbl1_hash_table_get(Xtndbl1HashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xtndbl1_hash_table_update(Xtndbl1HashTable *table, int64 key,
+	int64 value);
+
 // print the contents of 'table' to stdout
 void xtndbl1_hash_table_print(Xtndbl1HashTable *table);
 
 // print some statistics about 'table' to stdout
 void xtndbl1_hash_table_stats(Xtndbl1HashTable *table);
 
+// count the bytes 'table' is using into *usage
+void xtndbl1_hash_table_memory_usage(Xtndbl1HashTable *table,
+	MemoryUsage *usage);
+
 #endif
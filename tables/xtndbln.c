@@ -12,9 +12,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xtndbln.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
+#include "radix.h"
+#include "slab.h"
 
 // Macro to calculate the rightmost n bits of a number x
 #define rightmostnbits(n, x) (x) & ((1 <<(n)) - 1)
@@ -22,6 +27,14 @@
 #define FOUND true // To indicate the key can be found in the table
 #define NOT_FOUND false // To indicate the key cannot be found in the table
 
+// The version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
+// Macros to access the i-th key and value in bucket 'b' of table 't' (keys
+// are interleaved with their values, if the table stores any)
+#define KEY(t, b, i) (b)->keys[(i) * (t)->width]
+#define VALUE(t, b, i) (b)->keys[(i) * (t)->width + 1]
+
 /*********************************** STRUCT **********************************/
 // a bucket stores an array of keys
 // it also knows how many bits are shared between possible keys, and the first 
@@ -31,15 +44,19 @@ typedef struct xtndbln_bucket {
 					// in the table which points to it
 	int depth;		// how many hash value bits are being used by this bucket
 	int nkeys;		// number of keys currently contained in this bucket
-	int64 *keys;	// the keys stored in this bucket
+	int64 keys[];	// the keys stored in this bucket (each followed by its
+					// value, if the table stores values), allocated inline
 } Bucket;
 
 // helper structure to store statistics gathered
 typedef struct stats {
 	int nbuckets;	// how many distinct buckets does the table point to
 	int nkeys;		// how many keys are being stored in the table
-	int time;		// how much CPU time has been used to insert/lookup keys
-					// in this table
+	Latency inserts;	// how long inserts (and puts) have taken
+	Latency lookups;	// how long lookups (and gets and updates) have taken
+	int resizes_avoided;	// how many doublings and splits were done up
+							// front by xtndbln_hash_table_reserve
+	Histogram splits;	// how many buckets each insert had to split
 } Stats;
 
 // a hash table is an array of slots pointing to buckets holding up to 
@@ -50,16 +67,39 @@ struct xtndbln_table {
 	int size;			// how many entries in the table of pointers (2^depth)
 	int depth;			// how many bits of the hash value to use (log2(size))
 	int bucketsize;		// maximum number of keys per bucket
+	int width;			// how many int64 words each key takes up (1 or 2)
+	Slabs slabs;		// the memory every bucket (and its keys) is allocated
+						// from, in the order the buckets were created
 	Stats stats;		// collection of statistics about this hash table
+	Snapshot *snapshot;	// the snapshot some of the slabs are being used in
+						// place from, or NULL if they were all allocated
 };
 
+// the first section of a snapshot of an extendible hash table, followed by a
+// section holding the slabs (and so every bucket and its keys, exactly as
+// they are in memory) and a section holding the number of the bucket each
+// table address points to
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	int size;
+	int depth;
+	int bucketsize;
+	int width;
+	int itemsize;	// how many bytes each bucket (with its keys) takes up
+	int nitems;		// how many buckets there are in the slabs
+	Stats stats;
+} SnapshotHeader;
+
 /****************************** HELPER FUNCTIONS *****************************/
 // The new_bucket and double_extnd_table is cited from Matt Farrugia with some
 // modifications
 
-// Helper function to create a new bucket first referenced from 
+// Helper function to create a new bucket in 'table' first referenced from 
 // 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth, int bucketsize);
+static Bucket *new_bucket(XtndblNHashTable *table, int first_address,
+	int depth);
 
 // Helper function to double the table of bucket pointers, duplicating the 
 // bucket pointers in the first half into the new second half of the table
@@ -72,45 +112,131 @@ static void split_bucket(XtndblNHashTable *table, int address);
 // Helper function to reinsert a key into the hash table after splitting a
 // bucket - we can assume that there will definitely be space for this key 
 // because it was already inside the hash table previously
-static void reinsert_key(XtndblNHashTable *table, int64 key);
+static void reinsert_key(XtndblNHashTable *table, int64 *entry);
+
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XtndblNHashTable *table, int64 key, int64 value,
+	bool overwrite);
+
+// Helper function to find the entry holding 'key' in 'table', returning a
+// pointer to it (the key's value, if any, is the next word), or NULL
+static int64 *find_entry(XtndblNHashTable *table, int64 key);
+
+// Helper function to search for 'key', whose hash value is 'hash', in 'table'
+// returning a pointer to its entry as for find_entry (without timing)
+static int64 *search_entry(XtndblNHashTable *table, int64 key, int hash);
+
+// Helper function to prefetch the memory needed to probe for the key with
+// hash value 'hash', 'stage' steps ahead of the probe: 3 for the directory
+// entry, 2 for the bucket it points to, and 1 for that bucket's keys
+static void prefetch_stage(XtndblNHashTable *table, int hash, int stage);
 
 /**************************** FUNCTION DEFINITIONS ***************************/
-// initialise an extendible hash table with 'bucketsize' keys per bucket
-XtndblNHashTable *new_xtndbln_hash_table(int bucketsize) {
+// initialise an extendible hash table with 'bucketsize' keys per bucket,
+// storing a value alongside each key if 'values' is true
+XtndblNHashTable *new_xtndbln_hash_table(int bucketsize, bool values) {
 	XtndblNHashTable *table = malloc(sizeof *table);
 	assert(table);
 	
-	table->size = 1;
-	table->buckets = malloc(sizeof *table->buckets);
-	assert(table->buckets);
-	table->buckets[0] = new_bucket(0, 0, bucketsize);
-	
 	// Initialise the initial value
+	table->size = 1;
 	table->depth = 0;
 	table->bucketsize = bucketsize;
+	table->width = values ? 2 : 1;
+	table->snapshot = NULL;
+	
+	// Each bucket's keys are allocated right after it
+	initialise_slabs(&table->slabs,
+		sizeof (Bucket) + bucketsize * table->width * sizeof (int64));
+	
+	table->buckets = malloc(sizeof *table->buckets);
+	assert(table->buckets);
+	table->buckets[0] = new_bucket(table, 0, 0);
 	
 	table->stats.nbuckets = 1;
 	table->stats.nkeys = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.splits);
 
 	return table;
 }
 
 
+// initialise an extendible hash table with 'bucketsize' keys per bucket
+// holding the 'n' keys in 'keys', building its buckets and directory directly
+// rather than splitting buckets one key at a time
+XtndblNHashTable *new_xtndbln_hash_table_from_keys(int bucketsize, int64 *keys,
+	int n) {
+	// Group the keys by the rightmost bits of their hash values: each group
+	// becomes one bucket (partitioning reorders the keys, so use a copy)
+	int64 *sorted = malloc((sizeof *sorted) * (n > 0 ? n : 1));
+	int *hashes = malloc((sizeof *hashes) * (n > 0 ? n : 1));
+	assert(sorted && hashes);
+	int i;
+	for (i = 0; i < n; i++) {
+		sorted[i] = keys[i];
+		hashes[i] = h1(keys[i]);
+	}
+	int nparts, depth;
+	Partition *parts = radix_partition(sorted, hashes, n, bucketsize, &nparts,
+		&depth);
+	assert((1 << depth) < MAX_TABLE_SIZE
+		&& "error: table has grown too large!");
+	
+	XtndblNHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->size = 1 << depth;
+	table->depth = depth;
+	table->bucketsize = bucketsize;
+	table->width = 1;
+	table->snapshot = NULL;
+	initialise_slabs(&table->slabs,
+		sizeof (Bucket) + bucketsize * table->width * sizeof (int64));
+	table->buckets = malloc((sizeof *table->buckets) * table->size);
+	assert(table->buckets);
+	table->stats.nbuckets = nparts;
+	table->stats.nkeys = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.splits);
+	
+	// Create each bucket, and point every address ending in its bits at it
+	int p, address;
+	for (p = 0; p < nparts; p++) {
+		Bucket *bucket = new_bucket(table, parts[p].prefix, parts[p].depth);
+		for (i = 0; i < parts[p].nkeys; i++) {
+			KEY(table, bucket, i) = sorted[parts[p].start + i];
+		}
+		bucket->nkeys = parts[p].nkeys;
+		table->stats.nkeys += parts[p].nkeys;
+		
+		for (address = parts[p].prefix; address < table->size;
+			address += 1 << parts[p].depth) {
+			table->buckets[address] = bucket;
+		}
+	}
+	
+	free(parts);
+	free(sorted);
+	free(hashes);
+	
+	return table;
+}
+
+
 // free all memory associated with 'table'
 void free_xtndbln_hash_table(XtndblNHashTable *table) {
 	assert(table);
 
-	// Loop backwards through the array of pointers, freeing buckets only as we
-	// reach their first reference
-	// (if we loop through forwards, we wouldn't know which reference was last)
-	int i;
-	for (i = table->size-1; i >= 0; i--) {
-		if (table->buckets[i]->id == i) {
-			
-			// Free the array of keys and the bucket
-			free(table->buckets[i]->keys);
-			free(table->buckets[i]);
-		}
+	// Free every bucket (and its keys) at once, along with the slabs they 
+	// were allocated from (and the snapshot the rest of them are in)
+	free_slabs(&table->slabs);
+	if (table->snapshot) {
+		unmap_snapshot(table->snapshot);
 	}
 
 	// Free the array of bucket pointers
@@ -120,57 +246,152 @@ void free_xtndbln_hash_table(XtndblNHashTable *table) {
 	free(table);
 }
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xtndbln_hash_table_save(XtndblNHashTable *table, FILE *file) {
+	assert(table);
+	
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->size,
+		table->depth, table->bucketsize, table->width,
+		table->slabs.itemsize, table->slabs.nitems, table->stats };
+	return write_section(file, &header, sizeof header)
+		&& save_slabs(&table->slabs, file)
+		&& save_directory(&table->slabs, (void **)table->buckets, table->size,
+			file);
+}
+
+// load a table written by xtndbln_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+XtndblNHashTable *xtndbln_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)
+		|| header->bucketsize <= 0 || header->width < 1 || header->width > 2
+		|| header->itemsize != sizeof (Bucket)
+			+ (int64)header->bucketsize * header->width * sizeof (int64)
+		|| header->depth < 0 || header->depth >= 31
+		|| header->size != 1 << header->depth) {
+		return NULL;
+	}
+	
+	XtndblNHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->size = header->size;
+	table->depth = header->depth;
+	table->bucketsize = header->bucketsize;
+	table->width = header->width;
+	table->stats = header->stats;
+	
+	// The buckets (and their keys) are used straight from the snapshot, so
+	// only the table of pointers to them needs to be rebuilt
+	if (!load_slabs(&table->slabs, header->itemsize, header->nitems,
+		snapshot)) {
+		free(table);
+		return NULL;
+	}
+	table->buckets = malloc((sizeof *table->buckets) * table->size);
+	assert(table->buckets);
+	if (!load_directory(&table->slabs, (void **)table->buckets, table->size,
+		snapshot)) {
+		free(table->buckets);
+		free_slabs(&table->slabs);
+		free(table);
+		return NULL;
+	}
+	table->snapshot = snapshot;
+	
+	return table;
+}
+
 
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // Start timing
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// make room in 'table' for 'n' keys in total, by doubling the table and
+// splitting buckets up front until there is a bucket for every 'bucketsize'
+// keys. keys whose hash values crowd into the same bits will still need
+// more splits
+void xtndbln_hash_table_reserve(XtndblNHashTable *table, int n) {
+	assert(table);
 	
-	// Calculate table address
-	int hash = h1(key);
-	int address = rightmostnbits(table->depth, hash);
-	int i, no_keys = table->buckets[address]->nkeys;
+	// How many hash value bits give every 'bucketsize' keys a bucket?
+	int depth = 0;
+	while (((int64)table->bucketsize << depth) < n) {
+		depth++;
+	}
 	
+	// Double the table until it uses that many bits
+	while (table->depth < depth) {
+		double_extnd_table(table);
+		table->stats.resizes_avoided++;
+	}
 	
-	// Check whether the key have been inserted or not
-	if (table->buckets[address]->nkeys > 0) {
-		
-		table->stats.time += clock() - start_time; // Add time elapsed
-		// Iterate through the keys in this bucket
-		for (i = 0; i < no_keys; i++) {
-			
-			// The key have been inserted before
-			if (table->buckets[address]->keys[i] == key) {
-				
-				// add time elapsed to total CPU time before returning
-				table->stats.time += clock() - start_time;
-				
-				return false;	
-			}
+	// And split every bucket until it does too
+	int address;
+	for (address = 0; address < table->size; address++) {
+		while (table->buckets[address]->depth < depth) {
+			split_bucket(table, address);
+			table->stats.resizes_avoided++;
 		}
 	}
+}
+
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets were created
+void xtndbln_hash_table_foreach(XtndblNHashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table);
 	
-	// If not, try to insert the key to the table
-	while (table->buckets[address]->nkeys == table->bucketsize) {
+	// Every bucket was allocated from the slabs, so walking them visits each
+	// bucket exactly once without going through the table of pointers
+	int i, j;
+	for (i = 0; i < table->slabs.nitems; i++) {
+		Bucket *bucket = slab_item(&table->slabs, i);
+		for (j = 0; j < bucket->nkeys; j++) {
+			func(KEY(table, bucket, j),
+				table->width > 1 ? VALUE(table, bucket, j) : 0, ctx);
+		}
+	}
+}
+
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xtndbln_hash_table_next(XtndblNHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table);
+	
+	while (cursor->block < table->slabs.nitems) {
+		Bucket *bucket = slab_item(&table->slabs, cursor->block);
 		
-		split_bucket(table, address);
+		// The next key in this bucket, if it has any left
+		if (cursor->entry < bucket->nkeys) {
+			*key = KEY(table, bucket, cursor->entry);
+			if (value != NULL) {
+				*value = table->width > 1 ? 
+					VALUE(table, bucket, cursor->entry) : 0;
+			}
+			cursor->entry++;
+			return true;
+		}
 		
-		// and recalculate address because we might now need more bits
-		address = rightmostnbits(table->depth, hash);
+		// Otherwise, move on to the next bucket
+		cursor->block++;
+		cursor->entry = 0;
 	}
-	
-	no_keys = table->buckets[address]->nkeys;
-	
-	// There is now space! Just insert the key
-	table->buckets[address]->keys[no_keys] = key;
-	table->buckets[address]->nkeys++;
-	table->stats.nkeys++;
-	
-	// add time elapsed to total CPU time before returning
-	table->stats.time += clock() - start_time;
-
-	return true;
+	return false;
 }
 
 
@@ -178,31 +399,125 @@ bool xtndbln_hash_table_insert(XtndblNHashTable *table, int64 key) {
 // returns true if found, false if not
 bool xtndbln_hash_table_lookup(XtndblNHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // Start timing
+	return find_entry(table, key) != NULL;
+}
+
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xtndbln_hash_table_put(XtndblNHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xtndbln_hash_table_get(XtndblNHashTable *table, int64 key, int64 *value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
 	
-	// Calculate table address for this key
-	int address = rightmostnbits(table->depth, h1(key));
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	*value = entry[1];
+	return FOUND;
+}
+
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xtndbln_hash_table_update(XtndblNHashTable *table, int64 key,
+	int64 value) {
+	assert(table);
+	assert(table->width > 1 && "error: table does not store values!");
 	
-	// Look for the key in that bucket (unless it's empty)
-	if (table->buckets[address]->nkeys > 0) {
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	entry[1] = value;
+	return FOUND;
+}
+
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xtndbln_hash_table_insert_batch(XtndblNHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
+	
+	int hashes[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
 		
-		// Iterate through the keys in this bucket
-		int i, no_keys = table->buckets[address]->nkeys;
-		for (i = 0; i < no_keys; i++) {
-			
-			// We have found the key!!
-			if (table->buckets[address]->keys[i] == key) {
-				
-				// Add time elapsed to total CPU time before returning result
-				table->stats.time += clock() - start_time;
-				return FOUND;
+		// Hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+		}
+		
+		// Then insert each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		// (an insertion may split buckets and double the directory, so 
+		// addresses are recalculated from the hash values each time)
+		for (i = 0; i < m; i++) {
+			for (stage = 3; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes[i + stage*PREFETCH_DISTANCE],
+						stage);
+				}
 			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
 		}
 	}
 	
-	// Add time elapsed to total CPU time before returning result
-	table->stats.time += clock() - start_time;
-	return NOT_FOUND;
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xtndbln_hash_table_lookup_batch(XtndblNHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+	
+	int hashes[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first
+		for (i = 0; i < m; i++) {
+			hashes[i] = h1(keys[start + i]);
+		}
+		
+		// Then probe for each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		for (i = 0; i < m; i++) {
+			for (stage = 3; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes[i + stage*PREFETCH_DISTANCE],
+						stage);
+				}
+			}
+			results[start + i] = search_entry(table, keys[start + i],
+				hashes[i]) != NULL;
+		}
+	}
+	
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
 }
 
 
@@ -228,8 +543,11 @@ void xtndbln_hash_table_print(XtndblNHashTable *table) {
 			// print the bucket's contents
 			printf("[");
 			for(int j = 0; j < table->bucketsize; j++) {
-				if (j < table->buckets[i]->nkeys) {
-					printf(" %llu", table->buckets[i]->keys[j]);
+				if (j < table->buckets[i]->nkeys && table->width > 1) {
+					printf(" %llu: %llu", KEY(table, table->buckets[i], j),
+						VALUE(table, table->buckets[i], j));
+				} else if (j < table->buckets[i]->nkeys) {
+					printf(" %llu", KEY(table, table->buckets[i], j));
 				} else {
 					printf(" -");
 				}
@@ -255,27 +573,59 @@ void xtndbln_hash_table_stats(XtndblNHashTable *table) {
 	printf("            number of keys: %d\n", table->stats.nkeys);
 	printf("         number of buckets: %d\n", table->stats.nbuckets);
 	printf(" number of keys per bucket: %d\n", table->bucketsize);
+	if (table->stats.resizes_avoided > 0) {
+		printf("           resizes avoided: %d\n",
+			table->stats.resizes_avoided);
+	}
 	
-	// also calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf("            CPU time spent: %.6f sec\n", seconds);
+	// print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	
+	// print how many buckets inserts have had to split, and how full the
+	// buckets are now (each bucket's id is the first address pointing to it)
+	print_histogram("splits per insert", &table->stats.splits);
+	Histogram occupancy;
+	initialise_histogram(&occupancy);
+	int address;
+	for (address = 0; address < table->size; address++) {
+		if (table->buckets[address]->id == address) {
+			histogram_add(&occupancy, table->buckets[address]->nkeys);
+		}
+	}
+	print_histogram("keys per bucket", &occupancy);
+	
+	MemoryUsage usage;
+	xtndbln_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->stats.nkeys);
 	
 	printf("--- end stats ---\n");
 }
 
+// count the bytes 'table' is using into *usage
+void xtndbln_hash_table_memory_usage(XtndblNHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	size_t key_bytes = sizeof (int64) * table->width;
+	usage->directory = sizeof *table
+		+ sizeof *table->buckets * table->size;
+	usage->stats = sizeof table->stats;
+	usage->buckets = slabs_bytes(&table->slabs);
+	usage->slack = slabs_unused_bytes(&table->slabs) + key_bytes
+		* ((size_t)table->slabs.nitems * table->bucketsize
+			- table->stats.nkeys);
+}
+
 /********************************* NEW BUCKET ********************************/
-// Helper function to create a new bucket first referenced from 
+// Helper function to create a new bucket in 'table' first referenced from 
 // 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
-	Bucket *bucket = malloc(sizeof *bucket);
-	assert(bucket);
+static Bucket *new_bucket(XtndblNHashTable *table, int first_address,
+	int depth) {
+	Bucket *bucket = slab_alloc(&table->slabs);
 
 	bucket->id = first_address;
 	bucket->depth = depth;
 	
-	bucket->keys = malloc((bucketsize)* sizeof(int64));
-	assert(bucket->keys);
-	
 	bucket->nkeys = 0;
 	
 	return bucket;
@@ -285,6 +635,7 @@ static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
 // Helper function to double the table of bucket pointers, duplicating the 
 // bucket pointers in the first half into the new second half of the table
 static void double_extnd_table(XtndblNHashTable *table) {
+	int64 start = event_start();
 	int size = table->size * 2, i;
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 	
@@ -300,17 +651,21 @@ static void double_extnd_table(XtndblNHashTable *table) {
 	// finally, increase the table size and the depth we are using to hash keys
 	table->size = size;
 	table->depth++;
+	record_event(EVENT_DOUBLE, "xtndbln", start, size / 2, size, 0);
 }
 
 /******************************* REINSERT KEY ********************************/
 // Helper function to reinsert a key into the hash table after splitting a
 // bucket - we can assume that there will definitely be space for this key 
 // because it was already inside the hash table previously
-static void reinsert_key(XtndblNHashTable *table, int64 key) {
-	int address = rightmostnbits(table->depth, h1(key));
-	int no_keys = table->buckets[address]->nkeys;
-	table->buckets[address]->keys[no_keys] = key;
-	table->buckets[address]->nkeys++;
+static void reinsert_key(XtndblNHashTable *table, int64 *entry) {
+	int address = rightmostnbits(table->depth, h1(entry[0]));
+	Bucket *bucket = table->buckets[address];
+	int w;
+	for (w = 0; w < table->width; w++) {
+		bucket->keys[bucket->nkeys * table->width + w] = entry[w];
+	}
+	bucket->nkeys++;
 }
 
 /******************************** SPLIT BUCKET *******************************/
@@ -326,6 +681,7 @@ static void split_bucket(XtndblNHashTable *table, int address) {
 		// the table
 		double_extnd_table(table);
 	}
+	int64 start = event_start();
 	
 	// SECOND
 	// create a new bucket and update both buckets' depth
@@ -338,8 +694,7 @@ static void split_bucket(XtndblNHashTable *table, int address) {
 	
 	// New bucket's first address will be a 1 bit plus the old first address
 	int new_first_address = 1 << depth | first_address;
-	Bucket *newbucket = new_bucket(new_first_address, new_depth, 
-		table->bucketsize);
+	Bucket *newbucket = new_bucket(table, new_first_address, new_depth);
 	table->stats.nbuckets++;
 
 	// THIRD,
@@ -376,7 +731,118 @@ static void split_bucket(XtndblNHashTable *table, int address) {
 	int i, total_keys = bucket->nkeys;
 	bucket->nkeys = 0;
 
+	// (reinserting can't overwrite a key we haven't moved yet: the old bucket
+	// only ever refills from the front, behind the key being moved)
 	for (i = 0; i < total_keys; i++) {
-		reinsert_key(table, keys[i]);
+		reinsert_key(table, &keys[i * table->width]);
+	}
+	
+	record_event(EVENT_SPLIT, "xtndbln", start, total_keys, bucket->nkeys,
+		newbucket->nkeys);
+}
+
+/******************************** INSERT ENTRY *******************************/
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XtndblNHashTable *table, int64 key, int64 value,
+	bool overwrite) {
+	// Calculate table address
+	int hash = h1(key);
+	int address = rightmostnbits(table->depth, hash);
+	int i, no_keys = table->buckets[address]->nkeys;
+	
+	
+	// Check whether the key have been inserted or not
+	if (table->buckets[address]->nkeys > 0) {
+		
+		// Iterate through the keys in this bucket
+		for (i = 0; i < no_keys; i++) {
+			
+			// The key have been inserted before
+			if (KEY(table, table->buckets[address], i) == key) {
+				if (overwrite) {
+					VALUE(table, table->buckets[address], i) = value;
+				}
+				
+				
+				return false;	
+			}
+		}
+	}
+	
+	// If not, try to insert the key to the table
+	int splits = 0;
+	while (table->buckets[address]->nkeys == table->bucketsize) {
+		
+		split_bucket(table, address);
+		splits++;
+		
+		// and recalculate address because we might now need more bits
+		address = rightmostnbits(table->depth, hash);
+	}
+	
+	no_keys = table->buckets[address]->nkeys;
+	
+	// There is now space! Just insert the key
+	KEY(table, table->buckets[address], no_keys) = key;
+	if (table->width > 1) {
+		VALUE(table, table->buckets[address], no_keys) = value;
+	}
+	table->buckets[address]->nkeys++;
+	table->stats.nkeys++;
+	histogram_add(&table->stats.splits, splits);
+	
+	return true;
+}
+
+/********************************* FIND ENTRY ********************************/
+// Helper function to find the entry holding 'key' in 'table', returning a
+// pointer to it (the key's value, if any, is the next word), or NULL
+static int64 *find_entry(XtndblNHashTable *table, int64 key) {
+	int64 start = latency_start(&table->stats.lookups);
+	
+	int64 *entry = search_entry(table, key, h1(key));
+	
+	latency_stop(&table->stats.lookups, start);
+	return entry;
+}
+
+/******************************** SEARCH ENTRY *******************************/
+// Helper function to search for 'key', whose hash value is 'hash', in 'table'
+// returning a pointer to its entry as for find_entry (without timing)
+static int64 *search_entry(XtndblNHashTable *table, int64 key, int hash) {
+	
+	// Calculate table address for this key
+	int address = rightmostnbits(table->depth, hash);
+	
+	// Look for the key in that bucket (unless it's empty)
+	if (table->buckets[address]->nkeys > 0) {
+		
+		// Iterate through the keys in this bucket
+		int i, no_keys = table->buckets[address]->nkeys;
+		for (i = 0; i < no_keys; i++) {
+			
+			// We have found the key!!
+			if (KEY(table, table->buckets[address], i) == key) {
+				return &KEY(table, table->buckets[address], i);
+			}
+		}
+	}
+	
+	return NULL;
+}
+
+/******************************* PREFETCH STAGE ******************************/
+// Helper function to prefetch the memory needed to probe for the key with
+// hash value 'hash', 'stage' steps ahead of the probe: 3 for the directory
+// entry, 2 for the bucket it points to, and 1 for that bucket's keys
+static void prefetch_stage(XtndblNHashTable *table, int hash, int stage) {
+	int address = rightmostnbits(table->depth, hash);
+	if (stage == 3) {
+		prefetch(&table->buckets[address]);
+	} else if (stage == 2) {
+		prefetch(table->buckets[address]);
+	} else {
+		prefetch(table->buckets[address]->keys);
 	}
 }
@@ -14,9 +14,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
-#include <time.h>
 
 #include "xuckoo.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
+#include "slab.h"
 
 // macro to calculate the rightmost n bits of a number x
 #define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
@@ -24,22 +28,31 @@
 #define FOUND true // To indicate the key can be found in the table
 #define NOT_FOUND false // To indicate the key cannot be found in the table
 
+// The version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
 /*********************************** STRUCT **********************************/
 // a bucket stores a single key (full=true) or is empty (full=false)
 // it also knows how many bits are shared between possible keys, and the first 
 // table address that references it
+// if the table stores values, the key's value is allocated inline right after
+// it; otherwise the bucket has no space for a value at all
 typedef struct bucket {
 	int id;		// a unique id for this bucket, equal to the first address
 				// in the table which points to it
 	int depth;	// how many hash value bits are being used by this bucket
 	bool full;	// does this bucket contain a key
 	int64 key;	// the key stored in this bucket
+	int64 value[];	// the key's value (only present if the table has values)
 } Bucket;
 
 // helper structure to store statistics gathered
 typedef struct stats {
-	int time;		// how much CPU time has been used to insert/lookup keys
-					// in this table
+	Latency inserts;	// how long inserts (and puts) have taken
+	Latency lookups;	// how long lookups (and gets and updates) have taken
+	int resizes_avoided;	// how many doublings and splits were done up
+							// front by xuckoo_hash_table_reserve
+	Histogram kicks;	// how many keys each insert kicked out of their buckets
 } Stats;
 
 // an inner table is an extendible hash table with an array of slots pointing 
@@ -50,6 +63,9 @@ typedef struct inner_table {
 	int size;			// how many entries in the table of pointers (2^depth)
 	int depth;			// how many bits of the hash value to use (log2(size))
 	int nkeys;			// how many keys are being stored in the table
+	bool values;		// does this table store a value alongside each key?
+	Slabs slabs;		// the memory every bucket is allocated from, in the
+						// order the buckets were created
 } InnerTable;
 
 // a xuckoo hash table is just two inner tables for storing inserted keys
@@ -57,44 +73,126 @@ struct xuckoo_table {
 	InnerTable *table1;
 	InnerTable *table2;
 	Stats stats;		// collection of statistics about this hash table
+	Snapshot *snapshot;	// the snapshot some of the slabs are being used in
+						// place from, or NULL if they were all allocated
 };
 
+// the first section of a snapshot of a xuckoo hash table, followed by the
+// sections for the first and then the second inner table
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	Stats stats;
+} SnapshotHeader;
+
+// the first section of an inner table in a snapshot, followed by a section
+// holding its slabs (and so every bucket, exactly as it is in memory) and a
+// section holding the number of the bucket each table address points to
+typedef struct inner_header {
+	int size;
+	int depth;
+	int nkeys;
+	bool values;
+	int itemsize;	// how many bytes each bucket takes up
+	int nitems;		// how many buckets there are in the slabs
+} InnerHeader;
+
 /****************************** HELPER FUNCTIONS *****************************/
 // Helper function to initialise the InnerTable
-static InnerTable *initialise_inner_table(InnerTable *innertable);
+static InnerTable *initialise_inner_table(InnerTable *innertable, bool values);
 
-// Helper functions to create a new bucket first referenced from 
-// 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth);
+// Helper functions to create a new bucket in 'innertable' first referenced 
+// from 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(InnerTable *innertable, int first_address,
+	int depth);
 
 // Helper function to free the memory of the InnerTable
 void free_xuckoo_innertable(InnerTable *innertable);
 
+// Helper function to write the InnerTable to 'file' as snapshot sections,
+// returning false if they couldn't all be written
+static bool save_innertable(InnerTable *innertable, FILE *file);
+
+// Helper function to load an InnerTable written by save_innertable from the
+// next sections of 'snapshot', using its buckets in place (or NULL if they
+// are cut short or corrupted)
+static InnerTable *load_innertable(Snapshot *snapshot);
+
+// Helper function to add the bytes the InnerTable is using to *usage
+static void add_inner_memory_usage(InnerTable *innertable,
+	MemoryUsage *usage);
+
 // Helper function to double the table of bucket pointers, duplicating the
 // bucket pointers in the first half into the new second half of the table
 static void double_table(InnerTable *innertable);
 
 // Helper function to reinsert a key into the hash table after splitting
 // a bucket
-static void reinsert_key(InnerTable *innertable, int64 key, int table_no);
+static void reinsert_key(InnerTable *innertable, int64 key, int64 value,
+	int table_no);
 
 // Helper function to split the bucket in 'table' at address 'address',
 // growing table if necessary
 static void split_bucket(InnerTable *innertable, int address, int table_no);
 
+// Helper function to double the InnerTable and split its buckets until there
+// is a bucket for every one of its 'n' keys, returning how many doublings
+// and splits that took
+static int reserve_innertable(InnerTable *innertable, int n, int table_no);
+
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XuckooHashTable *table, int64 key, int64 value,
+	bool overwrite);
+
+// Helper function to find the bucket holding 'key' in 'table', or NULL
+static Bucket *find_bucket(XuckooHashTable *table, int64 key);
+
+// Helper function to search for 'key', whose hash values are 'hash_1' and
+// 'hash_2', in 'table', returning its bucket or NULL (without timing)
+static Bucket *search_bucket(XuckooHashTable *table, int64 key, int hash_1,
+	int hash_2);
+
+// Helper function to prefetch the memory needed to probe for the key with
+// hash values 'hash_1' and 'hash_2', 'stage' steps ahead of the probe: 2 for
+// the directory entries, and 1 for the buckets they point to
+static void prefetch_stage(XuckooHashTable *table, int hash_1, int hash_2,
+	int stage);
+
 /**************************** FUNCTION DEFINITIONS ***************************/
-// initialise an extendible cuckoo hash table
-XuckooHashTable *new_xuckoo_hash_table() {
+// initialise an extendible cuckoo hash table, storing a value alongside
+// each key if 'values' is true
+XuckooHashTable *new_xuckoo_hash_table(bool values) {
 	XuckooHashTable *table = malloc(sizeof *table);
 	assert(table);
 	
 	// Allocate memory for the first table
-	table->table1 = initialise_inner_table(table->table1);
+	table->table1 = initialise_inner_table(table->table1, values);
 	
 	// Allocate memory for the second table
-	table->table2 = initialise_inner_table(table->table2);
+	table->table2 = initialise_inner_table(table->table2, values);
+	
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.kicks);
+	table->snapshot = NULL;
 	
-	table->stats.time = 0;
+	return table;
+}
+
+// initialise an extendible cuckoo hash table holding the 'n' keys in 'keys'
+XuckooHashTable *new_xuckoo_hash_table_from_keys(int64 *keys, int n) {
+	XuckooHashTable *table = new_xuckoo_hash_table(false);
+	
+	// Which inner table each key ends up in depends on the keys inserted
+	// before it, so there is no way to place them all at once: insert them
+	// one at a time (skipping the wrapper functions)
+	int i;
+	for (i = 0; i < n; i++) {
+		insert_entry(table, keys[i], 0, false);
+	}
 	
 	return table;
 }
@@ -114,151 +212,263 @@ void free_xuckoo_hash_table(XuckooHashTable *table) {
 	free(table->table1->buckets);
 	free(table->table2->buckets);
 	
+	// Free the inner table structs themselves
+	free(table->table1);
+	free(table->table2);
+	
+	// Free the snapshot the rest of the buckets are in
+	if (table->snapshot) {
+		unmap_snapshot(table->snapshot);
+	}
+	
 	// Free the table struct itself
 	free(table);
 }
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xuckoo_hash_table_save(XuckooHashTable *table, FILE *file) {
+	assert(table);
+	
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->stats };
+	return write_section(file, &header, sizeof header)
+		&& save_innertable(table->table1, file)
+		&& save_innertable(table->table2, file);
+}
+
+// load a table written by xuckoo_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+XuckooHashTable *xuckoo_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)) {
+		return NULL;
+	}
+	
+	XuckooHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->stats = header->stats;
+	table->table1 = load_innertable(snapshot);
+	table->table2 = table->table1 ? load_innertable(snapshot) : NULL;
+	if (table->table2 == NULL) {
+		if (table->table1) {
+			free_xuckoo_innertable(table->table1);
+			free(table->table1->buckets);
+			free(table->table1);
+		}
+		free(table);
+		return NULL;
+	}
+	table->snapshot = snapshot;
+	
+	return table;
+}
+
 
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock();
-	
-	int total_kicked_keys = 0, hash;
-	int64 kick_key;
-	InnerTable *innertable = table->table1;
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
 
-	// Calculate table address
-	int hash_1 = h1(key), hash_2 = h2(key);
-	int address_1 = rightmostnbits(table->table1->depth, hash_1);
-	int address_2 = rightmostnbits(table->table2->depth, hash_2);
-	int address = address_1;
-	
-	// Check the key in table 1
-	if (table->table1->buckets[address_1]->full && 
-		table->table1->buckets[address_1]->key == key) {
-		table->stats.time += clock() - start_time; // Add time elapsed
-		return false;
-	}
-		
-	// Check the key in table 2
-	if (table->table2->buckets[address_2]->full && 
-		table->table2->buckets[address_2]->key == key) {
-		table->stats.time += clock() - start_time; // Add time elapsed
-		return false;
-	}
+
+// make room in 'table' for 'n' keys in total, by doubling each inner table
+// and splitting its buckets up front until there is a bucket for every
+// key in each table's half of the keys. keys whose hash values crowd into the
+// same bits will still need more splits
+void xuckoo_hash_table_reserve(XuckooHashTable *table, int n) {
+	assert(table);
 	
-	// Check which table that has the least keys
-	int insert_table = 1;
-	if (table->table1->nkeys > table->table2->nkeys) {
-		insert_table = 2;
-	}
+	// Expect the keys to be shared evenly between the two tables
+	table->stats.resizes_avoided += reserve_innertable(table->table1,
+		(n + 1) / 2, 1);
+	table->stats.resizes_avoided += reserve_innertable(table->table2,
+		(n + 1) / 2, 2);
+}
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets of the first and then
+// the second table were created
+void xuckoo_hash_table_foreach(XuckooHashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table);
 	
-	// Try to find an empty slot and check if there is a cycle
-	while (innertable->buckets[address]->full && 
-		total_kicked_keys != 2*(table->table1->size)) {
-		kick_key = innertable->buckets[address]->key;
-		total_kicked_keys++;
-		
-		innertable->buckets[address]->key = key;
-		key = kick_key;
-		
-		// If it kicked the key from the Table 1, need to insert the kicked 
-		// key to the Table 2 
-		if (insert_table == 1) {
-			
-			// Mark the next table that will be visited is table 2
-			insert_table = 2;
-				
-			// Update the temp_table and the hash
-			innertable = table->table2;
-			address = rightmostnbits(innertable->depth, h2(key));
+	// Every bucket was allocated from its table's slabs, so walking them 
+	// visits each bucket exactly once without going through the pointers
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	int t, i;
+	for (t = 0; t < 2; t++) {
+		for (i = 0; i < innertables[t]->slabs.nitems; i++) {
+			Bucket *bucket = slab_item(&innertables[t]->slabs, i);
+			if (bucket->full) {
+				func(bucket->key,
+					innertables[t]->values ? bucket->value[0] : 0, ctx);
+			}
 		}
-		
-		// If it kicked the key from the Table 2, need to insert the kicked 
-		// key to the Table 1
-		else if (insert_table == 2) {
-			
-			// Mark the next table that will be visited is table 2
-			insert_table = 1;
-				
-			// Update the temp_table and the hash
-			innertable = table->table1;
-			address = rightmostnbits(innertable->depth, h1(key));
-		}	
 	}
+}
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xuckoo_hash_table_next(XuckooHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table);
 	
-	// The number of kicked key is equal to the 2 times the table size,
-	// indicates that there is a cycling, so we need to grow the table
-	if (total_kicked_keys == 2*(table->table1->size)) {
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	while (cursor->part < 2) {
+		InnerTable *innertable = innertables[cursor->part];
 		
-		// Make space on the smallest size table to have space to 
-		// insert the key
-		while (innertable->buckets[address]->full) {
-			
-			// If the first table has size smaller than or equal to the second
-			// table's size, choose the first table
-			if (table->table1->size <= table->table2->size) {
-				innertable = table->table1;
-				hash = h1(key);
-				address = rightmostnbits(innertable->depth, hash);
-				insert_table = 1;
-			}
-			
-			// Otherwise, choose the second table
-			else {
-				innertable = table->table2;
-				hash = h2(key);
-				address = rightmostnbits(innertable->depth, hash);
-				insert_table = 2;
+		// The next full bucket in this table, if it has any left
+		while (cursor->block < innertable->slabs.nitems) {
+			Bucket *bucket = slab_item(&innertable->slabs, cursor->block);
+			cursor->block++;
+			if (bucket->full) {
+				*key = bucket->key;
+				if (value != NULL) {
+					*value = innertable->values ? bucket->value[0] : 0;
+				}
+				return true;
 			}
-			
-			split_bucket(innertable, address, insert_table);
-			
-			// and recalculate address because we might now need more bits
-			address = rightmostnbits(innertable->depth, hash);
 		}
+		
+		// Otherwise, move on to the next table
+		cursor->part++;
+		cursor->block = 0;
 	}
-	
-	// There is now space for the key, so we can just insert it
-	innertable->buckets[address]->key = key;
-	innertable->buckets[address]->full = true;
-	innertable->nkeys++;
-	
-	table->stats.time += clock() - start_time; // Add time elapsed
-	return true;
-	
+	return false;
 }
 
-
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool xuckoo_hash_table_lookup(XuckooHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // Start timing
+	return find_bucket(table, key) != NULL;
+}
+
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xuckoo_hash_table_put(XuckooHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->table1->values && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xuckoo_hash_table_get(XuckooHashTable *table, int64 key, int64 *value) {
+	assert(table);
+	assert(table->table1->values && "error: table does not store values!");
 	
-	// Calculate the address on the first and second table for this key
-	int address_table1 = rightmostnbits(table->table1->depth, h1(key));
-	int address_table2 = rightmostnbits(table->table2->depth, h2(key));
+	Bucket *bucket = find_bucket(table, key);
+	if (bucket == NULL) {
+		return NOT_FOUND;
+	}
+	*value = bucket->value[0];
+	return FOUND;
+}
+
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xuckoo_hash_table_update(XuckooHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->table1->values && "error: table does not store values!");
 	
-	// Look for the key in that bucket (unless it's empty)
+	Bucket *bucket = find_bucket(table, key);
+	if (bucket == NULL) {
+		return NOT_FOUND;
+	}
+	bucket->value[0] = value;
+	return FOUND;
+}
 
-	// Check the key at the first table
-	if (table->table1->buckets[address_table1]->full &&
-		table->table1->buckets[address_table1]->key == key) {
-		table->stats.time += clock() - start_time; // Add time elapsed
-		return FOUND;
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xuckoo_hash_table_insert_batch(XuckooHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
+	
+	int hashes1[BATCH_BLOCK], hashes2[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first, for both inner tables
+		for (i = 0; i < m; i++) {
+			hashes1[i] = h1(keys[start + i]);
+			hashes2[i] = h2(keys[start + i]);
+		}
+		
+		// Then insert each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		// (an insertion may split buckets and double the directories, so 
+		// addresses are recalculated from the hash values each time)
+		for (i = 0; i < m; i++) {
+			for (stage = 2; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes1[i + stage*PREFETCH_DISTANCE],
+						hashes2[i + stage*PREFETCH_DISTANCE], stage);
+				}
+			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
+		}
 	}
 	
-	// Check the key at the second table
-	if (table->table2->buckets[address_table2]->full &&
-		table->table2->buckets[address_table2]->key == key) {
-		table->stats.time += clock() - start_time; // Add time elapsed
-		return FOUND;
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xuckoo_hash_table_lookup_batch(XuckooHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+	
+	int hashes1[BATCH_BLOCK], hashes2[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first, for both inner tables
+		for (i = 0; i < m; i++) {
+			hashes1[i] = h1(keys[start + i]);
+			hashes2[i] = h2(keys[start + i]);
+		}
+		
+		// Then probe for each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		for (i = 0; i < m; i++) {
+			for (stage = 2; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes1[i + stage*PREFETCH_DISTANCE],
+						hashes2[i + stage*PREFETCH_DISTANCE], stage);
+				}
+			}
+			results[start + i] = search_bucket(table, keys[start + i],
+				hashes1[i], hashes2[i]) != NULL;
+		}
 	}
 	
-	return NOT_FOUND;
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
 }
 
 
@@ -287,7 +497,11 @@ void xuckoo_hash_table_print(XuckooHashTable *table) {
 			// if this is the first address at which a bucket occurs, print it
 			if (innertables[t]->buckets[i]->id == i) {
 				printf("%9d ", innertables[t]->buckets[i]->id);
-				if (innertables[t]->buckets[i]->full) {
+				if (innertables[t]->buckets[i]->full &&
+					innertables[t]->values) {
+					printf("[%llu: %llu]", innertables[t]->buckets[i]->key,
+						innertables[t]->buckets[i]->value[0]);
+				} else if (innertables[t]->buckets[i]->full) {
 					printf("[%llu]", innertables[t]->buckets[i]->key);
 				} else {
 					printf("[ ]");
@@ -320,36 +534,60 @@ void xuckoo_hash_table_stats(XuckooHashTable *table) {
 	printf("                    load factor: %.3f%%\n\n", 
 		table->table2->nkeys * 100.0 / table->table2->size);
 	
-	// Calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf("    CPU time spent: %.6f sec\n", seconds);
+	// print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	if (table->stats.resizes_avoided > 0) {
+		printf("   resizes avoided: %d\n", table->stats.resizes_avoided);
+	}
+	
+	// Print how many keys inserts have had to kick out of their buckets
+	print_histogram("kicks per insert", &table->stats.kicks);
+	
+	MemoryUsage usage;
+	xuckoo_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->table1->nkeys + table->table2->nkeys);
 	
 	printf("--- end stats ---\n");
 }
 
+// count the bytes 'table' is using into *usage
+void xuckoo_hash_table_memory_usage(XuckooHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	usage->directory = sizeof *table;
+	usage->stats = sizeof table->stats;
+	usage->buckets = usage->slack = 0;
+	add_inner_memory_usage(table->table1, usage);
+	add_inner_memory_usage(table->table2, usage);
+}
+
 /************************** INITIALISE INNER TABLE ***************************/
 // Helper function to initialise the InnerTable
-static InnerTable *initialise_inner_table(InnerTable *innertable) {
+static InnerTable *initialise_inner_table(InnerTable *innertable, bool values) {
 	innertable = malloc(sizeof (InnerTable));
 	assert(innertable);
 	
 	innertable->size = 1;
+	initialise_slabs(&innertable->slabs,
+		sizeof (Bucket) + (values ? sizeof (int64) : 0));
 	innertable->buckets = malloc(sizeof *innertable->buckets);
 	assert(innertable->buckets);
-	innertable->buckets[0] = new_bucket(0, 0);
+	innertable->buckets[0] = new_bucket(innertable, 0, 0);
 	innertable->depth = 0;
 	innertable->nkeys = 0;
+	innertable->values = values;
 	
 	return innertable;
 	
 }
 
 /******************************** NEW BUCKET *********************************/
-// Helper functions to create a new bucket first referenced from 
-// 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth) {
-	Bucket *bucket = malloc(sizeof *bucket);
-	assert(bucket);
+// Helper functions to create a new bucket in 'innertable' first referenced 
+// from 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(InnerTable *innertable, int first_address,
+	int depth) {
+	Bucket *bucket = slab_alloc(&innertable->slabs);
 	
 	bucket->id = first_address;
 	bucket->depth = depth;
@@ -362,24 +600,81 @@ static Bucket *new_bucket(int first_address, int depth) {
 /************************** FREE XUCKOO INNERTABLE ***************************/
 // Helper function to free the memory of the InnerTable
 void free_xuckoo_innertable(InnerTable *innertable) {
-	int i;
 	
-	// Looping backwards through the array of pointers, freeing buckets only 
-	// as we reach their first reference
-	// (If we loop through forwards, we would not know which reference was
-	// last)
+	// Free every bucket at once, along with the slabs they were allocated
+	// from
+	free_slabs(&innertable->slabs);
+}
+ 
+/****************************** SAVE INNER TABLE *****************************/
+// Helper function to write the InnerTable to 'file' as snapshot sections,
+// returning false if they couldn't all be written
+static bool save_innertable(InnerTable *innertable, FILE *file) {
+	InnerHeader header = { innertable->size, innertable->depth,
+		innertable->nkeys, innertable->values, innertable->slabs.itemsize,
+		innertable->slabs.nitems };
+	return write_section(file, &header, sizeof header)
+		&& save_slabs(&innertable->slabs, file)
+		&& save_directory(&innertable->slabs, (void **)innertable->buckets,
+			innertable->size, file);
+}
+
+/****************************** LOAD INNER TABLE *****************************/
+// Helper function to load an InnerTable written by save_innertable from the
+// next sections of 'snapshot', using its buckets in place (or NULL if they
+// are cut short or corrupted)
+static InnerTable *load_innertable(Snapshot *snapshot) {
+	InnerHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->itemsize != sizeof (Bucket)
+			+ (header->values ? sizeof (int64) : 0)
+		|| header->depth < 0 || header->depth >= 31
+		|| header->size != 1 << header->depth) {
+		return NULL;
+	}
 	
-	for (i = innertable->size - 1; i >= 0; i--) {
-		if (innertable->buckets[i]->id == i) {
-			free(innertable->buckets[i]);
-		}
+	InnerTable *innertable = malloc(sizeof (InnerTable));
+	assert(innertable);
+	innertable->size = header->size;
+	innertable->depth = header->depth;
+	innertable->nkeys = header->nkeys;
+	innertable->values = header->values;
+	
+	// Only the table of pointers to the buckets needs to be rebuilt
+	if (!load_slabs(&innertable->slabs, header->itemsize, header->nitems,
+		snapshot)) {
+		free(innertable);
+		return NULL;
 	}
+	innertable->buckets = malloc((sizeof *innertable->buckets)
+		* innertable->size);
+	assert(innertable->buckets);
+	if (!load_directory(&innertable->slabs, (void **)innertable->buckets,
+		innertable->size, snapshot)) {
+		free_xuckoo_innertable(innertable);
+		free(innertable->buckets);
+		free(innertable);
+		return NULL;
+	}
+	
+	return innertable;
 }
- 
+
+// Helper function to add the bytes the InnerTable is using to *usage
+static void add_inner_memory_usage(InnerTable *innertable,
+	MemoryUsage *usage) {
+	usage->directory += sizeof *innertable
+		+ sizeof *innertable->buckets * innertable->size;
+	usage->buckets += slabs_bytes(&innertable->slabs);
+	usage->slack += slabs_unused_bytes(&innertable->slabs)
+		+ sizeof (int64) * (innertable->values ? 2 : 1)
+		* (innertable->slabs.nitems - innertable->nkeys);
+}
+
 /******************************* DOUBLE TABLE ********************************/
 // Helper function to double the table of bucket pointers, duplicating the
 // bucket pointers in the first half into the new second half of the table
 static void double_table(InnerTable *innertable) {
+	int64 start = event_start();
 	int size = innertable->size*2;
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 	
@@ -398,13 +693,14 @@ static void double_table(InnerTable *innertable) {
 	// keys
 	innertable->size = size;
 	innertable->depth++;
-	
+	record_event(EVENT_DOUBLE, "xuckoo", start, size / 2, size, 0);
 }
 
 /******************************* REINSERT KEY ********************************/
 // Helper function to reinsert a key into the specified hash table after 
 // splitting a bucket
-static void reinsert_key(InnerTable *innertable, int64 key, int table_no) {
+static void reinsert_key(InnerTable *innertable, int64 key, int64 value,
+	int table_no) {
 	int address, hash = h1(key);
 
 	if (table_no == 2) {
@@ -413,6 +709,9 @@ static void reinsert_key(InnerTable *innertable, int64 key, int table_no) {
 	
 	address = rightmostnbits(innertable->depth, hash);
 	innertable->buckets[address]->key = key;
+	if (innertable->values) {
+		innertable->buckets[address]->value[0] = value;
+	}
 	innertable->buckets[address]->full = true;
 }
 
@@ -428,6 +727,7 @@ static void split_bucket(InnerTable *innertable, int address, int table_no) {
 		double_table(innertable);
 	}
 	// either way, now it's time to split this bucket
+	int64 start = event_start();
 
 
 	// SECOND,
@@ -441,7 +741,7 @@ static void split_bucket(InnerTable *innertable, int address, int table_no) {
 
 	// new bucket's first address will be a 1 bit plus the old first address
 	int new_first_address = 1 << depth | first_address;
-	Bucket *newbucket = new_bucket(new_first_address, new_depth);
+	Bucket *newbucket = new_bucket(innertable, new_first_address, new_depth);
 	
 	// THIRD,
 	// redirect every second address pointing to this bucket to the new bucket
@@ -471,8 +771,230 @@ static void split_bucket(InnerTable *innertable, int address, int table_no) {
 	// filter the key from the old bucket into its rightful place in the new 
 	// table (which may be the old bucket, or may be the new bucket)
 
-	// remove and reinsert the key
-	int64 key = bucket->key;
-	bucket->full = false;
-	reinsert_key(innertable, key, table_no);
+	// remove and reinsert the key (if there is one: buckets can be split
+	// while still empty when reserving space)
+	if (bucket->full) {
+		int64 key = bucket->key;
+		int64 value = innertable->values ? bucket->value[0] : 0;
+		bucket->full = false;
+		reinsert_key(innertable, key, value, table_no);
+	}
+	
+	// (between them, the two buckets now hold what the old bucket held)
+	record_event(EVENT_SPLIT, "xuckoo", start, bucket->full + newbucket->full,
+		bucket->full, newbucket->full);
+}
+
+/***************************** RESERVE INNERTABLE ****************************/
+// Helper function to double the InnerTable and split its buckets until there
+// is a bucket for every one of its 'n' keys, returning how many doublings
+// and splits that took
+static int reserve_innertable(InnerTable *innertable, int n, int table_no) {
+	int depth = 0, resizes = 0;
+	
+	// How many hash value bits give every key a bucket of its own?
+	while (((int64)1 << depth) < n) {
+		depth++;
+	}
+	
+	// Double the table until it uses that many bits
+	while (innertable->depth < depth) {
+		double_table(innertable);
+		resizes++;
+	}
+	
+	// And split every bucket until it does too
+	int address;
+	for (address = 0; address < innertable->size; address++) {
+		while (innertable->buckets[address]->depth < depth) {
+			split_bucket(innertable, address, table_no);
+			resizes++;
+		}
+	}
+	
+	return resizes;
+}
+
+/******************************* INSERT ENTRY ********************************/
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XuckooHashTable *table, int64 key, int64 value,
+	bool overwrite) {
+	int total_kicked_keys = 0, hash;
+	int64 kick_key, kick_value;
+	InnerTable *innertable = table->table1;
+	bool values = table->table1->values;
+
+	// Calculate table address
+	int hash_1 = h1(key), hash_2 = h2(key);
+	int address_1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_2 = rightmostnbits(table->table2->depth, hash_2);
+	int address = address_1;
+	
+	// Check the key in table 1
+	if (table->table1->buckets[address_1]->full && 
+		table->table1->buckets[address_1]->key == key) {
+		if (overwrite) {
+			table->table1->buckets[address_1]->value[0] = value;
+		}
+		return false;
+	}
+		
+	// Check the key in table 2
+	if (table->table2->buckets[address_2]->full && 
+		table->table2->buckets[address_2]->key == key) {
+		if (overwrite) {
+			table->table2->buckets[address_2]->value[0] = value;
+		}
+		return false;
+	}
+	
+	// Check which table that has the least keys
+	int insert_table = 1;
+	if (table->table1->nkeys > table->table2->nkeys) {
+		insert_table = 2;
+	}
+	
+	// Try to find an empty slot and check if there is a cycle
+	while (innertable->buckets[address]->full && 
+		total_kicked_keys != 2*(table->table1->size)) {
+		kick_key = innertable->buckets[address]->key;
+		total_kicked_keys++;
+		
+		// The kicked key's value (if any) travels along with it
+		innertable->buckets[address]->key = key;
+		key = kick_key;
+		if (values) {
+			kick_value = innertable->buckets[address]->value[0];
+			innertable->buckets[address]->value[0] = value;
+			value = kick_value;
+		}
+		
+		// If it kicked the key from the Table 1, need to insert the kicked 
+		// key to the Table 2 
+		if (insert_table == 1) {
+			
+			// Mark the next table that will be visited is table 2
+			insert_table = 2;
+				
+			// Update the temp_table and the hash
+			innertable = table->table2;
+			address = rightmostnbits(innertable->depth, h2(key));
+		}
+		
+		// If it kicked the key from the Table 2, need to insert the kicked 
+		// key to the Table 1
+		else if (insert_table == 2) {
+			
+			// Mark the next table that will be visited is table 2
+			insert_table = 1;
+				
+			// Update the temp_table and the hash
+			innertable = table->table1;
+			address = rightmostnbits(innertable->depth, h1(key));
+		}	
+	}
+	
+	// The number of kicked key is equal to the 2 times the table size,
+	// indicates that there is a cycling, so we need to grow the table
+	if (total_kicked_keys == 2*(table->table1->size)) {
+		int64 start = event_start();
+		int oldsize = table->table1->size + table->table2->size;
+		
+		// Make space on the smallest size table to have space to 
+		// insert the key
+		while (innertable->buckets[address]->full) {
+			
+			// If the first table has size smaller than or equal to the second
+			// table's size, choose the first table
+			if (table->table1->size <= table->table2->size) {
+				innertable = table->table1;
+				hash = h1(key);
+				address = rightmostnbits(innertable->depth, hash);
+				insert_table = 1;
+			}
+			
+			// Otherwise, choose the second table
+			else {
+				innertable = table->table2;
+				hash = h2(key);
+				address = rightmostnbits(innertable->depth, hash);
+				insert_table = 2;
+			}
+			
+			split_bucket(innertable, address, insert_table);
+			
+			// and recalculate address because we might now need more bits
+			address = rightmostnbits(innertable->depth, hash);
+		}
+		record_event(EVENT_CYCLE, "xuckoo", start, oldsize,
+			table->table1->size + table->table2->size, total_kicked_keys);
+	}
+	
+	// There is now space for the key, so we can just insert it
+	innertable->buckets[address]->key = key;
+	if (values) {
+		innertable->buckets[address]->value[0] = value;
+	}
+	innertable->buckets[address]->full = true;
+	innertable->nkeys++;
+	histogram_add(&table->stats.kicks, total_kicked_keys);
+	
+	return true;
+	
+}
+
+/******************************** FIND BUCKET ********************************/
+// Helper function to find the bucket holding 'key' in 'table', or NULL
+static Bucket *find_bucket(XuckooHashTable *table, int64 key) {
+	int64 start = latency_start(&table->stats.lookups);
+	
+	Bucket *found = search_bucket(table, key, h1(key), h2(key));
+	
+	latency_stop(&table->stats.lookups, start);
+	return found;
+}
+
+/******************************* SEARCH BUCKET *******************************/
+// Helper function to search for 'key', whose hash values are 'hash_1' and
+// 'hash_2', in 'table', returning its bucket or NULL (without timing)
+static Bucket *search_bucket(XuckooHashTable *table, int64 key, int hash_1,
+	int hash_2) {
+	
+	// Calculate the address on the first and second table for this key
+	int address_table1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_table2 = rightmostnbits(table->table2->depth, hash_2);
+	
+	// Look for the key in that bucket (unless it's empty)
+
+	// Check the key at the first table
+	if (table->table1->buckets[address_table1]->full &&
+		table->table1->buckets[address_table1]->key == key) {
+		return table->table1->buckets[address_table1];
+	}
+	
+	// Check the key at the second table
+	if (table->table2->buckets[address_table2]->full &&
+		table->table2->buckets[address_table2]->key == key) {
+		return table->table2->buckets[address_table2];
+	}
+	
+	return NULL;
+}
+
+/****************************** PREFETCH STAGE *******************************/
+// Helper function to prefetch the memory needed to probe for the key with
+// hash values 'hash_1' and 'hash_2', 'stage' steps ahead of the probe: 2 for
+// the directory entries, and 1 for the buckets they point to
+static void prefetch_stage(XuckooHashTable *table, int hash_1, int hash_2,
+	int stage) {
+	int address_table1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_table2 = rightmostnbits(table->table2->depth, hash_2);
+	if (stage == 2) {
+		prefetch(&table->table1->buckets[address_table1]);
+		prefetch(&table->table2->buckets[address_table2]);
+	} else {
+		prefetch(table->table1->buckets[address_table1]);
+		prefetch(table->table2->buckets[address_table2]);
+	}
 }
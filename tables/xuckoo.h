@@ -13,27 +13,91 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "scan.h"
+#include "snapshot.h"
+#include "memory.h"
 
 typedef struct xuckoo_table XuckooHashTable;
 
-// initialise an extendible cuckoo hash table
-XuckooHashTable *new_xuckoo_hash_table();
+// initialise an extendible cuckoo hash table, storing a value alongside
+// each key if 'values' is true
+XuckooHashTable *new_xuckoo_hash_table(bool values);
+
+// initialise an extendible cuckoo hash table holding the 'n' keys in 'keys'
+XuckooHashTable *new_xuckoo_hash_table_from_keys(int64 *keys, int n);
 
 // free all memory associated with 'table'
 void free_xuckoo_hash_table(XuckooHashTable *table);
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xuckoo_hash_table_save(XuckooHashTable *table, FILE *file);
+
+// load a table written by xuckoo_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place. the table takes over 'snapshot',
+// unmapping it when the table is freed. returns NULL (leaving 'snapshot'
+// alone) if it was written with a different snapshot layout, or is cut short
+// or corrupted
+XuckooHashTable *xuckoo_hash_table_load(Snapshot *snapshot);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xuckoo_hash_table_insert(XuckooHashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, by doubling each inner table
+// and splitting its buckets up front until there is a bucket for every
+// key in each table's half of the keys. keys whose hash values crowd into the
+// same bits will still need more splits
+void xuckoo_hash_table_reserve(XuckooHashTable *table, int n);
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets of the first and then
+// the second table were created
+void xuckoo_hash_table_foreach(XuckooHashTable *table, ScanFunc func,
+	void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xuckoo_hash_table_next(XuckooHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool xuckoo_hash_table_lookup(XuckooHashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xuckoo_hash_table_insert_batch(XuckooHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xuckoo_hash_table_lookup_batch(XuckooHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xuckoo_hash_table_put(XuckooHashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xuckoo_hash_table_get(XuckooHashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xuckoo_hash_table_update(XuckooHashTable *table, int64 key, int64 value);
+
 // print the contents of 'table' to stdout
 void xuckoo_hash_table_print(XuckooHashTable *table);
 
 // print some statistics about 'table' to stdout
 void xuckoo_hash_table_stats(XuckooHashTable *table);
 
+// count the bytes 'table' is using into *usage
+void xuckoo_hash_table_memory_usage(XuckooHashTable *table,
+	MemoryUsage *usage);
+
 #endif
@@ -17,6 +17,11 @@
 #include <time.h>
 
 #include "xuckoon.h"
+#include "batch.h"
+#include "latency.h"
+#include "histogram.h"
+#include "events.h"
+#include "slab.h"
 
 // macro to calculate the rightmost n bits of a number x
 #define rightmostnbits(n, x) (x) & ((1 << (n)) - 1)
@@ -24,6 +29,14 @@
 #define FOUND true // To indicate the key can be found in the table
 #define NOT_FOUND false // To indicate the key cannot be found in the table
 
+// The version of the snapshot layout below, to change whenever it changes
+#define SNAPSHOT_VERSION 5
+
+// macros to access the i-th key and value in bucket 'b' of inner table 't'
+// (keys are interleaved with their values, if the table stores any)
+#define KEY(t, b, i) (b)->keys[(i) * (t)->width]
+#define VALUE(t, b, i) (b)->keys[(i) * (t)->width + 1]
+
 /*********************************** STRUCT **********************************/
 // a bucket stores an array of keys
 // it also knows how many bits are shared between possible keys, and the first 
@@ -33,13 +46,17 @@ typedef struct bucket {
 					// in the table which points to it
 	int depth;		// how many hash value bits are being used by this bucket
 	int nkeys;		// number of keys currently contained in this bucket
-	int64 *keys;	// the keys stored in this bucket
+	int64 keys[];	// the keys stored in this bucket (each followed by its
+					// value, if the table stores values), allocated inline
 } Bucket;
 
 // helper structure to store statistics gathered
 typedef struct stats {
-	int time;    	// how much CPU time has been used to insert/lookup keys
-					// in this table
+	Latency inserts;	// how long inserts (and puts) have taken
+	Latency lookups;	// how long lookups (and gets and updates) have taken
+	int resizes_avoided;	// how many doublings and splits were done up
+							// front by xuckoon_hash_table_reserve
+	Histogram kicks;	// how many keys each insert kicked out of their buckets
 } Stats;
 
 // an inner table is an extendible hash table with an array of slots pointing 
@@ -50,30 +67,83 @@ typedef struct inner_table {
 	int size;			// how many entries in the table of pointers (2^depth)
 	int depth;			// how many bits of the hash value to use (log2(size))
 	int bucketsize;		// maximum number of keys per bucket
+	int width;			// how many int64 words each key takes up (1 or 2)
 	int total_keys; 	// number of keys in this table
+	Slabs slabs;		// the memory every bucket (and its keys) is allocated
+						// from, in the order the buckets were created
 } InnerTable;
 
 // a xuckoon hash table is just two inner tables for storing inserted keys
 struct xuckoon_table {
 	InnerTable *table1;
 	InnerTable *table2;
+	bool rotate;		// kick keys out of full buckets in turn, rather than
+						// at random?
+	int next_kick;		// (if so) which slot of a full bucket to kick next
 	Stats stats;
+	Snapshot *snapshot;	// the snapshot some of the slabs are being used in
+						// place from, or NULL if they were all allocated
 };
 
+// the first section of a snapshot of a xuckoon hash table, followed by the
+// sections for the first and then the second inner table
+typedef struct snapshot_header {
+	int version;	// SNAPSHOT_VERSION when the snapshot was written
+	size_t statsize;	// sizeof (Stats) in the program that wrote it, which
+						// depends on how it was built (see tables/latency.h)
+	bool rotate;
+	int next_kick;
+	Stats stats;
+} SnapshotHeader;
+
+// the first section of an inner table in a snapshot, followed by a section
+// holding its slabs (and so every bucket and its keys, exactly as they are in
+// memory) and a section holding the number of the bucket each table address
+// points to
+typedef struct inner_header {
+	int size;
+	int depth;
+	int bucketsize;
+	int width;
+	int total_keys;
+	int itemsize;	// how many bytes each bucket (with its keys) takes up
+	int nitems;		// how many buckets there are in the slabs
+} InnerHeader;
+
 /****************************** HELPER FUNCTIONS *****************************/
 // Helper function to initialise the InnerTable
 static InnerTable *initialise_inner_table(InnerTable *innertable, 
-	int bucketsize);
+	int bucketsize, int width);
 
-// Helper function to create a new bucket first referenced from 
-// 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth, int bucketsize);
+// Helper function to create a new bucket in 'innertable' first referenced 
+// from 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(InnerTable *innertable, int first_address,
+	int depth);
 
 // Helper function to free the memory of the InnerTable
 void free_xuckoon_innertable(InnerTable *innertable);
 
-// Helper function to lookup the key in the InnerTable
-bool lookup_innertable(InnerTable *innertable, int64 key, int address);
+// Helper function to write the InnerTable to 'file' as snapshot sections,
+// returning false if they couldn't all be written
+static bool save_innertable(InnerTable *innertable, FILE *file);
+
+// Helper function to load an InnerTable written by save_innertable from the
+// next sections of 'snapshot', using its buckets in place (or NULL if they
+// are cut short or corrupted)
+static InnerTable *load_innertable(Snapshot *snapshot);
+
+// Helper function to add the bytes the InnerTable is using to *usage
+static void add_inner_memory_usage(InnerTable *innertable,
+	MemoryUsage *usage);
+
+// Helper function to record how many keys each bucket of the InnerTable holds
+// in *occupancy
+static void add_inner_occupancy(InnerTable *innertable, Histogram *occupancy);
+
+// Helper function to lookup the key in the InnerTable, returning a pointer to
+// its entry (the key's value, if any, is the next word), or NULL
+static int64 *lookup_innertable(InnerTable *innertable, int64 key,
+	int address);
 
 // Helper function to double the table of bucket pointers, duplicating the
 // bucket pointers in the first half into the new second half of the table
@@ -81,7 +151,7 @@ static void double_xuckoon_innertable(InnerTable *innertable);
 
 // Helper function to reinsert a key into the hash table after splitting
 // a bucket
-static void reinsert_key(InnerTable *innertable, int64 key, 
+static void reinsert_key(InnerTable *innertable, int64 *entry, 
 	int table_no);
 
 // Helper function to split the bucket in 'table' at address 'address',
@@ -89,19 +159,70 @@ static void reinsert_key(InnerTable *innertable, int64 key,
 static void split_bucket(InnerTable *innertable, int address, 
 	int table_no);
 
+// Helper function to double the InnerTable and split its buckets until there
+// is a bucket for every 'bucketsize' of its 'n' keys, returning how many
+// doublings and splits that took
+static int reserve_innertable(InnerTable *innertable, int n, int table_no);
+
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XuckoonHashTable *table, int64 key, int64 value,
+	bool overwrite);
+
+// Helper function to find the entry holding 'key' in either inner table,
+// returning a pointer to it (its value, if any, is the next word), or NULL
+static int64 *find_entry(XuckoonHashTable *table, int64 key);
+
+// Helper function to search for 'key', whose hash values are 'hash_1' and
+// 'hash_2', in 'table', returning its entry as for find_entry (without timing)
+static int64 *search_entry(XuckoonHashTable *table, int64 key, int hash_1,
+	int hash_2);
+
+// Helper function to prefetch the memory needed to probe for the key with
+// hash values 'hash_1' and 'hash_2', 'stage' steps ahead of the probe: 3 for
+// the directory entries, 2 for the buckets they point to, and 1 for the keys
+// of those buckets
+static void prefetch_stage(XuckoonHashTable *table, int hash_1, int hash_2,
+	int stage);
+
 /**************************** FUNCTION DEFINITIONS ***************************/
-// initialise an extendible cuckoon hash table
-XuckoonHashTable *new_xuckoon_hash_table(int bucketsize) {
+// initialise an extendible cuckoon hash table, storing a value alongside
+// each key if 'values' is true
+XuckoonHashTable *new_xuckoon_hash_table(int bucketsize, bool values) {
 	XuckoonHashTable *table = malloc(sizeof *table);
 	assert(table);
+	int width = values ? 2 : 1;
 	
 	// Allocate memory for the first table
-	table->table1 = initialise_inner_table(table->table1, bucketsize);
+	table->table1 = initialise_inner_table(table->table1, bucketsize, width);
 	
 	// Allocate memory for the second table
-	table->table2 = initialise_inner_table(table->table2, bucketsize);
+	table->table2 = initialise_inner_table(table->table2, bucketsize, width);
 	
-	table->stats.time = 0;
+	initialise_latency(&table->stats.inserts);
+	initialise_latency(&table->stats.lookups);
+	table->stats.resizes_avoided = 0;
+	initialise_histogram(&table->stats.kicks);
+	table->rotate = false;
+	table->next_kick = 0;
+	table->snapshot = NULL;
+	
+	return table;
+}
+
+// initialise an extendible cuckoo hash table with 'bucketsize' keys per
+// bucket holding the 'n' keys in 'keys'
+XuckoonHashTable *new_xuckoon_hash_table_from_keys(int bucketsize, int64 *keys,
+	int n) {
+	XuckoonHashTable *table = new_xuckoon_hash_table(bucketsize, false);
+	
+	// Which inner table each key ends up in depends on the keys inserted
+	// before it, so there is no way to place them all at once: insert them
+	// one at a time (skipping the wrapper functions)
+	int i;
+	for (i = 0; i < n; i++) {
+		insert_entry(table, keys[i], 0, false);
+	}
 	
 	return table;
 }
@@ -120,163 +241,277 @@ void free_xuckoon_hash_table(XuckoonHashTable *table) {
 	free(table->table1->buckets);
 	free(table->table2->buckets);
 	
+	// Free the inner table structs themselves
+	free(table->table1);
+	free(table->table2);
+	
+	// Free the snapshot the rest of the buckets are in
+	if (table->snapshot) {
+		unmap_snapshot(table->snapshot);
+	}
+	
 	// Free the table struct itself
 	free(table);
 }
 
-// insert 'key' into 'table', if it's not in there already
-// returns true if insertion succeeds, false if it was already in there
-bool xuckoon_hash_table_insert(XuckoonHashTable *table, int64 key) {
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xuckoon_hash_table_save(XuckoonHashTable *table, FILE *file) {
 	assert(table);
-	int start_time = clock(); // Start timing
-	
-	time_t t;
-	int total_kicked_keys = 0, hash, random_kicked_index;
-	int64 kick_key;
-	InnerTable *innertable = table->table1;
-	
-	/* Intializes random number generator */
-	srand((unsigned) time(&t));
-	
-	// Calculate table address
-	int hash_1 = h1(key), hash_2 = h2(key);
-	int address_1 = rightmostnbits(table->table1->depth, hash_1);
-	int address_2 = rightmostnbits(table->table2->depth, hash_2);
-	int address = address_1, no_keys;
 	
-	// Check the key whether it has been inserted or not in Table 1 and 
-	// Table 2
-	bool is_in_table1 = xuckoon_hash_table_lookup(table, key);
-	bool is_in_table2 = xuckoon_hash_table_lookup(table, key);
-	
-	// It can find the key either in Table 1 or Table 2
-	if (is_in_table1 || is_in_table2) {
-		
-		// Add time elapsed to total CPU time before returning result
-		table->stats.time += clock() - start_time;
-		return false;	
+	SnapshotHeader header = { SNAPSHOT_VERSION, sizeof (Stats), table->rotate,
+		table->next_kick, table->stats };
+	return write_section(file, &header, sizeof header)
+		&& save_innertable(table->table1, file)
+		&& save_innertable(table->table2, file);
+}
+
+// load a table written by xuckoon_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place
+// returns NULL if it was written with a different snapshot layout, or is
+// cut short or corrupted
+XuckoonHashTable *xuckoon_hash_table_load(Snapshot *snapshot) {
+	SnapshotHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->version != SNAPSHOT_VERSION
+		|| header->statsize != sizeof (Stats)) {
+		return NULL;
 	}
 	
-	// Check which table that has the least keys
-	int insert_table = 1;
-	if (table->table1->buckets[address_1]->nkeys > 
-		table->table2->buckets[address_2]->nkeys) {
-		insert_table = 2;
+	XuckoonHashTable *table = malloc(sizeof *table);
+	assert(table);
+	table->rotate = header->rotate;
+	table->next_kick = header->next_kick;
+	table->stats = header->stats;
+	table->table1 = load_innertable(snapshot);
+	table->table2 = table->table1 ? load_innertable(snapshot) : NULL;
+	if (table->table2 == NULL) {
+		if (table->table1) {
+			free_xuckoon_innertable(table->table1);
+			free(table->table1->buckets);
+			free(table->table1);
+		}
+		free(table);
+		return NULL;
 	}
+	table->snapshot = snapshot;
 	
-	// Try to find an empty slot and check if there is a cycle
-	while (innertable->buckets[address]->nkeys == innertable->bucketsize && 
-		total_kicked_keys != 2*(table->table1->size)) {
-		
-		// Generate a random number to kick the key 
-		random_kicked_index = rand() % innertable->bucketsize;
-		kick_key = innertable->buckets[address]->keys[random_kicked_index];
-		total_kicked_keys++;
-		
-		innertable->buckets[address]->keys[random_kicked_index] = key;
-		key = kick_key;
-		
-		// If it kicked the key from the Table 1, need to insert the kicked 
-		// key to the Table 2 
-		if (insert_table == 1) {
-			
-			// Mark the next table that will be visited is table 2
-			insert_table = 2;
-				
-			// Update the temp_table and the hash
-			innertable = table->table2;
-			address = rightmostnbits(innertable->depth, h2(key));
+	return table;
+}
+
+// insert 'key' into 'table', if it's not in there already
+// returns true if insertion succeeds, false if it was already in there
+bool xuckoon_hash_table_insert(XuckoonHashTable *table, int64 key) {
+	assert(table);
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, 0, false);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+// make room in 'table' for 'n' keys in total, by doubling each inner table
+// and splitting its buckets up front until there is a bucket for every
+// 'bucketsize' keys of each table's half of the keys. keys whose hash values
+// crowd into the same bits will still need more splits
+void xuckoon_hash_table_reserve(XuckoonHashTable *table, int n) {
+	assert(table);
+	
+	// Expect the keys to be shared evenly between the two tables
+	table->stats.resizes_avoided += reserve_innertable(table->table1,
+		(n + 1) / 2, 1);
+	table->stats.resizes_avoided += reserve_innertable(table->table2,
+		(n + 1) / 2, 2);
+}
+
+// make 'table' kick the keys out of a full bucket in turn, slot by slot, if
+// 'rotate' is true (rather than at random)
+void xuckoon_hash_table_rotate_kicks(XuckoonHashTable *table, bool rotate) {
+	assert(table);
+	table->rotate = rotate;
+}
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets of the first and then
+// the second table were created
+void xuckoon_hash_table_foreach(XuckoonHashTable *table, ScanFunc func,
+	void *ctx) {
+	assert(table);
+	
+	// Every bucket was allocated from its table's slabs, so walking them 
+	// visits each bucket exactly once without going through the pointers
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	int t, i, j;
+	for (t = 0; t < 2; t++) {
+		for (i = 0; i < innertables[t]->slabs.nitems; i++) {
+			Bucket *bucket = slab_item(&innertables[t]->slabs, i);
+			for (j = 0; j < bucket->nkeys; j++) {
+				func(KEY(innertables[t], bucket, j), innertables[t]->width > 1 ?
+					VALUE(innertables[t], bucket, j) : 0, ctx);
+			}
 		}
-		
-		// If it kicked the key from the Table 2, need to insert the kicked 
-		// key to the Table 1
-		else if (insert_table == 2) {
-			
-			// Mark the next table that will be visited is table 2
-			insert_table = 1;
-				
-			// Update the temp_table and the hash
-			innertable = table->table1;
-			address = rightmostnbits(innertable->depth, h1(key));
-		}	
 	}
+}
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xuckoon_hash_table_next(XuckoonHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value) {
+	assert(table);
 	
-	// The number of kicked key is equal to the 2 times the table size,
-	// indicates that there is a cycling, so we need to grow the table
-	if (total_kicked_keys == 2*(table->table1->size)) {
+	InnerTable *innertables[2] = {table->table1, table->table2};
+	while (cursor->part < 2) {
+		InnerTable *innertable = innertables[cursor->part];
 		
-		// Make space on the smallest size table to have space to 
-		// insert the key
-		while (innertable->buckets[address]->nkeys == 
-			innertable->bucketsize) {
-			
-			// If the first table has size smaller than or equal to the second
-			// table's size, choose the first table
-			if (table->table1->size <= table->table2->size) {
-				innertable = table->table1;
-				hash = h1(key);
-				address = rightmostnbits(innertable->depth, hash);
-				insert_table = 1;
-			}
+		while (cursor->block < innertable->slabs.nitems) {
+			Bucket *bucket = slab_item(&innertable->slabs, cursor->block);
 			
-			// Otherwise, choose the second table
-			else {
-				innertable = table->table2;
-				hash = h2(key);
-				address = rightmostnbits(innertable->depth, hash);
-				insert_table = 2;
+			// The next key in this bucket, if it has any left
+			if (cursor->entry < bucket->nkeys) {
+				*key = KEY(innertable, bucket, cursor->entry);
+				if (value != NULL) {
+					*value = innertable->width > 1 ?
+						VALUE(innertable, bucket, cursor->entry) : 0;
+				}
+				cursor->entry++;
+				return true;
 			}
 			
-			split_bucket(innertable, address, insert_table);
-			
-			// and recalculate address because we might now need more bits
-			address = rightmostnbits(innertable->depth, hash);
+			// Otherwise, move on to the next bucket
+			cursor->block++;
+			cursor->entry = 0;
 		}
+		
+		// And then on to the next table
+		cursor->part++;
+		cursor->block = 0;
 	}
-	
-	// There is now space for the key, so we can just insert it
-	no_keys = innertable->buckets[address]->nkeys;
-	innertable->buckets[address]->keys[no_keys] = key;
-	innertable->buckets[address]->nkeys++;
-	innertable->total_keys++;
-	
-	// Add time elapsed to total CPU time before returning result
-	table->stats.time += clock() - start_time;
-	
-	return true;
-	
+	return false;
 }
 
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool xuckoon_hash_table_lookup(XuckoonHashTable *table, int64 key) {
 	assert(table);
-	int start_time = clock(); // Start timing
+	return find_entry(table, key) != NULL;
+}
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xuckoon_hash_table_put(XuckoonHashTable *table, int64 key, int64 value) {
+	assert(table);
+	assert(table->table1->width > 1 && "error: table does not store values!");
+	int64 start = latency_start(&table->stats.inserts);
+	bool inserted = insert_entry(table, key, value, true);
+	latency_stop(&table->stats.inserts, start);
+	return inserted;
+}
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xuckoon_hash_table_get(XuckoonHashTable *table, int64 key, int64 *value) {
+	assert(table);
+	assert(table->table1->width > 1 && "error: table does not store values!");
 	
-	// Calculate the address on the first and second table for this key
-	int address_table1 = rightmostnbits(table->table1->depth, h1(key));
-	int address_table2 = rightmostnbits(table->table2->depth, h2(key));
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	*value = entry[1];
+	return FOUND;
+}
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xuckoon_hash_table_update(XuckoonHashTable *table, int64 key,
+	int64 value) {
+	assert(table);
+	assert(table->table1->width > 1 && "error: table does not store values!");
 	
-	// Lookup the key on the first and the second table
-	bool look_table1 = lookup_innertable(table->table1, key, address_table1);
-	bool look_table2 = lookup_innertable(table->table2, key, address_table2);
+	int64 *entry = find_entry(table, key);
+	if (entry == NULL) {
+		return NOT_FOUND;
+	}
+	entry[1] = value;
+	return FOUND;
+}
+
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xuckoon_hash_table_insert_batch(XuckoonHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.inserts);
 	
-	// If the key can be found either in table 1 or table 2, return FOUND 
-	// (true)
-	if (look_table1 || look_table2) {
+	int hashes1[BATCH_BLOCK], hashes2[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
 		
-		// Add time elapsed to total CPU time before returning result
-		table->stats.time += clock() - start_time;
+		// Hash the whole block first, for both inner tables
+		for (i = 0; i < m; i++) {
+			hashes1[i] = h1(keys[start + i]);
+			hashes2[i] = h2(keys[start + i]);
+		}
 		
-		return FOUND;	
+		// Then insert each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		// (an insertion may split buckets and double the directories, so 
+		// addresses are recalculated from the hash values each time)
+		for (i = 0; i < m; i++) {
+			for (stage = 3; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes1[i + stage*PREFETCH_DISTANCE],
+						hashes2[i + stage*PREFETCH_DISTANCE], stage);
+				}
+			}
+			results[start + i] = insert_entry(table, keys[start + i], 0, false);
+		}
 	}
 	
-	// Add time elapsed to total CPU time before returning result
-	table->stats.time += clock() - start_time;
+	latency_stop_batch(&table->stats.inserts, batch_start, n);
+}
+
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xuckoon_hash_table_lookup_batch(XuckoonHashTable *table, int64 *keys,
+	int n, bool *results) {
+	assert(table);
+	// Start timing (once for the whole batch)
+	int64 batch_start = latency_start(&table->stats.lookups);
+	
+	int hashes1[BATCH_BLOCK], hashes2[BATCH_BLOCK];
+	int start, i, m, stage;
+	for (start = 0; start < n; start += BATCH_BLOCK) {
+		m = block_size(n, start);
+		
+		// Hash the whole block first, for both inner tables
+		for (i = 0; i < m; i++) {
+			hashes1[i] = h1(keys[start + i]);
+			hashes2[i] = h2(keys[start + i]);
+		}
+		
+		// Then probe for each key, while prefetching the memory for the keys 
+		// ahead of it, one level of indirection per prefetch distance
+		for (i = 0; i < m; i++) {
+			for (stage = 3; stage >= 1; stage--) {
+				if (i + stage*PREFETCH_DISTANCE < m) {
+					prefetch_stage(table, hashes1[i + stage*PREFETCH_DISTANCE],
+						hashes2[i + stage*PREFETCH_DISTANCE], stage);
+				}
+			}
+			results[start + i] = search_entry(table, keys[start + i],
+				hashes1[i], hashes2[i]) != NULL;
+		}
+	}
 	
-	return NOT_FOUND;
+	latency_stop_batch(&table->stats.lookups, batch_start, n);
 }
 
+
 // print the contents of 'table' to stdout
 void xuckoon_hash_table_print(XuckoonHashTable *table) {
 	assert(table);
@@ -307,8 +542,12 @@ void xuckoon_hash_table_print(XuckoonHashTable *table) {
 				// print the bucket's contents
 				printf("[");
 				for(int j = 0; j < innertables[t]->bucketsize; j++) {
-					if (j < innertables[t]->buckets[i]->nkeys) {
-						printf(" %llu", innertables[t]->buckets[i]->keys[j]);
+					Bucket *bucket = innertables[t]->buckets[i];
+					if (j < bucket->nkeys && innertables[t]->width > 1) {
+						printf(" %llu: %llu", KEY(innertables[t], bucket, j),
+							VALUE(innertables[t], bucket, j));
+					} else if (j < bucket->nkeys) {
+						printf(" %llu", KEY(innertables[t], bucket, j));
 					} else {
 						printf(" -");
 					}
@@ -338,48 +577,80 @@ void xuckoon_hash_table_stats(XuckoonHashTable *table) {
 	printf("	  number of keys in table 2: %d keys\n", 
 		table->table2->total_keys);
 	
-	// Calculate CPU usage in seconds and print this
-	float seconds = table->stats.time * 1.0 / CLOCKS_PER_SEC;
-	printf("    CPU time spent: %.6f sec\n", seconds);
+	// print how long operations have taken
+	print_latency("insert", &table->stats.inserts);
+	print_latency("lookup", &table->stats.lookups);
+	if (table->stats.resizes_avoided > 0) {
+		printf("   resizes avoided: %d\n", table->stats.resizes_avoided);
+	}
+	if (table->rotate) {
+		printf("    keys kicked out: in turn\n");
+	}
+	
+	// Print how many keys inserts have had to kick out of their buckets, and
+	// how full the buckets of both tables are now
+	print_histogram("kicks per insert", &table->stats.kicks);
+	Histogram occupancy;
+	initialise_histogram(&occupancy);
+	add_inner_occupancy(table->table1, &occupancy);
+	add_inner_occupancy(table->table2, &occupancy);
+	print_histogram("keys per bucket", &occupancy);
+	
+	MemoryUsage usage;
+	xuckoon_hash_table_memory_usage(table, &usage);
+	print_memory_usage(&usage, table->table1->total_keys
+		+ table->table2->total_keys);
 	
 	printf("--- end stats ---\n");
 
 }
 
+// count the bytes 'table' is using into *usage
+void xuckoon_hash_table_memory_usage(XuckoonHashTable *table,
+	MemoryUsage *usage) {
+	assert(table);
+	usage->directory = sizeof *table;
+	usage->stats = sizeof table->stats;
+	usage->buckets = usage->slack = 0;
+	add_inner_memory_usage(table->table1, usage);
+	add_inner_memory_usage(table->table2, usage);
+}
+
 /************************** INITIALISE INNER TABLE ***************************/
 // Helper function to initialise the InnerTable
 static InnerTable *initialise_inner_table(InnerTable *innertable, 
-	int bucketsize) {
+	int bucketsize, int width) {
 	innertable = malloc(sizeof (InnerTable));
 	assert(innertable);
 
-	innertable->size = 1;
-	innertable->buckets = malloc(sizeof *innertable->buckets);
-	assert(innertable->buckets);
-	innertable->buckets[0] = new_bucket(0, 0, bucketsize);
-	
 	// Initialise the initial value
+	innertable->size = 1;
 	innertable->depth = 0;
 	innertable->total_keys = 0;
 	innertable->bucketsize = bucketsize;
+	innertable->width = width;
+	
+	// Each bucket's keys are allocated right after it
+	initialise_slabs(&innertable->slabs,
+		sizeof (Bucket) + bucketsize * width * sizeof (int64));
+	innertable->buckets = malloc(sizeof *innertable->buckets);
+	assert(innertable->buckets);
+	innertable->buckets[0] = new_bucket(innertable, 0, 0);
 		
 	return innertable;
 	
 }
 
 /********************************* NEW BUCKET ********************************/
-// Helper function to create a new bucket first referenced from 
-// 'first_address', based on 'depth' bits of its keys' hash values
-static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
-	Bucket *bucket = malloc(sizeof *bucket);
-	assert(bucket);
+// Helper function to create a new bucket in 'innertable' first referenced 
+// from 'first_address', based on 'depth' bits of its keys' hash values
+static Bucket *new_bucket(InnerTable *innertable, int first_address,
+	int depth) {
+	Bucket *bucket = slab_alloc(&innertable->slabs);
 
 	bucket->id = first_address;
 	bucket->depth = depth;
 	
-	bucket->keys = malloc((bucketsize)* sizeof(int64));
-	assert(bucket->keys);
-	
 	bucket->nkeys = 0;
 	
 	return bucket;
@@ -389,26 +660,17 @@ static Bucket *new_bucket(int first_address, int depth, int bucketsize) {
 /************************** FREE XUCKOON INNERTABLE **************************/
 // Helper function to free the memory of the InnerTable
 void free_xuckoon_innertable(InnerTable *innertable) {
-	int i;
-	
-	// Looping backwards through the array of pointers, freeing buckets only 
-	// as we reach their first reference
-	// (If we loop through forwards, we would not know which reference was
-	// last)
 	
-	for (i = innertable->size - 1; i >= 0; i--) {
-		if (innertable->buckets[i]->id == i) {
-			
-			// Free the array of keys and the bucket
-			free(innertable->buckets[i]->keys);
-			free(innertable->buckets[i]);
-		}
-	}
+	// Free every bucket (and its keys) at once, along with the slabs they 
+	// were allocated from
+	free_slabs(&innertable->slabs);
 }
 
 /***************************** LOOKUP INNERTABLE *****************************/
-// Helper function to lookup the key in the InnerTable
-bool lookup_innertable(InnerTable *innertable, int64 key, int address) {
+// Helper function to lookup the key in the InnerTable, returning a pointer to
+// its entry (the key's value, if any, is the next word), or NULL
+static int64 *lookup_innertable(InnerTable *innertable, int64 key,
+	int address) {
 	
 	// Look for the key in that bucket (unless it's empty)
 	if (innertable->buckets[address]->nkeys > 0) {
@@ -418,19 +680,100 @@ bool lookup_innertable(InnerTable *innertable, int64 key, int address) {
 		for (i = 0; i < no_keys; i++) {
 			
 			// We have found the key!!
-			if (innertable->buckets[address]->keys[i] == key) {
-				return FOUND;
+			if (KEY(innertable, innertable->buckets[address], i) == key) {
+				return &KEY(innertable, innertable->buckets[address], i);
 			}
 		}
 	}
 	
-	return NOT_FOUND;
+	return NULL;
+}
+
+/****************************** SAVE INNER TABLE *****************************/
+// Helper function to write the InnerTable to 'file' as snapshot sections,
+// returning false if they couldn't all be written
+static bool save_innertable(InnerTable *innertable, FILE *file) {
+	InnerHeader header = { innertable->size, innertable->depth,
+		innertable->bucketsize, innertable->width, innertable->total_keys,
+		innertable->slabs.itemsize, innertable->slabs.nitems };
+	return write_section(file, &header, sizeof header)
+		&& save_slabs(&innertable->slabs, file)
+		&& save_directory(&innertable->slabs, (void **)innertable->buckets,
+			innertable->size, file);
+}
+
+/****************************** LOAD INNER TABLE *****************************/
+// Helper function to load an InnerTable written by save_innertable from the
+// next sections of 'snapshot', using its buckets in place (or NULL if they
+// are cut short or corrupted)
+static InnerTable *load_innertable(Snapshot *snapshot) {
+	InnerHeader *header = read_section(snapshot, sizeof *header);
+	if (header == NULL || header->bucketsize <= 0
+		|| header->width < 1 || header->width > 2
+		|| header->itemsize != sizeof (Bucket)
+			+ (int64)header->bucketsize * header->width * sizeof (int64)
+		|| header->depth < 0 || header->depth >= 31
+		|| header->size != 1 << header->depth) {
+		return NULL;
+	}
+	
+	InnerTable *innertable = malloc(sizeof (InnerTable));
+	assert(innertable);
+	innertable->size = header->size;
+	innertable->depth = header->depth;
+	innertable->bucketsize = header->bucketsize;
+	innertable->width = header->width;
+	innertable->total_keys = header->total_keys;
+	
+	// The buckets (and their keys) are used straight from the snapshot, so
+	// only the table of pointers to them needs to be rebuilt
+	if (!load_slabs(&innertable->slabs, header->itemsize, header->nitems,
+		snapshot)) {
+		free(innertable);
+		return NULL;
+	}
+	innertable->buckets = malloc((sizeof *innertable->buckets)
+		* innertable->size);
+	assert(innertable->buckets);
+	if (!load_directory(&innertable->slabs, (void **)innertable->buckets,
+		innertable->size, snapshot)) {
+		free_xuckoon_innertable(innertable);
+		free(innertable->buckets);
+		free(innertable);
+		return NULL;
+	}
+	
+	return innertable;
+}
+
+// Helper function to add the bytes the InnerTable is using to *usage
+static void add_inner_memory_usage(InnerTable *innertable,
+	MemoryUsage *usage) {
+	usage->directory += sizeof *innertable
+		+ sizeof *innertable->buckets * innertable->size;
+	usage->buckets += slabs_bytes(&innertable->slabs);
+	usage->slack += slabs_unused_bytes(&innertable->slabs)
+		+ sizeof (int64) * innertable->width
+		* ((size_t)innertable->slabs.nitems * innertable->bucketsize
+			- innertable->total_keys);
+}
+
+// Helper function to record how many keys each bucket of the InnerTable holds
+// in *occupancy (each bucket's id is the first address pointing to it)
+static void add_inner_occupancy(InnerTable *innertable, Histogram *occupancy) {
+	int address;
+	for (address = 0; address < innertable->size; address++) {
+		if (innertable->buckets[address]->id == address) {
+			histogram_add(occupancy, innertable->buckets[address]->nkeys);
+		}
+	}
 }
 
 /******************************* DOUBLE TABLE ********************************/
 // Helper function to double the table of bucket pointers, duplicating the
 // bucket pointers in the first half into the new second half of the table
 static void double_xuckoon_innertable(InnerTable *innertable) {
+	int64 start = event_start();
 	int size = innertable->size*2;
 	assert(size < MAX_TABLE_SIZE && "error: table has grown too large!");
 	
@@ -449,24 +792,26 @@ static void double_xuckoon_innertable(InnerTable *innertable) {
 	// keys
 	innertable->size = size;
 	innertable->depth++;
-	
+	record_event(EVENT_DOUBLE, "xuckoon", start, size / 2, size, 0);
 }
 
 /******************************* REINSERT KEY ********************************/
 // Helper function to reinsert a key into the specified hash table after 
 // splitting a bucket
-static void reinsert_key(InnerTable *innertable, int64 key, 
+static void reinsert_key(InnerTable *innertable, int64 *entry, 
 	int table_no) {
-	int address, hash = h1(key), no_keys;
+	int address, hash = h1(entry[0]), w;
 
 	if (table_no == 2) {
-		hash = h2(key);	
+		hash = h2(entry[0]);	
 	}
 	
 	address = rightmostnbits(innertable->depth, hash);
-	no_keys = innertable->buckets[address]->nkeys;
-	innertable->buckets[address]->keys[no_keys] = key;
-	innertable->buckets[address]->nkeys++;
+	Bucket *bucket = innertable->buckets[address];
+	for (w = 0; w < innertable->width; w++) {
+		bucket->keys[bucket->nkeys * innertable->width + w] = entry[w];
+	}
+	bucket->nkeys++;
 }
 
 /******************************* SPLIT BUCKET ********************************/
@@ -482,6 +827,7 @@ static void split_bucket(InnerTable *innertable, int address,
 		double_xuckoon_innertable(innertable);
 	}
 	// either way, now it's time to split this bucket
+	int64 start = event_start();
 
 
 	// SECOND,
@@ -495,8 +841,7 @@ static void split_bucket(InnerTable *innertable, int address,
 
 	// new bucket's first address will be a 1 bit plus the old first address
 	int new_first_address = 1 << depth | first_address;
-	Bucket *newbucket = new_bucket(new_first_address, new_depth, 
-		innertable->bucketsize);
+	Bucket *newbucket = new_bucket(innertable, new_first_address, new_depth);
 	
 	// THIRD,
 	// redirect every second address pointing to this bucket to the new bucket
@@ -532,6 +877,238 @@ static void split_bucket(InnerTable *innertable, int address,
 	bucket->nkeys = 0;
 
 	for (i = 0; i < total_keys; i++) {
-		reinsert_key(innertable, keys[i], table_no);
+		reinsert_key(innertable, &keys[i * innertable->width], table_no);
+	}
+	
+	record_event(EVENT_SPLIT, "xuckoon", start, total_keys, bucket->nkeys,
+		newbucket->nkeys);
+}
+
+/***************************** RESERVE INNERTABLE ****************************/
+// Helper function to double the InnerTable and split its buckets until there
+// is a bucket for every 'bucketsize' of its 'n' keys, returning how many
+// doublings and splits that took
+static int reserve_innertable(InnerTable *innertable, int n, int table_no) {
+	int depth = 0, resizes = 0;
+	
+	// How many hash value bits give every 'bucketsize' keys a bucket?
+	while (((int64)innertable->bucketsize << depth) < n) {
+		depth++;
+	}
+	
+	// Double the table until it uses that many bits
+	while (innertable->depth < depth) {
+		double_xuckoon_innertable(innertable);
+		resizes++;
+	}
+	
+	// And split every bucket until it does too
+	int address;
+	for (address = 0; address < innertable->size; address++) {
+		while (innertable->buckets[address]->depth < depth) {
+			split_bucket(innertable, address, table_no);
+			resizes++;
+		}
+	}
+	
+	return resizes;
+}
+
+/******************************* INSERT ENTRY ********************************/
+// Helper function to insert 'key' with 'value' into 'table', replacing the
+// value of an existing 'key' instead if 'overwrite' is true
+static bool insert_entry(XuckoonHashTable *table, int64 key, int64 value,
+	bool overwrite) {
+	time_t t;
+	int total_kicked_keys = 0, hash, random_kicked_index;
+	int64 kick_key, kick_value;
+	InnerTable *innertable = table->table1;
+	int width = table->table1->width;
+	
+	/* Intializes random number generator (unless keys are kicked in turn) */
+	if (!table->rotate) {
+		srand((unsigned) time(&t));
+	}
+	
+	// Calculate table address
+	int hash_1 = h1(key), hash_2 = h2(key);
+	int address_1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_2 = rightmostnbits(table->table2->depth, hash_2);
+	int address = address_1, no_keys;
+	
+	// Check the key whether it has been inserted or not in Table 1 and 
+	// Table 2
+	int64 *entry = search_entry(table, key, hash_1, hash_2);
+	
+	// It can find the key either in Table 1 or Table 2
+	if (entry != NULL) {
+		if (overwrite) {
+			entry[1] = value;
+		}
+		
+		return false;	
+	}
+	
+	// Check which table that has the least keys
+	int insert_table = 1;
+	if (table->table1->buckets[address_1]->nkeys > 
+		table->table2->buckets[address_2]->nkeys) {
+		insert_table = 2;
+	}
+	
+	// Try to find an empty slot and check if there is a cycle
+	while (innertable->buckets[address]->nkeys == innertable->bucketsize && 
+		total_kicked_keys != 2*(table->table1->size)) {
+		
+		// Generate a random number to kick the key (or take the next slot
+		// in turn)
+		if (table->rotate) {
+			random_kicked_index = table->next_kick;
+			table->next_kick = (table->next_kick + 1) % innertable->bucketsize;
+		} else {
+			random_kicked_index = rand() % innertable->bucketsize;
+		}
+		kick_key = KEY(innertable, innertable->buckets[address],
+			random_kicked_index);
+		total_kicked_keys++;
+		
+		// The kicked key's value (if any) travels along with it
+		KEY(innertable, innertable->buckets[address], random_kicked_index) =
+			key;
+		key = kick_key;
+		if (width > 1) {
+			kick_value = VALUE(innertable, innertable->buckets[address],
+				random_kicked_index);
+			VALUE(innertable, innertable->buckets[address],
+				random_kicked_index) = value;
+			value = kick_value;
+		}
+		
+		// If it kicked the key from the Table 1, need to insert the kicked 
+		// key to the Table 2 
+		if (insert_table == 1) {
+			
+			// Mark the next table that will be visited is table 2
+			insert_table = 2;
+				
+			// Update the temp_table and the hash
+			innertable = table->table2;
+			address = rightmostnbits(innertable->depth, h2(key));
+		}
+		
+		// If it kicked the key from the Table 2, need to insert the kicked 
+		// key to the Table 1
+		else if (insert_table == 2) {
+			
+			// Mark the next table that will be visited is table 2
+			insert_table = 1;
+				
+			// Update the temp_table and the hash
+			innertable = table->table1;
+			address = rightmostnbits(innertable->depth, h1(key));
+		}	
+	}
+	
+	// The number of kicked key is equal to the 2 times the table size,
+	// indicates that there is a cycling, so we need to grow the table
+	if (total_kicked_keys == 2*(table->table1->size)) {
+		int64 start = event_start();
+		int oldsize = table->table1->size + table->table2->size;
+		
+		// Make space on the smallest size table to have space to 
+		// insert the key
+		while (innertable->buckets[address]->nkeys == 
+			innertable->bucketsize) {
+			
+			// If the first table has size smaller than or equal to the second
+			// table's size, choose the first table
+			if (table->table1->size <= table->table2->size) {
+				innertable = table->table1;
+				hash = h1(key);
+				address = rightmostnbits(innertable->depth, hash);
+				insert_table = 1;
+			}
+			
+			// Otherwise, choose the second table
+			else {
+				innertable = table->table2;
+				hash = h2(key);
+				address = rightmostnbits(innertable->depth, hash);
+				insert_table = 2;
+			}
+			
+			split_bucket(innertable, address, insert_table);
+			
+			// and recalculate address because we might now need more bits
+			address = rightmostnbits(innertable->depth, hash);
+		}
+		record_event(EVENT_CYCLE, "xuckoon", start, oldsize,
+			table->table1->size + table->table2->size, total_kicked_keys);
+	}
+	
+	// There is now space for the key, so we can just insert it
+	no_keys = innertable->buckets[address]->nkeys;
+	KEY(innertable, innertable->buckets[address], no_keys) = key;
+	if (width > 1) {
+		VALUE(innertable, innertable->buckets[address], no_keys) = value;
+	}
+	innertable->buckets[address]->nkeys++;
+	innertable->total_keys++;
+	histogram_add(&table->stats.kicks, total_kicked_keys);
+	
+	return true;
+	
+}
+
+/********************************* FIND ENTRY ********************************/
+// Helper function to find the entry holding 'key' in either inner table,
+// returning a pointer to it (its value, if any, is the next word), or NULL
+static int64 *find_entry(XuckoonHashTable *table, int64 key) {
+	int64 start = latency_start(&table->stats.lookups);
+	
+	int64 *entry = search_entry(table, key, h1(key), h2(key));
+	
+	latency_stop(&table->stats.lookups, start);
+	
+	return entry;
+}
+
+/******************************** SEARCH ENTRY *******************************/
+// Helper function to search for 'key', whose hash values are 'hash_1' and
+// 'hash_2', in 'table', returning its entry as for find_entry (without timing)
+static int64 *search_entry(XuckoonHashTable *table, int64 key, int hash_1,
+	int hash_2) {
+	
+	// Calculate the address on the first and second table for this key
+	int address_table1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_table2 = rightmostnbits(table->table2->depth, hash_2);
+	
+	// Lookup the key on the first and then the second table
+	int64 *entry = lookup_innertable(table->table1, key, address_table1);
+	if (entry == NULL) {
+		entry = lookup_innertable(table->table2, key, address_table2);
+	}
+	
+	return entry;
+}
+
+/****************************** PREFETCH STAGE *******************************/
+// Helper function to prefetch the memory needed to probe for the key with
+// hash values 'hash_1' and 'hash_2', 'stage' steps ahead of the probe: 3 for
+// the directory entries, 2 for the buckets they point to, and 1 for the keys
+// of those buckets
+static void prefetch_stage(XuckoonHashTable *table, int hash_1, int hash_2,
+	int stage) {
+	int address_table1 = rightmostnbits(table->table1->depth, hash_1);
+	int address_table2 = rightmostnbits(table->table2->depth, hash_2);
+	if (stage == 3) {
+		prefetch(&table->table1->buckets[address_table1]);
+		prefetch(&table->table2->buckets[address_table2]);
+	} else if (stage == 2) {
+		prefetch(table->table1->buckets[address_table1]);
+		prefetch(table->table2->buckets[address_table2]);
+	} else {
+		prefetch(table->table1->buckets[address_table1]->keys);
+		prefetch(table->table2->buckets[address_table2]->keys);
 	}
 }
@@ -13,27 +13,98 @@
 
 #include <stdbool.h>
 #include "../inthash.h"
+#include "scan.h"
+#include "snapshot.h"
+#include "memory.h"
 
 typedef struct xuckoon_table XuckoonHashTable;
 
-// initialise an extendible cuckoo hash table
-XuckoonHashTable *new_xuckoon_hash_table(int bucketsize);
+// initialise an extendible cuckoo hash table with 'bucketsize' keys per
+// bucket, storing a value alongside each key if 'values' is true
+XuckoonHashTable *new_xuckoon_hash_table(int bucketsize, bool values);
+
+// initialise an extendible cuckoo hash table with 'bucketsize' keys per
+// bucket holding the 'n' keys in 'keys'
+XuckoonHashTable *new_xuckoon_hash_table_from_keys(int bucketsize, int64 *keys,
+	int n);
 
 // free all memory associated with 'table'
 void free_xuckoon_hash_table(XuckoonHashTable *table);
 
+// write 'table' to 'file' as a series of snapshot sections
+// returns false if they couldn't all be written
+bool xuckoon_hash_table_save(XuckoonHashTable *table, FILE *file);
+
+// load a table written by xuckoon_hash_table_save from the next sections of
+// 'snapshot', using its buckets in place. the table takes over 'snapshot',
+// unmapping it when the table is freed. returns NULL (leaving 'snapshot'
+// alone) if it was written with a different snapshot layout, or is cut short
+// or corrupted
+XuckoonHashTable *xuckoon_hash_table_load(Snapshot *snapshot);
+
 // insert 'key' into 'table', if it's not in there already
 // returns true if insertion succeeds, false if it was already in there
 bool xuckoon_hash_table_insert(XuckoonHashTable *table, int64 key);
 
+// make room in 'table' for 'n' keys in total, by doubling each inner table
+// and splitting its buckets up front until there is a bucket for every
+// 'bucketsize' keys of each table's half of the keys. keys whose hash values
+// crowd into the same bits will still need more splits
+void xuckoon_hash_table_reserve(XuckoonHashTable *table, int n);
+
+// make 'table' kick the keys out of a full bucket in turn, slot by slot, if
+// 'rotate' is true (rather than at random)
+void xuckoon_hash_table_rotate_kicks(XuckoonHashTable *table, bool rotate);
+
+// call 'func' on every key in 'table' (along with its value, if the table
+// stores values, and 'ctx'), in the order the buckets of the first and then
+// the second table were created
+void xuckoon_hash_table_foreach(XuckoonHashTable *table, ScanFunc func,
+	void *ctx);
+
+// get the key after 'cursor' in 'table' (in the same order as foreach),
+// storing it in *key (and its value in *value, if 'value' isn't NULL), and
+// move 'cursor' past it. returns false if there are no keys left
+bool xuckoon_hash_table_next(XuckoonHashTable *table, Cursor *cursor,
+	int64 *key, int64 *value);
+
 // lookup whether 'key' is inside 'table'
 // returns true if found, false if not
 bool xuckoon_hash_table_lookup(XuckoonHashTable *table, int64 key);
 
+// insert each of the 'n' keys in 'keys' into 'table', if it's not in there
+// already. results[i] is set to true if keys[i] was inserted, false if it was
+// already in there (or was repeated earlier in 'keys')
+void xuckoon_hash_table_insert_batch(XuckoonHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// lookup whether each of the 'n' keys in 'keys' is inside 'table'
+// results[i] is set to true if keys[i] was found, false if not
+void xuckoon_hash_table_lookup_batch(XuckoonHashTable *table, int64 *keys,
+	int n, bool *results);
+
+// associate 'value' with 'key' in 'table', inserting 'key' if it's not in
+// there already and replacing its old value if it is
+// returns true if 'key' was newly inserted, false if it was already in there
+bool xuckoon_hash_table_put(XuckoonHashTable *table, int64 key, int64 value);
+
+// lookup the value associated with 'key' in 'table', storing it in *value
+// returns true if found, false if not (leaving *value untouched)
+bool xuckoon_hash_table_get(XuckoonHashTable *table, int64 key, int64 *value);
+
+// replace the value associated with 'key' in 'table' with 'value'
+// returns true if 'key' was found (and updated), false if not
+bool xuckoon_hash_table_update(XuckoonHashTable *table, int64 key,
+	int64 value);
+
 // print the contents of 'table' to stdout
 void xuckoon_hash_table_print(XuckoonHashTable *table);
 
 // print some statistics about 'table' to stdout
 void xuckoon_hash_table_stats(XuckoonHashTable *table);
 
+// count the bytes 'table' is using into *usage
+void xuckoon_hash_table_memory_usage(XuckoonHashTable *table,
+	MemoryUsage *usage);
+
 #endif
\ No newline at end of file